@@ -0,0 +1,72 @@
+#include "bench.hpp"
+#include "alert_engine.hpp"
+#include "gpu_monitor.hpp"
+#include "synthetic_source.hpp"
+
+namespace {
+
+constexpr long long START_MS = 1700000000000LL;
+
+// Rules in the style of a real config: a handful of metrics and windows,
+// many thresholds, so equal aggregates are shared
+std::string makeRules(size_t count) {
+    const char* values[] = { "temperature", "gpu_util", "power_w / power_limit_w", "mem_used_bytes / mem_total_bytes" };
+    const char* windows[] = { "30s", "1m", "5m" };
+    std::string rules;
+    for (size_t i = 0; i < count; ++i) {
+        rules += "rule" + std::to_string(i) + ": ";
+        if (i % 3 == 2) rules += "avg ";
+        rules += values[i % 4];
+        rules += i % 2 ? " > " : " < ";
+        rules += std::to_string(i % 4 < 2 ? 10 + i % 80 : i % 90) + (i % 4 < 2 ? "" : "%");
+        rules += i % 3 == 2 ? " over " : " for ";
+        rules += windows[(i / 4) % 3];
+        rules += "\n";
+    }
+    return rules;
+}
+
+void runRules(BenchContext& context, size_t ruleCount) {
+    constexpr unsigned int GPUS = 64;
+    SyntheticConfig config;
+    config.deviceCount = GPUS;
+    config.stepMs = GpuMonitor::DEFAULT_INTERVAL_MS;
+    GpuMonitor monitor(std::make_unique<SyntheticSource>(config));
+    monitor.initialize();
+    std::vector<GpuSnapshot> snapshots;
+    for (int i = 0; i < 600; ++i) {
+        monitor.update();
+        GpuSnapshot snapshot;
+        snapshot.metrics = monitor.getSnapshot()->metrics;
+        snapshots.push_back(std::move(snapshot));
+    }
+
+    AlertEngine engine;
+    engine.setLog(nullptr);
+    std::string error;
+    engine.parse(makeRules(ruleCount), error);
+
+    long long time = START_MS;
+    size_t next = 0;
+    const double ns = measureNs([&] {
+        GpuSnapshot& snapshot = snapshots[next++ % snapshots.size()];
+        time += GpuMonitor::DEFAULT_INTERVAL_MS;
+        snapshot.timestampMs = time;
+        engine.evaluate(snapshot);
+    }, 1000);
+    context.report("windows_per_gpu", static_cast<double>(engine.windowCount()), "");
+    context.report("sample_64gpu", ns / 1000.0, "us");
+    context.report("per_gpu", ns / GPUS, "ns");
+    context.report("per_rule_per_gpu", ns / GPUS / ruleCount, "ns");
+    context.report("events", static_cast<double>(engine.eventCount()), "");
+}
+
+}
+
+NVWINTOP_BENCHMARK(alert_rules_10) {
+    runRules(context, 10);
+}
+
+NVWINTOP_BENCHMARK(alert_rules_300) {
+    runRules(context, 300);
+}
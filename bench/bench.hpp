@@ -0,0 +1,91 @@
+#pragma once
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+    std::string name;  // benchmark/result
+    double value;
+    std::string unit;
+};
+
+// Every result reported so far, for bench_main's JSON output
+inline std::vector<BenchResult>& benchResults() {
+    static std::vector<BenchResult> results;
+    return results;
+}
+
+// Minimal benchmark harness for nvwintop_bench. Benchmarks register
+// themselves with NVWINTOP_BENCHMARK and report named results; bench_main
+// runs the ones matching the command-line filter, and exits non-zero if any
+// of them failed a check.
+class BenchContext {
+public:
+    explicit BenchContext(std::string benchmark) : m_benchmark(std::move(benchmark)) {}
+
+    void report(const std::string& name, double value, const char* unit) {
+        printf("%-48s %14.3f %s\n", (m_benchmark + "/" + name).c_str(), value, unit);
+        fflush(stdout);
+        benchResults().push_back({ m_benchmark + "/" + name, value, unit });
+    }
+
+    // Reports a failed check or setup on stderr and marks the benchmark failed
+    void fail(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        fprintf(stderr, "%s: ", m_benchmark.c_str());
+        vfprintf(stderr, format, args);
+        fputc('\n', stderr);
+        va_end(args);
+        m_failed = true;
+    }
+
+    const std::string& benchmark() const { return m_benchmark; }
+    bool failed() const { return m_failed; }
+
+private:
+    std::string m_benchmark;
+    bool m_failed = false;
+};
+
+using BenchFunction = void (*)(BenchContext&);
+
+struct Benchmark {
+    const char* name;
+    BenchFunction function;
+};
+
+inline std::vector<Benchmark>& benchmarks() {
+    static std::vector<Benchmark> registry;
+    return registry;
+}
+
+struct BenchRegistration {
+    BenchRegistration(const char* name, BenchFunction function) {
+        benchmarks().push_back({ name, function });
+    }
+};
+
+#define NVWINTOP_BENCHMARK(name)                                             \
+    static void bench_##name(BenchContext& context);                        \
+    static BenchRegistration registration_##name(#name, &bench_##name);     \
+    static void bench_##name(BenchContext& context)
+
+// Calls fn repeatedly for about durationMs and returns nanoseconds per call
+template <typename F>
+double measureNs(F&& fn, long long durationMs = 500) {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + std::chrono::milliseconds(durationMs);
+    const auto start = Clock::now();
+    unsigned long long calls = 0;
+    auto now = start;
+    do {
+        // Check the clock every few calls so it doesn't dominate cheap operations
+        for (int i = 0; i < 16; ++i) fn();
+        calls += 16;
+        now = Clock::now();
+    } while (now < deadline);
+    return std::chrono::duration<double, std::nano>(now - start).count() / static_cast<double>(calls);
+}
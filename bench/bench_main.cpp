@@ -0,0 +1,91 @@
+#include "bench.hpp"
+#include "instrumentation.hpp"
+#include "time_format.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+void writeJsonString(FILE* out, const std::string& text) {
+    fputc('"', out);
+    for (char c : text) {
+        if (c == '"' || c == '\\') fputc('\\', out);
+        fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+// One object per run, stable enough to diff across releases:
+// {"timestamp": ..., "instrumentation": ..., "results": [{"name", "value", "unit"}, ...]}
+bool writeJson(const char* path, const std::vector<BenchResult>& results) {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+
+    const long long nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    char timestamp[32];
+    formatUtc(nowMs, timestamp, sizeof(timestamp));
+    fprintf(out, "{\n  \"timestamp\": \"%s\",\n  \"instrumentation\": %s,\n  \"results\": [", timestamp,
+            NVWINTOP_INSTRUMENTATION ? "true" : "false");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        fprintf(out, "%s\n    {\"name\": ", i ? "," : "");
+        writeJsonString(out, result.name);
+        // JSON has no NaN or infinity
+        if (std::isfinite(result.value)) {
+            fprintf(out, ", \"value\": %.17g, \"unit\": ", result.value);
+        } else {
+            fprintf(out, ", \"value\": null, \"unit\": ");
+        }
+        writeJsonString(out, result.unit);
+        fputc('}', out);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    return fclose(out) == 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    // --json FILE also writes every result to FILE; other arguments are
+    // substring filters on benchmark names
+    const char* jsonPath = nullptr;
+    std::vector<const char*> filters;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            filters.push_back(argv[i]);
+        }
+    }
+
+    int run = 0;
+    int failed = 0;
+    for (const Benchmark& benchmark : benchmarks()) {
+        bool selected = filters.empty();
+        for (size_t i = 0; i < filters.size() && !selected; ++i) {
+            selected = strstr(benchmark.name, filters[i]) != nullptr;
+        }
+        if (!selected) continue;
+
+        BenchContext context(benchmark.name);
+        benchmark.function(context);
+        ++run;
+        if (context.failed()) ++failed;
+    }
+
+    if (run == 0) {
+        fprintf(stderr, "No benchmarks match the filter\n");
+        return 1;
+    }
+    if (jsonPath && !writeJson(jsonPath, benchResults())) {
+        fprintf(stderr, "Failed to write %s\n", jsonPath);
+        return 1;
+    }
+    if (failed != 0) {
+        fprintf(stderr, "%d of %d benchmarks failed\n", failed, run);
+        return 1;
+    }
+    return 0;
+}
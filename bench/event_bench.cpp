@@ -0,0 +1,99 @@
+#include "bench.hpp"
+#include "gpu_monitor.hpp"
+#include "nvml_source.hpp"
+#include <nvml.h>
+#include <nvml_stub.h>
+#include <thread>
+
+namespace {
+
+// Polls the log until an event matching pred shows up or timeoutMs passes
+template <typename Pred>
+bool waitForEvent(const GpuMonitor& monitor, long long timeoutMs, Pred pred) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (const GpuEvent& event : *monitor.eventLog().events()) {
+            if (pred(event)) return true;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return false;
+}
+
+}
+
+// From nvmlStubInjectEvent() to the event being in the log, through the
+// event thread's blocking wait
+NVWINTOP_BENCHMARK(event_xid_latency) {
+    nvmlStubSetDeviceCount(4);
+    nvmlStubSetEventsSupported(1);
+    nvmlStubSetXidPeriod(0);
+    auto monitor = std::make_unique<GpuMonitor>(std::make_unique<NvmlSource>());
+    if (!monitor->initialize()) {
+        context.fail("NVML stub failed to initialize");
+        return;
+    }
+    monitor->update();
+    const std::string uuid = monitor->getSnapshot()->metrics[2].uuid;
+
+    constexpr int INJECTIONS = 50;
+    size_t missed = 0;
+    double totalUs = 0.0;
+    double maxUs = 0.0;
+    for (int i = 0; i < INJECTIONS; ++i) {
+        // A different XID each time so none merges into the last
+        const unsigned long long xid = 100 + i;
+        const auto start = std::chrono::steady_clock::now();
+        nvmlStubInjectEvent(2, nvmlEventTypeXidCriticalError, xid);
+        const bool seen = waitForEvent(*monitor, 1000, [&](const GpuEvent& event) {
+            return event.type == GpuEventType::Xid && event.data == xid && event.uuid == uuid;
+        });
+        const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        if (!seen) ++missed;
+        totalUs += us;
+        maxUs = std::max(maxUs, us);
+    }
+
+    // Events reach the published snapshot with the next tick
+    monitor->update();
+    size_t published = 0;
+    for (const GpuEvent& event : *monitor->getSnapshot()->events) {
+        if (event.type == GpuEventType::Xid && event.gpuIndex == 2) ++published;
+    }
+
+    const auto stopStart = std::chrono::steady_clock::now();
+    monitor.reset();
+    const double stopMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stopStart).count();
+
+    context.report("missed", static_cast<double>(missed), "");
+    context.report("in_snapshot", static_cast<double>(published), "");
+    context.report("avg_latency", totalUs / INJECTIONS, "us");
+    context.report("max_latency", maxUs, "us");
+    context.report("shutdown", stopMs, "ms");
+}
+
+// The stub's GPUs throttle at their power cap for 0.4 s every 7 s; polling
+// at 1 Hz must still report it, with the time the counters say was lost
+NVWINTOP_BENCHMARK(event_throttle) {
+    nvmlStubSetDeviceCount(2);
+    GpuMonitor monitor(std::make_unique<NvmlSource>());
+    if (!monitor.initialize()) {
+        context.fail("NVML stub failed to initialize");
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    unsigned int throttledMs = 0;
+    for (int tick = 0; tick < 10 && throttledMs == 0; ++tick) {
+        monitor.update();
+        for (const GpuEvent& event : *monitor.getSnapshot()->events) {
+            if (event.type == GpuEventType::Throttle && (event.data & throttle_reason::SW_POWER_CAP)) {
+                throttledMs = std::max(throttledMs, event.durationMs);
+            }
+        }
+        if (throttledMs == 0) std::this_thread::sleep_for(std::chrono::milliseconds(GpuMonitor::DEFAULT_INTERVAL_MS));
+    }
+    context.report("throttled", throttledMs, "ms");
+    context.report("seen_after", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), "s");
+    if (throttledMs == 0) context.fail("no power cap throttling seen");
+}
@@ -0,0 +1,93 @@
+#include "bench.hpp"
+#include "history_workload.hpp"
+#include <cstdio>
+
+namespace {
+
+// Raw history of rawSize samples at 1 s plus GpuMonitor's two rollups, filled
+// past capacity so every push evicts. Times one push on its own, and one
+// push while the previous view is still held, as after every publish.
+void runHistory(BenchContext& context, size_t rawSize, bool compressed) {
+    TieredHistory history(monitorTiers(compressed, rawSize));
+    unsigned int tick = 0;
+    auto pushNext = [&] {
+        history.push(makeHistoryMetrics(tick), HISTORY_START_MS + static_cast<long long>(tick) * 1000);
+        ++tick;
+    };
+    while (tick < rawSize + HistoryTier::BLOCK_SAMPLES) pushNext();
+
+    context.report("push", measureNs(pushNext), "ns");
+
+    MetricsHistory view;
+    context.report("push_viewed", measureNs([&] {
+        pushNext();
+        view = history.view();
+    }), "ns");
+
+    const MetricsHistory full = history.view();
+    context.report("raw_samples", static_cast<double>(full.size()), "");
+    context.report("memory", full.memoryBytes() / 1024.0, "KiB");
+}
+
+const char* const HISTORY_FILE = "nvwintop_bench_history.bin";
+
+// Saving 8 GPUs' full week of history on exit, and loading it into fresh
+// histories on the next start, as the warm start does before the first frame
+void runHistoryFile(BenchContext& context, bool compressed) {
+    constexpr unsigned int DEVICES = 8;
+    const TieredHistory history = historyOf(7 * 24 * 3600, compressed);
+    const MetricsHistory view = history.view();
+
+    context.report("save", measureNs([&] {
+        std::vector<StoredHistory> devices;
+        for (unsigned int i = 0; i < DEVICES; ++i) devices.push_back(storeHistory(view, i));
+        writeHistoryFile(HISTORY_FILE, HISTORY_START_MS, devices);
+    }) / 1e6, "ms");
+
+    context.report("load", measureNs([&] {
+        long long savedAtMs = 0;
+        std::vector<StoredHistory> devices;
+        readHistoryFile(HISTORY_FILE, savedAtMs, devices);
+        for (const StoredHistory& device : devices) {
+            TieredHistory restored(monitorTiers(compressed));
+            restoreHistory(restored, device);
+        }
+    }) / 1e6, "ms");
+
+    FILE* file = fopen(HISTORY_FILE, "rb");
+    long size = 0;
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        size = ftell(file);
+        fclose(file);
+    }
+    std::remove(HISTORY_FILE);
+    context.report("file", size / 1024.0, "KiB");
+    context.report("raw", DEVICES * view.rawBytes() / 1024.0, "KiB");
+}
+
+}
+
+NVWINTOP_BENCHMARK(history_file_8gpu) {
+    runHistoryFile(context, false);
+}
+
+NVWINTOP_BENCHMARK(history_file_8gpu_compressed) {
+    runHistoryFile(context, true);
+}
+
+NVWINTOP_BENCHMARK(history_600) {
+    runHistory(context, GpuMonitor::HISTORY_SIZE, false);
+}
+
+NVWINTOP_BENCHMARK(history_3600) {
+    runHistory(context, 3600, false);
+}
+
+NVWINTOP_BENCHMARK(history_86400) {
+    runHistory(context, 86400, false);
+}
+
+NVWINTOP_BENCHMARK(history_86400_compressed) {
+    runHistory(context, 86400, true);
+}
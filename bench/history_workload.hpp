@@ -0,0 +1,87 @@
+#pragma once
+#include "gpu_monitor.hpp"
+#include "history_store.hpp"
+#include "metrics_history.hpp"
+#include <climits>
+#include <string>
+#include <vector>
+
+// Histories shaped like GpuMonitor's, and their round trip through the
+// history file. Shared by the history benchmarks and tests.
+constexpr long long HISTORY_START_MS = 1700000000000LL;
+
+inline GpuMetrics makeHistoryMetrics(unsigned int i) {
+    GpuMetrics metrics = {};
+    metrics.gpuUtil = (i * 7) % 101;
+    metrics.memUtil = (i * 3) % 101;
+    metrics.temperature = 40 + i % 40;
+    metrics.fanSpeed = 30 + i % 50;
+    metrics.powerUsage = 100.0 + (i % 200);
+    metrics.powerLimit = 300;
+    metrics.coreClock = 1500 + i % 400;
+    metrics.memClock = 9000;
+    metrics.totalMemory = 24ULL << 30;
+    metrics.usedMemory = (static_cast<unsigned long long>(i % 24) + 1) << 30;
+    return metrics;
+}
+
+// GpuMonitor's tiers, with a raw tier of rawSize samples at 1 s
+inline std::vector<TierSpec> monitorTiers(bool compressed, size_t rawSize = GpuMonitor::HISTORY_SIZE) {
+    return { { 1000, rawSize, compressed },
+             { 10000, 2160, compressed },
+             { 60000, 10080, compressed } };
+}
+
+// GpuMonitor's tiers filled with samples at 1 s; a week makes every tier wrap
+inline TieredHistory historyOf(unsigned int seconds, bool compressed) {
+    TieredHistory history(monitorTiers(compressed));
+    for (unsigned int tick = 0; tick < seconds; ++tick) {
+        history.push(makeHistoryMetrics(tick), HISTORY_START_MS + static_cast<long long>(tick) * 1000);
+    }
+    return history;
+}
+
+inline StoredHistory storeHistory(const MetricsHistory& history, unsigned int index) {
+    StoredHistory stored;
+    stored.device = { index, "GPU-bench-" + std::to_string(index), L"Bench GPU", 24ULL << 30, 300 };
+    for (size_t t = 0; t < history.tierCount(); ++t) {
+        const HistoryTier& tier = history.tier(t);
+        StoredTier out;
+        out.resolutionMs = tier.spec().resolutionMs;
+        out.columnCount = tier.columnCount();
+        tier.exportBlocks(out.blocks);
+        stored.tiers.push_back(std::move(out));
+    }
+    return stored;
+}
+
+// Restores the stored tiers matching history's by resolution; false if any did not fit
+inline bool restoreHistory(TieredHistory& history, const StoredHistory& stored) {
+    bool restored = true;
+    for (size_t t = 0; t < history.tierCount(); ++t) {
+        for (const StoredTier& tier : stored.tiers) {
+            if (tier.resolutionMs == history.tierSpec(t).resolutionMs) restored = history.restoreTier(t, tier.blocks) && restored;
+        }
+    }
+    return restored;
+}
+
+// Columns of any tier whose samples differ between the two
+inline size_t countDifferences(const MetricsHistory& a, const MetricsHistory& b) {
+    if (a.tierCount() != b.tierCount()) return 1;
+    size_t differences = 0;
+    std::vector<long long> timesA, timesB;
+    std::vector<float> valuesA, valuesB;
+    for (size_t t = 0; t < a.tierCount(); ++t) {
+        for (size_t c = 0; c < a.tier(t).columnCount(); ++c) {
+            timesA.clear();
+            timesB.clear();
+            valuesA.clear();
+            valuesB.clear();
+            a.tier(t).decode(LLONG_MIN, c, &timesA, valuesA);
+            b.tier(t).decode(LLONG_MIN, c, &timesB, valuesB);
+            if (timesA != timesB || valuesA != valuesB) ++differences;
+        }
+    }
+    return differences;
+}
@@ -0,0 +1,72 @@
+#include "bench.hpp"
+#include "dashboard_layout.hpp"
+#include "display_list.hpp"
+#include "gpu_monitor.hpp"
+#include "graph_scene.hpp"
+#include "synthetic_source.hpp"
+
+namespace {
+
+constexpr float VIEW_WIDTH = 1920.0f;
+constexpr float VIEW_HEIGHT = 1080.0f;
+
+void runViewport(BenchContext& context, unsigned int gpus, LayoutMode mode) {
+    SyntheticConfig config;
+    config.deviceCount = gpus;
+    config.stepMs = GpuMonitor::DEFAULT_INTERVAL_MS;  // Fill history without waiting for it
+    GpuMonitor monitor(std::make_unique<SyntheticSource>(config));
+    monitor.initialize();
+    for (int i = 0; i < 120; ++i) {
+        monitor.update();
+    }
+    const auto snapshot = monitor.getSnapshot();
+
+    GraphScene scene;
+    scene.setMode(mode);
+    scene.resize(VIEW_WIDTH, VIEW_HEIGHT);
+    DisplayList list;
+    GraphScene::FrameStats stats = scene.build(snapshot->metrics, snapshot->history, list);
+    context.report("content_height", scene.contentHeight(gpus), "px");
+
+    context.report("full_frame", measureNs([&] {
+        scene.invalidate();
+        stats = scene.build(snapshot->metrics, snapshot->history, list);
+    }) / 1000.0, "us");
+    context.report("full_frame_primitives", static_cast<double>(stats.primitives), "");
+    context.report("devices_visible", static_cast<double>(stats.devicesVisible), "");
+
+    // Paging back and forth; graphs that come into view get new chrome
+    bool down = false;
+    context.report("scroll_frame", measureNs([&] {
+        down = !down;
+        scene.scrollBy(down ? VIEW_HEIGHT : -VIEW_HEIGHT);
+        stats = scene.build(snapshot->metrics, snapshot->history, list);
+    }) / 1000.0, "us");
+}
+
+}
+
+// Placing 256 GPUs is a handful of arithmetic, whatever the count
+NVWINTOP_BENCHMARK(layout_update) {
+    LayoutParams params;
+    params.width = VIEW_WIDTH;
+    params.height = VIEW_HEIGHT;
+    params.devices = 256;
+    params.graphsPerDevice = 4;
+    DashboardLayout layout;
+    context.report("update_256gpu", measureNs([&] {
+        layout.update(params);
+    }), "ns");
+}
+
+NVWINTOP_BENCHMARK(viewport_16gpu_detail) {
+    runViewport(context, 16, LayoutMode::Detail);
+}
+
+NVWINTOP_BENCHMARK(viewport_256gpu_detail) {
+    runViewport(context, 256, LayoutMode::Detail);
+}
+
+NVWINTOP_BENCHMARK(viewport_256gpu_grid) {
+    runViewport(context, 256, LayoutMode::Grid);
+}
@@ -0,0 +1,39 @@
+#include "bench.hpp"
+#include "polyline_series.hpp"
+
+namespace {
+
+void runPolyline(BenchContext& context, size_t count) {
+    const PolylineSeries series = makePolylineSeries(count);
+    std::vector<PolylineIsa> isas = { PolylineIsa::Scalar };
+    if (detectPolylineIsa() != PolylineIsa::Scalar) isas.push_back(PolylineIsa::Sse2);
+    if (detectPolylineIsa() == PolylineIsa::Avx2) isas.push_back(PolylineIsa::Avx2);
+
+    std::vector<float> xs(count), ys(count);
+    for (PolylineIsa isa : isas) {
+        const std::string prefix = polylineIsaName(isa);
+        const double mapNs = measureNs([&] {
+            PolylineBuilder::map(isa, series.times.data(), series.values.data(), count, series.transform,
+                                 xs.data(), ys.data());
+        });
+        context.report(prefix + "_map", mapNs / static_cast<double>(count), "ns/sample");
+
+        PolylineBuilder builder(isa);
+        size_t points = 0;
+        const double buildNs = measureNs([&] {
+            points = builder.build(series.times.data(), series.values.data(), count, series.transform).size();
+        });
+        context.report(prefix + "_build", buildNs / 1000.0, "us");
+        context.report(prefix + "_points", static_cast<double>(points), "");
+    }
+}
+
+}
+
+NVWINTOP_BENCHMARK(polyline_1200) {
+    runPolyline(context, 1200);
+}
+
+NVWINTOP_BENCHMARK(polyline_100k) {
+    runPolyline(context, 100003);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "polyline_kernel.hpp"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Test data shared by the polyline benchmarks and tests
+struct PolylineSeries {
+    static constexpr float GRAPH_WIDTH = 1000.0f;
+
+    std::vector<long long> times;
+    std::vector<float> values;
+    std::vector<float> highs;  // values plus a spread, for buildSpread()
+    PlotTransform transform;
+};
+
+// Noisy load at 100 ms resolution with spikes, out-of-range values and an
+// occasional NaN, so clamping and tails are exercised
+inline PolylineSeries makePolylineSeries(size_t count) {
+    PolylineSeries series;
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 8.0f);
+    const long long start = 1700000000000LL;
+    for (size_t i = 0; i < count; ++i) {
+        series.times.push_back(start + static_cast<long long>(i) * 100);
+        float value = 50.0f + 40.0f * std::sin(static_cast<float>(i) * 0.001f) + noise(rng);
+        if (i % 997 == 0) value = 250.0f;
+        if (i % 1499 == 0) value = -20.0f;
+        if (i % 4999 == 0) value = std::numeric_limits<float>::quiet_NaN();
+        series.values.push_back(value);
+        series.highs.push_back(value + static_cast<float>(i % 13));
+    }
+    const float spanMs = static_cast<float>(count) * 100.0f;
+    series.transform = { start, 5.0f, PolylineSeries::GRAPH_WIDTH / spanMs, 300.0f, 3.0f, 1.0f, 100.0f };
+    return series;
+}
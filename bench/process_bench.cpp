@@ -0,0 +1,73 @@
+#include "bench.hpp"
+#include "gpu_monitor.hpp"
+#include "process_history.hpp"
+#include "process_workload.hpp"
+#include <algorithm>
+#include <random>
+
+namespace {
+
+constexpr long long START_MS = ProcessWorkload::START_MS;
+constexpr long long TICK_MS = ProcessWorkload::TICK_MS;
+
+// One tick of process accounting with live processes on 8 GPUs, mean
+// lifetime lifetimeMs, against re-sorting everything tracked each tick
+void runChurn(BenchContext& context, size_t live, long long lifetimeMs) {
+    ProcessHistory history;
+    ProcessWorkload workload(live, lifetimeMs, 3);
+    long long nowMs = START_MS;
+    std::vector<ProcessUsage> rows;
+    // Reach steady state, with a full minute of exited processes tracked
+    for (int i = 0; i < 120; ++i) {
+        history.update(workload.tick(nowMs), nowMs);
+        nowMs += TICK_MS;
+    }
+    const unsigned long long evictedBefore = history.evicted();
+    const unsigned long long rescansBefore = history.rescans();
+    int ticks = 0;
+
+    // Ticks are generated ahead so only the accounting is timed, and replayed
+    // in a loop: processes from an earlier pass return as new runs
+    std::vector<std::vector<ProcessInfo>> generated;
+    for (int i = 0; i < 600; ++i) generated.push_back(workload.tick(nowMs + i * TICK_MS));
+    context.report("update", measureNs([&] {
+        history.update(generated[ticks % generated.size()], nowMs);
+        nowMs += TICK_MS;
+        ++ticks;
+    }) / 1000.0, "us");
+    context.report("top10_both", measureNs([&] {
+        history.top(ProcessRanking::PeakMemory, ProcessHistory::DEFAULT_TOP_COUNT, rows);
+        history.top(ProcessRanking::AvgUtil, ProcessHistory::DEFAULT_TOP_COUNT, rows);
+    }) / 1000.0, "us");
+
+    // What the incremental ranking saves: sorting every tracked row each tick
+    std::mt19937 rng(5);
+    std::vector<ProcessUsage> all(history.size());
+    for (ProcessUsage& row : all) {
+        row.peakMemory = static_cast<unsigned long long>(rng() % 8192) << 20;
+        row.avgUtil = static_cast<float>(rng() % 1000) / 10.0f;
+    }
+    context.report("full_sort_both", measureNs([&] {
+        std::vector<ProcessUsage> copy = all;
+        std::sort(copy.begin(), copy.end(), [](const ProcessUsage& a, const ProcessUsage& b) {
+            return a.peakMemory > b.peakMemory;
+        });
+        std::sort(copy.begin(), copy.end(), [](const ProcessUsage& a, const ProcessUsage& b) {
+            return a.avgUtil > b.avgUtil;
+        });
+    }) / 1000.0, "us");
+
+    context.report("tracked", static_cast<double>(history.size()), "");
+    context.report("evicted_per_tick", ticks ? static_cast<double>(history.evicted() - evictedBefore) / ticks : 0.0, "");
+    context.report("rescans_per_tick", ticks ? static_cast<double>(history.rescans() - rescansBefore) / ticks : 0.0, "");
+}
+
+}
+
+NVWINTOP_BENCHMARK(process_churn_500) {
+    runChurn(context, 500, 60 * 1000);
+}
+
+NVWINTOP_BENCHMARK(process_churn_3000) {
+    runChurn(context, 3000, 10 * 1000);
+}
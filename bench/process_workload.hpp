@@ -0,0 +1,69 @@
+#pragma once
+#include "gpu_monitor.hpp"
+#include <random>
+#include <vector>
+
+// GPUs running a changing set of processes: each one that exits is replaced
+// by a new pid, occasionally an old pid with a new start time. Shared by the
+// process benchmarks and tests.
+class ProcessWorkload {
+public:
+    static constexpr long long START_MS = 1700000000000LL;
+    static constexpr long long TICK_MS = 1000;
+
+    ProcessWorkload(size_t live, long long meanLifetimeMs, unsigned int seed)
+        : m_rng(seed)
+        , m_meanLifetimeMs(meanLifetimeMs)
+    {
+        for (size_t i = 0; i < live; ++i) start(START_MS);
+    }
+
+    const std::vector<ProcessInfo>& tick(long long nowMs) {
+        std::uniform_int_distribution<unsigned long long> memoryStep(0, 256ULL << 20);
+        std::uniform_int_distribution<unsigned int> util(0, 100);
+        m_infos.clear();
+        for (size_t i = 0; i < m_live.size();) {
+            if (m_live[i].endMs <= nowMs) {
+                m_live[i] = m_live.back();
+                m_live.pop_back();
+                start(nowMs);
+                continue;
+            }
+            ProcessInfo& info = m_live[i].info;
+            info.memoryUsed = m_live[i].baseMemory + memoryStep(m_rng);
+            info.gpuUtil = util(m_rng) * (info.pid % 3) / 2;
+            m_infos.push_back(info);
+            ++i;
+        }
+        return m_infos;
+    }
+
+private:
+    struct LiveProcess {
+        ProcessInfo info;
+        unsigned long long baseMemory;
+        long long endMs;
+    };
+
+    void start(long long nowMs) {
+        std::exponential_distribution<double> lifetime(1.0 / static_cast<double>(m_meanLifetimeMs));
+        std::uniform_int_distribution<unsigned long long> memoryMiB(64, 8192);
+        LiveProcess process;
+        process.info = {};
+        process.info.gpuIndex = static_cast<unsigned int>(m_nextPid % 8);
+        // Every 16th process reuses a pid, as the OS eventually does
+        process.info.pid = m_nextPid % 16 == 0 ? 1000 + static_cast<unsigned int>(m_nextPid % 64) : m_nextPid;
+        process.info.startTime = nowMs + m_nextPid;
+        process.baseMemory = memoryMiB(m_rng) << 20;
+        process.info.memoryUsed = process.baseMemory;
+        process.endMs = nowMs + TICK_MS + static_cast<long long>(lifetime(m_rng));
+        ++m_nextPid;
+        m_live.push_back(process);
+    }
+
+    std::mt19937 m_rng;
+    long long m_meanLifetimeMs;
+    unsigned int m_nextPid = 100000;
+    std::vector<LiveProcess> m_live;
+    std::vector<ProcessInfo> m_infos;
+};
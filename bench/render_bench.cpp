@@ -0,0 +1,68 @@
+#include "bench.hpp"
+#include "display_list.hpp"
+#include "gpu_monitor.hpp"
+#include "graph_scene.hpp"
+#include "synthetic_source.hpp"
+
+namespace {
+
+void runScene(BenchContext& context, unsigned int gpus) {
+    SyntheticConfig config;
+    config.deviceCount = gpus;
+    config.stepMs = GpuMonitor::DEFAULT_INTERVAL_MS;  // Fill history without waiting for it
+    GpuMonitor monitor(std::make_unique<SyntheticSource>(config));
+    monitor.initialize();
+    for (int i = 0; i < 180; ++i) {
+        monitor.update();
+    }
+    const auto previous = monitor.getSnapshot();
+    monitor.update();
+    const auto latest = monitor.getSnapshot();
+
+    GraphScene scene;
+    scene.resize(1024.0f, 768.0f * gpus);
+    DisplayList list;
+
+    // New layout and chrome, as after a resize
+    GraphScene::FrameStats stats;
+    bool wide = false;
+    context.report("resize_frame", measureNs([&] {
+        wide = !wide;
+        scene.resize(wide ? 1280.0f : 1024.0f, 768.0f * gpus);
+        stats = scene.build(latest->metrics, latest->history, list);
+    }) / 1000.0, "us");
+    scene.resize(1024.0f, 768.0f * gpus);
+
+    // Everything from cached chrome, as after a lost render target
+    context.report("full_frame", measureNs([&] {
+        scene.invalidate();
+        stats = scene.build(latest->metrics, latest->history, list);
+    }) / 1000.0, "us");
+    context.report("full_frame_primitives", static_cast<double>(stats.primitives), "");
+
+    // A new sample arrives every frame
+    bool flip = false;
+    context.report("sample_frame", measureNs([&] {
+        const auto& snapshot = flip ? latest : previous;
+        flip = !flip;
+        stats = scene.build(snapshot->metrics, snapshot->history, list);
+    }) / 1000.0, "us");
+    context.report("sample_frame_primitives", static_cast<double>(stats.primitives), "");
+    context.report("sample_frame_graphs", static_cast<double>(stats.graphsDrawn), "");
+
+    // Repaint with nothing new, e.g. after the window was uncovered
+    context.report("idle_frame", measureNs([&] {
+        stats = scene.build(latest->metrics, latest->history, list);
+    }), "ns");
+    context.report("idle_frame_primitives", static_cast<double>(stats.primitives), "");
+}
+
+}
+
+NVWINTOP_BENCHMARK(scene_1gpu) {
+    runScene(context, 1);
+}
+
+NVWINTOP_BENCHMARK(scene_8gpu) {
+    runScene(context, 8);
+}
@@ -0,0 +1,63 @@
+#include "bench.hpp"
+#include "gpu_monitor.hpp"
+#include "nvml_source.hpp"
+#include <nvml.h>
+#include <nvml_stub.h>
+
+namespace {
+
+// One GpuMonitor::update() against the stub: every NVML call, history and
+// process list for each device, and publishing the snapshot
+void runSampling(BenchContext& context, unsigned int gpus, unsigned int processesPerGpu) {
+    nvmlStubSetDeviceCount(gpus);
+    nvmlStubSetProcessCount(processesPerGpu);
+    nvmlStubSetEventsSupported(0);  // No event thread competing for the workers
+    {
+        GpuMonitor monitor(std::make_unique<NvmlSource>());
+        if (!monitor.initialize()) {
+            context.fail("NVML stub failed to initialize");
+            return;
+        }
+        // Warm the process name cache and the history spares
+        for (int i = 0; i < 3; ++i) monitor.update();
+
+        for (bool parallel : { false, true }) {
+            monitor.setParallelCollection(parallel);
+            const double us = measureNs([&] { monitor.update(); }) / 1000.0;
+            const std::string prefix = parallel ? "parallel" : "serial";
+            context.report(prefix + "_tick", us, "us");
+            context.report(prefix + "_per_gpu", us / gpus, "us");
+        }
+        context.report("processes", static_cast<double>(monitor.getSnapshot()->processes.size()), "");
+    }
+    nvmlStubSetDeviceCount(2);
+    nvmlStubSetProcessCount(3);
+    nvmlStubSetEventsSupported(1);
+}
+
+}
+
+NVWINTOP_BENCHMARK(sampling_1gpu) {
+    runSampling(context, 1, 3);
+}
+
+NVWINTOP_BENCHMARK(sampling_8gpu) {
+    runSampling(context, 8, 3);
+}
+
+NVWINTOP_BENCHMARK(sampling_64gpu) {
+    runSampling(context, 64, 3);
+}
+
+NVWINTOP_BENCHMARK(sampling_256gpu) {
+    runSampling(context, 256, 3);
+}
+
+// Hundreds of processes: compute processes, their utilization and names
+NVWINTOP_BENCHMARK(processes_400) {
+    runSampling(context, 8, 50);
+}
+
+NVWINTOP_BENCHMARK(processes_1600) {
+    runSampling(context, 8, 200);
+}
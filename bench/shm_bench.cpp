@@ -0,0 +1,85 @@
+#include "bench.hpp"
+#include "gpu_monitor.hpp"
+#include "shm_publisher.hpp"
+#include "shm_reader.hpp"
+#include "synthetic_source.hpp"
+#include <atomic>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Synthetic snapshot with a full shared-memory history window
+std::shared_ptr<const GpuSnapshot> makeSnapshot(unsigned int gpus) {
+    SyntheticConfig config;
+    config.deviceCount = gpus;
+    config.stepMs = GpuMonitor::DEFAULT_INTERVAL_MS;  // Fill history without waiting for it
+    GpuMonitor monitor(std::make_unique<SyntheticSource>(config));
+    monitor.initialize();
+    for (unsigned int i = 0; i < ShmPublisher::DEFAULT_HISTORY_CAPACITY; ++i) {
+        monitor.update();
+    }
+    return monitor.getSnapshot();
+}
+
+void runReads(BenchContext& context, unsigned int gpus) {
+    const auto snapshot = makeSnapshot(gpus);
+    const std::string name = "nvwintop_bench_" + std::to_string(getpid());
+
+    ShmPublisher publisher;
+    if (!publisher.open(name)) {
+        context.fail("cannot create shared memory");
+        return;
+    }
+    context.report("publish", measureNs([&] { publisher.onSnapshot(*snapshot); }) / 1000.0, "us");
+
+    ShmReader reader;
+    if (!reader.open(name)) {
+        context.fail("cannot open shared memory");
+        return;
+    }
+
+    ShmSnapshot out;
+    context.report("read_metrics", measureNs([&] { reader.read(out, false); }), "ns");
+    context.report("read_history", measureNs([&] { reader.read(out, true); }) / 1000.0, "us");
+
+    // Same reads while a writer republishes every millisecond, a thousand times the default rate
+    std::atomic<bool> stop(false);
+    std::thread writer([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            publisher.onSnapshot(*snapshot);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    unsigned long long retriesBefore = reader.retries();
+    unsigned long long reads = 0;
+    unsigned long long failed = 0;
+    auto count = [&](bool result) {
+        ++reads;
+        if (!result) ++failed;
+    };
+    context.report("read_metrics_contended", measureNs([&] { count(reader.read(out, false)); }), "ns");
+    context.report("read_history_contended", measureNs([&] { count(reader.read(out, true)); }) / 1000.0, "us");
+    stop = true;
+    writer.join();
+
+    context.report("retries_per_read_contended",
+                   static_cast<double>(reader.retries() - retriesBefore) / static_cast<double>(reads), "");
+    context.report("failed_reads_contended", static_cast<double>(failed), "");
+}
+
+}
+
+NVWINTOP_BENCHMARK(shm_read_8gpu) {
+    runReads(context, 8);
+}
+
+NVWINTOP_BENCHMARK(shm_read_256gpu) {
+    runReads(context, 256);
+}
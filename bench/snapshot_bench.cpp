@@ -0,0 +1,43 @@
+#include "bench.hpp"
+#include "gpu_monitor.hpp"
+#include "snapshot_renderer.hpp"
+#include "synthetic_source.hpp"
+
+namespace {
+
+void runSnapshot(BenchContext& context, unsigned int gpus) {
+    SyntheticConfig config;
+    config.deviceCount = gpus;
+    config.stepMs = GpuMonitor::DEFAULT_INTERVAL_MS;  // Fill history without waiting for it
+    GpuMonitor monitor(std::make_unique<SyntheticSource>(config));
+    monitor.initialize();
+    for (int i = 0; i < 180; ++i) {
+        monitor.update();
+    }
+    const auto snapshot = monitor.getSnapshot();
+
+    SnapshotRenderer renderer;
+    context.report("render", measureNs([&] {
+        renderer.render(*snapshot);
+    }) / 1e6, "ms");
+
+    std::vector<uint8_t> png;
+    context.report("encode", measureNs([&] {
+        renderer.encode(png);
+    }) / 1e6, "ms");
+
+    const RasterCanvas& canvas = renderer.canvas();
+    context.report("pixels", static_cast<double>(canvas.width() * canvas.height()) / 1e6, "M");
+    context.report("png_size", png.size() / 1024.0, "KiB");
+    context.report("primitives", static_cast<double>(renderer.lastFrame().primitives), "");
+}
+
+}
+
+NVWINTOP_BENCHMARK(snapshot_1gpu) {
+    runSnapshot(context, 1);
+}
+
+NVWINTOP_BENCHMARK(snapshot_64gpu) {
+    runSnapshot(context, 64);
+}
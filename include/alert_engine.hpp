@@ -0,0 +1,153 @@
+#pragma once
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "gpu_monitor.hpp"
+
+enum class AlertAggregate {
+    Last,  // Latest sample only
+    Min,
+    Max,
+    Avg
+};
+
+enum class AlertCompare {
+    Greater,
+    GreaterEqual,
+    Less,
+    LessEqual
+};
+
+// One aggregate of a value over the trailing lengthMs, in amortized constant
+// time per sample: min and max keep a monotonic deque whose front is the
+// answer, avg keeps a running sum of the samples in the window.
+class SlidingWindow {
+public:
+    SlidingWindow(AlertAggregate aggregate, long long lengthMs);
+
+    // Drops samples older than timestampMs - lengthMs, then adds value
+    // unless it is NaN. Timestamps must not go backwards.
+    void add(long long timestampMs, double value);
+    // NaN while the window holds no samples
+    double value() const;
+    void clear();
+
+private:
+    struct Entry {
+        long long timestampMs;
+        double value;
+    };
+
+    void evict(long long timestampMs);
+
+    AlertAggregate m_aggregate;
+    long long m_lengthMs;
+    std::deque<Entry> m_entries;  // Min and max: candidates only; avg: every sample
+    double m_sum;
+    size_t m_evicted;             // Since the sum was last recomputed
+    double m_last;
+};
+
+// value (or value / divisor) aggregated over windowMs, compared with threshold
+struct AlertCondition {
+    Metric metric;
+    bool ratio = false;
+    Metric divisor = Metric::GpuUtil;
+    AlertAggregate aggregate = AlertAggregate::Last;
+    long long windowMs = 0;
+    AlertCompare compare = AlertCompare::Greater;
+    double threshold = 0.0;
+    std::string text;   // As written in the rules file
+    size_t window = 0;  // Window shared by equal aggregates, assigned by the engine
+};
+
+// Fires when every condition holds, resolves as soon as one no longer does
+struct AlertRule {
+    std::string name;
+    std::vector<AlertCondition> conditions;
+};
+
+struct AlertEvent {
+    const AlertRule* rule;
+    unsigned int gpuIndex;
+    std::string uuid;
+    bool firing;              // False when resolved
+    long long timestampMs;
+    long long sinceMs;        // When a resolved alert fired
+    std::vector<double> values;  // Aggregate per condition
+};
+
+// Evaluates alert rules against every published snapshot. Rules are read
+// from a text file, one per line:
+//
+//   hot:        temperature > 85 for 30s
+//   at_limit:   power_w / power_limit_w >= 0.98 for 5m
+//   idle_alloc: mem_used_bytes / mem_total_bytes > 95% and max gpu_util < 5 over 2m
+//
+// Values are metric keys (see --list-metrics) in export units, or the ratio
+// of two. "for D" means the comparison held for every sample in the last D,
+// which is a window minimum for > and >=, and a maximum for < and <=; min,
+// max or avg before the value pick the aggregate explicitly. Conditions with
+// a window only hold once the GPU has been sampled for that long. Equal
+// aggregates are computed once per GPU however many rules use them, so a
+// sample costs constant time per distinct window and per condition.
+class AlertEngine : public SnapshotSink {
+public:
+    AlertEngine();
+
+    // Replace the rules; on failure error names the line and the rules are unchanged
+    bool load(const std::string& path, std::string& error);
+    bool parse(const std::string& text, std::string& error);
+
+    // Firing and resolving are written here as they happen (default stderr, nullptr for none)
+    void setLog(FILE* log) { m_log = log; }
+    // Also called for every transition, on the thread that published the snapshot
+    void setListener(std::function<void(const AlertEvent&)> listener) { m_listener = std::move(listener); }
+
+    void evaluate(const GpuSnapshot& snapshot);
+    void onSnapshot(const GpuSnapshot& snapshot) override { evaluate(snapshot); }
+
+    const std::vector<AlertRule>& rules() const { return m_rules; }
+    // Distinct windows kept per GPU
+    size_t windowCount() const { return m_windows.size(); }
+    // Rule and GPU pairs currently firing
+    size_t firingCount() const { return m_firing; }
+    unsigned long long eventCount() const { return m_events; }
+
+private:
+    struct WindowKey {
+        Metric metric;
+        bool ratio;
+        Metric divisor;
+        AlertAggregate aggregate;
+        long long windowMs;
+    };
+
+    struct Device {
+        unsigned int index = 0;
+        long long firstMs = 0;  // Windows only hold once they span this far back
+        long long lastMs = 0;
+        unsigned long long generation = 0;
+        std::vector<SlidingWindow> windows;  // Parallel to m_windows
+        std::vector<double> values;          // Latest aggregate of each window
+        std::vector<char> firing;            // Parallel to m_rules
+        std::vector<long long> sinceMs;
+    };
+
+    Device& device(const GpuMetrics& gpu, long long timestampMs);
+    void report(const AlertRule& rule, const Device& device, const std::string& uuid,
+                bool firing, long long timestampMs);
+    void dropMissingDevices(long long timestampMs);
+
+    std::vector<AlertRule> m_rules;
+    std::vector<WindowKey> m_windows;
+    std::unordered_map<std::string, Device> m_devices;  // By UUID
+    unsigned long long m_generation;
+    size_t m_firing;
+    unsigned long long m_events;
+    FILE* m_log;
+    std::function<void(const AlertEvent&)> m_listener;
+};
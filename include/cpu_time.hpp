@@ -0,0 +1,5 @@
+#pragma once
+#include <chrono>
+
+// CPU time consumed so far by the calling thread
+std::chrono::microseconds threadCpuTime();
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include "display_list.hpp"
+
+enum class LayoutMode {
+    Detail,  // Full graphs for every GPU; scrolls once they would get too small
+    Grid     // One compact cell per GPU with a sparkline, colored by load
+};
+
+struct LayoutParams {
+    LayoutMode mode = LayoutMode::Detail;
+    float width = 0.0f;
+    float height = 0.0f;  // Of the viewport
+    size_t devices = 0;
+    size_t graphsPerDevice = 0;
+    size_t columns = 1;              // Detail panels side by side
+    float minGraphHeight = 100.0f;   // Detail graphs shrink to fit the viewport down to this
+};
+
+// Places GPU panels on a uniform grid in content coordinates, which start at
+// the top of the first panel row and may extend past the viewport. Every rect
+// and the range of panels overlapping a band of content are computed
+// directly, so the cost of drawing depends on what is visible rather than on
+// the number of GPUs.
+class DashboardLayout {
+public:
+    static constexpr float HEADER_HEIGHT = 40.0f;
+    static constexpr float GRID_CELL_WIDTH = 200.0f;  // Smallest cell; cells stretch to fill a row
+    static constexpr float GRID_CELL_HEIGHT = 56.0f;
+
+    DashboardLayout();
+
+    void update(const LayoutParams& params);
+    const LayoutParams& params() const { return m_params; }
+
+    size_t columns() const { return m_columns; }
+    float graphHeight() const { return m_graphHeight; }
+    float contentHeight() const { return m_contentHeight; }
+    float maxScroll() const;
+
+    // Whole panel of a device: header and graphs in detail mode, the cell in grid mode
+    DlRect panelRect(size_t device) const;
+
+    // Detail mode only: the header text box and the graph in each slot
+    DlRect headerRect(size_t device) const;
+    DlRect graphRect(size_t device, size_t slot) const;
+
+    // Half-open range of devices whose panels overlap content rows [top, bottom)
+    std::pair<size_t, size_t> visibleRange(float top, float bottom) const;
+
+private:
+    LayoutParams m_params;
+    size_t m_columns;     // Panels per row
+    size_t m_graphRows;   // Rows of graphs in a detail panel
+    float m_panelWidth;   // Including the gap to the next panel
+    float m_panelHeight;  // Excluding the gap to the next row
+    float m_pitch;        // From one row of panels to the next
+    float m_graphHeight;
+    float m_contentHeight;
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <nvml.h>
+#include <vector>
+#include <string>
+#include "metrics_source.hpp"
+
+// Enumerates NVML devices once and caches their static properties so the
+// sampling hot path only has to query counters that actually change.
+class DeviceRegistry {
+public:
+    // Re-enumerates devices, reusing cached entries whose UUID is unchanged.
+    // Returns true if devices were added, removed or reordered.
+    bool refresh();
+
+    const std::vector<DeviceInfo>& devices() const { return m_devices; }
+    nvmlDevice_t handle(size_t device) const { return m_handles[device]; }
+    size_t size() const { return m_devices.size(); }
+
+private:
+    static DeviceInfo queryDevice(nvmlDevice_t handle, unsigned int index, const std::string& uuid);
+
+    std::vector<DeviceInfo> m_devices;
+    std::vector<nvmlDevice_t> m_handles;  // Parallel to m_devices
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct DlPoint {
+    float x;
+    float y;
+};
+
+struct DlRect {
+    float left;
+    float top;
+    float right;
+    float bottom;
+};
+
+// Fixed palette; backends create one brush per entry
+enum class DlBrush : uint8_t {
+    Window,      // Area between graphs
+    Background,  // Graph background
+    Separator,   // Borders, grid lines and min/max spread
+    Green,
+    Yellow,
+    Red,
+    GreenShade,  // Dark tints of the level colors, behind grid cells
+    YellowShade,
+    RedShade,
+    Count
+};
+
+constexpr size_t DL_BRUSH_COUNT = static_cast<size_t>(DlBrush::Count);
+
+enum class DlFont : uint8_t {
+    Text,
+    Title
+};
+
+enum class DlOp : uint8_t {
+    FillRect,
+    StrokeRect,
+    Lines,      // count points forming count / 2 separate segments
+    Polyline,   // count points joined end to end
+    Text,       // count characters of text starting at first
+    PushClip,
+    PopClip
+};
+
+struct DlCommand {
+    DlOp op;
+    DlBrush brush;
+    DlFont font;
+    float width;     // Stroke width
+    DlRect rect;     // FillRect, StrokeRect, Text layout box and PushClip
+    uint32_t first;  // Offset into points() or text()
+    uint32_t count;
+};
+
+// Platform-neutral list of drawing commands for one frame, replayed by a
+// rendering backend. Adjacent segments with the same brush and width are
+// merged into one command. Storage is kept across clear() so a list that is
+// rebuilt every frame stops allocating.
+class DisplayList {
+public:
+    void clear();
+    bool empty() const { return m_commands.empty(); }
+
+    void fillRect(const DlRect& rect, DlBrush brush);
+    void strokeRect(const DlRect& rect, DlBrush brush, float width);
+    void line(DlPoint from, DlPoint to, DlBrush brush, float width);
+    void polyline(const DlPoint* points, size_t count, DlBrush brush, float width);
+    void text(const wchar_t* text, size_t length, const DlRect& rect, DlFont font, DlBrush brush);
+    void pushClip(const DlRect& rect);
+    void popClip();
+
+    // Appends every command of other
+    void append(const DisplayList& other);
+
+    const std::vector<DlCommand>& commands() const { return m_commands; }
+    const DlPoint* points(const DlCommand& command) const { return m_points.data() + command.first; }
+    const wchar_t* text(const DlCommand& command) const { return m_text.data() + command.first; }
+
+    // Draw calls a backend issues to replay the list, one per segment, rectangle or text
+    size_t primitiveCount() const;
+
+private:
+    DlCommand& add(DlOp op, DlBrush brush, float width);
+
+    std::vector<DlCommand> m_commands;
+    std::vector<DlPoint> m_points;
+    std::vector<wchar_t> m_text;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "metrics_source.hpp"
+
+// Throttle reason bits, with NVML's nvmlClocksThrottleReason* values
+namespace throttle_reason {
+constexpr unsigned long long GPU_IDLE = 0x1;
+constexpr unsigned long long APPLICATIONS_CLOCKS = 0x2;
+constexpr unsigned long long SW_POWER_CAP = 0x4;
+constexpr unsigned long long HW_SLOWDOWN = 0x8;
+constexpr unsigned long long SYNC_BOOST = 0x10;
+constexpr unsigned long long SW_THERMAL = 0x20;
+constexpr unsigned long long HW_THERMAL = 0x40;
+constexpr unsigned long long HW_POWER_BRAKE = 0x80;
+
+// Reasons that mean the GPU wanted to run faster than it was allowed to
+constexpr unsigned long long SLOWDOWN = SW_POWER_CAP | HW_SLOWDOWN | SW_THERMAL | HW_THERMAL | HW_POWER_BRAKE;
+}
+
+// Bounded, time-ordered log of device events. Appends come from the event
+// thread and the sampler; a repeat of a GPU's newest event of a kind (the same
+// XID, or throttling) within MERGE_GAP_MS is folded into it, so a storm or
+// sustained throttling takes one entry. The oldest entries are dropped once
+// the log is full.
+class EventLog {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 512;
+    static constexpr long long MERGE_GAP_MS = 3000;
+
+    explicit EventLog(size_t capacity = DEFAULT_CAPACITY);
+
+    void append(std::vector<GpuEvent>& events);
+
+    // Oldest first. The same vector is returned until something is appended,
+    // so publishing it with every snapshot costs nothing while all is quiet.
+    std::shared_ptr<const std::vector<GpuEvent>> events() const;
+
+    // Events appended so far, merged ones included
+    unsigned long long total() const;
+
+private:
+    void insert(GpuEvent& event);
+
+    mutable std::mutex m_mutex;
+    size_t m_capacity;
+    std::deque<GpuEvent> m_events;
+    mutable std::shared_ptr<const std::vector<GpuEvent>> m_published;  // Null after a change
+    unsigned long long m_sequence;
+    unsigned long long m_total;
+};
+
+const char* eventTypeName(GpuEventType type);
+
+// Comma-separated names of the slowdown reasons in mask, such as "power_cap,hw_thermal"
+std::string throttleReasonNames(unsigned long long mask);
+
+// One line such as "2024-05-01T12:00:00.250Z xid 79 gpu=0 uuid=GPU-..."
+std::string formatEvent(const GpuEvent& event);
@@ -1,13 +1,25 @@
 #pragma once
-#include <nvml.h>
 #include <vector>
-#include <deque>
 #include <string>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include "event_log.hpp"
+#include "metrics_history.hpp"
+#include "metrics_source.hpp"
+#include "process_history.hpp"
+#include "process_names.hpp"
+#include "sampling_scheduler.hpp"
 
 struct GpuMetrics {
     unsigned int index;
+    std::string uuid;
     std::wstring name;
     unsigned int gpuUtil;
     unsigned int memUtil;
@@ -27,26 +39,202 @@ struct ProcessInfo {
     std::wstring name;
     unsigned long long memoryUsed;
     unsigned int gpuUtil;
+    unsigned long long startTime = 0;  // OS creation time, 0 if unknown
+};
+
+// Result of one sampling tick. A snapshot is never modified once it has been
+// published, so readers can hold on to it without any locking.
+struct GpuSnapshot {
+    std::vector<GpuMetrics> metrics;
+    std::vector<MetricsHistory> history;
+    std::vector<ProcessInfo> processes;
+    long long timestampMs = 0;  // Milliseconds since the Unix epoch
+
+    // History loaded from a previous run; nothing has been sampled yet and
+    // metrics hold each device's last saved values
+    bool restored = false;
+
+    // Processes seen over the last hour, exited ones included, ranked by
+    // peak memory and by average utilization
+    std::vector<ProcessUsage> topByMemory;
+    std::vector<ProcessUsage> topByUtil;
+    size_t processesTracked = 0;
+
+    // Recent device events, oldest first, shared between snapshots until a new one arrives
+    std::shared_ptr<const std::vector<GpuEvent>> events;
+
+    // Wall-clock time spent collecting this tick, and whether devices were polled in parallel
+    std::chrono::microseconds sampleDuration{0};
+    bool sampledInParallel = false;
+
+    // Over the last minute of sampling: samples taken per second, and CPU time
+    // spent sampling on all threads
+    double sampleRateHz = 0.0;
+    std::chrono::microseconds cpuTimePerMinute{0};
+};
+
+// Receives every published snapshot on the thread that called update()
+class SnapshotSink {
+public:
+    virtual ~SnapshotSink() = default;
+    virtual void onSnapshot(const GpuSnapshot& snapshot) = 0;
+};
+
+class WorkerPool;
+
+enum class MonitorState {
+    Connecting,  // The source is not up yet
+    Running,
+    Failed       // The source could not be initialized
+};
+
+// Milliseconds from the monitor's construction to each startup step; negative until it happens
+struct StartupTimes {
+    double historyLoadedMs = -1.0;  // Saved history published as the first snapshot
+    double initializedMs = -1.0;    // Source up and devices enumerated
+    double firstSampleMs = -1.0;    // First sampled snapshot published
+    double firstFrameMs = -1.0;     // Reported by the UI through markFirstFrame()
 };
 
 class GpuMonitor {
 public:
-    static constexpr size_t HISTORY_SIZE = 120; // 2 minutes of history at 1s intervals
+    static constexpr size_t HISTORY_SIZE = 600; // 10 minutes of raw history at 1s intervals
+    static constexpr unsigned int DEFAULT_INTERVAL_MS = 1000;
+    static constexpr long long RESCAN_INTERVAL_MS = 10 * 1000; // Device add/remove detection period
+    static constexpr unsigned int EVENT_WAIT_MS = 250; // Longest the event thread takes to notice shutdown
 
-    GpuMonitor();
+    GpuMonitor();  // Samples real GPUs through NVML
+    explicit GpuMonitor(std::unique_ptr<MetricsSource> source);
     ~GpuMonitor();
 
     bool initialize();
-    void update();
-    
-    const std::vector<GpuMetrics>& getCurrentMetrics() const { return m_currentMetrics; }
-    const std::vector<std::deque<GpuMetrics>>& getMetricsHistory() const { return m_metricsHistory; }
-    const std::vector<ProcessInfo>& getProcessInfo() const { return m_processInfo; }
+    // Returns false if the source had no new sample and nothing was published
+    bool update();
+
+    MonitorState state() const { return m_state.load(std::memory_order_acquire); }
+    StartupTimes startupTimes() const;
+    // Called by the UI once its first frame is on screen
+    void markFirstFrame() { markStartup(m_firstFrameUs); }
+
+    // Publishes history saved by saveHistory() as the first snapshot, so
+    // graphs can be drawn before the source is up. Sampling then continues
+    // each device's history. Call before initialize() or startAsync().
+    bool loadHistory(const std::string& path);
+    // Saves the history of the attached devices; call after stop()
+    bool saveHistory(const std::string& path);
+
+    // Sinks are called in the order added. Add them before start().
+    void addSink(std::shared_ptr<SnapshotSink> sink) { m_sinks.push_back(std::move(sink)); }
+
+    // Keep history in compressed blocks: several times less memory for the same
+    // retention, at the cost of decoding on read. Set before initialize().
+    void setCompressedHistory(bool enabled) { m_compressedHistory = enabled; }
+
+    // Poll devices concurrently on a worker pool (default) or one after another
+    void setParallelCollection(bool enabled) { m_parallelCollection = enabled; }
+
+    // Rows published in topByMemory and topByUtil. Set before start().
+    void setTopProcessCount(size_t count) { m_processHistory.setTopCount(count); }
+
+    // Usage buckets of one process from the process history, oldest first;
+    // false once it has been evicted
+    bool processSeries(const ProcessKey& key, std::vector<ProcessBucket>& out);
+
+    // Lets the scheduler choose the delay after every sample instead of using a
+    // fixed interval. Set before start().
+    void setScheduler(std::unique_ptr<SamplingScheduler> scheduler) { m_scheduler = std::move(scheduler); }
+    SamplingScheduler* scheduler() const { return m_scheduler.get(); }
+
+    // Runs update() on a background thread every intervalMs, or as often as the
+    // scheduler says. onSample is called from the sampler thread each time a
+    // new snapshot has been published.
+    bool start(unsigned int intervalMs, std::function<void()> onSample);
+    // As start(), but initializes the source on the sampler thread first so
+    // the caller never waits for the driver. onReady is called from that
+    // thread with the result; sampling only follows a successful one.
+    bool startAsync(unsigned int intervalMs, std::function<void(bool)> onReady, std::function<void()> onSample);
+    void stop();
+
+    std::shared_ptr<const GpuSnapshot> getSnapshot() const { return std::atomic_load(&m_snapshot); }
+
+    // Events from the driver's event thread and from polling, also published with every snapshot
+    const EventLog& eventLog() const { return m_eventLog; }
 
 private:
+    // Per-device result of one tick, filled independently by each worker
+    struct DeviceSample {
+        bool valid = false;
+        bool lost = false;
+        GpuMetrics metrics = {};
+        std::vector<ProcessInfo> processes;
+        std::vector<SubSample> subSamples;
+        std::vector<GpuEvent> events;
+    };
+
+    void collectDevice(size_t device, DeviceSample& sample);
+    void onDevicesChanged();
+    void samplerLoop(unsigned int intervalMs, std::function<void()> onSample);
+    void markStartup(std::atomic<long long>& step);
+    void eventLoop();
+    void stopEvents();
+    std::shared_ptr<const GpuSnapshot> publish(bool restored);
+
+    std::unique_ptr<MetricsSource> m_source;
+
+    // Working state, only touched by update() under m_mutex
     std::vector<GpuMetrics> m_currentMetrics;
-    std::vector<std::deque<GpuMetrics>> m_metricsHistory;
     std::vector<ProcessInfo> m_processInfo;
+    std::vector<DeviceSample> m_deviceSamples;
     std::mutex m_mutex;
     bool m_initialized;
+    std::atomic<MonitorState> m_state;
+
+    // Microseconds since m_createdAt, -1 until reached
+    std::chrono::steady_clock::time_point m_createdAt;
+    std::atomic<long long> m_historyLoadedUs;
+    std::atomic<long long> m_initializedUs;
+    std::atomic<long long> m_firstSampleUs;
+    std::atomic<long long> m_firstFrameUs;
+
+    std::unordered_map<std::string, TieredHistory> m_historyByUuid;
+    std::vector<TieredHistory*> m_activeHistory;   // In registry device order
+    std::vector<TieredHistory*> m_currentHistory;  // Parallel to m_currentMetrics
+    ProcessNameCache m_processNames;
+    ProcessHistory m_processHistory;
+    std::vector<ProcessUsage> m_topByMemory;
+    std::vector<ProcessUsage> m_topByUtil;
+    bool m_compressedHistory;
+    bool m_rescanRequested;
+    std::chrono::steady_clock::time_point m_lastRescan;
+
+    // Sampling cost over the last minute
+    struct TickCost {
+        std::chrono::steady_clock::time_point time;
+        std::chrono::microseconds cpuTime;
+    };
+    std::deque<TickCost> m_recentTicks;
+    std::chrono::microseconds m_recentCpuTime{0};
+    double m_sampleRateHz = 0.0;
+
+    std::unique_ptr<WorkerPool> m_workerPool;
+    std::atomic<bool> m_parallelCollection;
+    long long m_lastTimestampMs = 0;
+    std::chrono::microseconds m_lastSampleDuration{0};
+    bool m_lastSampleParallel = false;
+
+    // Latest published snapshot, swapped atomically
+    std::shared_ptr<const GpuSnapshot> m_snapshot;
+    std::vector<std::shared_ptr<SnapshotSink>> m_sinks;
+    std::unique_ptr<SamplingScheduler> m_scheduler;
+
+    // Blocks in the source's event wait so events cost nothing until they happen
+    EventLog m_eventLog;
+    std::vector<GpuEvent> m_tickEvents;
+    std::thread m_eventThread;
+    std::atomic<bool> m_eventsStopRequested;
+
+    std::thread m_samplerThread;
+    std::mutex m_samplerMutex;
+    std::condition_variable m_samplerCv;
+    bool m_stopRequested;
 };
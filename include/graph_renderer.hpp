@@ -4,33 +4,59 @@
 #include <memory>
 #include <vector>
 #include "gpu_monitor.hpp"
+#include "graph_scene.hpp"
 
+// Direct2D backend for GraphScene. The render target keeps its contents
+// between frames, so a frame only replays what the scene says has changed.
 class GraphRenderer {
 public:
+    static constexpr long long DEFAULT_TIME_WINDOW_MS = GraphScene::DEFAULT_TIME_WINDOW_MS;
+
     GraphRenderer();
     ~GraphRenderer();
 
     bool initialize(HWND hwnd);
     void render(const std::vector<GpuMetrics>& currentMetrics,
-               const std::vector<std::deque<GpuMetrics>>& history);
+               const std::vector<MetricsHistory>& history);
     void resize();
+    bool isOccluded() const;  // True while the window is completely covered
+
+    // Span of time shown by every graph; selects which history tier is drawn
+    void setTimeWindow(long long windowMs) { m_scene.setTimeWindow(windowMs); }
+    long long timeWindow() const { return m_scene.timeWindow(); }
+
+    // Metrics graphed for each GPU
+    void setGraphs(std::vector<Metric> metrics) { m_scene.setGraphs(std::move(metrics)); }
+
+    // Sampler and render latencies over the graphs; empty hides them
+    void setOverlay(std::vector<ProbeSummary> rows) { m_scene.setOverlay(std::move(rows)); }
+
+    // Connecting state and startup times along the bottom; empty hides them
+    void setStatus(std::wstring text) { m_scene.setStatus(std::move(text)); }
+
+    // XIDs, ECC errors and throttling marked on the graphs
+    void setEvents(std::shared_ptr<const std::vector<GpuEvent>> events) { m_scene.setEvents(std::move(events)); }
+
+    // Full graphs or the compact grid; either scrolls when it doesn't fit
+    void setMode(LayoutMode mode) { m_scene.setMode(mode); }
+    LayoutMode mode() const { return m_scene.mode(); }
+    void scrollBy(float delta) { m_scene.scrollBy(delta); }
+    void setScroll(float scroll) { m_scene.setScroll(scroll); }
+
+    const GraphScene::FrameStats& lastFrame() const { return m_scene.lastFrame(); }
 
 private:
     void createDeviceResources();
-    void drawGraph(const D2D1_RECT_F& rect, const std::deque<GpuMetrics>& history,
-                  const wchar_t* title, float currentValue, const wchar_t* units);
-    
+    void discardDeviceResources();
+    void replay(const DisplayList& list);
+
     HWND m_hwnd;
     ID2D1Factory* m_pD2DFactory;
     ID2D1HwndRenderTarget* m_pRenderTarget;
-    ID2D1SolidColorBrush* m_pBrushText;
-    ID2D1SolidColorBrush* m_pBrushGraph;
-    ID2D1SolidColorBrush* m_pBrushBackground;
-    ID2D1SolidColorBrush* m_pBrushRed;
-    ID2D1SolidColorBrush* m_pBrushYellow;
-    ID2D1SolidColorBrush* m_pBrushSeparator;
-    ID2D1SolidColorBrush* m_pBrushNvidiaGreen;
+    ID2D1SolidColorBrush* m_brushes[DL_BRUSH_COUNT];
     IDWriteFactory* m_pDWriteFactory;
     IDWriteTextFormat* m_pTextFormat;
     IDWriteTextFormat* m_pTitleFormat;
+    GraphScene m_scene;
+    DisplayList m_displayList;  // Reused every frame
 };
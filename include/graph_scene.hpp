@@ -0,0 +1,145 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "dashboard_layout.hpp"
+#include "display_list.hpp"
+#include "gpu_monitor.hpp"
+#include "instrumentation.hpp"
+#include "metric_registry.hpp"
+#include "polyline_kernel.hpp"
+
+// Lays out the per-GPU graphs and turns snapshots into display lists. Static
+// chrome (borders, grids and scale labels) is built once and reused until the
+// graph moves or its scale changes. After a full repaint, a frame only
+// contains the graphs whose data changed, each clipped to its own area, so
+// the backend must keep the previous frame's pixels. Only GPUs inside the
+// viewport are drawn, so frames cost the same on 8 GPUs as on 256.
+// Has no platform dependencies.
+class GraphScene {
+public:
+    static constexpr long long DEFAULT_TIME_WINDOW_MS = 2 * 60 * 1000;
+
+    struct FrameStats {
+        bool fullRepaint = false;
+        size_t devicesVisible = 0;
+        size_t graphsDrawn = 0;
+        size_t commands = 0;
+        size_t primitives = 0;  // Draw calls needed to replay the frame
+    };
+
+    GraphScene();
+
+    void resize(float width, float height);
+
+    // Span of time shown by every graph; selects which history tier is drawn
+    void setTimeWindow(long long windowMs);
+    long long timeWindow() const { return m_timeWindowMs; }
+
+    // Metrics graphed for each GPU, two per row; grid cells show the first
+    void setGraphs(std::vector<Metric> metrics);
+    const std::vector<Metric>& graphs() const { return m_graphMetrics; }
+
+    void setMode(LayoutMode mode);
+    LayoutMode mode() const { return m_mode; }
+
+    // GPU panels side by side in detail mode; the window shows one, large dashboards tile several
+    void setColumns(size_t columns);
+    size_t columns() const { return m_columns; }
+
+    // Detail graphs shrink to share the viewport down to this height, then the view scrolls
+    void setMinGraphHeight(float height);
+
+    // Offset of the viewport into the content, clamped once the layout is known
+    void scrollBy(float delta) { setScroll(m_scroll + delta); }
+    void setScroll(float scroll);
+    float scroll() const { return m_scroll; }
+
+    // Height of the whole dashboard for devices GPUs at the current settings
+    float contentHeight(size_t devices) const;
+
+    // Device events to mark on the graphs: XIDs and ECC errors as red lines,
+    // throttling as a yellow band along the top. Cheap to call every frame
+    // with the snapshot's list; graphs are only redrawn when it changes.
+    void setEvents(std::shared_ptr<const std::vector<GpuEvent>> events);
+
+    // Latency table drawn over the top right corner of the view; empty hides it.
+    // Redrawn after anything beneath it, so it costs one table per frame.
+    void setOverlay(std::vector<ProbeSummary> rows);
+
+    // One line of status, such as connecting or startup times, drawn over the
+    // bottom left corner of the view; empty hides it
+    void setStatus(std::wstring text);
+
+    // Makes the next frame repaint everything, e.g. after the backend lost its pixels
+    void invalidate() { m_fullRepaint = true; }
+
+    // Replaces out with the commands that bring the previous frame up to date
+    const FrameStats& build(const std::vector<GpuMetrics>& metrics,
+                            const std::vector<MetricsHistory>& history,
+                            DisplayList& out);
+    const FrameStats& lastFrame() const { return m_stats; }
+
+private:
+    struct Graph {
+        const MetricDescriptor* descriptor;
+        DlRect rect = {};  // In window coordinates, set when the graph is first drawn in place
+
+        // Background, border, grid and scale labels, valid for scaleMax (in display units)
+        DisplayList chrome;
+        float scaleMax = -1.0f;
+
+        // What the graph showed last frame
+        long long latestMs = -1;
+        size_t samples = 0;
+        long long resolutionMs = 0;
+        float value = -1.0f;
+        wchar_t valueText[16] = {};
+    };
+
+    LayoutParams layoutParams(size_t devices) const;
+    bool devicesChanged(const std::vector<GpuMetrics>& metrics) const;
+    void layout(const std::vector<GpuMetrics>& metrics);
+    void place(Graph& graph, const DlRect& rect);
+    bool graphChanged(const Graph& graph, const MetricsHistory& history, float value) const;
+    HistoryWindow readWindow(Graph& graph, const MetricsHistory& history);
+    void formatValue(Graph& graph, float value);
+    void buildChrome(Graph& graph);
+    void bucketEvents(const std::vector<GpuMetrics>& metrics);
+    void drawMarkers(size_t device, const DlRect& plot, long long windowStart, float bandHeight, DisplayList& out);
+    void drawOverlay(DisplayList& out);
+    void drawStatus(DisplayList& out);
+    void drawHeader(const GpuMetrics& metrics, const DlRect& rect, DisplayList& out);
+    void drawGraph(Graph& graph, size_t device, const MetricsHistory& history, float value, DisplayList& out);
+    void drawCell(Graph& graph, size_t device, const GpuMetrics& metrics, const MetricsHistory& history, float value,
+                  DisplayList& out);
+
+    float m_width;
+    float m_height;
+    long long m_timeWindowMs;
+    LayoutMode m_mode;
+    size_t m_columns;
+    float m_minGraphHeight;
+    float m_scroll;
+    bool m_fullRepaint;
+
+    std::vector<std::pair<unsigned int, std::wstring>> m_devices;  // Index and name the layout was built for
+    std::vector<Metric> m_graphMetrics;
+    DashboardLayout m_layout;
+    std::vector<Graph> m_graphs;  // Per device: every graph in detail mode, one cell in grid mode
+
+    std::shared_ptr<const std::vector<GpuEvent>> m_events;
+    std::vector<std::vector<const GpuEvent*>> m_deviceEvents;  // Per device, in m_events order
+    bool m_eventsChanged;
+
+    std::vector<ProbeSummary> m_overlay;
+    bool m_overlayChanged;
+
+    std::wstring m_status;
+    bool m_statusChanged;
+
+    HistoryReader m_historyReader;  // Decode buffers for compressed history
+    PolylineBuilder m_polyline;
+    FrameStats m_stats;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Sealed, immutable run of history samples. Timestamps are stored as
+// delta-of-deltas and every value column as XOR-ed floats (the Gorilla
+// scheme), each in its own bit stream so a column decodes without touching
+// the others. Regular timestamps and values that hold steady cost one bit per
+// sample.
+struct CompressedBlock {
+    long long firstTimestampMs = 0;
+    long long lastTimestampMs = 0;
+    size_t count = 0;
+    std::vector<uint32_t> offsets;  // Stream starts in data: timestamps, then each column, then the end
+    std::vector<uint8_t> data;
+
+    size_t columnCount() const { return offsets.empty() ? 0 : offsets.size() - 2; }
+    size_t memoryBytes() const;
+};
+
+// values holds columnCount columns of count floats each, columnStride apart
+std::shared_ptr<const CompressedBlock> compressBlock(const long long* timestamps, const float* values,
+                                                     size_t columnStride, size_t columnCount, size_t count);
+
+// Each fills block.count entries
+void decompressTimestamps(const CompressedBlock& block, long long* out);
+void decompressColumn(const CompressedBlock& block, size_t column, float* out);
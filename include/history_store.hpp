@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "history_codec.hpp"
+#include "metrics_source.hpp"
+
+// History saved on a clean shutdown, so the next start can show graphs
+// before the first sample. Integers are little-endian.
+//
+//   HistoryFileHeader
+//   payload of varints:
+//     devices  count, then per device: index, uuid, name, total memory, power limit, tier count
+//     tiers    per tier: resolution, column count, block count
+//     blocks   per block: sample count, first and last timestamp (zigzag), the column count + 2
+//              stream offsets, then the streams' bytes
+//
+// Blocks are the history's own CompressedBlocks, so a compressed history is
+// saved by copying bytes and loaded by adopting whole blocks.
+
+constexpr uint32_t HISTORY_FILE_MAGIC = 0x4857564e;  // "NVWH"
+constexpr uint32_t HISTORY_FILE_VERSION = 1;
+
+struct HistoryFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t savedAtMs;
+};
+
+static_assert(sizeof(HistoryFileHeader) == 16, "unexpected padding");
+
+struct StoredTier {
+    long long resolutionMs = 0;
+    size_t columnCount = 0;
+    std::vector<std::shared_ptr<const CompressedBlock>> blocks;  // Oldest first
+};
+
+// One device's tiers, finest first
+struct StoredHistory {
+    DeviceInfo device;
+    std::vector<StoredTier> tiers;
+};
+
+// Writes a temporary file next to path and renames it over path, so a
+// failed save leaves the previous file intact
+bool writeHistoryFile(const std::string& path, long long savedAtMs, const std::vector<StoredHistory>& devices);
+
+// Reads the file through a read-only mapping. False if it is missing,
+// damaged or from another version.
+bool readHistoryFile(const std::string& path, long long& savedAtMs, std::vector<StoredHistory>& devices);
@@ -0,0 +1,172 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+// Set by CMake (NVWINTOP_INSTRUMENTATION); 0 compiles every probe out
+#ifndef NVWINTOP_INSTRUMENTATION
+#define NVWINTOP_INSTRUMENTATION 1
+#endif
+
+// Log-linear histogram of durations in fixed memory, in the style of
+// HdrHistogram: 16 linear sub-buckets per power of two, so any percentile is
+// within 1/16 of the true value across 40 bits of range. Units are up to the
+// caller (probes record clock ticks). Recording is one relaxed atomic add,
+// plus a compare-exchange on the rare new maximum, and is safe from any thread.
+class LatencyHistogram {
+public:
+    static constexpr unsigned int SUB_BUCKET_BITS = 4;
+    static constexpr unsigned int SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr unsigned int MAX_BITS = 40;  // Longer durations land in the top bucket
+    static constexpr size_t BUCKET_COUNT = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void record(unsigned long long value) {
+        m_buckets[bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+        unsigned long long max = m_max.load(std::memory_order_relaxed);
+        while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+    }
+
+    // Middle of the bucket holding the q-th quantile (0 to 1), capped at the maximum; 0 when empty
+    double percentile(double q) const;
+    // Sums the buckets, so meant for reporting rather than hot paths
+    unsigned long long count() const;
+    unsigned long long max() const { return m_max.load(std::memory_order_relaxed); }
+    void reset();
+
+    static size_t bucketFor(unsigned long long value);
+    static unsigned long long bucketLow(size_t bucket);
+    static unsigned long long bucketWidth(size_t bucket);
+
+private:
+    std::atomic<unsigned long long> m_buckets[BUCKET_COUNT];
+    std::atomic<unsigned long long> m_max;
+};
+
+inline size_t LatencyHistogram::bucketFor(unsigned long long value) {
+    if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    const unsigned int bits = static_cast<unsigned int>(index);
+#else
+    const unsigned int bits = 63u - static_cast<unsigned int>(__builtin_clzll(value));
+#endif
+    if (bits >= MAX_BITS) return BUCKET_COUNT - 1;
+    const unsigned int shift = bits - SUB_BUCKET_BITS;
+    return (bits - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+// Clock probes read: the TSC on x86-64, a few cycles and no system call,
+// and steady_clock nanoseconds elsewhere
+inline unsigned long long probeTicks() {
+#if defined(_M_X64) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Measured against steady_clock over the life of the process
+double probeNsPerTick();
+
+// Everything the sampler and renderers time: each NVML and OS call made
+// while sampling, and the stages around them
+enum class Probe : size_t {
+    NvmlGetCount,
+    NvmlGetHandleByIndex,
+    NvmlGetUuid,
+    NvmlGetName,
+    NvmlGetEnforcedPowerLimit,
+    NvmlGetSamples,
+    NvmlGetFieldValues,
+    NvmlGetUtilizationRates,
+    NvmlGetTemperature,
+    NvmlGetFanSpeed,
+    NvmlGetPowerUsage,
+    NvmlGetClockInfo,
+    NvmlGetMemoryInfo,
+    NvmlGetComputeProcesses,
+    NvmlGetGraphicsProcesses,
+    NvmlGetProcessUtilization,
+    NvmlGetThrottleReasons,
+    NvmlGetViolationStatus,
+    ProcessStartTime,  // OS query that tells a reused pid apart
+    ProcessName,
+    ThreadCpuTime,
+    SampleDevice,      // Everything collected for one GPU
+    SampleTick,        // GpuMonitor::update()
+    Publish,           // Snapshot handed to every sink
+    SceneBuild,        // Display list for one frame
+    RenderFrame,       // Scene build plus replay onto the window or image
+    Count
+};
+
+constexpr size_t PROBE_COUNT = static_cast<size_t>(Probe::Count);
+
+const char* probeName(Probe probe);
+// Histogram of probeTicks() every probe records into; always present, unused when instrumentation is off
+LatencyHistogram& probeHistogram(Probe probe);
+void resetProbes();
+
+struct ProbeSummary {
+    Probe probe;
+    unsigned long long count;
+    double p50Ns;
+    double p99Ns;
+    double maxNs;
+};
+
+// Probes that recorded anything, in Probe order; empty when compiled out
+std::vector<ProbeSummary> summarizeProbes();
+
+// Short human-readable duration such as "850ns", "12.3us" or "4.10ms"
+std::string formatDuration(double ns);
+
+// Times a scope into a probe's histogram
+class ProbeTimer {
+public:
+    explicit ProbeTimer(Probe probe)
+        : m_histogram(probeHistogram(probe))
+        , m_start(probeTicks())
+    {}
+
+    ~ProbeTimer() { m_histogram.record(probeTicks() - m_start); }
+
+    ProbeTimer(const ProbeTimer&) = delete;
+    ProbeTimer& operator=(const ProbeTimer&) = delete;
+
+private:
+    LatencyHistogram& m_histogram;
+    unsigned long long m_start;
+};
+
+template <typename F>
+auto timedCall(Probe probe, F&& call) {
+    ProbeTimer timer(probe);
+    return call();
+}
+
+#define NVWINTOP_CONCAT_INNER(a, b) a##b
+#define NVWINTOP_CONCAT(a, b) NVWINTOP_CONCAT_INNER(a, b)
+
+// NVWINTOP_TIMED(probe, call) evaluates call and times it;
+// NVWINTOP_PROBE(probe) times the rest of the enclosing scope.
+// Both reduce to the bare call, or to nothing, when compiled out; the probe
+// is still evaluated so a probe passed in as a parameter counts as used.
+#if NVWINTOP_INSTRUMENTATION
+#define NVWINTOP_TIMED(probe, call) timedCall(probe, [&]() { return call; })
+#define NVWINTOP_PROBE(probe) ProbeTimer NVWINTOP_CONCAT(probeTimer_, __LINE__)(probe)
+#else
+#define NVWINTOP_TIMED(probe, call) ((void)(probe), (call))
+#define NVWINTOP_PROBE(probe) ((void)(probe))
+#endif
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "gpu_monitor.hpp"
+
+// How a graph picks the top of its vertical axis
+enum class MetricScale {
+    Fixed,  // Always scaleMax
+    Auto    // Visible peak plus 20% headroom, at least scaleMax
+};
+
+// Everything the renderer, exporters and CLI need to know about one metric.
+// Values are converted to display units by multiplying with displayScale and
+// to OpenMetrics base units by multiplying with exportScale.
+struct MetricDescriptor {
+    Metric metric;
+    double (*value)(const GpuMetrics& metrics);
+
+    const char* key;            // CSV column, JSON key and CLI name
+    const char* exportName;     // OpenMetrics family
+    const char* exportUnit;
+    const char* help;
+    double exportScale;
+    int textDecimals;           // Decimals in CSV, JSON and OpenMetrics output
+
+    const wchar_t* title;
+    const wchar_t* unitSuffix;  // Appended to the current value
+    double displayScale;
+    int displayDecimals;
+    MetricScale scale;
+    float scaleMax;             // In display units
+    float warnPercent;          // Yellow above this share of the scale
+    float criticalPercent;      // Red above this share of the scale
+};
+
+namespace metric_detail {
+
+template <auto Field>
+double field(const GpuMetrics& metrics) {
+    return static_cast<double>(metrics.*Field);
+}
+
+constexpr float NEVER = 1000.0f;  // Threshold for metrics where high values are not a problem
+constexpr double GIB = 1.0 / (1024.0 * 1024.0 * 1024.0);
+
+}
+
+// One entry per Metric, in enum order
+constexpr MetricDescriptor METRIC_DESCRIPTORS[METRIC_COUNT] = {
+    { Metric::GpuUtil, &metric_detail::field<&GpuMetrics::gpuUtil>,
+      "gpu_util", "nvwintop_gpu_utilization_percent", "percent", "GPU core utilization", 1.0, 0,
+      L"GPU Utilization", L"%", 1.0, 1, MetricScale::Fixed, 100.0f, 60.0f, 80.0f },
+    { Metric::MemUtil, &metric_detail::field<&GpuMetrics::memUtil>,
+      "mem_util", "nvwintop_gpu_memory_utilization_percent", "percent", "Memory controller utilization", 1.0, 0,
+      L"Memory Utilization", L"%", 1.0, 1, MetricScale::Fixed, 100.0f, 60.0f, 80.0f },
+    { Metric::Temperature, &metric_detail::field<&GpuMetrics::temperature>,
+      "temperature", "nvwintop_gpu_temperature_celsius", "celsius", "GPU core temperature", 1.0, 0,
+      L"Temperature", L"\u2103", 1.0, 0, MetricScale::Fixed, 100.0f, 60.0f, 80.0f },
+    { Metric::FanSpeed, &metric_detail::field<&GpuMetrics::fanSpeed>,
+      "fan_speed", "nvwintop_gpu_fan_speed_percent", "percent", "Fan speed as a percentage of maximum", 1.0, 0,
+      L"Fan Speed", L"%", 1.0, 0, MetricScale::Fixed, 100.0f, 60.0f, 80.0f },
+    { Metric::PowerUsage, &metric_detail::field<&GpuMetrics::powerUsage>,
+      "power_w", "nvwintop_gpu_power_usage_watts", "watts", "Board power draw", 1.0, 3,
+      L"Power Usage", L"W", 1.0, 0, MetricScale::Auto, 50.0f, 60.0f, 80.0f },
+    { Metric::PowerLimit, &metric_detail::field<&GpuMetrics::powerLimit>,
+      "power_limit_w", "nvwintop_gpu_power_limit_watts", "watts", "Enforced power limit", 1.0, 0,
+      L"Power Limit", L"W", 1.0, 0, MetricScale::Auto, 50.0f, metric_detail::NEVER, metric_detail::NEVER },
+    { Metric::CoreClock, &metric_detail::field<&GpuMetrics::coreClock>,
+      "core_clock_mhz", "nvwintop_gpu_core_clock_hertz", "hertz", "Graphics clock", 1e6, 0,
+      L"Core Clock", L" MHz", 1.0, 0, MetricScale::Auto, 500.0f, metric_detail::NEVER, metric_detail::NEVER },
+    { Metric::MemClock, &metric_detail::field<&GpuMetrics::memClock>,
+      "mem_clock_mhz", "nvwintop_gpu_memory_clock_hertz", "hertz", "Memory clock", 1e6, 0,
+      L"Memory Clock", L" MHz", 1.0, 0, MetricScale::Auto, 500.0f, metric_detail::NEVER, metric_detail::NEVER },
+    { Metric::TotalMemory, &metric_detail::field<&GpuMetrics::totalMemory>,
+      "mem_total_bytes", "nvwintop_gpu_memory_total_bytes", "bytes", "Total device memory", 1.0, 0,
+      L"Total Memory", L" GiB", metric_detail::GIB, 1, MetricScale::Auto, 1.0f, metric_detail::NEVER, metric_detail::NEVER },
+    { Metric::UsedMemory, &metric_detail::field<&GpuMetrics::usedMemory>,
+      "mem_used_bytes", "nvwintop_gpu_memory_used_bytes", "bytes", "Used device memory", 1.0, 0,
+      L"Used Memory", L" GiB", metric_detail::GIB, 1, MetricScale::Auto, 1.0f, metric_detail::NEVER, metric_detail::NEVER },
+};
+
+namespace metric_detail {
+
+constexpr bool inEnumOrder() {
+    for (size_t i = 0; i < METRIC_COUNT; ++i) {
+        if (static_cast<size_t>(METRIC_DESCRIPTORS[i].metric) != i) return false;
+    }
+    return true;
+}
+
+static_assert(inEnumOrder(), "METRIC_DESCRIPTORS must list every Metric in enum order");
+
+}
+
+constexpr const MetricDescriptor& describe(Metric metric) {
+    return METRIC_DESCRIPTORS[static_cast<size_t>(metric)];
+}
+
+// Graphs shown for each GPU unless configured otherwise
+constexpr Metric DEFAULT_GRAPHS[] = { Metric::GpuUtil, Metric::MemUtil, Metric::Temperature, Metric::PowerUsage };
+
+// Looks a metric up by key; returns false if there is none
+bool findMetric(const std::string& key, Metric& metric);
+
+// Parses a comma-separated list of keys. Returns false and leaves out
+// untouched if any key is unknown or the list is empty.
+bool parseMetricList(const std::string& list, std::vector<Metric>& out);
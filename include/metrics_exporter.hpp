@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include "gpu_monitor.hpp"
+
+// Serves the latest snapshot as OpenMetrics text over HTTP (GET /metrics).
+// The body is formatted once per sample, on the sampling thread, into a
+// recycled buffer and published atomically; a scrape only sends the bytes of
+// the current body and never touches NVML.
+class MetricsExporter : public SnapshotSink {
+public:
+    static constexpr unsigned short DEFAULT_PORT = 9945;
+
+    MetricsExporter();
+    ~MetricsExporter() override;
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Listens on bindAddress:port and serves from a background thread. Port 0
+    // picks a free port; port() reports the one actually bound.
+    bool start(unsigned short port, const std::string& bindAddress = "127.0.0.1");
+    void stop();
+    unsigned short port() const { return m_port; }
+
+    void onSnapshot(const GpuSnapshot& snapshot) override;
+
+    unsigned long long scrapeCount() const { return m_scrapes.load(std::memory_order_relaxed); }
+
+private:
+    static void serialize(const GpuSnapshot& snapshot, std::string& body);
+    void serveLoop();
+    void handleConnection(intptr_t client);
+
+    std::shared_ptr<const std::string> m_body;  // Swapped atomically
+    std::shared_ptr<std::string> m_spare;       // Retired body, reused once no scrape holds it
+
+    intptr_t m_listenSocket;
+    unsigned short m_port;
+    std::thread m_thread;
+    std::atomic<bool> m_stopRequested;
+    std::atomic<unsigned long long> m_scrapes;
+};
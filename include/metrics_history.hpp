@@ -0,0 +1,315 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstddef>
+#include "history_codec.hpp"
+
+struct GpuMetrics;
+struct SubSample;
+
+// Numeric GpuMetrics fields that are kept as history columns
+enum class Metric : size_t {
+    GpuUtil,
+    MemUtil,
+    Temperature,
+    FanSpeed,
+    PowerUsage,
+    PowerLimit,
+    CoreClock,
+    MemClock,
+    TotalMemory,
+    UsedMemory,
+    Count
+};
+
+constexpr size_t METRIC_COUNT = static_cast<size_t>(Metric::Count);
+
+// Statistic kept per metric in rollup tiers. Raw tiers only store one value,
+// which is returned for every statistic.
+enum class Stat : size_t {
+    Avg,
+    Min,
+    Max,
+    Count
+};
+
+constexpr size_t STAT_COUNT = static_cast<size_t>(Stat::Count);
+
+// Converts the numeric fields of a sample into history column order
+void toMetricValues(const GpuMetrics& metrics, float (&values)[METRIC_COUNT]);
+
+// Read-only view over contiguous values, oldest first
+template <typename T>
+struct Span {
+    const T* data = nullptr;
+    size_t size = 0;
+
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+    const T& operator[](size_t i) const { return data[i]; }
+    bool empty() const { return size == 0; }
+
+    Span subspan(size_t offset) const {
+        Span span;
+        if (offset < size) {
+            span.data = data + offset;
+            span.size = size - offset;
+        }
+        return span;
+    }
+};
+
+struct TierSpec {
+    long long resolutionMs;  // Time covered by one slot
+    size_t capacity;         // Number of slots
+    bool compressed = false; // Store sealed blocks compressed instead of in a ring
+};
+
+// Column-oriented samples at one resolution, kept in one of two layouts.
+//
+// Uncompressed tiers keep their window in a ring of capacity + SLACK_SAMPLES
+// slots. Every column is written twice (at i and i + slots) so the window is
+// always one contiguous span no matter where the ring has wrapped. All memory
+// is allocated up front; push() never allocates.
+//
+// Compressed tiers append to an open block of BLOCK_SAMPLES samples, kept in a
+// ring the same way. A full block is sealed into an immutable CompressedBlock
+// shared by every copy of the tier, and whole blocks are dropped once the rest
+// still hold capacity samples. They have no spans; read them through a
+// HistoryReader.
+//
+// Copies share the ring and only carry the position and size of their window,
+// so copying a tier is cheap. Pushing into one copy overwrites the oldest
+// slots of the ring, which other copies may still show: TieredHistory only
+// pushes where overwrites() says no published copy is affected.
+class HistoryTier {
+public:
+    static constexpr size_t BLOCK_SAMPLES = 128;
+    // Ring slots beyond the window, which copies can lag behind the tier by
+    static constexpr size_t SLACK_SAMPLES = 64;
+
+    HistoryTier(const TierSpec& spec, bool rollup);
+
+    const TierSpec& spec() const { return m_spec; }
+    bool isRollup() const { return m_rollup; }
+    bool isCompressed() const { return m_spec.compressed; }
+    size_t columnCount() const { return m_columnCount; }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_spec.capacity; }
+    bool empty() const { return m_size == 0; }
+
+    // Time span the tier can hold when full
+    long long retentionMs() const { return m_spec.resolutionMs * static_cast<long long>(m_spec.capacity); }
+
+    // Uncompressed tiers only; empty for compressed ones
+    Span<long long> timestamps() const;
+    Span<float> column(Metric metric, Stat stat = Stat::Avg) const;
+    // Index of the first sample at or after timestampMs
+    size_t lowerBound(long long timestampMs) const;
+
+    float latest(Metric metric, Stat stat = Stat::Avg) const;
+    long long latestTimestamp() const;
+
+    // Appends the samples at or after fromMs of one column (and their timestamps,
+    // unless null) to the given buffers, oldest first. Works for both layouts;
+    // only the requested column is decoded.
+    void decode(long long fromMs, size_t column, std::vector<long long>* timestamps, std::vector<float>& values) const;
+
+    // Bytes held by this tier, and what the same samples take as plain columns
+    size_t memoryBytes() const;
+    size_t rawBytes() const { return m_size * (sizeof(long long) + m_columnCount * sizeof(float)); }
+
+    // values holds columnCount() floats: one per metric, or metric * STAT_COUNT + stat for rollups
+    void push(long long timestampMs, const float* values);
+    void clear();
+
+    // True if the next pushes into this tier would overwrite a sample that
+    // published, an earlier copy of it, still shows
+    bool overwrites(const HistoryTier& published, size_t pushes) const;
+    // Moves the tier onto a ring of its own, leaving copies on the old one as they are
+    void detach();
+
+    // Live samples as compressed blocks of up to BLOCK_SAMPLES, oldest first.
+    // Sealed blocks of compressed tiers are shared, not encoded again.
+    void exportBlocks(std::vector<std::shared_ptr<const CompressedBlock>>& out) const;
+    // Appends the samples of an exported block, adopting it whole where the
+    // layout allows. False if its columns do not match this tier's, or its
+    // samples are out of order or do not follow the tier's newest one.
+    bool appendBlock(const std::shared_ptr<const CompressedBlock>& block);
+
+    size_t columnIndex(Metric metric, Stat stat) const {
+        return m_rollup ? static_cast<size_t>(metric) * STAT_COUNT + static_cast<size_t>(stat)
+                        : static_cast<size_t>(metric);
+    }
+
+private:
+    // Samples of the window, shared by a tier and its copies
+    struct Ring {
+        Ring(size_t slots, size_t columnCount)
+            : slots(slots), timestamps(2 * slots, 0), values(columnCount * 2 * slots, 0.0f) {}
+
+        size_t slots;
+        std::vector<long long> timestamps;
+        std::vector<float> values;
+    };
+    using BlockList = std::vector<std::shared_ptr<const CompressedBlock>>;
+
+    // Samples in the ring: the whole window, or the open block when compressed
+    size_t ringSamples() const { return m_spec.compressed ? m_open : m_size; }
+    // Slot of the oldest sample in the ring; the rest follow contiguously
+    size_t ringStart() const { return static_cast<size_t>((m_end - ringSamples()) % m_ring->slots); }
+    const float* columnBase(size_t column) const { return m_ring->values.data() + column * 2 * m_ring->slots; }
+    void sealBlock();
+    void appendSealed(std::shared_ptr<const CompressedBlock> block);
+
+    TierSpec m_spec;
+    bool m_rollup;
+    size_t m_columnCount;
+    std::shared_ptr<Ring> m_ring;
+    unsigned long long m_end = 0;  // Samples ever pushed into the ring; the next one's position
+    size_t m_size = 0;
+
+    // Compressed layout: sealed blocks, oldest first, in front of the open block
+    std::shared_ptr<const BlockList> m_blocks;
+    size_t m_sealedSamples = 0;
+    size_t m_open = 0;  // Samples in the open block
+};
+
+// One metric of a tier from some point in time on. The spans point into the
+// tier itself or, for compressed tiers, into the reader that produced them,
+// and stay valid until that reader's next read(). Raw tiers return the same
+// span for avg, min and max.
+struct HistoryWindow {
+    Span<long long> timestamps;
+    Span<float> avg;
+    Span<float> min;
+    Span<float> max;
+    bool rollup = false;
+};
+
+// Reads history windows from either tier layout. Decode buffers are kept
+// between reads so a reader that draws every frame stops allocating.
+class HistoryReader {
+public:
+    HistoryWindow read(const HistoryTier& tier, Metric metric, long long fromMs);
+
+private:
+    std::vector<long long> m_timestamps;
+    std::vector<float> m_columns[STAT_COUNT];
+};
+
+// Immutable view of one device's history, finest tier first. Copies are cheap
+// because tiers are shared, which is what lets snapshots carry history.
+// Devices whose driver samples between ticks also have a fine tier.
+class MetricsHistory {
+public:
+    MetricsHistory() = default;
+    MetricsHistory(std::wstring name, std::vector<std::shared_ptr<const HistoryTier>> tiers,
+                   std::shared_ptr<const HistoryTier> fine = nullptr)
+        : m_name(std::move(name)), m_tiers(std::move(tiers)), m_fine(std::move(fine)) {}
+
+    const std::wstring& name() const { return m_name; }
+
+    size_t tierCount() const { return m_tiers.size(); }
+    const HistoryTier& tier(size_t index) const { return *m_tiers[index]; }
+
+    // Sub-second tier, or null if the source never reported sub-samples
+    const HistoryTier* fineTier() const { return m_fine.get(); }
+
+    // Finest tier that covers windowMs, or the coarsest one if none does. The
+    // fine tier is only chosen once it reaches back as far as the raw tier.
+    const HistoryTier& selectTier(long long windowMs) const;
+
+    // Shortcuts to the raw tier
+    size_t size() const { return m_tiers.empty() ? 0 : m_tiers[0]->size(); }
+    bool empty() const { return size() == 0; }
+    Span<float> column(Metric metric) const;
+    float latest(Metric metric) const { return m_tiers.empty() ? 0.0f : m_tiers[0]->latest(metric); }
+    long long latestTimestamp() const { return m_tiers.empty() ? 0 : m_tiers[0]->latestTimestamp(); }
+
+    size_t memoryBytes() const;
+    size_t rawBytes() const;
+
+private:
+    std::wstring m_name;
+    std::vector<std::shared_ptr<const HistoryTier>> m_tiers;
+    std::shared_ptr<const HistoryTier> m_fine;
+};
+
+// Writer side of a device's history. Raw samples go into the first tier, one
+// per resolution slot: the slot keeps its first sample and faster ones only go
+// into the fine tier. Every coarser tier accumulates min, max and average
+// incrementally until its time bucket rolls over. A tier a published view
+// holds is retired as it is and the writer carries on in a copy, which writes
+// into ring slots the view no longer shows. Retired copies are reused once
+// their views are gone, so publishing does not allocate either.
+class TieredHistory {
+public:
+    // Sub-samples and fast ticks are bucketed into a fine tier covering the default graph window
+    static constexpr long long FINE_RESOLUTION_MS = 100;
+    static constexpr size_t FINE_CAPACITY = 1200;
+
+    explicit TieredHistory(const std::vector<TierSpec>& tiers);
+
+    TieredHistory(TieredHistory&&) = default;
+    TieredHistory& operator=(TieredHistory&&) = default;
+    TieredHistory(const TieredHistory&) = delete;
+    TieredHistory& operator=(const TieredHistory&) = delete;
+
+    void setName(const std::wstring& name) { m_name = name; }
+    const std::wstring& name() const { return m_name; }
+
+    void push(const GpuMetrics& metrics, long long timestampMs);
+    // Adds the driver's readings since the last tick to the fine tier. Metrics
+    // without readings in a bucket keep their previous value; metrics without
+    // any this tick take the tick's value.
+    void pushSubSamples(const std::vector<SubSample>& samples, const GpuMetrics& metrics);
+    void clear();
+
+    size_t tierCount() const { return m_tiers.size(); }
+    const TierSpec& tierSpec(size_t tier) const { return m_tiers[tier]->spec(); }
+    size_t tierColumns(size_t tier) const { return m_tiers[tier]->columnCount(); }
+
+    // Refills a tier from blocks saved by HistoryTier::exportBlocks() on a
+    // previous run. Sampling carries on after the newest restored sample;
+    // buckets that were still open when the history was saved are lost.
+    // False at the first block that does not fit, with the ones before it
+    // restored.
+    bool restoreTier(size_t tier, const std::vector<std::shared_ptr<const CompressedBlock>>& blocks);
+    void clearTier(size_t tier);
+
+    MetricsHistory view() const;
+
+private:
+    struct Rollup {
+        long long bucket = 0;
+        unsigned int count = 0;
+        double weight = 0.0;  // Milliseconds the samples stand for
+        float min[METRIC_COUNT] = {};
+        float max[METRIC_COUNT] = {};
+        double sum[METRIC_COUNT] = {};
+    };
+
+    // Tier ready for the given number of pushes
+    static HistoryTier& writable(std::shared_ptr<HistoryTier>& current,
+                                 std::vector<std::shared_ptr<HistoryTier>>& retired, size_t pushes);
+    HistoryTier& writable(size_t tier, size_t pushes) { return writable(m_tiers[tier], m_retired[tier], pushes); }
+    void flushRollup(size_t tier);
+    HistoryTier& writableFine();  // Creates the fine tier on first use
+    void pushFine(long long timestampMs, const float* values);
+
+    std::wstring m_name;
+    std::vector<std::shared_ptr<HistoryTier>> m_tiers;
+    std::vector<std::vector<std::shared_ptr<HistoryTier>>> m_retired;  // Copies handed to views, per tier
+    std::vector<Rollup> m_rollups;
+
+    // Fine tier, created on the first sub-samples
+    std::shared_ptr<HistoryTier> m_fine;
+    std::vector<std::shared_ptr<HistoryTier>> m_fineRetired;
+    float m_fineValues[METRIC_COUNT] = {};
+    long long m_fineBucket = -1;  // Last bucket pushed
+    long long m_lastPushMs = -1;
+    std::vector<SubSample> m_fineScratch;
+};
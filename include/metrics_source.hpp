@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+
+struct GpuMetrics;
+struct ProcessInfo;
+enum class Metric : size_t;
+
+// Properties of a device that do not change while it stays attached
+struct DeviceInfo {
+    unsigned int index;
+    std::string uuid;
+    std::wstring name;
+    unsigned long long totalMemory;
+    unsigned int powerLimit;  // Enforced power limit in watts
+};
+
+// One reading the driver took on its own between ticks
+struct SubSample {
+    long long timestampMs;
+    Metric metric;
+    float value;
+};
+
+enum class GpuEventType : unsigned char {
+    Xid,       // Critical driver error; data is the XID number
+    EccError,  // Uncorrectable (double-bit) ECC error
+    Throttle   // Clocks held back; data is the NVML throttle reason mask
+};
+
+// Something a device went through between ticks
+struct GpuEvent {
+    long long timestampMs;    // When it happened, or for throttling the tick that saw it
+    long long lastMs;         // Latest occurrence once repeats are merged
+    std::string uuid;
+    unsigned int gpuIndex;
+    GpuEventType type;
+    unsigned long long data;
+    unsigned int durationMs;  // Time spent throttled; 0 for other events
+    unsigned int count;       // Occurrences merged into this one
+    unsigned long long sequence;  // Order of arrival, assigned by the event log
+};
+
+enum class SampleStatus {
+    Ok,
+    Failed,      // Nothing usable this tick; try again next tick
+    DeviceLost   // The device list is stale and must be refreshed
+};
+
+// Where GpuMonitor gets its data from. The NVML backend talks to the driver;
+// other backends simulate or replay devices behind the same interface.
+class MetricsSource {
+public:
+    virtual ~MetricsSource() = default;
+
+    virtual bool initialize() = 0;
+    virtual void shutdown() = 0;
+
+    // Re-enumerates devices. Returns true if devices were added, removed or reordered.
+    virtual bool refreshDevices() = 0;
+    virtual const std::vector<DeviceInfo>& devices() const = 0;
+
+    // Called once per tick before any sampleDevice(). Sources with their own
+    // clock, such as replays, overwrite timestampMs. Failed skips the tick;
+    // DeviceLost refreshes the device list before sampling.
+    virtual SampleStatus beginSample(long long& timestampMs) {
+        (void)timestampMs;
+        return SampleStatus::Ok;
+    }
+
+    // Fills the dynamic counters of devices()[device] and its processes (empty on entry).
+    // Static fields (index, uuid, name, total memory, power limit) are already
+    // set by the caller. May be called concurrently for different devices.
+    virtual SampleStatus sampleDevice(size_t device, GpuMetrics& metrics, std::vector<ProcessInfo>& processes) = 0;
+
+    // Readings of devices()[device] taken since the previous tick, for sources
+    // that see finer than the polling interval. Called right after a successful
+    // sampleDevice() on the same thread; samples is empty on entry and may be
+    // filled in any order.
+    virtual void collectSubSamples(size_t device, std::vector<SubSample>& samples) {
+        (void)device;
+        (void)samples;
+    }
+
+    // Events devices()[device] went through since the previous tick that
+    // polling found, such as throttling seen in the driver's cumulative
+    // counters. Called like collectSubSamples(); events is empty on entry.
+    virtual void collectEvents(size_t device, std::vector<GpuEvent>& events) {
+        (void)device;
+        (void)events;
+    }
+
+    // Sources the driver notifies of events return true from openEvents();
+    // waitEvents() is then called in a loop on a dedicated thread and blocks
+    // for up to timeoutMs, appending whatever arrived, and closeEvents() is
+    // called on that thread when monitoring stops. They may run concurrently
+    // with sampling and refreshDevices().
+    virtual bool openEvents() { return false; }
+    virtual void waitEvents(unsigned int timeoutMs, std::vector<GpuEvent>& events) {
+        (void)timeoutMs;
+        (void)events;
+    }
+    virtual void closeEvents() {}
+};
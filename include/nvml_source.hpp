@@ -0,0 +1,96 @@
+#pragma once
+#include <nvml.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "metrics_source.hpp"
+#include "device_registry.hpp"
+#include "instrumentation.hpp"
+
+// Reads live counters from the NVIDIA driver through NVML
+class NvmlSource : public MetricsSource {
+public:
+    bool initialize() override;
+    void shutdown() override;
+
+    bool refreshDevices() override;
+    const std::vector<DeviceInfo>& devices() const override { return m_registry.devices(); }
+
+    SampleStatus sampleDevice(size_t device, GpuMetrics& metrics, std::vector<ProcessInfo>& processes) override;
+    void collectSubSamples(size_t device, std::vector<SubSample>& samples) override;
+    void collectEvents(size_t device, std::vector<GpuEvent>& events) override;
+
+    // XIDs and uncorrectable ECC errors. Clock change events are left alone:
+    // they fire on every DVFS step, and throttling is read from the violation
+    // counters each tick instead.
+    bool openEvents() override;
+    void waitEvents(unsigned int timeoutMs, std::vector<GpuEvent>& events) override;
+    void closeEvents() override;
+
+private:
+    // Counters read from the driver's sample ring, and the batched field
+    // values that stand in for them when the ring is unsupported
+    static constexpr size_t SAMPLED_COUNTERS = 4;
+    static constexpr size_t BATCHED_FIELDS = 1;
+
+    // Cursor into the driver's sample ring for one counter of one device
+    struct SampledCounter {
+        bool supported = true;
+        bool hasValue = false;
+        float value = 0.0f;  // Newest reading, kept while the driver has nothing new
+        unsigned long long lastTimestamp = 0;
+        std::vector<nvmlSample_t> buffer;
+    };
+
+    // Reused NVML buffers and the per-process utilization cursor of one device
+    struct DeviceState {
+        std::vector<nvmlProcessInfo_t> processBuffer = std::vector<nvmlProcessInfo_t>(32);
+        std::vector<nvmlProcessUtilizationSample_t> utilBuffer;
+        std::vector<unsigned long long> utilTimestamps;
+        unsigned long long lastUtilTimestamp = 0;
+
+        // Which collection path each counter takes is learned per device: a
+        // counter the driver rejects once falls back for good
+        SampledCounter sampled[SAMPLED_COUNTERS];
+        bool fieldSupported[BATCHED_FIELDS] = { true };
+        std::vector<SubSample> subSamples;
+
+        // Cumulative time the power and thermal policies held the clocks back
+        bool violationSupported[2] = { true, true };
+        unsigned long long violationNs[2] = {};
+        unsigned long long violationReference = 0;  // Microseconds, 0 before the first reading
+        std::vector<GpuEvent> events;
+    };
+
+    // What the event thread knows of a device; it must not touch m_registry
+    struct EventDevice {
+        nvmlDevice_t handle;
+        unsigned int index;
+        std::string uuid;
+    };
+
+    // Both clear the bit of every Metric they fill in from pending
+    static nvmlReturn_t readSampledCounters(nvmlDevice_t device, DeviceState& state, GpuMetrics& metrics,
+                                            unsigned int& pending);
+    static nvmlReturn_t readFields(nvmlDevice_t device, DeviceState& state, GpuMetrics& metrics,
+                                   unsigned int& pending);
+
+    using ProcessQuery = nvmlReturn_t (*)(nvmlDevice_t, unsigned int*, nvmlProcessInfo_t*);
+
+    static void collectProcesses(ProcessQuery query, Probe probe, nvmlDevice_t device, unsigned int index,
+                                 DeviceState& state, std::vector<ProcessInfo>& processes);
+    static void collectProcessUtilization(nvmlDevice_t device, DeviceState& state, std::vector<ProcessInfo>& processes);
+    static void readThrottling(nvmlDevice_t device, const DeviceInfo& info, DeviceState& state);
+
+    // Registers the devices with a fresh event set; false if none would take it
+    bool registerEvents();
+
+    DeviceRegistry m_registry;
+    std::vector<DeviceState> m_states;  // Parallel to m_registry.devices()
+
+    std::mutex m_eventMutex;                 // Guards m_eventDevices and m_eventVersion
+    std::vector<EventDevice> m_eventDevices;
+    unsigned long long m_eventVersion = 0;   // Bumped when the device list changes
+    unsigned long long m_registeredVersion = 0;
+    nvmlEventSet_t m_eventSet = nullptr;     // Event thread only
+};
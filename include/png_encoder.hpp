@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Encodes row-major 0x00RRGGBB pixels as an 8-bit RGB PNG. The deflate
+// stream uses fixed Huffman codes and only looks for repeats of the previous
+// pixel and of the row above, which is fast and suits flat, UI-like images;
+// photos would compress poorly.
+void encodePng(const uint32_t* pixels, size_t width, size_t height, std::vector<uint8_t>& out);
+
+bool writePng(const char* path, const uint32_t* pixels, size_t width, size_t height);
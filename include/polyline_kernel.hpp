@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "display_list.hpp"
+
+// Maps samples to screen space:
+//   x = xOrigin + (timestamp - originMs) * xScale
+//   y = yOrigin - clamp(value * valueScale, 0, valueMax) * yScale
+// Timestamps must lie within 2^31 ms (about 24 days) after originMs.
+struct PlotTransform {
+    long long originMs;
+    float xOrigin;
+    float xScale;
+    float yOrigin;
+    float yScale;
+    float valueScale;
+    float valueMax;
+};
+
+enum class PolylineIsa {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Best instruction set this CPU supports
+PolylineIsa detectPolylineIsa();
+const char* polylineIsaName(PolylineIsa isa);
+
+// Turns a history column into at most two points per pixel column, the
+// lowest and highest in time order, so the work after it is bounded by the
+// graph's width instead of the number of samples, and peaks stay visible.
+// Scratch buffers are kept between calls.
+class PolylineBuilder {
+public:
+    explicit PolylineBuilder(PolylineIsa isa = detectPolylineIsa());
+
+    PolylineIsa isa() const { return m_isa; }
+
+    // Returns the decimated line, valid until the next call
+    const std::vector<DlPoint>& build(const long long* times, const float* values, size_t count,
+                                      const PlotTransform& transform);
+
+    // Vertical segments, as point pairs, spanning the lowest min to the
+    // highest max of each pixel column; columns without spread are skipped
+    const std::vector<DlPoint>& buildSpread(const long long* times, const float* minValues,
+                                            const float* maxValues, size_t count,
+                                            const PlotTransform& transform);
+
+    // The mapping step on its own, writing count floats to xs and ys
+    static void map(PolylineIsa isa, const long long* times, const float* values, size_t count,
+                    const PlotTransform& transform, float* xs, float* ys);
+
+private:
+    PolylineIsa m_isa;
+    std::vector<float> m_xs;
+    std::vector<float> m_ys;
+    std::vector<float> m_ysHigh;
+    std::vector<DlPoint> m_points;
+};
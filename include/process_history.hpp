@@ -0,0 +1,171 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ProcessInfo;
+
+// One run of a process on one GPU. Pids are reused, so the OS start time
+// tells runs of the same pid apart (0 when the source does not know it).
+struct ProcessKey {
+    unsigned int gpuIndex;
+    unsigned int pid;
+    unsigned long long startTime;
+
+    bool operator==(const ProcessKey& other) const {
+        return gpuIndex == other.gpuIndex && pid == other.pid && startTime == other.startTime;
+    }
+};
+
+struct ProcessKeyHash {
+    size_t operator()(const ProcessKey& key) const {
+        unsigned long long h = (static_cast<unsigned long long>(key.gpuIndex) << 32) | key.pid;
+        h ^= key.startTime + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h);
+    }
+};
+
+// Samples of one process within one RESOLUTION_MS slot
+struct ProcessBucket {
+    long long timestampMs;          // Start of the slot
+    unsigned long long maxMemory;
+    unsigned int utilSum;
+    unsigned int samples;
+
+    float avgUtil() const { return samples ? static_cast<float>(utilSum) / samples : 0.0f; }
+};
+
+// One row of a process table
+struct ProcessUsage {
+    ProcessKey key;
+    std::wstring name;
+    unsigned long long memoryUsed;  // Latest sample
+    unsigned int gpuUtil;           // Latest sample
+    unsigned long long peakMemory;  // Over the retained buckets
+    float avgUtil;                  // Over the retained buckets
+    long long firstSeenMs;
+    long long lastSeenMs;
+    bool running;                   // Seen in the latest update
+};
+
+enum class ProcessRanking {
+    PeakMemory,
+    AvgUtil,
+};
+
+// Usage history of every GPU process seen recently. Each process keeps up
+// to an hour of RESOLUTION_MS buckets, allocated as it lives, and leaves
+// EXITED_RETENTION_MS after it was last seen, or earlier when more than
+// MAX_PROCESSES are tracked.
+//
+// Each ranking keeps its top rows between updates together with an upper
+// bound on every score outside them. A new score is one comparison against
+// the lowest top row; the top rows are re-sorted at the end of an update,
+// and only when one of them may have fallen below the bound does a linear
+// selection over all scores run. Nothing ever sorts the whole set.
+class ProcessHistory {
+public:
+    static constexpr long long RESOLUTION_MS = 10 * 1000;
+    static constexpr size_t CAPACITY = 360;  // One hour of buckets
+    static constexpr long long EXITED_RETENTION_MS = 60 * 1000;
+    static constexpr size_t MAX_PROCESSES = 4096;
+    static constexpr size_t DEFAULT_TOP_COUNT = 10;
+
+    ProcessHistory();
+    ProcessHistory(const ProcessHistory&) = delete;
+    ProcessHistory& operator=(const ProcessHistory&) = delete;
+
+    // Rows kept ranked; top() returns no more than this
+    void setTopCount(size_t count);
+    size_t topCount() const { return m_topCount; }
+
+    // Records one tick; processes missing from it count as exited
+    void update(const std::vector<ProcessInfo>& processes, long long timestampMs);
+    void clear();
+
+    // Up to count rows, highest first
+    void top(ProcessRanking ranking, size_t count, std::vector<ProcessUsage>& out) const;
+
+    // Buckets of one process, oldest first; false if it is not tracked
+    bool series(const ProcessKey& key, std::vector<ProcessBucket>& out) const;
+
+    size_t size() const { return m_entries.size(); }
+    unsigned long long evicted() const { return m_evicted; }
+    // Linear selections run because the top rows could not be kept incrementally
+    unsigned long long rescans() const { return m_rescans; }
+
+private:
+    static constexpr size_t RANKING_COUNT = 2;
+
+    struct Entry {
+        ProcessKey key;
+        std::wstring name;
+        unsigned long long serial = 0;  // Breaks ties in order of first sighting
+        size_t slot = 0;                // In m_scores
+        bool inTop[RANKING_COUNT] = {};
+        std::vector<ProcessBucket> buckets;  // Ring once CAPACITY buckets are held
+        size_t oldest = 0;
+        unsigned long long peakMemory = 0;
+        unsigned long long utilSum = 0;      // Over all buckets
+        unsigned long long samples = 0;
+        unsigned long long memoryUsed = 0;
+        unsigned int gpuUtil = 0;
+        long long firstSeenMs = 0;
+        long long lastSeenMs = 0;
+        unsigned long long lastTick = 0;
+
+        ProcessBucket& newest() { return buckets[(oldest + buckets.size() - 1) % buckets.size()]; }
+        double avgUtil() const { return samples ? static_cast<double>(utilSum) / samples : 0.0; }
+    };
+
+    // Score and tie-break of one process in one ranking; ahead() means ranked higher
+    struct Rank {
+        double score;
+        unsigned long long serial;
+
+        bool ahead(const Rank& other) const {
+            return score != other.score ? score > other.score : serial < other.serial;
+        }
+    };
+
+    // Scores of every tracked process, packed so a selection reads little memory
+    struct Scores {
+        double score[RANKING_COUNT];
+        unsigned long long serial;
+        Entry* entry;
+
+        Rank rank(size_t ranking) const { return { score[ranking], serial }; }
+    };
+
+    struct Ranking {
+        std::vector<Entry*> top;  // Sorted after every update; more than m_topCount while one runs
+        Rank cutoff;              // Lowest top row as of the last update
+        Rank outside;             // No process outside top ranks ahead of this
+        bool hasOutside = false;
+        bool stale = true;        // Needs a selection over all scores
+    };
+
+    using EntryList = std::list<Entry>;
+
+    void record(Entry& entry, const ProcessInfo& process, long long timestampMs);
+    void rescore(Entry& entry);
+    void evict(EntryList::iterator it);
+    void finishRanking(size_t ranking);
+    void select(size_t ranking);
+    Rank rank(const Entry& entry, size_t ranking) const { return m_scores[entry.slot].rank(ranking); }
+    ProcessUsage usage(const Entry& entry) const;
+
+    // Least recently seen first, so exited processes gather at the front
+    EntryList m_entries;
+    std::unordered_map<ProcessKey, EntryList::iterator, ProcessKeyHash> m_index;
+    std::vector<Scores> m_scores;
+    Ranking m_rankings[RANKING_COUNT];
+    std::vector<Scores> m_selection;  // Scratch for select()
+    size_t m_topCount;
+    unsigned long long m_tick = 0;
+    unsigned long long m_nextSerial = 0;
+    unsigned long long m_evicted = 0;
+    unsigned long long m_rescans = 0;
+};
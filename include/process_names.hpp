@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+
+// Remembers executable names by pid so the OS is only asked for a name when a
+// pid is seen for the first time. Entries also store the process start time,
+// which is re-checked when a pid reappears after missing a tick, so a reused
+// pid is not mislabeled. A pid present on consecutive ticks costs no OS call.
+class ProcessNameCache {
+public:
+    static constexpr unsigned int MAX_IDLE_TICKS = 30; // Ticks an unused entry survives
+
+    // Also returns the start time that identifies this run of the pid
+    const std::wstring& lookup(unsigned int pid, unsigned long long& startTime);
+
+    // Ends one sampling tick and drops entries that have not been used recently
+    void endTick();
+
+    size_t size() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        unsigned long long startTime;
+        std::wstring name;
+        unsigned long long lastUsedTick;
+    };
+
+    std::unordered_map<unsigned int, Entry> m_entries;
+    unsigned long long m_tick = 0;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "display_list.hpp"
+
+// CPU backend for display lists, drawing into an in-memory image. Lines are
+// antialiased; rectangles and clips snap to pixel centers like aliased
+// Direct2D; text uses a built-in 5x7 bitmap font covering ASCII. Needs no
+// window or graphics device, so graphs can be rendered on headless nodes.
+class RasterCanvas {
+public:
+    RasterCanvas();
+
+    // Discards the image; every pixel starts out black
+    void resize(size_t width, size_t height);
+    size_t width() const { return m_width; }
+    size_t height() const { return m_height; }
+
+    void replay(const DisplayList& list);
+
+    // Row-major 0x00RRGGBB pixels
+    const uint32_t* pixels() const { return m_pixels.data(); }
+
+private:
+    struct Clip {
+        int left;
+        int top;
+        int right;   // Exclusive
+        int bottom;  // Exclusive
+    };
+
+    Clip toPixels(const DlRect& rect) const;
+    void fill(const DlRect& rect, uint32_t color);
+    void blend(int x, int y, uint32_t color, int alpha);
+    void strokeSegment(DlPoint from, DlPoint to, float width, uint32_t color);
+    void drawText(const wchar_t* text, size_t length, const DlRect& rect, DlFont font, uint32_t color);
+    void drawGlyph(const uint8_t* columns, int x, int y, bool bold, uint32_t color);
+
+    size_t m_width;
+    size_t m_height;
+    std::vector<uint32_t> m_pixels;
+    std::vector<Clip> m_clips;  // Clips restored by PopClip, innermost last
+    Clip m_clip;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "metrics_source.hpp"
+#include "telemetry_reader.hpp"
+
+// Plays a TelemetryRecorder file back through GpuMonitor. Each tick delivers
+// the next recorded sample with its original timestamp, so history, graphs and
+// exports look exactly as they did live. Playback speed is set by how often
+// the monitor is ticked: recordedIntervalMs() for real time, less to go faster.
+class ReplaySource : public MetricsSource {
+public:
+    explicit ReplaySource(const std::string& path);
+
+    bool initialize() override;
+    void shutdown() override;
+
+    SampleStatus beginSample(long long& timestampMs) override;
+    bool refreshDevices() override;
+    const std::vector<DeviceInfo>& devices() const override { return m_devices; }
+
+    SampleStatus sampleDevice(size_t device, GpuMetrics& metrics, std::vector<ProcessInfo>& processes) override;
+
+    // Continues playback from the first sample at or after timestampMs. Meant
+    // to be used before sampling starts; history already collected is kept.
+    bool seek(long long timestampMs);
+
+    bool finished() const { return m_finished; }
+    long long startTime() const { return m_reader.startTime(); }
+    long long endTime() const { return m_reader.endTime(); }
+
+    // Typical spacing of the recorded samples, taken from the first block
+    unsigned int recordedIntervalMs() const { return m_recordedIntervalMs; }
+
+private:
+    bool loadBlock(size_t block);
+
+    std::string m_path;
+    TelemetryReader m_reader;
+    TelemetryBlock m_block;
+    size_t m_blockIndex;
+    size_t m_nextSample;
+    size_t m_sample;  // Sample being delivered this tick
+    std::vector<DeviceInfo> m_devices;
+    bool m_devicesChanged;
+    bool m_finished;
+    unsigned int m_recordedIntervalMs;
+};
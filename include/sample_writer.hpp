@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "gpu_monitor.hpp"
+
+enum class OutputFormat {
+    Csv,        // One row per GPU per sample
+    JsonLines   // One object per sample, including processes
+};
+
+// Streams snapshots as text. Rows are formatted into a fixed buffer that is
+// reused for the lifetime of the writer, so writing a sample never allocates.
+class SampleWriter {
+public:
+    SampleWriter(FILE* out, OutputFormat format);
+    ~SampleWriter();
+
+    SampleWriter(const SampleWriter&) = delete;
+    SampleWriter& operator=(const SampleWriter&) = delete;
+
+    // Metrics written for each GPU, in order; all of them by default. Set before writeHeader().
+    void setMetrics(std::vector<Metric> metrics) { m_metrics = std::move(metrics); }
+
+    void writeHeader();
+    void write(const GpuSnapshot& snapshot);
+    void flush();
+
+private:
+    void writeCsv(const GpuSnapshot& snapshot);
+    void writeJson(const GpuSnapshot& snapshot);
+
+    void put(char c);
+    void put(const char* text);
+    void putUnsigned(unsigned long long value);
+    void putSigned(long long value);
+    void putFixed(double value, int precision);
+    void putMetric(Metric metric, const GpuMetrics& metrics);
+    void putQuoted(const std::string& text);
+    void putQuoted(const std::wstring& text);
+
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    FILE* m_out;
+    OutputFormat m_format;
+    std::vector<Metric> m_metrics;
+    char m_buffer[BUFFER_SIZE];
+    size_t m_length;
+};
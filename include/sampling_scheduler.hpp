@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <vector>
+
+struct GpuSnapshot;
+
+struct SchedulerConfig {
+    unsigned int minIntervalMs = 100;    // While metrics move fast or cross a threshold
+    unsigned int baseIntervalMs = 1000;  // Ordinary activity
+    unsigned int maxIntervalMs = 5000;   // Steady devices
+
+    // Fastest change across all devices, in percentage points per second
+    // (power and memory relative to their limits, temperature weighted by 5)
+    float fastRate = 20.0f;
+    float steadyRate = 2.0f;
+
+    // Crossing any of these in either direction samples at the minimum interval
+    unsigned int utilThreshold = 80;         // Percent
+    unsigned int temperatureThreshold = 80;  // Celsius
+    float powerThreshold = 0.9f;             // Fraction of the power limit
+};
+
+// Picks the delay before the next sample from how much the last one moved.
+// Fast change or a threshold crossing drops straight to the minimum interval;
+// quiet ticks double the interval up to the base, and steady ones on up to the
+// maximum. History stays correct because every sample carries its own
+// timestamp and rollups bucket by time, not by sample count.
+class SamplingScheduler {
+public:
+    explicit SamplingScheduler(const SchedulerConfig& config = SchedulerConfig());
+
+    // Called on the sampling thread with each snapshot as it is published
+    unsigned int next(const GpuSnapshot& snapshot);
+
+    // While nothing is shown there is no point in sub-second sampling, so the
+    // interval does not go below the base. May be called from any thread.
+    void setVisible(bool visible) { m_visible.store(visible, std::memory_order_relaxed); }
+
+    // Interval chosen by the last next()
+    unsigned int interval() const { return m_intervalMs.load(std::memory_order_relaxed); }
+    const SchedulerConfig& config() const { return m_config; }
+
+private:
+    struct DeviceState {
+        float util;
+        float memUtil;
+        float power;        // Percent of the limit
+        float memory;       // Percent of total
+        float temperature;
+        bool hot;
+    };
+
+    SchedulerConfig m_config;
+    std::vector<DeviceState> m_previous;  // Parallel to the last snapshot's metrics
+    long long m_previousTimestampMs;
+    unsigned int m_adaptiveMs;            // Before the visibility clamp
+    std::atomic<unsigned int> m_intervalMs;
+    std::atomic<bool> m_visible;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Binary layout of the shared-memory segment GpuMonitor publishes snapshots
+// into. The layout is fixed for a given SHM_VERSION; readers check the magic,
+// version and record sizes before trusting anything else. Field order and
+// types never change within a version.
+//
+//   ShmHeader
+//   ShmGpu[maxGpus]           at gpusOffset
+//   ShmProcess[maxProcesses]  at processesOffset
+//   history[maxGpus]          at historyOffset, historyStride bytes per GPU:
+//                               int64_t timestamps[historyCapacity]
+//                               float values[metricCount][historyCapacity]
+//
+// Everything after `sequence` is guarded by it as a seqlock: the writer makes
+// it odd, updates the segment and makes it even again. A reader copies what it
+// needs and retries if the sequence was odd or changed in the meantime.
+
+constexpr uint32_t SHM_MAGIC = 0x5357564e;  // "NVWS"
+constexpr uint32_t SHM_VERSION = 1;
+constexpr const char* SHM_DEFAULT_NAME = "nvwintop";
+
+constexpr size_t SHM_UUID_SIZE = 96;
+constexpr size_t SHM_NAME_SIZE = 96;
+constexpr size_t SHM_PROCESS_NAME_SIZE = 64;
+
+// History columns, in GpuMetrics field order
+enum class ShmMetric : uint32_t {
+    GpuUtil,
+    MemUtil,
+    Temperature,
+    FanSpeed,
+    PowerUsage,
+    PowerLimit,
+    CoreClock,
+    MemClock,
+    TotalMemory,
+    UsedMemory,
+    Count
+};
+
+constexpr size_t SHM_METRIC_COUNT = static_cast<size_t>(ShmMetric::Count);
+
+struct ShmGpu {
+    uint32_t index;
+    uint32_t gpuUtil;
+    uint32_t memUtil;
+    uint32_t temperature;
+    uint32_t fanSpeed;
+    uint32_t powerLimit;   // Watts
+    uint32_t coreClock;    // MHz
+    uint32_t memClock;     // MHz
+    double powerUsage;     // Watts
+    uint64_t totalMemory;  // Bytes
+    uint64_t usedMemory;   // Bytes
+    uint32_t historySize;  // Valid samples at the start of this GPU's history
+    uint32_t reserved;
+    char uuid[SHM_UUID_SIZE];  // NUL-terminated
+    char name[SHM_NAME_SIZE];  // NUL-terminated ASCII
+};
+
+struct ShmProcess {
+    uint32_t gpuIndex;
+    uint32_t pid;
+    uint32_t gpuUtil;
+    uint32_t reserved;
+    uint64_t memoryUsed;
+    char name[SHM_PROCESS_NAME_SIZE];
+};
+
+struct ShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t gpuRecordSize;
+    uint32_t processRecordSize;
+    uint32_t metricCount;
+    uint32_t maxGpus;
+    uint32_t maxProcesses;
+    uint32_t historyCapacity;
+    uint32_t reserved;
+    uint64_t totalSize;
+    uint64_t gpusOffset;
+    uint64_t processesOffset;
+    uint64_t historyOffset;
+    uint64_t historyStride;
+
+    alignas(64) std::atomic<uint64_t> sequence;
+
+    int64_t timestampMs;    // Unix epoch milliseconds of the sample
+    uint64_t sampleCount;   // Samples published since the segment was created
+    uint32_t gpuCount;
+    uint32_t processCount;  // Capped at maxProcesses
+    uint32_t writerActive;  // Cleared when the publisher shuts down
+    uint32_t reserved2;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock needs a lock-free 64-bit atomic");
+static_assert(sizeof(ShmGpu) == 256, "ShmGpu layout changed; bump SHM_VERSION");
+static_assert(sizeof(ShmProcess) == 88, "ShmProcess layout changed; bump SHM_VERSION");
+static_assert(sizeof(ShmHeader) == 192, "ShmHeader layout changed; bump SHM_VERSION");
@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include "gpu_monitor.hpp"
+#include "shm_reader.hpp"
+
+// Mirrors every snapshot into a named shared-memory segment (see shm_layout.hpp)
+// so other local tools can read current metrics, processes and recent history
+// with ShmReader instead of opening NVML themselves. The segment is sized once
+// on open; devices and processes beyond the maxima are left out.
+class ShmPublisher : public SnapshotSink {
+public:
+    static constexpr unsigned int DEFAULT_MAX_GPUS = 256;
+    static constexpr unsigned int DEFAULT_MAX_PROCESSES = 4096;
+    static constexpr unsigned int DEFAULT_HISTORY_CAPACITY = 120;
+
+    ShmPublisher() = default;
+    ~ShmPublisher() override;
+
+    ShmPublisher(const ShmPublisher&) = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+    bool open(const std::string& name = SHM_DEFAULT_NAME,
+              unsigned int maxGpus = DEFAULT_MAX_GPUS,
+              unsigned int maxProcesses = DEFAULT_MAX_PROCESSES,
+              unsigned int historyCapacity = DEFAULT_HISTORY_CAPACITY);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    void onSnapshot(const GpuSnapshot& snapshot) override;
+
+private:
+    void writeHistory(size_t gpu, const MetricsHistory& history, ShmGpu& record);
+
+    SharedMemory m_memory;
+    ShmHeader* m_header = nullptr;
+    HistoryReader m_historyReader;
+};
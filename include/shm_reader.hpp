@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "shm_layout.hpp"
+
+// Named shared-memory segment: POSIX shm_open on Linux, a named file mapping
+// in the Local\ namespace on Windows
+class SharedMemory {
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    // Creates (or replaces) a read-write segment of the given size
+    bool create(const std::string& name, size_t size);
+    // Maps an existing segment read-only
+    bool open(const std::string& name);
+    void close();
+
+    void* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    void* m_data;
+    size_t m_size;
+    std::string m_name;
+    bool m_owner;
+#ifdef _WIN32
+    void* m_mapping;
+#endif
+};
+
+// Copy of everything a reader took out of the segment
+struct ShmSnapshot {
+    int64_t timestampMs = 0;
+    uint64_t sampleCount = 0;
+    std::vector<ShmGpu> gpus;
+    std::vector<ShmProcess> processes;
+
+    // Oldest first; gpus[i].historySize entries are valid
+    const int64_t* historyTimestamps(size_t gpu) const;
+    const float* historyColumn(size_t gpu, ShmMetric metric) const;
+
+    std::vector<uint8_t> history;  // Raw history area, historyStride bytes per GPU
+    size_t historyCapacity = 0;
+    size_t historyStride = 0;
+};
+
+// Reads snapshots published by NvWinTop. Once open, a read is a handful of
+// memcpys out of the mapping with no system calls; buffers are sized on open
+// so reads do not allocate.
+class ShmReader {
+public:
+    static constexpr unsigned int DEFAULT_MAX_RETRIES = 1000;
+
+    // False if there is no segment, or its version or layout is not this build's
+    bool open(const std::string& name = SHM_DEFAULT_NAME);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    // False if the publisher has gone away or kept the segment busy for
+    // maxRetries attempts. History is copied only when asked for.
+    bool read(ShmSnapshot& out, bool withHistory = true, unsigned int maxRetries = DEFAULT_MAX_RETRIES);
+
+    // Attempts that had to be repeated because the writer was active
+    unsigned long long retries() const { return m_retries; }
+
+private:
+    SharedMemory m_memory;
+    const ShmHeader* m_header = nullptr;
+    unsigned long long m_retries = 0;
+};
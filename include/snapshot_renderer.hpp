@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "display_list.hpp"
+#include "gpu_monitor.hpp"
+#include "graph_scene.hpp"
+#include "raster_canvas.hpp"
+
+struct SnapshotConfig {
+    LayoutMode mode = LayoutMode::Detail;
+    unsigned int width = 1600;       // Image width in pixels
+    unsigned int columns = 0;        // Detail panels per row; 0 picks a count that suits the GPUs
+    unsigned int graphHeight = 120;  // Pixels per detail graph; the image grows to fit every GPU
+    bool overlay = false;            // Draw the latency table over the graphs
+};
+
+// Renders dashboards without a window: the graph scene the window uses,
+// replayed onto a RasterCanvas and encoded as PNG
+class SnapshotRenderer {
+public:
+    explicit SnapshotRenderer(const SnapshotConfig& config = SnapshotConfig());
+
+    void setTimeWindow(long long windowMs) { m_scene.setTimeWindow(windowMs); }
+    void setGraphs(std::vector<Metric> metrics) { m_scene.setGraphs(std::move(metrics)); }
+
+    // Draws every GPU in snapshot onto the canvas
+    void render(const GpuSnapshot& snapshot);
+    const RasterCanvas& canvas() const { return m_canvas; }
+    const GraphScene::FrameStats& lastFrame() const { return m_scene.lastFrame(); }
+
+    void encode(std::vector<uint8_t>& out) const;
+    bool write(const char* path) const;
+
+    static unsigned int defaultColumns(size_t devices);
+
+private:
+    SnapshotConfig m_config;
+    GraphScene m_scene;
+    DisplayList m_displayList;
+    RasterCanvas m_canvas;
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "metrics_source.hpp"
+
+struct SyntheticConfig {
+    unsigned int deviceCount = 8;
+    unsigned int processesPerDevice = 4;  // Average number of live processes per device
+    double processStartsPerMinute = 6.0;  // Per device; exits balance starts on average
+    double timeScale = 1.0;               // Simulated seconds per wall-clock second
+    long long stepMs = 0;                 // If set, each tick advances simulated time by this much instead
+    unsigned int seed = 1;
+};
+
+// Simulated GPU fleet for scale and load testing without hardware. Each device
+// alternates between idle and busy phases; temperature, fan, power and clocks
+// follow utilization with realistic lag, and processes start and exit at a
+// configurable rate.
+class SyntheticSource : public MetricsSource {
+public:
+    explicit SyntheticSource(const SyntheticConfig& config = SyntheticConfig());
+
+    bool initialize() override;
+    void shutdown() override {}
+
+    bool refreshDevices() override;
+    const std::vector<DeviceInfo>& devices() const override { return m_devices; }
+
+    SampleStatus beginSample(long long& timestampMs) override;
+    SampleStatus sampleDevice(size_t device, GpuMetrics& metrics, std::vector<ProcessInfo>& processes) override;
+
+    // Simulates GPUs being attached or detached; seen at the next refreshDevices()
+    void setDeviceCount(unsigned int count) { m_requestedCount = count; }
+
+private:
+    struct SimProcess {
+        unsigned int pid;
+        std::wstring name;
+        unsigned long long memory;
+        double share;    // Fraction of the device's utilization
+        double endTime;  // Simulated seconds
+    };
+
+    struct DeviceState {
+        std::mt19937 rng;
+        double lastTime = -1.0;
+        double phaseEnd = 0.0;
+        double targetUtil = 0.0;
+        double util = 0.0;
+        double temperature = 30.0;
+        double nextProcessStart = 0.0;
+        std::vector<SimProcess> processes;
+    };
+
+    double now() const;
+    void advance(DeviceState& state, double time);
+    void startProcess(DeviceState& state, double time);
+
+    SyntheticConfig m_config;
+    std::vector<DeviceInfo> m_devices;
+    std::vector<DeviceState> m_states;
+    std::atomic<unsigned int> m_requestedCount;
+    std::atomic<unsigned int> m_nextPid;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    // Stepped clock: wall-clock time of the first tick and ticks since
+    long long m_firstTimestampMs = 0;
+    long long m_ticks = 0;
+};
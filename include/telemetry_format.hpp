@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+struct GpuMetrics;
+
+// On-disk layout of telemetry recordings. Integers are little-endian.
+//
+//   TelemetryFileHeader
+//   block*                 one per TELEMETRY_SAMPLES_PER_BLOCK samples, or sooner when the device set changes
+//   TelemetryIndexEntry*   block index, written on close
+//   TelemetryIndexTrailer
+//
+// A recording cut short by a crash has no index; readers rebuild it by walking
+// the block headers. Each block is a TelemetryBlockHeader followed by a payload
+// of varint-encoded sections:
+//
+//   device table    count, then per device: index, uuid, name, total memory, power limit
+//   timestamps      column of zigzag deltas, the first relative to firstTimestampMs
+//   metric columns  one per device and RecordedField, zigzag deltas from the previous sample
+//   processes       per sample: row count, then per row the device slot, zigzag deltas of pid,
+//                   memory and utilization from the same row of the previous sample, and a name id
+//   process names   dictionary referenced by the process rows
+//
+// Every column and section is prefixed with its byte length so readers can skip it.
+
+constexpr uint32_t TELEMETRY_FILE_MAGIC = 0x5257564e;   // "NVWR"
+constexpr uint32_t TELEMETRY_BLOCK_MAGIC = 0x4b4c4254;  // "TBLK"
+constexpr uint32_t TELEMETRY_INDEX_MAGIC = 0x58444e49;  // "INDX"
+constexpr uint32_t TELEMETRY_VERSION = 1;
+constexpr size_t TELEMETRY_SAMPLES_PER_BLOCK = 60;
+
+struct TelemetryFileHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct TelemetryBlockHeader {
+    uint32_t magic;
+    uint32_t payloadSize;
+    int64_t firstTimestampMs;
+    int64_t lastTimestampMs;
+    uint32_t sampleCount;
+    uint32_t deviceCount;
+};
+
+struct TelemetryIndexEntry {
+    int64_t firstTimestampMs;
+    int64_t lastTimestampMs;
+    uint64_t offset;  // Of the block header, from the start of the file
+};
+
+struct TelemetryIndexTrailer {
+    uint64_t indexOffset;
+    uint32_t blockCount;
+    uint32_t magic;
+};
+
+static_assert(sizeof(TelemetryFileHeader) == 8, "unexpected padding");
+static_assert(sizeof(TelemetryBlockHeader) == 32, "unexpected padding");
+static_assert(sizeof(TelemetryIndexEntry) == 24, "unexpected padding");
+static_assert(sizeof(TelemetryIndexTrailer) == 16, "unexpected padding");
+
+// Dynamic GpuMetrics fields stored per sample. Power is kept in milliwatts,
+// which is what NVML reports, so every field round-trips exactly.
+enum class RecordedField : size_t {
+    GpuUtil,
+    MemUtil,
+    Temperature,
+    FanSpeed,
+    PowerMilliwatts,
+    CoreClock,
+    MemClock,
+    UsedMemory,
+    Count
+};
+
+constexpr size_t RECORDED_FIELD_COUNT = static_cast<size_t>(RecordedField::Count);
+
+// Delta base for process rows
+struct ProcessRow {
+    int64_t pid = 0;
+    int64_t memoryUsed = 0;
+    int64_t gpuUtil = 0;
+};
+
+void toRecordedFields(const GpuMetrics& metrics, int64_t (&fields)[RECORDED_FIELD_COUNT]);
+void fromRecordedFields(const int64_t (&fields)[RECORDED_FIELD_COUNT], GpuMetrics& metrics);
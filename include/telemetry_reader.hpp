@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "gpu_monitor.hpp"
+#include "telemetry_format.hpp"
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+};
+
+// One decoded block of a recording
+struct TelemetryBlock {
+    std::vector<DeviceInfo> devices;
+    std::vector<long long> timestamps;
+    std::vector<GpuMetrics> metrics;        // Sample-major: sample * devices.size() + device
+    std::vector<ProcessInfo> processes;
+    std::vector<size_t> processOffsets;     // Sample s owns processes [offsets[s], offsets[s + 1])
+
+    size_t sampleCount() const { return timestamps.size(); }
+};
+
+// Random access to a recording written by TelemetryRecorder. The file is
+// memory-mapped and the block index is read in place, so opening a multi-day
+// recording and seeking in it touches only the index and the blocks decoded.
+class TelemetryReader {
+public:
+    TelemetryReader();
+
+    bool open(const std::string& path);
+    void close();
+
+    size_t blockCount() const { return m_blockCount; }
+    TelemetryIndexEntry blockInfo(size_t block) const;
+    long long startTime() const;
+    long long endTime() const;
+
+    // True if the file had no index (the recorder did not close cleanly) and it was rebuilt by scanning
+    bool indexRebuilt() const { return m_indexRebuilt; }
+
+    // First block whose samples end at or after timestampMs, or blockCount() if none
+    size_t findBlock(long long timestampMs) const;
+
+    bool readBlock(size_t block, TelemetryBlock& out) const;
+
+private:
+    bool loadIndex();
+    void rebuildIndex();
+
+    MappedFile m_file;
+    const uint8_t* m_index;  // TelemetryIndexEntry array, in the mapping or in m_rebuiltIndex
+    size_t m_blockCount;
+    std::vector<TelemetryIndexEntry> m_rebuiltIndex;
+    bool m_indexRebuilt;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "gpu_monitor.hpp"
+#include "telemetry_format.hpp"
+
+// Appends every published snapshot to a compact binary recording (see
+// telemetry_format.hpp). Samples are delta-encoded into in-memory columns as
+// they arrive and written out a block at a time, so the per-sample cost is a
+// few dozen varint appends and the file grows by a few bytes per GPU per second.
+class TelemetryRecorder : public SnapshotSink {
+public:
+    TelemetryRecorder();
+    ~TelemetryRecorder() override;
+
+    TelemetryRecorder(const TelemetryRecorder&) = delete;
+    TelemetryRecorder& operator=(const TelemetryRecorder&) = delete;
+
+    bool open(const std::string& path);
+    // Writes the pending block and the block index
+    void close();
+    bool isOpen() const { return m_file != nullptr; }
+
+    void append(const GpuSnapshot& snapshot);
+    void onSnapshot(const GpuSnapshot& snapshot) override { append(snapshot); }
+
+    unsigned long long bytesWritten() const { return m_offset; }
+    unsigned long long samplesWritten() const { return m_totalSamples; }
+
+private:
+    bool matchesBlockDevices(const GpuSnapshot& snapshot) const;
+    void beginBlock(const GpuSnapshot& snapshot);
+    void flushBlock();
+    uint32_t nameId(const std::wstring& name);
+    bool write(const void* data, size_t size);
+
+    FILE* m_file;
+    unsigned long long m_offset;
+    unsigned long long m_totalSamples;
+    std::vector<TelemetryIndexEntry> m_index;
+
+    // Block being built. Buffers keep their capacity across blocks.
+    std::vector<DeviceInfo> m_devices;
+    uint32_t m_sampleCount;
+    int64_t m_firstTimestampMs;
+    int64_t m_lastTimestampMs;
+    std::vector<uint8_t> m_timestamps;
+    std::vector<std::vector<uint8_t>> m_columns;  // Device-major, RECORDED_FIELD_COUNT per device
+    std::vector<int64_t> m_previous;              // Last value per column, for deltas
+    std::vector<uint8_t> m_processes;
+    std::vector<ProcessRow> m_previousRows;
+    std::unordered_map<std::wstring, uint32_t> m_nameIds;
+    std::vector<const std::wstring*> m_names;     // By id, pointing into m_nameIds
+    std::vector<uint8_t> m_payload;
+};
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstddef>
+
+// Writes a Unix timestamp in milliseconds as ISO 8601 UTC, such as
+// 2024-05-01T12:00:00.250Z; out needs room for 25 characters
+void formatUtc(long long timestampMs, char* out, size_t size);
@@ -1,27 +1,51 @@
 #pragma once
 #include <windows.h>
 #include <memory>
+#include <string>
 #include "gpu_monitor.hpp"
 #include "graph_renderer.hpp"
 
+// Posted by the sampler thread whenever a new GPU snapshot is available
+constexpr UINT WM_GPU_SAMPLE = WM_APP + 1;
+// Posted once the monitor has tried to come up; wParam is nonzero if it did
+constexpr UINT WM_GPU_READY = WM_APP + 2;
+
 class MainWindow {
 public:
-    MainWindow();
+    MainWindow();  // Samples real GPUs every DEFAULT_INTERVAL_MS
+    MainWindow(std::unique_ptr<GpuMonitor> monitor, unsigned int intervalMs);
     ~MainWindow();
 
+    // Metrics graphed for each GPU instead of the defaults
+    void setGraphs(std::vector<Metric> metrics) { m_renderer->setGraphs(std::move(metrics)); }
+
+    // History drawn in the first frame and saved again on close; empty for none
+    void setHistoryPath(std::string path) { m_historyPath = std::move(path); }
+
+    // Shows the window at once; the monitor comes up in the background
     bool create();
     void show(int nCmdShow);
     HWND handle() const { return m_hwnd; }
+    bool failed() const { return m_failed; }  // The monitor could not be initialized
 
 private:
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
     LRESULT handleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
     void onPaint();
-    void onTimer();
+    void onSample();
+    void onReady(bool ready);
+    std::wstring statusText(const GpuSnapshot& snapshot) const;
+    bool updateVisibility();  // Tells the scheduler whether anyone is looking
     void onResize();
+    void onKeyDown(WPARAM key);
 
     HWND m_hwnd;
     std::unique_ptr<GpuMonitor> m_gpuMonitor;
+    unsigned int m_intervalMs;
     std::unique_ptr<GraphRenderer> m_renderer;
     bool m_isActive;
+    bool m_showOverlay;  // Latency table and startup times, toggled with D
+    bool m_failed;
+    bool m_firstFrame;
+    std::string m_historyPath;
 };
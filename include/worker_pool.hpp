@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Small fixed-size thread pool for fork/join work such as polling every GPU
+// of a tick in parallel. The calling thread takes part in the work as well.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threadCount);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return m_threads.size(); }
+
+    // Calls fn(i) for every i in [0, count) and returns once all calls finished
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    // CPU time the pool's own threads spent on jobs since the last call
+    std::chrono::microseconds takeCpuTime() {
+        return std::chrono::microseconds(m_cpuMicros.exchange(0, std::memory_order_relaxed));
+    }
+
+private:
+    void workerLoop();
+    bool runNext(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_workCv;
+    std::condition_variable m_doneCv;
+    const std::function<void(size_t)>* m_job;
+    size_t m_jobCount;
+    size_t m_nextIndex;
+    size_t m_pending;
+    bool m_stopping;
+    std::atomic<long long> m_cpuMicros;
+};
@@ -0,0 +1,436 @@
+#include "alert_engine.hpp"
+#include "metric_registry.hpp"
+#include "time_format.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+constexpr double NO_VALUE = std::numeric_limits<double>::quiet_NaN();
+
+// Reads the rules grammar described in alert_engine.hpp from one line
+class RuleParser {
+public:
+    explicit RuleParser(const std::string& line) : m_line(line), m_pos(0) {}
+
+    bool parse(AlertRule& rule, std::string& error) {
+        const size_t colon = m_line.find(':');
+        if (colon == std::string::npos) return fail(error, "expected 'name: condition'");
+        rule.name = trim(m_line.substr(0, colon));
+        if (rule.name.empty()) return fail(error, "missing rule name");
+        for (char c : rule.name) {
+            if (!isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.') {
+                return fail(error, "rule names may only contain letters, digits, '_', '-' and '.'");
+            }
+        }
+
+        m_pos = colon + 1;
+        do {
+            AlertCondition condition;
+            if (!parseCondition(condition, error)) return false;
+            rule.conditions.push_back(std::move(condition));
+        } while (acceptWord("and"));
+
+        skipSpace();
+        if (m_pos < m_line.size()) return fail(error, "unexpected '" + m_line.substr(m_pos) + "'");
+        return true;
+    }
+
+private:
+    bool parseCondition(AlertCondition& condition, std::string& error) {
+        skipSpace();
+        const size_t start = m_pos;
+        bool explicitAggregate = true;
+        if (acceptWord("min")) {
+            condition.aggregate = AlertAggregate::Min;
+        } else if (acceptWord("max")) {
+            condition.aggregate = AlertAggregate::Max;
+        } else if (acceptWord("avg")) {
+            condition.aggregate = AlertAggregate::Avg;
+        } else {
+            explicitAggregate = false;
+        }
+
+        if (!parseMetric(condition.metric, error)) return false;
+        skipSpace();
+        if (accept('/')) {
+            condition.ratio = true;
+            if (!parseMetric(condition.divisor, error)) return false;
+        }
+
+        skipSpace();
+        if (accept('>')) {
+            condition.compare = accept('=') ? AlertCompare::GreaterEqual : AlertCompare::Greater;
+        } else if (accept('<')) {
+            condition.compare = accept('=') ? AlertCompare::LessEqual : AlertCompare::Less;
+        } else {
+            return fail(error, "expected >, >=, < or <=");
+        }
+
+        skipSpace();
+        const char* begin = m_line.c_str() + m_pos;
+        char* end = nullptr;
+        condition.threshold = strtod(begin, &end);
+        if (end == begin) return fail(error, "expected a number");
+        m_pos += static_cast<size_t>(end - begin);
+        if (accept('%')) condition.threshold /= 100.0;
+
+        if (acceptWord("for") || acceptWord("over")) {
+            if (!parseDuration(condition.windowMs, error)) return false;
+            // Held throughout the window: never below a lower bound, never above an upper one
+            if (!explicitAggregate) {
+                const bool lower = condition.compare == AlertCompare::Greater ||
+                                   condition.compare == AlertCompare::GreaterEqual;
+                condition.aggregate = lower ? AlertAggregate::Min : AlertAggregate::Max;
+            }
+        } else if (explicitAggregate) {
+            return fail(error, "an aggregate needs 'over DURATION'");
+        }
+
+        condition.text = trim(m_line.substr(start, m_pos - start));
+        return true;
+    }
+
+    bool parseMetric(Metric& metric, std::string& error) {
+        skipSpace();
+        const size_t start = m_pos;
+        while (m_pos < m_line.size() && isWordChar(m_line[m_pos])) ++m_pos;
+        const std::string key = m_line.substr(start, m_pos - start);
+        if (key.empty()) return fail(error, "expected a metric");
+        if (!findMetric(key, metric)) return fail(error, "unknown metric '" + key + "'");
+        return true;
+    }
+
+    // A number directly followed by ms, s, m or h
+    bool parseDuration(long long& ms, std::string& error) {
+        skipSpace();
+        const char* begin = m_line.c_str() + m_pos;
+        char* end = nullptr;
+        const double amount = strtod(begin, &end);
+        if (end == begin || amount <= 0.0) return fail(error, "expected a duration such as 30s or 5m");
+        m_pos += static_cast<size_t>(end - begin);
+
+        double scale;
+        if (acceptSuffix("ms")) {
+            scale = 1.0;
+        } else if (acceptSuffix("s")) {
+            scale = 1000.0;
+        } else if (acceptSuffix("m")) {
+            scale = 60.0 * 1000.0;
+        } else if (acceptSuffix("h")) {
+            scale = 60.0 * 60.0 * 1000.0;
+        } else {
+            return fail(error, "durations need a unit: ms, s, m or h");
+        }
+        ms = static_cast<long long>(amount * scale);
+        return true;
+    }
+
+    static bool isWordChar(char c) {
+        return isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    static std::string trim(const std::string& text) {
+        const size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos) return std::string();
+        const size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+
+    void skipSpace() {
+        while (m_pos < m_line.size() && (m_line[m_pos] == ' ' || m_line[m_pos] == '\t' || m_line[m_pos] == '\r')) {
+            ++m_pos;
+        }
+    }
+
+    bool accept(char c) {
+        if (m_pos < m_line.size() && m_line[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    // word as a whole word after optional spaces
+    bool acceptWord(const char* word) {
+        skipSpace();
+        const size_t length = strlen(word);
+        if (m_line.compare(m_pos, length, word) != 0) return false;
+        if (m_pos + length < m_line.size() && isWordChar(m_line[m_pos + length])) return false;
+        m_pos += length;
+        return true;
+    }
+
+    // suffix directly at the cursor, not followed by more letters
+    bool acceptSuffix(const char* suffix) {
+        const size_t length = strlen(suffix);
+        if (m_line.compare(m_pos, length, suffix) != 0) return false;
+        if (m_pos + length < m_line.size() && isWordChar(m_line[m_pos + length])) return false;
+        m_pos += length;
+        return true;
+    }
+
+    static bool fail(std::string& error, const std::string& message) {
+        error = message;
+        return false;
+    }
+
+    const std::string& m_line;
+    size_t m_pos;
+};
+
+bool holds(AlertCompare compare, double value, double threshold) {
+    // NaN (no samples, or a zero divisor) compares false either way
+    switch (compare) {
+    case AlertCompare::Greater: return value > threshold;
+    case AlertCompare::GreaterEqual: return value >= threshold;
+    case AlertCompare::Less: return value < threshold;
+    case AlertCompare::LessEqual: return value <= threshold;
+    }
+    return false;
+}
+
+}
+
+SlidingWindow::SlidingWindow(AlertAggregate aggregate, long long lengthMs)
+    : m_aggregate(aggregate)
+    , m_lengthMs(lengthMs)
+    , m_sum(0.0)
+    , m_evicted(0)
+    , m_last(NO_VALUE)
+{
+}
+
+void SlidingWindow::add(long long timestampMs, double value) {
+    if (m_aggregate == AlertAggregate::Last) {
+        m_last = value;
+        return;
+    }
+
+    evict(timestampMs);
+    if (std::isnan(value)) return;
+
+    switch (m_aggregate) {
+    case AlertAggregate::Min:
+        // Older samples that are not smaller can never be the minimum again
+        while (!m_entries.empty() && m_entries.back().value >= value) m_entries.pop_back();
+        break;
+    case AlertAggregate::Max:
+        while (!m_entries.empty() && m_entries.back().value <= value) m_entries.pop_back();
+        break;
+    default:
+        m_sum += value;
+        break;
+    }
+    m_entries.push_back({ timestampMs, value });
+}
+
+void SlidingWindow::evict(long long timestampMs) {
+    const long long cutoff = timestampMs - m_lengthMs;
+    while (!m_entries.empty() && m_entries.front().timestampMs < cutoff) {
+        if (m_aggregate == AlertAggregate::Avg) {
+            m_sum -= m_entries.front().value;
+            ++m_evicted;
+        }
+        m_entries.pop_front();
+    }
+
+    // Subtracting leaves rounding error behind; summing afresh once per
+    // window's worth of evictions keeps it bounded at amortized O(1)
+    if (m_aggregate == AlertAggregate::Avg && m_evicted > m_entries.size()) {
+        m_sum = 0.0;
+        for (const Entry& entry : m_entries) m_sum += entry.value;
+        m_evicted = 0;
+    }
+}
+
+double SlidingWindow::value() const {
+    if (m_aggregate == AlertAggregate::Last) return m_last;
+    if (m_entries.empty()) return NO_VALUE;
+    if (m_aggregate == AlertAggregate::Avg) return m_sum / static_cast<double>(m_entries.size());
+    return m_entries.front().value;
+}
+
+void SlidingWindow::clear() {
+    m_entries.clear();
+    m_sum = 0.0;
+    m_evicted = 0;
+    m_last = NO_VALUE;
+}
+
+AlertEngine::AlertEngine()
+    : m_generation(0)
+    , m_firing(0)
+    , m_events(0)
+    , m_log(stderr)
+{
+}
+
+bool AlertEngine::load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), error);
+}
+
+bool AlertEngine::parse(const std::string& text, std::string& error) {
+    std::vector<AlertRule> rules;
+    std::vector<WindowKey> windows;
+    std::istringstream lines(text);
+    std::string line;
+    for (size_t number = 1; std::getline(lines, line); ++number) {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+        AlertRule rule;
+        std::string message;
+        if (!RuleParser(line).parse(rule, message)) {
+            error = "line " + std::to_string(number) + ": " + message;
+            return false;
+        }
+        for (const AlertRule& other : rules) {
+            if (other.name == rule.name) {
+                error = "line " + std::to_string(number) + ": duplicate rule '" + rule.name + "'";
+                return false;
+            }
+        }
+
+        for (AlertCondition& condition : rule.conditions) {
+            const WindowKey key = { condition.metric, condition.ratio, condition.divisor,
+                                    condition.aggregate, condition.windowMs };
+            size_t window = 0;
+            while (window < windows.size()) {
+                const WindowKey& other = windows[window];
+                if (other.metric == key.metric && other.ratio == key.ratio &&
+                    (!key.ratio || other.divisor == key.divisor) &&
+                    other.aggregate == key.aggregate && other.windowMs == key.windowMs) {
+                    break;
+                }
+                ++window;
+            }
+            if (window == windows.size()) windows.push_back(key);
+            condition.window = window;
+        }
+        rules.push_back(std::move(rule));
+    }
+
+    // Alert state belongs to the old rules, so it starts over
+    m_rules = std::move(rules);
+    m_windows = std::move(windows);
+    m_devices.clear();
+    m_firing = 0;
+    return true;
+}
+
+AlertEngine::Device& AlertEngine::device(const GpuMetrics& gpu, long long timestampMs) {
+    auto inserted = m_devices.emplace(gpu.uuid, Device());
+    Device& device = inserted.first->second;
+    if (inserted.second) {
+        device.windows.reserve(m_windows.size());
+        for (const WindowKey& key : m_windows) device.windows.emplace_back(key.aggregate, key.windowMs);
+        device.values.assign(m_windows.size(), NO_VALUE);
+        device.firing.assign(m_rules.size(), 0);
+        device.sinceMs.assign(m_rules.size(), 0);
+        device.firstMs = timestampMs;
+    } else if (timestampMs < device.lastMs) {
+        // The clock went backwards (a replay seek); windows start over
+        for (SlidingWindow& window : device.windows) window.clear();
+        device.firstMs = timestampMs;
+    }
+    device.index = gpu.index;
+    device.lastMs = timestampMs;
+    device.generation = m_generation;
+    return device;
+}
+
+void AlertEngine::evaluate(const GpuSnapshot& snapshot) {
+    if (m_rules.empty()) return;
+    ++m_generation;
+    const long long now = snapshot.timestampMs;
+
+    for (const GpuMetrics& gpu : snapshot.metrics) {
+        Device& state = device(gpu, now);
+
+        for (size_t w = 0; w < m_windows.size(); ++w) {
+            const WindowKey& key = m_windows[w];
+            double value = describe(key.metric).value(gpu);
+            if (key.ratio) {
+                const double divisor = describe(key.divisor).value(gpu);
+                value = divisor != 0.0 ? value / divisor : NO_VALUE;
+            }
+            state.windows[w].add(now, value);
+            state.values[w] = state.windows[w].value();
+        }
+
+        for (size_t r = 0; r < m_rules.size(); ++r) {
+            bool firing = true;
+            for (const AlertCondition& condition : m_rules[r].conditions) {
+                if (now - state.firstMs < condition.windowMs ||
+                    !holds(condition.compare, state.values[condition.window], condition.threshold)) {
+                    firing = false;
+                    break;
+                }
+            }
+            if (firing == (state.firing[r] != 0)) continue;
+
+            state.firing[r] = firing;
+            if (firing) state.sinceMs[r] = now;
+            report(m_rules[r], state, gpu.uuid, firing, now);
+        }
+    }
+
+    if (m_devices.size() != snapshot.metrics.size()) dropMissingDevices(now);
+}
+
+// Devices that have gone away resolve whatever they had firing
+void AlertEngine::dropMissingDevices(long long timestampMs) {
+    for (auto it = m_devices.begin(); it != m_devices.end();) {
+        if (it->second.generation == m_generation) {
+            ++it;
+            continue;
+        }
+        for (size_t r = 0; r < m_rules.size(); ++r) {
+            if (it->second.firing[r]) {
+                it->second.firing[r] = 0;
+                report(m_rules[r], it->second, it->first, false, timestampMs);
+            }
+        }
+        it = m_devices.erase(it);
+    }
+}
+
+void AlertEngine::report(const AlertRule& rule, const Device& device, const std::string& uuid,
+                         bool firing, long long timestampMs) {
+    const size_t r = static_cast<size_t>(&rule - m_rules.data());
+    firing ? ++m_firing : --m_firing;
+    ++m_events;
+
+    AlertEvent event = { &rule, device.index, uuid, firing, timestampMs, device.sinceMs[r], {} };
+    for (const AlertCondition& condition : rule.conditions) event.values.push_back(device.values[condition.window]);
+
+    if (m_log) {
+        char time[32];
+        formatUtc(timestampMs, time, sizeof(time));
+        fprintf(m_log, "%s %s %s gpu=%u uuid=%s", time, firing ? "FIRING" : "RESOLVED",
+                rule.name.c_str(), device.index, uuid.c_str());
+        if (firing) {
+            for (size_t c = 0; c < rule.conditions.size(); ++c) {
+                fprintf(m_log, "%s %s (%g)", c == 0 ? "" : " and", rule.conditions[c].text.c_str(), event.values[c]);
+            }
+        } else {
+            fprintf(m_log, " after %.1fs", (timestampMs - event.sinceMs) / 1000.0);
+        }
+        fputc('\n', m_log);
+        fflush(m_log);
+    }
+    if (m_listener) m_listener(event);
+}
@@ -0,0 +1,26 @@
+#include "cpu_time.hpp"
+#include "instrumentation.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+std::chrono::microseconds threadCpuTime() {
+    NVWINTOP_PROBE(Probe::ThreadCpuTime);
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return std::chrono::microseconds(0);
+
+    // FILETIME counts 100 ns units
+    auto toTicks = [](const FILETIME& time) {
+        return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return std::chrono::microseconds(static_cast<long long>((toTicks(kernel) + toTicks(user)) / 10));
+#else
+    timespec ts = {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return std::chrono::microseconds(static_cast<long long>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+#endif
+}
@@ -0,0 +1,96 @@
+#include "dashboard_layout.hpp"
+#include <algorithm>
+#include <cmath>
+
+using std::max;
+using std::min;
+
+namespace {
+
+constexpr float MARGIN = 10.0f;
+
+}
+
+DashboardLayout::DashboardLayout()
+    : m_columns(1)
+    , m_graphRows(0)
+    , m_panelWidth(0.0f)
+    , m_panelHeight(0.0f)
+    , m_pitch(1.0f)
+    , m_graphHeight(0.0f)
+    , m_contentHeight(0.0f)
+{}
+
+void DashboardLayout::update(const LayoutParams& params) {
+    m_params = params;
+    const size_t devices = params.devices;
+
+    if (params.mode == LayoutMode::Grid) {
+        m_columns = max<size_t>(1, static_cast<size_t>((params.width - MARGIN) / (GRID_CELL_WIDTH + MARGIN)));
+        m_panelWidth = (params.width - MARGIN) / m_columns;
+        m_panelHeight = GRID_CELL_HEIGHT;
+        m_pitch = GRID_CELL_HEIGHT + MARGIN;
+        m_graphRows = 0;
+        m_graphHeight = 0.0f;
+        const size_t rows = (devices + m_columns - 1) / m_columns;
+        m_contentHeight = MARGIN + rows * m_pitch;
+        return;
+    }
+
+    // Graphs share the viewport while that keeps them at least minGraphHeight tall
+    m_columns = max<size_t>(1, params.columns);
+    m_panelWidth = params.width / m_columns;
+    m_graphRows = (params.graphsPerDevice + 1) / 2;
+    const size_t rows = max<size_t>(1, (devices + m_columns - 1) / m_columns);
+    const size_t graphRows = max<size_t>(1, m_graphRows);
+    const float fit = (params.height - 2 * MARGIN - rows * HEADER_HEIGHT) / (graphRows * rows);
+    m_graphHeight = max(fit, params.minGraphHeight);
+    m_panelHeight = HEADER_HEIGHT + m_graphRows * m_graphHeight;
+    m_pitch = m_panelHeight;
+    m_contentHeight = devices == 0 ? 0.0f : 2 * MARGIN + rows * m_pitch;
+}
+
+float DashboardLayout::maxScroll() const {
+    return max(0.0f, m_contentHeight - m_params.height);
+}
+
+DlRect DashboardLayout::panelRect(size_t device) const {
+    const float top = MARGIN + (device / m_columns) * m_pitch;
+    if (m_params.mode == LayoutMode::Grid) {
+        const float left = MARGIN + (device % m_columns) * m_panelWidth;
+        return { left, top, left + m_panelWidth - MARGIN, top + m_panelHeight };
+    }
+    const float left = (device % m_columns) * m_panelWidth;
+    return { left, top, left + m_panelWidth, top + m_panelHeight };
+}
+
+DlRect DashboardLayout::headerRect(size_t device) const {
+    const DlRect panel = panelRect(device);
+    return { panel.left + MARGIN, panel.top, panel.right - MARGIN, panel.top + 30 };
+}
+
+DlRect DashboardLayout::graphRect(size_t device, size_t slot) const {
+    // Two graphs per row, with a gap above every row but the first
+    const DlRect panel = panelRect(device);
+    const float graphWidth = (m_panelWidth - 40) / 2;
+    const size_t row = slot / 2;
+    const float baseY = panel.top + HEADER_HEIGHT;
+    const float top = baseY + row * m_graphHeight + (row > 0 ? MARGIN : 0);
+    const float bottom = baseY + (row + 1) * m_graphHeight;
+    return slot % 2 == 0 ? DlRect{ panel.left + 10, top, panel.left + 10 + graphWidth, bottom }
+                         : DlRect{ panel.left + 20 + graphWidth, top, panel.right - 10, bottom };
+}
+
+std::pair<size_t, size_t> DashboardLayout::visibleRange(float top, float bottom) const {
+    const size_t devices = m_params.devices;
+    if (devices == 0 || bottom <= top) return { 0, 0 };
+
+    // A row is visible when its panels, not just the gap below them, overlap the band
+    const float firstRow = std::floor((top - MARGIN - m_panelHeight) / m_pitch) + 1;
+    const float endRow = std::ceil((bottom - MARGIN) / m_pitch);
+    const size_t rows = (devices + m_columns - 1) / m_columns;
+    const size_t first = static_cast<size_t>(min(max(firstRow, 0.0f), static_cast<float>(rows)));
+    const size_t end = static_cast<size_t>(min(max(endRow, 0.0f), static_cast<float>(rows)));
+    if (first >= end) return { 0, 0 };
+    return { first * m_columns, min(devices, end * m_columns) };
+}
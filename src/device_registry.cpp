@@ -0,0 +1,70 @@
+#include "device_registry.hpp"
+#include "instrumentation.hpp"
+#include <cstring>
+
+DeviceInfo DeviceRegistry::queryDevice(nvmlDevice_t handle, unsigned int index, const std::string& uuid) {
+    DeviceInfo info = {};
+    info.index = index;
+    info.uuid = uuid;
+
+    char name[NVML_DEVICE_NAME_BUFFER_SIZE];
+    if (NVWINTOP_TIMED(Probe::NvmlGetName, nvmlDeviceGetName(handle, name, NVML_DEVICE_NAME_BUFFER_SIZE)) == NVML_SUCCESS) {
+        info.name = std::wstring(name, name + strlen(name));
+    }
+
+    nvmlMemory_t memInfo;
+    if (NVWINTOP_TIMED(Probe::NvmlGetMemoryInfo, nvmlDeviceGetMemoryInfo(handle, &memInfo)) == NVML_SUCCESS) {
+        info.totalMemory = memInfo.total;
+    }
+
+    unsigned int powerLimit;
+    if (NVWINTOP_TIMED(Probe::NvmlGetEnforcedPowerLimit, nvmlDeviceGetEnforcedPowerLimit(handle, &powerLimit)) == NVML_SUCCESS) {
+        info.powerLimit = powerLimit / 1000; // Convert from milliwatts to watts
+    }
+
+    return info;
+}
+
+bool DeviceRegistry::refresh() {
+    unsigned int deviceCount = 0;
+    if (NVWINTOP_TIMED(Probe::NvmlGetCount, nvmlDeviceGetCount(&deviceCount)) != NVML_SUCCESS) {
+        deviceCount = 0;
+    }
+
+    std::vector<DeviceInfo> devices;
+    std::vector<nvmlDevice_t> handles;
+    devices.reserve(deviceCount);
+    handles.reserve(deviceCount);
+
+    for (unsigned int i = 0; i < deviceCount; ++i) {
+        nvmlDevice_t handle;
+        if (NVWINTOP_TIMED(Probe::NvmlGetHandleByIndex, nvmlDeviceGetHandleByIndex(i, &handle)) != NVML_SUCCESS) continue;
+
+        char uuid[NVML_DEVICE_UUID_BUFFER_SIZE];
+        if (NVWINTOP_TIMED(Probe::NvmlGetUuid, nvmlDeviceGetUUID(handle, uuid, NVML_DEVICE_UUID_BUFFER_SIZE)) != NVML_SUCCESS) continue;
+
+        // Known device: keep the cached properties, only the index may have moved
+        bool cached = false;
+        for (const auto& known : m_devices) {
+            if (known.uuid == uuid) {
+                devices.push_back(known);
+                devices.back().index = i;
+                cached = true;
+                break;
+            }
+        }
+        if (!cached) {
+            devices.push_back(queryDevice(handle, i, uuid));
+        }
+        handles.push_back(handle);
+    }
+
+    bool changed = devices.size() != m_devices.size();
+    for (size_t i = 0; !changed && i < devices.size(); ++i) {
+        changed = devices[i].uuid != m_devices[i].uuid;
+    }
+
+    m_devices = std::move(devices);
+    m_handles = std::move(handles);
+    return changed;
+}
@@ -0,0 +1,87 @@
+#include "display_list.hpp"
+
+void DisplayList::clear() {
+    m_commands.clear();
+    m_points.clear();
+    m_text.clear();
+}
+
+DlCommand& DisplayList::add(DlOp op, DlBrush brush, float width) {
+    DlCommand command = {};
+    command.op = op;
+    command.brush = brush;
+    command.font = DlFont::Text;
+    command.width = width;
+    m_commands.push_back(command);
+    return m_commands.back();
+}
+
+void DisplayList::fillRect(const DlRect& rect, DlBrush brush) {
+    add(DlOp::FillRect, brush, 0.0f).rect = rect;
+}
+
+void DisplayList::strokeRect(const DlRect& rect, DlBrush brush, float width) {
+    add(DlOp::StrokeRect, brush, width).rect = rect;
+}
+
+void DisplayList::line(DlPoint from, DlPoint to, DlBrush brush, float width) {
+    if (m_commands.empty() || m_commands.back().op != DlOp::Lines ||
+        m_commands.back().brush != brush || m_commands.back().width != width) {
+        DlCommand& command = add(DlOp::Lines, brush, width);
+        command.first = static_cast<uint32_t>(m_points.size());
+    }
+    m_points.push_back(from);
+    m_points.push_back(to);
+    m_commands.back().count += 2;
+}
+
+void DisplayList::polyline(const DlPoint* points, size_t count, DlBrush brush, float width) {
+    if (count < 2) return;
+    DlCommand& command = add(DlOp::Polyline, brush, width);
+    command.first = static_cast<uint32_t>(m_points.size());
+    command.count = static_cast<uint32_t>(count);
+    m_points.insert(m_points.end(), points, points + count);
+}
+
+void DisplayList::text(const wchar_t* text, size_t length, const DlRect& rect, DlFont font, DlBrush brush) {
+    DlCommand& command = add(DlOp::Text, brush, 0.0f);
+    command.font = font;
+    command.rect = rect;
+    command.first = static_cast<uint32_t>(m_text.size());
+    command.count = static_cast<uint32_t>(length);
+    m_text.insert(m_text.end(), text, text + length);
+}
+
+void DisplayList::pushClip(const DlRect& rect) {
+    add(DlOp::PushClip, DlBrush::Window, 0.0f).rect = rect;
+}
+
+void DisplayList::popClip() {
+    add(DlOp::PopClip, DlBrush::Window, 0.0f);
+}
+
+void DisplayList::append(const DisplayList& other) {
+    const uint32_t pointBase = static_cast<uint32_t>(m_points.size());
+    const uint32_t textBase = static_cast<uint32_t>(m_text.size());
+    for (DlCommand command : other.m_commands) {
+        if (command.op == DlOp::Text) command.first += textBase;
+        else if (command.op == DlOp::Lines || command.op == DlOp::Polyline) command.first += pointBase;
+        m_commands.push_back(command);
+    }
+    m_points.insert(m_points.end(), other.m_points.begin(), other.m_points.end());
+    m_text.insert(m_text.end(), other.m_text.begin(), other.m_text.end());
+}
+
+size_t DisplayList::primitiveCount() const {
+    size_t count = 0;
+    for (const DlCommand& command : m_commands) {
+        switch (command.op) {
+            case DlOp::Lines: count += command.count / 2; break;
+            case DlOp::Polyline: count += command.count - 1; break;
+            case DlOp::PushClip:
+            case DlOp::PopClip: break;
+            default: ++count; break;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,101 @@
+#include "event_log.hpp"
+#include "time_format.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+EventLog::EventLog(size_t capacity)
+    : m_capacity(capacity)
+    , m_sequence(0)
+    , m_total(0)
+{}
+
+void EventLog::append(std::vector<GpuEvent>& events) {
+    if (events.empty()) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (GpuEvent& event : events) {
+        insert(event);
+    }
+    while (m_events.size() > m_capacity) m_events.pop_front();
+    m_published.reset();
+}
+
+void EventLog::insert(GpuEvent& event) {
+    ++m_total;
+
+    // Merge into the GPU's newest event of the same kind if it is recent enough
+    for (auto it = m_events.rbegin(); it != m_events.rend(); ++it) {
+        if (it->uuid != event.uuid || it->type != event.type) continue;
+        if (event.type != GpuEventType::Throttle && it->data != event.data) continue;
+        if (event.timestampMs - it->lastMs > MERGE_GAP_MS || event.timestampMs < it->timestampMs) break;
+        it->lastMs = std::max(it->lastMs, event.timestampMs);
+        it->data |= event.data;
+        it->durationMs += event.durationMs;
+        it->count += event.count;
+        return;
+    }
+
+    // Events from the event thread and the sampler can arrive slightly out of order
+    event.sequence = ++m_sequence;
+    auto position = m_events.end();
+    while (position != m_events.begin() && std::prev(position)->timestampMs > event.timestampMs) --position;
+    m_events.insert(position, std::move(event));
+}
+
+std::shared_ptr<const std::vector<GpuEvent>> EventLog::events() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_published) {
+        m_published = std::make_shared<const std::vector<GpuEvent>>(m_events.begin(), m_events.end());
+    }
+    return m_published;
+}
+
+unsigned long long EventLog::total() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_total;
+}
+
+const char* eventTypeName(GpuEventType type) {
+    switch (type) {
+        case GpuEventType::Xid: return "xid";
+        case GpuEventType::EccError: return "ecc";
+        case GpuEventType::Throttle: return "throttle";
+    }
+    return "unknown";
+}
+
+std::string throttleReasonNames(unsigned long long mask) {
+    static const struct {
+        unsigned long long bit;
+        const char* name;
+    } REASONS[] = {
+        { throttle_reason::SW_POWER_CAP, "power_cap" },
+        { throttle_reason::HW_SLOWDOWN, "hw_slowdown" },
+        { throttle_reason::SW_THERMAL, "sw_thermal" },
+        { throttle_reason::HW_THERMAL, "hw_thermal" },
+        { throttle_reason::HW_POWER_BRAKE, "power_brake" },
+    };
+    std::string names;
+    for (const auto& reason : REASONS) {
+        if (!(mask & reason.bit)) continue;
+        if (!names.empty()) names += ',';
+        names += reason.name;
+    }
+    return names.empty() ? "other" : names;
+}
+
+std::string formatEvent(const GpuEvent& event) {
+    char time[32];
+    formatUtc(event.timestampMs, time, sizeof(time));
+    char line[256];
+    if (event.type == GpuEventType::Throttle) {
+        snprintf(line, sizeof(line), "%s throttle %s gpu=%u uuid=%s throttled_ms=%u", time,
+                 throttleReasonNames(event.data).c_str(), event.gpuIndex, event.uuid.c_str(), event.durationMs);
+    } else {
+        snprintf(line, sizeof(line), "%s %s %llu gpu=%u uuid=%s", time, eventTypeName(event.type),
+                 event.data, event.gpuIndex, event.uuid.c_str());
+    }
+    std::string result = line;
+    if (event.count > 1) result += " repeats=" + std::to_string(event.count);
+    return result;
+}
@@ -1,125 +1,423 @@
 #include "gpu_monitor.hpp"
-#include <windows.h>
-#include <psapi.h>
+#include "worker_pool.hpp"
+#include "nvml_source.hpp"
+#include "cpu_time.hpp"
+#include "history_store.hpp"
+#include "instrumentation.hpp"
 #include <algorithm>
 
-GpuMonitor::GpuMonitor() : m_initialized(false) {}
+namespace {
+
+// Raw samples for 10 minutes, 10s rollups for 6 hours, 1 minute rollups for 7 days
+std::vector<TierSpec> historyTiers(bool compressed) {
+    return {
+        { 1000, GpuMonitor::HISTORY_SIZE, compressed },
+        { 10 * 1000, 6 * 360, compressed },
+        { 60 * 1000, 7 * 24 * 60, compressed },
+    };
+}
+
+// Identity from the saved device, readings from its newest raw sample
+GpuMetrics restoredMetrics(const DeviceInfo& device, const MetricsHistory& history) {
+    GpuMetrics metrics = {};
+    metrics.index = device.index;
+    metrics.uuid = device.uuid;
+    metrics.name = device.name;
+    metrics.totalMemory = device.totalMemory;
+    metrics.powerLimit = device.powerLimit;
+    metrics.gpuUtil = static_cast<unsigned int>(history.latest(Metric::GpuUtil));
+    metrics.memUtil = static_cast<unsigned int>(history.latest(Metric::MemUtil));
+    metrics.temperature = static_cast<unsigned int>(history.latest(Metric::Temperature));
+    metrics.fanSpeed = static_cast<unsigned int>(history.latest(Metric::FanSpeed));
+    metrics.powerUsage = history.latest(Metric::PowerUsage);
+    metrics.coreClock = static_cast<unsigned int>(history.latest(Metric::CoreClock));
+    metrics.memClock = static_cast<unsigned int>(history.latest(Metric::MemClock));
+    metrics.usedMemory = static_cast<unsigned long long>(history.latest(Metric::UsedMemory));
+    return metrics;
+}
+
+}
+
+GpuMonitor::GpuMonitor()
+    : GpuMonitor(std::make_unique<NvmlSource>())
+{}
+
+GpuMonitor::GpuMonitor(std::unique_ptr<MetricsSource> source)
+    : m_source(std::move(source))
+    , m_initialized(false)
+    , m_state(MonitorState::Connecting)
+    , m_createdAt(std::chrono::steady_clock::now())
+    , m_historyLoadedUs(-1)
+    , m_initializedUs(-1)
+    , m_firstSampleUs(-1)
+    , m_firstFrameUs(-1)
+    , m_compressedHistory(false)
+    , m_rescanRequested(false)
+    , m_parallelCollection(true)
+    , m_snapshot(std::make_shared<GpuSnapshot>())
+    , m_eventsStopRequested(false)
+    , m_stopRequested(false)
+{}
 
 GpuMonitor::~GpuMonitor() {
+    stop();
+    stopEvents();
+    m_workerPool.reset();
     if (m_initialized) {
-        nvmlShutdown();
+        m_source->shutdown();
     }
 }
 
 bool GpuMonitor::initialize() {
     if (m_initialized) return true;
 
-    nvmlReturn_t result = nvmlInit();
-    if (result != NVML_SUCCESS) return false;
-
-    unsigned int deviceCount = 0;
-    result = nvmlDeviceGetCount(&deviceCount);
-    if (result != NVML_SUCCESS) return false;
+    if (!m_source->initialize()) {
+        m_state = MonitorState::Failed;
+        return false;
+    }
+    onDevicesChanged();
+    m_lastRescan = std::chrono::steady_clock::now();
+    if (m_source->openEvents()) {
+        m_eventThread = std::thread(&GpuMonitor::eventLoop, this);
+    }
 
-    m_metricsHistory.resize(deviceCount);
     m_initialized = true;
+    markStartup(m_initializedUs);
+    m_state.store(MonitorState::Running, std::memory_order_release);
     return true;
 }
 
-void GpuMonitor::update() {
-    if (!m_initialized) return;
+void GpuMonitor::markStartup(std::atomic<long long>& step) {
+    long long unset = -1;
+    const long long us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_createdAt).count();
+    step.compare_exchange_strong(unset, us);
+}
 
-    std::lock_guard<std::mutex> lock(m_mutex);
-    unsigned int deviceCount = 0;
-    nvmlDeviceGetCount(&deviceCount);
+StartupTimes GpuMonitor::startupTimes() const {
+    auto ms = [](const std::atomic<long long>& step) {
+        const long long us = step.load();
+        return us < 0 ? -1.0 : us / 1000.0;
+    };
+    StartupTimes times;
+    times.historyLoadedMs = ms(m_historyLoadedUs);
+    times.initializedMs = ms(m_initializedUs);
+    times.firstSampleMs = ms(m_firstSampleUs);
+    times.firstFrameMs = ms(m_firstFrameUs);
+    return times;
+}
+
+bool GpuMonitor::loadHistory(const std::string& path) {
+    if (m_initialized) return false;
+
+    long long savedAtMs = 0;
+    std::vector<StoredHistory> stored;
+    if (!readHistoryFile(path, savedAtMs, stored)) return false;
 
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::vector<TierSpec> specs = historyTiers(m_compressedHistory);
     m_currentMetrics.clear();
-    m_processInfo.clear();
+    m_currentHistory.clear();
+    for (const StoredHistory& device : stored) {
+        TieredHistory history(specs);
+        history.setName(device.device.name);
+        // Tiers are matched by resolution, so whatever still fits survives a change of tiers
+        for (size_t t = 0; t < history.tierCount(); ++t) {
+            for (const StoredTier& tier : device.tiers) {
+                if (tier.resolutionMs != specs[t].resolutionMs || tier.columnCount != history.tierColumns(t)) continue;
+                // A damaged tier is dropped rather than shown half restored
+                if (!history.restoreTier(t, tier.blocks)) history.clearTier(t);
+            }
+        }
+
+        // Keyed by UUID like live history, so sampling picks up where the saved history ends
+        auto it = m_historyByUuid.insert_or_assign(device.device.uuid, std::move(history)).first;
+        m_currentMetrics.push_back(restoredMetrics(device.device, it->second.view()));
+        m_currentHistory.push_back(&it->second);
+    }
+    m_lastTimestampMs = savedAtMs;
 
-    for (unsigned int i = 0; i < deviceCount; ++i) {
-        nvmlDevice_t device;
-        if (nvmlDeviceGetHandleByIndex(i, &device) != NVML_SUCCESS) continue;
+    // Sinks only see sampled data
+    publish(true);
+    markStartup(m_historyLoadedUs);
+    return true;
+}
 
-        GpuMetrics metrics = {};
-        metrics.index = i;
+bool GpuMonitor::saveHistory(const std::string& path) {
+    std::vector<StoredHistory> stored;
+    long long savedAtMs = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Without the source there are no attached devices; leave any earlier file alone
+        if (!m_initialized) return false;
 
-        // Get device name
-        char name[NVML_DEVICE_NAME_BUFFER_SIZE];
-        if (nvmlDeviceGetName(device, name, NVML_DEVICE_NAME_BUFFER_SIZE) == NVML_SUCCESS) {
-            metrics.name = std::wstring(name, name + strlen(name));
+        const auto& devices = m_source->devices();
+        for (size_t i = 0; i < devices.size() && i < m_activeHistory.size(); ++i) {
+            const MetricsHistory history = m_activeHistory[i]->view();
+            StoredHistory device;
+            device.device = devices[i];
+            for (size_t t = 0; t < history.tierCount(); ++t) {
+                const HistoryTier& tier = history.tier(t);
+                StoredTier out;
+                out.resolutionMs = tier.spec().resolutionMs;
+                out.columnCount = tier.columnCount();
+                tier.exportBlocks(out.blocks);
+                device.tiers.push_back(std::move(out));
+            }
+            stored.push_back(std::move(device));
         }
+        savedAtMs = m_lastTimestampMs;
+    }
+    return writeHistoryFile(path, savedAtMs, stored);
+}
 
-        // Get utilization
-        nvmlUtilization_t utilization;
-        if (nvmlDeviceGetUtilizationRates(device, &utilization) == NVML_SUCCESS) {
-            metrics.gpuUtil = utilization.gpu;
-            metrics.memUtil = utilization.memory;
-        }
+void GpuMonitor::onDevicesChanged() {
+    const auto& devices = m_source->devices();
 
-        // Get temperature
-        unsigned int temp;
-        if (nvmlDeviceGetTemperature(device, NVML_TEMPERATURE_GPU, &temp) == NVML_SUCCESS) {
-            metrics.temperature = temp;
+    // History is keyed by UUID, so a device keeps its history when indices shift
+    // and picks it up again if it disappears and comes back
+    m_activeHistory.clear();
+    for (const auto& device : devices) {
+        auto it = m_historyByUuid.find(device.uuid);
+        if (it == m_historyByUuid.end()) {
+            it = m_historyByUuid.emplace(device.uuid, TieredHistory(historyTiers(m_compressedHistory))).first;
+            it->second.setName(device.name);
         }
+        m_activeHistory.push_back(&it->second);
+    }
 
-        // Get fan speed
-        unsigned int fanSpeed;
-        if (nvmlDeviceGetFanSpeed(device, &fanSpeed) == NVML_SUCCESS) {
-            metrics.fanSpeed = fanSpeed;
-        }
+    // One worker per additional device; the sampler thread polls the first one itself
+    size_t threads = 0;
+    if (devices.size() > 1) {
+        threads = std::min<size_t>(devices.size(), std::max(1u, std::thread::hardware_concurrency())) - 1;
+    }
+    if (threads == 0) {
+        m_workerPool.reset();
+    } else if (!m_workerPool || m_workerPool->size() != threads) {
+        m_workerPool = std::make_unique<WorkerPool>(threads);
+    }
+}
 
-        // Get power usage
-        unsigned int power;
-        if (nvmlDeviceGetPowerUsage(device, &power) == NVML_SUCCESS) {
-            metrics.powerUsage = power / 1000.0; // Convert from milliwatts to watts
-        }
+void GpuMonitor::collectDevice(size_t device, DeviceSample& sample) {
+    NVWINTOP_PROBE(Probe::SampleDevice);
+    sample.valid = false;
+    sample.lost = false;
+    sample.processes.clear();
+    sample.subSamples.clear();
+    sample.events.clear();
 
-        // Get clock speeds
-        unsigned int clock;
-        if (nvmlDeviceGetClockInfo(device, NVML_CLOCK_GRAPHICS, &clock) == NVML_SUCCESS) {
-            metrics.coreClock = clock;
-        }
-        if (nvmlDeviceGetClockInfo(device, NVML_CLOCK_MEM, &clock) == NVML_SUCCESS) {
-            metrics.memClock = clock;
+    const DeviceInfo& info = m_source->devices()[device];
+    GpuMetrics metrics = {};
+    metrics.index = info.index;
+    metrics.uuid = info.uuid;
+    metrics.name = info.name;
+    metrics.totalMemory = info.totalMemory;
+    metrics.powerLimit = info.powerLimit;
+
+    SampleStatus status = m_source->sampleDevice(device, metrics, sample.processes);
+    if (status == SampleStatus::DeviceLost) {
+        sample.lost = true;
+        return;
+    }
+    if (status != SampleStatus::Ok) return;
+
+    m_source->collectSubSamples(device, sample.subSamples);
+    m_source->collectEvents(device, sample.events);
+    sample.metrics = std::move(metrics);
+    sample.valid = true;
+}
+
+bool GpuMonitor::update() {
+    if (!m_initialized) return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    NVWINTOP_PROBE(Probe::SampleTick);
+    auto tickStart = std::chrono::steady_clock::now();
+    auto cpuStart = threadCpuTime();
+    long long timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    SampleStatus tick = m_source->beginSample(timestampMs);
+    if (tick == SampleStatus::Failed) return false;
+    if (tick == SampleStatus::DeviceLost) m_rescanRequested = true;
+
+    // The device set rarely changes, so only re-enumerate every few seconds or after
+    // a device was lost. Time-based so the cost does not follow the sampling rate.
+    if (m_rescanRequested || tickStart - m_lastRescan >= std::chrono::milliseconds(RESCAN_INTERVAL_MS)) {
+        if (m_source->refreshDevices()) {
+            onDevicesChanged();
         }
+        m_rescanRequested = false;
+        m_lastRescan = tickStart;
+    }
 
-        // Get memory info
-        nvmlMemory_t memInfo;
-        if (nvmlDeviceGetMemoryInfo(device, &memInfo) == NVML_SUCCESS) {
-            metrics.totalMemory = memInfo.total;
-            metrics.usedMemory = memInfo.used;
+    const size_t deviceCount = m_source->devices().size();
+
+    // Each device writes only to its own slot, so collection needs no locking
+    m_deviceSamples.resize(deviceCount);
+    bool parallel = m_parallelCollection.load(std::memory_order_relaxed) && m_workerPool && deviceCount > 1;
+    if (parallel) {
+        m_workerPool->parallelFor(deviceCount, [this](size_t i) {
+            collectDevice(i, m_deviceSamples[i]);
+        });
+    } else {
+        for (size_t i = 0; i < deviceCount; ++i) {
+            collectDevice(i, m_deviceSamples[i]);
         }
+    }
 
-        m_currentMetrics.push_back(metrics);
+    // Merge in device order so the result matches the serial loop exactly
+    m_currentMetrics.clear();
+    m_currentHistory.clear();
+    m_processInfo.clear();
+    for (size_t i = 0; i < deviceCount; ++i) {
+        DeviceSample& sample = m_deviceSamples[i];
+        if (sample.lost) m_rescanRequested = true;
+        if (!sample.valid) continue;
 
-        // Update history
-        m_metricsHistory[i].push_back(metrics);
-        if (m_metricsHistory[i].size() > HISTORY_SIZE) {
-            m_metricsHistory[i].pop_front();
+        m_currentMetrics.push_back(sample.metrics);
+        m_tickEvents.insert(m_tickEvents.end(), sample.events.begin(), sample.events.end());
+        // Sub-samples first: they are older than the tick itself
+        if (!sample.subSamples.empty()) {
+            m_activeHistory[i]->pushSubSamples(sample.subSamples, sample.metrics);
         }
+        m_activeHistory[i]->push(sample.metrics, timestampMs);
+        m_currentHistory.push_back(m_activeHistory[i]);
 
-        // Get process information
-        unsigned int processCount = 0;
-        nvmlProcessInfo_t processes[32];
-        if (nvmlDeviceGetComputeRunningProcesses(device, &processCount, processes) == NVML_SUCCESS) {
-            for (unsigned int p = 0; p < processCount; ++p) {
-                ProcessInfo procInfo;
-                procInfo.gpuIndex = i;
-                procInfo.pid = processes[p].pid;
-                procInfo.memoryUsed = processes[p].usedGpuMemory;
-
-                // Get process name
-                HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processes[p].pid);
-                if (hProcess) {
-                    wchar_t processName[MAX_PATH];
-                    if (GetModuleBaseNameW(hProcess, NULL, processName, MAX_PATH)) {
-                        procInfo.name = processName;
-                    }
-                    CloseHandle(hProcess);
-                }
-
-                m_processInfo.push_back(procInfo);
+        // Names are resolved here, on one thread, so the cache needs no locking
+        for (auto& process : sample.processes) {
+            if (process.name.empty()) {
+                process.name = m_processNames.lookup(process.pid, process.startTime);
             }
+            m_processInfo.push_back(process);
+        }
+    }
+    m_processNames.endTick();
+    m_processHistory.update(m_processInfo, timestampMs);
+    m_processHistory.top(ProcessRanking::PeakMemory, m_processHistory.topCount(), m_topByMemory);
+    m_processHistory.top(ProcessRanking::AvgUtil, m_processHistory.topCount(), m_topByUtil);
+    m_eventLog.append(m_tickEvents);
+    m_tickEvents.clear();
+
+    m_lastSampleDuration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - tickStart);
+    m_lastSampleParallel = parallel;
+    m_lastTimestampMs = timestampMs;
+
+    // Worker threads report their own CPU time; the rest was spent on this one
+    auto cpuTime = threadCpuTime() - cpuStart;
+    if (m_workerPool) cpuTime += m_workerPool->takeCpuTime();
+    m_recentTicks.push_back({ tickStart, cpuTime });
+    m_recentCpuTime += cpuTime;
+    while (tickStart - m_recentTicks.front().time >= std::chrono::minutes(1)) {
+        m_recentCpuTime -= m_recentTicks.front().cpuTime;
+        m_recentTicks.pop_front();
+    }
+    const double spanSeconds = std::chrono::duration<double>(tickStart - m_recentTicks.front().time).count();
+    m_sampleRateHz = spanSeconds > 0.0 ? (m_recentTicks.size() - 1) / spanSeconds : 0.0;
+
+    NVWINTOP_PROBE(Probe::Publish);
+    auto snapshot = publish(false);
+    for (const auto& sink : m_sinks) {
+        sink->onSnapshot(*snapshot);
+    }
+    markStartup(m_firstSampleUs);
+    return true;
+}
+
+std::shared_ptr<const GpuSnapshot> GpuMonitor::publish(bool restored) {
+    auto snapshot = std::make_shared<GpuSnapshot>();
+    snapshot->restored = restored;
+    snapshot->metrics = m_currentMetrics;
+    snapshot->history.reserve(m_currentHistory.size());
+    for (const auto* history : m_currentHistory) {
+        snapshot->history.push_back(history->view());
+    }
+    snapshot->processes = m_processInfo;
+    snapshot->topByMemory = m_topByMemory;
+    snapshot->topByUtil = m_topByUtil;
+    snapshot->processesTracked = m_processHistory.size();
+    snapshot->timestampMs = m_lastTimestampMs;
+    snapshot->events = m_eventLog.events();
+    snapshot->sampleDuration = m_lastSampleDuration;
+    snapshot->sampledInParallel = m_lastSampleParallel;
+    snapshot->sampleRateHz = m_sampleRateHz;
+    snapshot->cpuTimePerMinute = m_recentCpuTime;
+    std::shared_ptr<const GpuSnapshot> published(std::move(snapshot));
+    std::atomic_store(&m_snapshot, published);
+    return published;
+}
+
+bool GpuMonitor::processSeries(const ProcessKey& key, std::vector<ProcessBucket>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_processHistory.series(key, out);
+}
+
+bool GpuMonitor::start(unsigned int intervalMs, std::function<void()> onSample) {
+    if (!m_initialized || m_samplerThread.joinable()) return false;
+
+    m_stopRequested = false;
+    m_samplerThread = std::thread(&GpuMonitor::samplerLoop, this, intervalMs, std::move(onSample));
+    return true;
+}
+
+bool GpuMonitor::startAsync(unsigned int intervalMs, std::function<void(bool)> onReady,
+                            std::function<void()> onSample) {
+    if (m_samplerThread.joinable()) return false;
+
+    m_stopRequested = false;
+    m_samplerThread = std::thread([this, intervalMs, onReady = std::move(onReady), onSample = std::move(onSample)]() {
+        const bool ready = initialize();
+        if (onReady) onReady(ready);
+        if (ready) samplerLoop(intervalMs, onSample);
+    });
+    return true;
+}
+
+void GpuMonitor::stop() {
+    if (!m_samplerThread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_samplerMutex);
+        m_stopRequested = true;
+    }
+    m_samplerCv.notify_all();
+    m_samplerThread.join();
+}
+
+void GpuMonitor::samplerLoop(unsigned int intervalMs, std::function<void()> onSample) {
+    auto nextTick = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_samplerMutex);
+    while (!m_stopRequested) {
+        lock.unlock();
+        if (update()) {
+            if (m_scheduler) intervalMs = m_scheduler->next(*getSnapshot());
+            if (onSample) onSample();
         }
+        lock.lock();
+
+        // Schedule against a fixed cadence so slow ticks don't accumulate drift
+        nextTick += std::chrono::milliseconds(intervalMs);
+        auto now = std::chrono::steady_clock::now();
+        if (nextTick < now) nextTick = now;
+        m_samplerCv.wait_until(lock, nextTick, [this] { return m_stopRequested; });
     }
 }
+
+void GpuMonitor::eventLoop() {
+    std::vector<GpuEvent> events;
+    while (!m_eventsStopRequested.load(std::memory_order_relaxed)) {
+        m_source->waitEvents(EVENT_WAIT_MS, events);
+        m_eventLog.append(events);
+        events.clear();
+    }
+    m_source->closeEvents();
+}
+
+// The driver's wait cannot be interrupted, so this returns within EVENT_WAIT_MS
+void GpuMonitor::stopEvents() {
+    if (!m_eventThread.joinable()) return;
+    m_eventsStopRequested = true;
+    m_eventThread.join();
+}
@@ -1,36 +1,18 @@
 #include "graph_renderer.hpp"
-#include <algorithm>
-#include <cmath>
-
-using std::max;
-using std::min;
-using std::ceil;
+#include "instrumentation.hpp"
 
 GraphRenderer::GraphRenderer()
     : m_hwnd(nullptr)
     , m_pD2DFactory(nullptr)
     , m_pRenderTarget(nullptr)
-    , m_pBrushText(nullptr)
-    , m_pBrushGraph(nullptr)
-    , m_pBrushBackground(nullptr)
+    , m_brushes()
     , m_pDWriteFactory(nullptr)
     , m_pTextFormat(nullptr)
     , m_pTitleFormat(nullptr)
-    , m_pBrushRed(nullptr)
-    , m_pBrushYellow(nullptr)
-    , m_pBrushSeparator(nullptr)
-    , m_pBrushNvidiaGreen(nullptr)
 {}
 
 GraphRenderer::~GraphRenderer() {
-    if (m_pBrushText) m_pBrushText->Release();
-    if (m_pBrushGraph) m_pBrushGraph->Release();
-    if (m_pBrushBackground) m_pBrushBackground->Release();
-    if (m_pBrushRed) m_pBrushRed->Release();
-    if (m_pBrushYellow) m_pBrushYellow->Release();
-    if (m_pBrushSeparator) m_pBrushSeparator->Release();
-    if (m_pBrushNvidiaGreen) m_pBrushNvidiaGreen->Release();
-    if (m_pRenderTarget) m_pRenderTarget->Release();
+    discardDeviceResources();
     if (m_pD2DFactory) m_pD2DFactory->Release();
     if (m_pTextFormat) m_pTextFormat->Release();
     if (m_pTitleFormat) m_pTitleFormat->Release();
@@ -88,7 +70,9 @@ void GraphRenderer::createDeviceResources() {
         D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties();
         props.pixelFormat = D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE);
 
-        D2D1_HWND_RENDER_TARGET_PROPERTIES hwndProps = D2D1::HwndRenderTargetProperties(m_hwnd, size);
+        // Partial frames draw over the previous one, so its pixels must survive presentation
+        D2D1_HWND_RENDER_TARGET_PROPERTIES hwndProps =
+            D2D1::HwndRenderTargetProperties(m_hwnd, size, D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS);
 
         HRESULT hr = m_pD2DFactory->CreateHwndRenderTarget(
             props,
@@ -97,241 +81,109 @@ void GraphRenderer::createDeviceResources() {
         );
 
         if (SUCCEEDED(hr)) {
-            m_pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(0.1f, 0.1f, 0.1f), &m_pBrushBackground);
-            m_pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(0x76/255.0f, 0xb9/255.0f, 0x00/255.0f), &m_pBrushNvidiaGreen);
-            m_pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.8f, 0.0f), &m_pBrushGraph);
-            m_pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(0.9f, 0.2f, 0.2f), &m_pBrushRed);
-            m_pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(0.9f, 0.9f, 0.2f), &m_pBrushYellow);
-            m_pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(0.4f, 0.4f, 0.4f), &m_pBrushSeparator);
+            static const D2D1_COLOR_F colors[DL_BRUSH_COUNT] = {
+                D2D1::ColorF(0.15f, 0.15f, 0.15f),                          // Window
+                D2D1::ColorF(0.1f, 0.1f, 0.1f),                             // Background
+                D2D1::ColorF(0.4f, 0.4f, 0.4f),                             // Separator
+                D2D1::ColorF(0x76/255.0f, 0xb9/255.0f, 0x00/255.0f),        // Green
+                D2D1::ColorF(0.9f, 0.9f, 0.2f),                             // Yellow
+                D2D1::ColorF(0.9f, 0.2f, 0.2f),                             // Red
+                D2D1::ColorF(0.12f, 0.2f, 0.08f),                           // GreenShade
+                D2D1::ColorF(0.25f, 0.23f, 0.08f),                          // YellowShade
+                D2D1::ColorF(0.3f, 0.1f, 0.1f),                             // RedShade
+            };
+            for (size_t i = 0; i < DL_BRUSH_COUNT; ++i) {
+                m_pRenderTarget->CreateSolidColorBrush(colors[i], &m_brushes[i]);
+            }
+            m_scene.invalidate();  // A new target starts out blank
         }
     }
 }
 
+void GraphRenderer::discardDeviceResources() {
+    for (ID2D1SolidColorBrush*& brush : m_brushes) {
+        if (brush) brush->Release();
+        brush = nullptr;
+    }
+    if (m_pRenderTarget) m_pRenderTarget->Release();
+    m_pRenderTarget = nullptr;
+}
+
 void GraphRenderer::resize() {
     if (m_pRenderTarget) {
         RECT rc;
         GetClientRect(m_hwnd, &rc);
         D2D1_SIZE_U size = D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top);
         m_pRenderTarget->Resize(size);
+        m_scene.invalidate();  // Resizing does not preserve contents
     }
 }
 
-void GraphRenderer::drawGraph(const D2D1_RECT_F& rect, 
-                            const std::deque<GpuMetrics>& history,
-                            const wchar_t* title,
-                            float currentValue,
-                            const wchar_t* units) {
-    // Draw background and border
-    m_pRenderTarget->FillRectangle(rect, m_pBrushBackground);
-    m_pRenderTarget->DrawRectangle(rect, m_pBrushSeparator, 1.0f);
+bool GraphRenderer::isOccluded() const {
+    return m_pRenderTarget && (m_pRenderTarget->CheckWindowState() & D2D1_WINDOW_STATE_OCCLUDED);
+}
 
-    // Calculate max value for scaling
-    float maxValue = 100.0f; // Default max for percentages
-    if (wcscmp(title, L"Temperature") == 0) {
-        maxValue = 100.0f; // Max temp in Celsius
-    } else if (wcscmp(title, L"Power Usage") == 0) {
-        // Find max power usage in history plus 20% headroom
-        maxValue = 0.0f;
-        for (const auto& metrics : history) {
-            if (wcscmp(title, L"Power Usage") == 0) {
-                maxValue = max(maxValue, static_cast<float>(metrics.powerUsage));
+void GraphRenderer::replay(const DisplayList& list) {
+    auto toRect = [](const DlRect& rect) { return D2D1::RectF(rect.left, rect.top, rect.right, rect.bottom); };
+    auto toPoint = [](const DlPoint& point) { return D2D1::Point2F(point.x, point.y); };
+
+    for (const DlCommand& command : list.commands()) {
+        ID2D1SolidColorBrush* brush = m_brushes[static_cast<size_t>(command.brush)];
+        switch (command.op) {
+            case DlOp::FillRect:
+                m_pRenderTarget->FillRectangle(toRect(command.rect), brush);
+                break;
+            case DlOp::StrokeRect:
+                m_pRenderTarget->DrawRectangle(toRect(command.rect), brush, command.width);
+                break;
+            case DlOp::Lines: {
+                const DlPoint* points = list.points(command);
+                for (uint32_t i = 0; i + 1 < command.count; i += 2) {
+                    m_pRenderTarget->DrawLine(toPoint(points[i]), toPoint(points[i + 1]), brush, command.width);
+                }
+                break;
+            }
+            case DlOp::Polyline: {
+                const DlPoint* points = list.points(command);
+                for (uint32_t i = 1; i < command.count; ++i) {
+                    m_pRenderTarget->DrawLine(toPoint(points[i - 1]), toPoint(points[i]), brush, command.width);
+                }
+                break;
             }
+            case DlOp::Text:
+                m_pRenderTarget->DrawText(
+                    list.text(command),
+                    command.count,
+                    command.font == DlFont::Title ? m_pTitleFormat : m_pTextFormat,
+                    toRect(command.rect),
+                    brush
+                );
+                break;
+            case DlOp::PushClip:
+                m_pRenderTarget->PushAxisAlignedClip(toRect(command.rect), D2D1_ANTIALIAS_MODE_ALIASED);
+                break;
+            case DlOp::PopClip:
+                m_pRenderTarget->PopAxisAlignedClip();
+                break;
         }
-        maxValue = ceil(maxValue * 1.2f); // Add 20% headroom and round up
-        if (maxValue < 50.0f) maxValue = 50.0f; // Minimum scale for power
-    }
-
-    const float graphHeight = rect.bottom - rect.top - 30;
-    const float graphWidth = rect.right - rect.left - 45;
-
-    // Draw grid lines
-    float scaleStep = graphHeight / 4;
-    for (int i = 1; i <= 4; i++) {
-        float y = rect.bottom - 5 - (i * scaleStep);
-        m_pRenderTarget->DrawLine(
-            D2D1::Point2F(rect.left + 5, y),
-            D2D1::Point2F(rect.right - 40, y),
-            m_pBrushSeparator,
-            0.5f
-        );
-    }
-
-    // Draw scale on the right
-    for (int i = 0; i <= 4; i++) {
-        float y = rect.bottom - 5 - (i * scaleStep);
-        float value = i * (maxValue / 4.0f);
-        wchar_t scaleText[8];
-        swprintf_s(scaleText, L"%.0f", value);
-        
-        // Choose text color based on value
-        ID2D1SolidColorBrush* textBrush = m_pBrushNvidiaGreen;
-        if (value > maxValue * 0.8f) textBrush = m_pBrushRed;
-        else if (value > maxValue * 0.6f) textBrush = m_pBrushYellow;
-        
-        m_pRenderTarget->DrawText(
-            scaleText,
-            wcslen(scaleText),
-            m_pTextFormat,
-            D2D1::RectF(rect.right - 35, y - 10, rect.right - 5, y + 10),
-            textBrush
-        );
-    }
-
-    // Draw title and current value
-    wchar_t valueText[64];
-    if (wcscmp(title, L"Temperature") == 0) {
-        swprintf_s(valueText, L"%.0f\u2103", currentValue);
-    } else if (wcscmp(title, L"Power Usage") == 0) {
-        swprintf_s(valueText, L"%.0fW", currentValue);
-    } else {
-        swprintf_s(valueText, L"%.1f%%", currentValue);
-    }
-    
-    // Choose text color based on current value
-    ID2D1SolidColorBrush* textBrush = m_pBrushNvidiaGreen;
-    float normalizedValue = currentValue;
-    if (wcscmp(title, L"Power Usage") == 0) {
-        normalizedValue = (currentValue / maxValue) * 100.0f;
-    }
-    
-    if (normalizedValue > 80.0f) textBrush = m_pBrushRed;
-    else if (normalizedValue > 60.0f) textBrush = m_pBrushYellow;
-    
-    m_pRenderTarget->DrawText(
-        title,
-        wcslen(title),
-        m_pTitleFormat,
-        D2D1::RectF(rect.left + 5, rect.top + 5, rect.right - 70, rect.top + 25),
-        textBrush
-    );
-
-    m_pRenderTarget->DrawText(
-        valueText,
-        wcslen(valueText),
-        m_pTextFormat,
-        D2D1::RectF(rect.right - 70, rect.top + 5, rect.right - 30, rect.top + 25),
-        textBrush
-    );
-
-    // Draw graph
-    if (history.size() < 2) return;
-
-    const float xStep = graphWidth / (history.size() - 1);
-    
-    std::vector<D2D1_POINT_2F> points;
-    points.reserve(history.size());
-
-    float x = rect.left + 5;
-    for (const auto& metrics : history) {
-        float value = 0.0f;
-        if (wcscmp(title, L"GPU Utilization") == 0) value = metrics.gpuUtil;
-        else if (wcscmp(title, L"Memory Utilization") == 0) value = metrics.memUtil;
-        else if (wcscmp(title, L"Temperature") == 0) value = metrics.temperature;
-        else if (wcscmp(title, L"Power Usage") == 0) value = static_cast<float>(metrics.powerUsage);
-
-        // Ensure value is within bounds
-        value = max(0.0f, min(value, maxValue));
-        
-        // Calculate y position
-        float y = rect.bottom - 5 - ((value / maxValue) * graphHeight);
-        points.push_back(D2D1::Point2F(x, y));
-        x += xStep;
-    }
-
-    // Draw the line graph with color based on value
-    for (size_t i = 1; i < points.size(); ++i) {
-        float value = (rect.bottom - points[i].y - 5) / graphHeight * maxValue;
-        ID2D1SolidColorBrush* brush = m_pBrushGraph;
-        
-        float percentage = (value / maxValue) * 100.0f;
-        if (percentage > 80.0f) brush = m_pBrushRed;
-        else if (percentage > 60.0f) brush = m_pBrushYellow;
-        else brush = m_pBrushNvidiaGreen;
-        
-        m_pRenderTarget->DrawLine(points[i-1], points[i], brush, 2.0f);
     }
 }
 
 void GraphRenderer::render(const std::vector<GpuMetrics>& currentMetrics,
-                         const std::vector<std::deque<GpuMetrics>>& history) {
+                         const std::vector<MetricsHistory>& history) {
+    NVWINTOP_PROBE(Probe::RenderFrame);
     createDeviceResources();
-
-    m_pRenderTarget->BeginDraw();
-    m_pRenderTarget->Clear(D2D1::ColorF(0.15f, 0.15f, 0.15f));
-
-    if (currentMetrics.empty() || history.empty()) {
-        m_pRenderTarget->EndDraw();
-        return;
-    }
+    if (!m_pRenderTarget) return;
 
     RECT rc;
     GetClientRect(m_hwnd, &rc);
-    const float width = static_cast<float>(rc.right - rc.left);
-    const float height = static_cast<float>(rc.bottom - rc.top);
-    
-    const float graphWidth = (width - 40) / 2;
-    const float graphHeight = (height - 20 - currentMetrics.size() * 40) / (2 * currentMetrics.size());
-    
-    for (size_t i = 0; i < currentMetrics.size(); ++i) {
-        float baseY = 10 + i * (graphHeight * 2 + 40);
-
-        // Draw GPU header with model name
-        wchar_t gpuHeader[256];
-        swprintf_s(gpuHeader, L"GPU %d: %s", i, currentMetrics[i].name.c_str());
-        m_pRenderTarget->DrawText(
-            gpuHeader,
-            wcslen(gpuHeader),
-            m_pTitleFormat,
-            D2D1::RectF(10, baseY, width - 10, baseY + 30),
-            m_pBrushNvidiaGreen
-        );
+    m_scene.resize(static_cast<float>(rc.right - rc.left), static_cast<float>(rc.bottom - rc.top));
+    m_scene.build(currentMetrics, history, m_displayList);
 
-        // Draw separator line
-        m_pRenderTarget->DrawLine(
-            D2D1::Point2F(10, baseY + 35),
-            D2D1::Point2F(width - 10, baseY + 35),
-            m_pBrushSeparator,
-            1.0f
-        );
-
-        baseY += 40;
-        
-        // GPU Utilization
-        drawGraph(
-            D2D1::RectF(10, baseY, 10 + graphWidth, baseY + graphHeight),
-            history[i],
-            L"GPU Utilization",
-            static_cast<float>(currentMetrics[i].gpuUtil),
-            L"%"
-        );
-
-        // Memory Utilization
-        drawGraph(
-            D2D1::RectF(20 + graphWidth, baseY, width - 10, baseY + graphHeight),
-            history[i],
-            L"Memory Utilization",
-            static_cast<float>(currentMetrics[i].memUtil),
-            L"%"
-        );
-
-        // Temperature
-        drawGraph(
-            D2D1::RectF(10, baseY + graphHeight + 10, 10 + graphWidth, baseY + graphHeight * 2),
-            history[i],
-            L"Temperature",
-            static_cast<float>(currentMetrics[i].temperature),
-            L"\u2103"
-        );
-
-        // Power Usage
-        drawGraph(
-            D2D1::RectF(20 + graphWidth, baseY + graphHeight + 10, width - 10, baseY + graphHeight * 2),
-            history[i],
-            L"Power Usage",
-            static_cast<float>(currentMetrics[i].powerUsage),
-            L"W"
-        );
+    m_pRenderTarget->BeginDraw();
+    replay(m_displayList);
+    if (m_pRenderTarget->EndDraw() == D2DERR_RECREATE_TARGET) {
+        // The device was lost; start over with a full frame on a new target
+        discardDeviceResources();
     }
-
-    m_pRenderTarget->EndDraw();
 }
@@ -0,0 +1,527 @@
+#include "graph_scene.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cwchar>
+#include <iterator>
+
+using std::max;
+using std::min;
+using std::ceil;
+
+namespace {
+
+// Partial frames repaint this far around a graph, which covers scale labels
+// that overhang its border without reaching the neighbouring graphs
+constexpr float GRAPH_MARGIN = 3.0f;
+
+// Green up to the metric's warning share of the scale, yellow up to its critical share, red above
+DlBrush levelBrush(const MetricDescriptor& descriptor, float percentage) {
+    if (percentage > descriptor.criticalPercent) return DlBrush::Red;
+    if (percentage > descriptor.warnPercent) return DlBrush::Yellow;
+    return DlBrush::Green;
+}
+
+// Dark tint of a level color, used as the background of grid cells
+DlBrush shadeBrush(DlBrush level) {
+    if (level == DlBrush::Red) return DlBrush::RedShade;
+    if (level == DlBrush::Yellow) return DlBrush::YellowShade;
+    return DlBrush::GreenShade;
+}
+
+DlRect inflate(const DlRect& rect, float amount) {
+    return { rect.left - amount, rect.top - amount, rect.right + amount, rect.bottom + amount };
+}
+
+DlRect offset(const DlRect& rect, float dy) {
+    return { rect.left, rect.top + dy, rect.right, rect.bottom + dy };
+}
+
+bool sameRect(const DlRect& a, const DlRect& b) {
+    return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+// Top of the scale in display units
+float scaleFor(const MetricDescriptor& descriptor, const HistoryWindow& window) {
+    float maxValue = descriptor.scaleMax;
+    if (descriptor.scale == MetricScale::Auto) {
+        float peak = 0.0f;
+        for (float value : window.max) {
+            peak = max(peak, value);
+        }
+        maxValue = max(maxValue, ceil(peak * static_cast<float>(descriptor.displayScale) * 1.2f));
+    }
+    return maxValue;
+}
+
+}
+
+GraphScene::GraphScene()
+    : m_width(0.0f)
+    , m_height(0.0f)
+    , m_timeWindowMs(DEFAULT_TIME_WINDOW_MS)
+    , m_mode(LayoutMode::Detail)
+    , m_columns(1)
+    , m_minGraphHeight(LayoutParams().minGraphHeight)
+    , m_scroll(0.0f)
+    , m_fullRepaint(true)
+    , m_graphMetrics(std::begin(DEFAULT_GRAPHS), std::end(DEFAULT_GRAPHS))
+    , m_eventsChanged(false)
+    , m_overlayChanged(false)
+    , m_statusChanged(false)
+{}
+
+void GraphScene::resize(float width, float height) {
+    if (width == m_width && height == m_height) return;
+    m_width = width;
+    m_height = height;
+    m_devices.clear();  // Forces a new layout
+    m_fullRepaint = true;
+}
+
+void GraphScene::setTimeWindow(long long windowMs) {
+    if (windowMs == m_timeWindowMs) return;
+    m_timeWindowMs = windowMs;
+    m_fullRepaint = true;
+}
+
+void GraphScene::setGraphs(std::vector<Metric> metrics) {
+    if (metrics.empty() || metrics == m_graphMetrics) return;
+    m_graphMetrics = std::move(metrics);
+    m_devices.clear();  // Forces a new layout
+    m_fullRepaint = true;
+}
+
+void GraphScene::setMode(LayoutMode mode) {
+    if (mode == m_mode) return;
+    m_mode = mode;
+    m_scroll = 0.0f;
+    m_devices.clear();  // Forces a new layout
+    m_fullRepaint = true;
+}
+
+void GraphScene::setColumns(size_t columns) {
+    columns = max<size_t>(columns, 1);
+    if (columns == m_columns) return;
+    m_columns = columns;
+    m_devices.clear();  // Forces a new layout
+    m_fullRepaint = true;
+}
+
+void GraphScene::setMinGraphHeight(float height) {
+    if (height == m_minGraphHeight) return;
+    m_minGraphHeight = height;
+    m_devices.clear();  // Forces a new layout
+    m_fullRepaint = true;
+}
+
+void GraphScene::setEvents(std::shared_ptr<const std::vector<GpuEvent>> events) {
+    if (events == m_events) return;
+    m_events = std::move(events);
+    m_eventsChanged = true;
+}
+
+void GraphScene::setOverlay(std::vector<ProbeSummary> rows) {
+    if (rows.empty() && m_overlay.empty()) return;
+    if (rows.size() < m_overlay.size()) m_fullRepaint = true;  // Uncovers what was beneath
+    m_overlay = std::move(rows);
+    m_overlayChanged = true;
+}
+
+void GraphScene::setStatus(std::wstring text) {
+    if (text == m_status) return;
+    if (text.empty()) m_fullRepaint = true;  // Uncovers what was beneath
+    m_status = std::move(text);
+    m_statusChanged = true;
+}
+
+void GraphScene::setScroll(float scroll) {
+    // Clamped against the current layout here, and again when the next frame lays out
+    scroll = max(0.0f, m_devices.empty() ? scroll : min(scroll, m_layout.maxScroll()));
+    if (scroll == m_scroll) return;
+    m_scroll = scroll;
+    m_fullRepaint = true;
+}
+
+LayoutParams GraphScene::layoutParams(size_t devices) const {
+    LayoutParams params;
+    params.mode = m_mode;
+    params.width = m_width;
+    params.height = m_height;
+    params.devices = devices;
+    params.graphsPerDevice = m_graphMetrics.size();
+    params.columns = m_columns;
+    params.minGraphHeight = m_minGraphHeight;
+    return params;
+}
+
+float GraphScene::contentHeight(size_t devices) const {
+    DashboardLayout layout;
+    layout.update(layoutParams(devices));
+    return layout.contentHeight();
+}
+
+bool GraphScene::devicesChanged(const std::vector<GpuMetrics>& metrics) const {
+    if (metrics.size() != m_devices.size()) return true;
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        if (metrics[i].index != m_devices[i].first || metrics[i].name != m_devices[i].second) return true;
+    }
+    return false;
+}
+
+// Only records what each slot shows; graphs get their place when they are first drawn
+void GraphScene::layout(const std::vector<GpuMetrics>& metrics) {
+    m_devices.clear();
+    m_graphs.clear();
+    m_layout.update(layoutParams(metrics.size()));
+    m_scroll = min(m_scroll, m_layout.maxScroll());
+
+    const size_t slots = m_mode == LayoutMode::Grid ? 1 : m_graphMetrics.size();
+    m_graphs.reserve(metrics.size() * slots);
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        m_devices.emplace_back(metrics[i].index, metrics[i].name);
+        for (size_t slot = 0; slot < slots; ++slot) {
+            Graph graph;
+            graph.descriptor = &describe(m_graphMetrics[slot]);
+            m_graphs.push_back(std::move(graph));
+        }
+    }
+}
+
+void GraphScene::place(Graph& graph, const DlRect& rect) {
+    if (sameRect(graph.rect, rect)) return;
+    graph.rect = rect;
+    graph.scaleMax = -1.0f;  // Chrome was built for the old position
+}
+
+bool GraphScene::graphChanged(const Graph& graph, const MetricsHistory& history, float value) const {
+    if (value != graph.value) return true;
+    if (history.empty()) return graph.samples != 0;
+    const HistoryTier& tier = history.selectTier(m_timeWindowMs);
+    return tier.latestTimestamp() != graph.latestMs || tier.size() != graph.samples ||
+           tier.spec().resolutionMs != graph.resolutionMs;
+}
+
+// Visible part of the graph's history, from the finest tier that still covers the time window
+HistoryWindow GraphScene::readWindow(Graph& graph, const MetricsHistory& history) {
+    HistoryWindow window;
+    graph.latestMs = -1;
+    graph.samples = 0;
+    graph.resolutionMs = 0;
+    if (!history.empty()) {
+        const HistoryTier& tier = history.selectTier(m_timeWindowMs);
+        window = m_historyReader.read(tier, graph.descriptor->metric, history.latestTimestamp() - m_timeWindowMs);
+        graph.latestMs = tier.latestTimestamp();
+        graph.samples = tier.size();
+        graph.resolutionMs = tier.spec().resolutionMs;
+    }
+    return window;
+}
+
+// Only formatted when the value changes
+void GraphScene::formatValue(Graph& graph, float value) {
+    if (value == graph.value) return;
+    const MetricDescriptor& descriptor = *graph.descriptor;
+    graph.value = value;
+    swprintf(graph.valueText, 16, L"%.*f%ls", descriptor.displayDecimals,
+             value * static_cast<float>(descriptor.displayScale), descriptor.unitSuffix);
+}
+
+void GraphScene::buildChrome(Graph& graph) {
+    const DlRect& rect = graph.rect;
+    const float maxValue = graph.scaleMax;
+    DisplayList& chrome = graph.chrome;
+    chrome.clear();
+
+    // Background and border
+    chrome.fillRect(rect, DlBrush::Background);
+    chrome.strokeRect(rect, DlBrush::Separator, 1.0f);
+
+    // Grid lines
+    const float graphHeight = rect.bottom - rect.top - 30;
+    const float scaleStep = graphHeight / 4;
+    for (int i = 1; i <= 4; i++) {
+        float y = rect.bottom - 5 - (i * scaleStep);
+        chrome.line({ rect.left + 5, y }, { rect.right - 40, y }, DlBrush::Separator, 0.5f);
+    }
+
+    // Scale on the right, colored by value
+    for (int i = 0; i <= 4; i++) {
+        float y = rect.bottom - 5 - (i * scaleStep);
+        float value = i * (maxValue / 4.0f);
+        wchar_t scaleText[8];
+        swprintf(scaleText, 8, L"%.0f", value);
+        chrome.text(scaleText, wcslen(scaleText), { rect.right - 35, y - 10, rect.right - 5, y + 10 },
+                    DlFont::Text, levelBrush(*graph.descriptor, value / maxValue * 100.0f));
+    }
+}
+
+// Sorts the event list by device; events of GPUs not shown are left out
+void GraphScene::bucketEvents(const std::vector<GpuMetrics>& metrics) {
+    m_deviceEvents.resize(metrics.size());
+    for (auto& events : m_deviceEvents) events.clear();
+    if (!m_events) return;
+    for (const GpuEvent& event : *m_events) {
+        for (size_t i = 0; i < metrics.size(); ++i) {
+            if (metrics[i].uuid != event.uuid) continue;
+            m_deviceEvents[i].push_back(&event);
+            break;
+        }
+    }
+}
+
+// Events of a device inside plot, which spans the time window from windowStart
+void GraphScene::drawMarkers(size_t device, const DlRect& plot, long long windowStart, float bandHeight,
+                             DisplayList& out) {
+    if (device >= m_deviceEvents.size()) return;
+    const float xScale = (plot.right - plot.left) / static_cast<float>(m_timeWindowMs);
+    auto toX = [&](long long timestampMs) {
+        return plot.left + static_cast<float>(timestampMs - windowStart) * xScale;
+    };
+
+    for (const GpuEvent* event : m_deviceEvents[device]) {
+        if (event->lastMs < windowStart) continue;
+        if (event->type == GpuEventType::Throttle) {
+            // Throttling shorter than a pixel or two would not show
+            float left = max(toX(event->timestampMs), plot.left);
+            float right = min(max(toX(event->lastMs), left + 2.0f), plot.right);
+            if (left >= plot.right) continue;
+            out.fillRect({ left, plot.top, right, plot.top + bandHeight }, DlBrush::Yellow);
+        } else {
+            const float x = toX(event->timestampMs);
+            if (x < plot.left || x > plot.right) continue;
+            out.line({ x, plot.top }, { x, plot.bottom }, DlBrush::Red, 1.0f);
+        }
+    }
+}
+
+// One row per probe: name, p50, p99, max and call count
+void GraphScene::drawOverlay(DisplayList& out) {
+    constexpr float ROW_HEIGHT = 16.0f;
+    constexpr float NAME_WIDTH = 255.0f;
+    constexpr float COLUMN_WIDTH = 62.0f;
+    constexpr float BOX_WIDTH = NAME_WIDTH + 4 * COLUMN_WIDTH + 10.0f;
+
+    const float left = max(0.0f, m_width - BOX_WIDTH - 5.0f);
+    const float top = 5.0f;
+    const DlRect box = { left, top, left + BOX_WIDTH, top + (m_overlay.size() + 1) * ROW_HEIGHT + 8.0f };
+    out.fillRect(box, DlBrush::Background);
+    out.strokeRect(box, DlBrush::Separator, 1.0f);
+
+    auto cell = [&](const std::wstring& text, size_t row, size_t column, DlBrush brush) {
+        const float x = left + 5.0f + (column == 0 ? 0.0f : NAME_WIDTH + (column - 1) * COLUMN_WIDTH);
+        const float y = top + 4.0f + row * ROW_HEIGHT;
+        const float width = column == 0 ? NAME_WIDTH : COLUMN_WIDTH;
+        out.text(text.c_str(), text.size(), { x, y, x + width, y + ROW_HEIGHT }, DlFont::Text, brush);
+    };
+    auto widen = [](const std::string& text) { return std::wstring(text.begin(), text.end()); };
+
+    const wchar_t* headers[] = { L"probe", L"p50", L"p99", L"max", L"calls" };
+    for (size_t c = 0; c < 5; ++c) cell(headers[c], 0, c, DlBrush::Yellow);
+    for (size_t r = 0; r < m_overlay.size(); ++r) {
+        const ProbeSummary& row = m_overlay[r];
+        cell(widen(probeName(row.probe)), r + 1, 0, DlBrush::Green);
+        cell(widen(formatDuration(row.p50Ns)), r + 1, 1, DlBrush::Green);
+        cell(widen(formatDuration(row.p99Ns)), r + 1, 2, DlBrush::Green);
+        cell(widen(formatDuration(row.maxNs)), r + 1, 3, DlBrush::Green);
+        cell(std::to_wstring(row.count), r + 1, 4, DlBrush::Green);
+    }
+}
+
+void GraphScene::drawStatus(DisplayList& out) {
+    constexpr float WIDTH = 420.0f;
+    constexpr float HEIGHT = 24.0f;
+
+    const DlRect box = { 5.0f, max(5.0f, m_height - HEIGHT - 5.0f), 5.0f + WIDTH, max(5.0f, m_height - 5.0f) };
+    out.fillRect(box, DlBrush::Background);
+    out.strokeRect(box, DlBrush::Separator, 1.0f);
+    out.text(m_status.c_str(), m_status.size(), { box.left + 6.0f, box.top + 4.0f, box.right - 6.0f, box.bottom },
+             DlFont::Text, DlBrush::Yellow);
+}
+
+// GPU header with model name, and a separator line below it
+void GraphScene::drawHeader(const GpuMetrics& metrics, const DlRect& rect, DisplayList& out) {
+    wchar_t gpuHeader[256];
+    swprintf(gpuHeader, 256, L"GPU %u: %ls", metrics.index, metrics.name.c_str());
+    out.text(gpuHeader, wcslen(gpuHeader), rect, DlFont::Title, DlBrush::Green);
+    out.line({ rect.left, rect.top + 35 }, { rect.right, rect.top + 35 }, DlBrush::Separator, 1.0f);
+}
+
+void GraphScene::drawGraph(Graph& graph, size_t device, const MetricsHistory& history, float currentValue,
+                           DisplayList& out) {
+    const DlRect& rect = graph.rect;
+    const MetricDescriptor& descriptor = *graph.descriptor;
+    const float displayScale = static_cast<float>(descriptor.displayScale);
+
+    const HistoryWindow window = readWindow(graph, history);
+    const long long windowStart = history.latestTimestamp() - m_timeWindowMs;
+    const Span<long long> times = window.timestamps;
+    const Span<float> values = window.avg;
+    const Span<float> minValues = window.min;
+    const Span<float> maxValues = window.max;
+    const bool rollup = window.rollup;
+
+    const float maxValue = scaleFor(descriptor, window);
+    if (maxValue != graph.scaleMax) {
+        graph.scaleMax = maxValue;
+        buildChrome(graph);
+    }
+    out.append(graph.chrome);
+
+    // Title and current value
+    formatValue(graph, currentValue);
+    const DlBrush textBrush = levelBrush(descriptor, currentValue * displayScale / maxValue * 100.0f);
+    out.text(descriptor.title, wcslen(descriptor.title), { rect.left + 5, rect.top + 5, rect.right - 70, rect.top + 25 },
+             DlFont::Title, textBrush);
+    out.text(graph.valueText, wcslen(graph.valueText), { rect.right - 70, rect.top + 5, rect.right - 30, rect.top + 25 },
+             DlFont::Text, textBrush);
+
+    const float graphHeight = rect.bottom - rect.top - 30;
+    const float graphWidth = rect.right - rect.left - 45;
+    const DlRect plot = { rect.left + 5, rect.bottom - 5 - graphHeight, rect.left + 5 + graphWidth, rect.bottom - 5 };
+    if (!history.empty()) drawMarkers(device, plot, windowStart, 3.0f, out);
+
+    if (values.size < 2) return;
+
+    // Place samples by timestamp so gaps and irregular intervals stay visible
+    const float xScale = graphWidth / static_cast<float>(m_timeWindowMs);
+    const PlotTransform transform = {
+        windowStart, rect.left + 5, xScale, rect.bottom - 5, graphHeight / maxValue, displayScale, maxValue
+    };
+
+    // Rollup tiers also show the min/max spread behind the average line
+    if (rollup) {
+        const std::vector<DlPoint>& spread =
+            m_polyline.buildSpread(times.data, minValues.data, maxValues.data, values.size, transform);
+        for (size_t i = 0; i + 1 < spread.size(); i += 2) {
+            out.line(spread[i], spread[i + 1], DlBrush::Separator, 1.0f);
+        }
+    }
+
+    // At most two points per pixel column however long the history is
+    const std::vector<DlPoint>& points = m_polyline.build(times.data, values.data, values.size, transform);
+
+    // Each segment is colored by the value it ends at, found by comparing
+    // against the thresholds' heights; runs of one color become one polyline
+    const float warnY = rect.bottom - 5 - descriptor.warnPercent / 100.0f * graphHeight;
+    const float criticalY = rect.bottom - 5 - descriptor.criticalPercent / 100.0f * graphHeight;
+    size_t runStart = 0;
+    DlBrush runBrush = DlBrush::Green;
+    for (size_t i = 1; i < points.size(); ++i) {
+        const float y = points[i].y;
+        DlBrush brush = y < criticalY ? DlBrush::Red : (y < warnY ? DlBrush::Yellow : DlBrush::Green);
+        if (i == 1) {
+            runBrush = brush;
+        } else if (brush != runBrush) {
+            out.polyline(&points[runStart], i - runStart, runBrush, 2.0f);
+            runStart = i - 1;
+            runBrush = brush;
+        }
+    }
+    out.polyline(&points[runStart], points.size() - runStart, runBrush, 2.0f);
+}
+
+// Compact cell: GPU number and current value over a sparkline, on a
+// background tinted by the load level
+void GraphScene::drawCell(Graph& graph, size_t device, const GpuMetrics& metrics, const MetricsHistory& history,
+                          float currentValue, DisplayList& out) {
+    const DlRect& rect = graph.rect;
+    const MetricDescriptor& descriptor = *graph.descriptor;
+    const float displayScale = static_cast<float>(descriptor.displayScale);
+
+    const HistoryWindow window = readWindow(graph, history);
+    const float maxValue = scaleFor(descriptor, window);
+    formatValue(graph, currentValue);
+    const DlBrush level = levelBrush(descriptor, currentValue * displayScale / maxValue * 100.0f);
+
+    out.fillRect(rect, shadeBrush(level));
+    out.strokeRect(rect, DlBrush::Separator, 1.0f);
+
+    wchar_t label[16];
+    swprintf(label, 16, L"GPU %u", metrics.index);
+    out.text(label, wcslen(label), { rect.left + 5, rect.top + 3, rect.right - 60, rect.top + 19 },
+             DlFont::Title, level);
+    out.text(graph.valueText, wcslen(graph.valueText), { rect.right - 60, rect.top + 3, rect.right - 5, rect.top + 19 },
+             DlFont::Text, level);
+
+    const float sparkHeight = rect.bottom - rect.top - 27;
+    if (!history.empty()) {
+        const DlRect plot = { rect.left + 5, rect.bottom - 5 - sparkHeight, rect.right - 5, rect.bottom - 5 };
+        drawMarkers(device, plot, history.latestTimestamp() - m_timeWindowMs, 2.0f, out);
+    }
+
+    if (window.avg.size < 2) return;
+    const PlotTransform transform = {
+        history.latestTimestamp() - m_timeWindowMs, rect.left + 5,
+        (rect.right - rect.left - 10) / static_cast<float>(m_timeWindowMs),
+        rect.bottom - 5, sparkHeight / maxValue, displayScale, maxValue
+    };
+    const std::vector<DlPoint>& points =
+        m_polyline.build(window.timestamps.data, window.avg.data, window.avg.size, transform);
+    out.polyline(points.data(), points.size(), level, 1.0f);
+}
+
+const GraphScene::FrameStats& GraphScene::build(const std::vector<GpuMetrics>& metrics,
+                                                const std::vector<MetricsHistory>& history,
+                                                DisplayList& out) {
+    NVWINTOP_PROBE(Probe::SceneBuild);
+    out.clear();
+    m_stats = FrameStats();
+
+    if (devicesChanged(metrics)) {
+        layout(metrics);
+        m_fullRepaint = true;
+    }
+
+    const bool full = m_fullRepaint;
+    m_fullRepaint = false;
+
+    // New events can land on any graph, so every visible one is redrawn
+    const bool eventsChanged = m_eventsChanged;
+    m_eventsChanged = false;
+    if (eventsChanged || full) bucketEvents(metrics);
+    if (full) {
+        out.fillRect({ 0, 0, m_width, m_height }, DlBrush::Window);
+    }
+
+    // Everything is laid out in content coordinates; only GPUs overlapping the viewport are touched
+    const bool grid = m_mode == LayoutMode::Grid;
+    const size_t slots = grid ? 1 : m_graphMetrics.size();
+    const std::pair<size_t, size_t> visible = m_layout.visibleRange(m_scroll, m_scroll + m_height);
+    const size_t end = min(visible.second, min(metrics.size(), history.size()));
+    for (size_t i = visible.first; i < end; ++i) {
+        ++m_stats.devicesVisible;
+        if (full && !grid) drawHeader(metrics[i], offset(m_layout.headerRect(i), -m_scroll), out);
+
+        for (size_t slot = 0; slot < slots; ++slot) {
+            Graph& graph = m_graphs[i * slots + slot];
+            place(graph, offset(grid ? m_layout.panelRect(i) : m_layout.graphRect(i, slot), -m_scroll));
+            const float value = static_cast<float>(graph.descriptor->value(metrics[i]));
+            if (!full && !eventsChanged && !graphChanged(graph, history[i], value)) continue;
+
+            if (!full) {
+                const DlRect area = inflate(graph.rect, GRAPH_MARGIN);
+                out.pushClip(area);
+                out.fillRect(area, DlBrush::Window);
+            }
+            if (grid) {
+                drawCell(graph, i, metrics[i], history[i], value, out);
+            } else {
+                drawGraph(graph, i, history[i], value, out);
+            }
+            if (!full) out.popClip();
+            ++m_stats.graphsDrawn;
+        }
+    }
+
+    // On top of whatever was drawn this frame
+    if (!m_overlay.empty() && (full || m_overlayChanged || m_stats.graphsDrawn > 0)) drawOverlay(out);
+    m_overlayChanged = false;
+    if (!m_status.empty() && (full || m_statusChanged || m_stats.graphsDrawn > 0)) drawStatus(out);
+    m_statusChanged = false;
+
+    m_stats.fullRepaint = full;
+    m_stats.commands = out.commands().size();
+    m_stats.primitives = out.primitiveCount();
+    return m_stats;
+}
@@ -0,0 +1,510 @@
+#include "gpu_monitor.hpp"
+#include "alert_engine.hpp"
+#include "sample_writer.hpp"
+#include "nvml_source.hpp"
+#include "synthetic_source.hpp"
+#include "replay_source.hpp"
+#include "telemetry_recorder.hpp"
+#include "metrics_exporter.hpp"
+#include "shm_publisher.hpp"
+#include "metric_registry.hpp"
+#include "snapshot_renderer.hpp"
+#include "instrumentation.hpp"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+namespace {
+
+volatile std::sig_atomic_t g_stopRequested = 0;
+
+void onSignal(int) {
+    g_stopRequested = 1;
+}
+
+void printUsage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s --headless [options]\n"
+        "  --interval MS     Sampling interval in milliseconds (default %u)\n"
+        "  --count N         Stop after N samples (default: run until interrupted)\n"
+        "  --adaptive        Sample faster while metrics move and slower while they are steady\n"
+        "  --min-interval MS Fastest adaptive interval (default %u)\n"
+        "  --max-interval MS Slowest adaptive interval (default %u)\n"
+        "  --format FORMAT   csv, jsonl or none (default csv)\n"
+        "  --metrics LIST    Comma-separated metrics to write (default all)\n"
+        "  --list-metrics    Print the available metrics and exit\n"
+        "  --serial          Poll GPUs one after another instead of in parallel\n"
+        "  --synthetic N     Simulate N GPUs instead of reading NVML\n"
+        "  --processes N     Average processes per simulated GPU (default %u)\n"
+        "  --churn N         Process starts per simulated GPU per minute (default %.0f)\n"
+        "  --time-scale X    Simulated seconds per real second (default 1)\n"
+        "  --listen PORT     Serve OpenMetrics at http://ADDRESS:PORT/metrics\n"
+        "  --listen-address ADDRESS  Address to serve on (default 127.0.0.1)\n"
+        "  --shm             Publish samples to shared memory for local readers\n"
+        "  --shm-name NAME   Shared-memory segment name (default %s)\n"
+        "  --record FILE     Also write every sample to a binary recording\n"
+        "  --replay FILE     Play back a recording instead of reading NVML\n"
+        "  --speed X         Replay speed relative to real time, 0 for unpaced (default 1)\n"
+        "  --from MS         Start the replay at this Unix timestamp in milliseconds\n"
+        "  --compress-history  Keep history in compressed blocks\n"
+        "  --history FILE    Start from the history saved in FILE, and save it there on exit\n"
+        "  --alerts FILE     Evaluate the alert rules in FILE against every sample\n"
+        "  --alert-log FILE  Append firing and resolved alerts to FILE (default stderr)\n"
+        "  --events          Print XIDs, ECC errors and throttling to stderr as they are seen\n"
+        "  --top N           Print the N processes with the most memory and utilization over the last hour on exit\n"
+        "  --stats           Print sampling cost, history size, peak memory, startup times and call latencies\n"
+        "                    to stderr on exit\n"
+        "  --snapshot FILE   Write the graphs to a PNG image when sampling stops\n"
+        "  --snapshot-width PX  Image width (default %u)\n"
+        "  --snapshot-columns N GPUs side by side (default: 1 to 4 by GPU count)\n"
+        "  --debug-overlay   Draw the call latency table over the snapshot\n"
+        "  --layout MODE     detail for full graphs, grid for a compact cell per GPU (default detail)\n"
+        "  --graphs LIST     Comma-separated metrics graphed for each GPU\n"
+        "  --time-window S   Seconds of history shown in the snapshot (default %lld)\n",
+        program, GpuMonitor::DEFAULT_INTERVAL_MS,
+        SchedulerConfig().minIntervalMs, SchedulerConfig().maxIntervalMs,
+        SyntheticConfig().processesPerDevice, SyntheticConfig().processStartsPerMinute, SHM_DEFAULT_NAME,
+        SnapshotConfig().width, GraphScene::DEFAULT_TIME_WINDOW_MS / 1000);
+}
+
+void printMetrics() {
+    for (const MetricDescriptor& descriptor : METRIC_DESCRIPTORS) {
+        printf("%-16s %s\n", descriptor.key, descriptor.help);
+    }
+}
+
+// Reports how much memory history takes against plain columns, and how fast
+// every tier decodes back into windows
+void printHistoryStats(const GpuSnapshot& snapshot) {
+    size_t memoryBytes = 0;
+    size_t rawBytes = 0;
+    for (const auto& history : snapshot.history) {
+        memoryBytes += history.memoryBytes();
+        rawBytes += history.rawBytes();
+    }
+
+    HistoryReader reader;
+    unsigned long long values = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& history : snapshot.history) {
+        for (size_t t = 0; t < history.tierCount(); ++t) {
+            const HistoryTier& tier = history.tier(t);
+            for (size_t m = 0; m < METRIC_COUNT; ++m) {
+                HistoryWindow window = reader.read(tier, static_cast<Metric>(m), LLONG_MIN);
+                values += window.avg.size * (tier.isRollup() ? STAT_COUNT : 1);
+            }
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(stderr, "history_kb=%zu history_raw_kb=%zu compression_ratio=%.1f decode_mvalues_per_s=%.1f\n",
+        memoryBytes / 1024, rawBytes / 1024,
+        memoryBytes ? static_cast<double>(rawBytes) / memoryBytes : 0.0,
+        seconds > 0.0 ? values / seconds / 1e6 : 0.0);
+}
+
+// Process names are ASCII in practice; anything else is replaced
+std::string narrow(const std::wstring& text) {
+    std::string out;
+    for (wchar_t c : text) out += c > 0x20 && c < 0x7f ? static_cast<char>(c) : '_';
+    return out;
+}
+
+void printTopProcesses(const char* ranking, const std::vector<ProcessUsage>& rows, long long nowMs) {
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const ProcessUsage& row = rows[i];
+        fprintf(stderr, "top=%s rank=%zu gpu=%u pid=%u name=%s peak_mem_mib=%llu avg_util=%.1f"
+            " mem_mib=%llu util=%u age_s=%lld %s\n",
+            ranking, i + 1, row.key.gpuIndex, row.key.pid, row.name.empty() ? "-" : narrow(row.name).c_str(),
+            row.peakMemory >> 20, row.avgUtil, row.memoryUsed >> 20, row.gpuUtil,
+            (nowMs - row.firstSeenMs) / 1000, row.running ? "running" : "exited");
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int intervalMs = GpuMonitor::DEFAULT_INTERVAL_MS;
+    unsigned long long count = 0;
+    OutputFormat format = OutputFormat::Csv;
+    bool parallel = true;
+    bool synthetic = false;
+    bool intervalSet = false;
+    bool printStats = false;
+    bool compressHistory = false;
+    bool writeOutput = true;
+    bool formatSet = false;
+    std::vector<Metric> outputMetrics;
+    int listenPort = -1;
+    const char* listenAddress = "127.0.0.1";
+    bool publishShm = false;
+    bool adaptive = false;
+    SchedulerConfig schedulerConfig;
+    const char* shmName = SHM_DEFAULT_NAME;
+    SyntheticConfig syntheticConfig;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    double replaySpeed = 1.0;
+    bool speedSet = false;
+    long long replayFrom = 0;
+    const char* snapshotPath = nullptr;
+    SnapshotConfig snapshotConfig;
+    std::vector<Metric> graphs;
+    long long timeWindowMs = GraphScene::DEFAULT_TIME_WINDOW_MS;
+    const char* alertsPath = nullptr;
+    const char* alertLogPath = nullptr;
+    bool printEvents = false;
+    size_t topProcesses = 0;
+    const char* historyPath = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--headless") == 0) {
+            // The only mode on this platform; accepted for command-line compatibility
+        } else if (strcmp(arg, "--interval") == 0 && value) {
+            intervalMs = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+            intervalSet = true;
+            ++i;
+        } else if (strcmp(arg, "--count") == 0 && value) {
+            count = strtoull(value, nullptr, 10);
+            ++i;
+        } else if (strcmp(arg, "--adaptive") == 0) {
+            adaptive = true;
+        } else if (strcmp(arg, "--min-interval") == 0 && value) {
+            schedulerConfig.minIntervalMs = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+            adaptive = true;
+            ++i;
+        } else if (strcmp(arg, "--max-interval") == 0 && value) {
+            schedulerConfig.maxIntervalMs = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+            adaptive = true;
+            ++i;
+        } else if (strcmp(arg, "--format") == 0 && value) {
+            if (strcmp(value, "csv") == 0) {
+                format = OutputFormat::Csv;
+            } else if (strcmp(value, "jsonl") == 0 || strcmp(value, "json") == 0) {
+                format = OutputFormat::JsonLines;
+            } else if (strcmp(value, "none") == 0) {
+                writeOutput = false;
+            } else {
+                printUsage(argv[0]);
+                return 2;
+            }
+            formatSet = true;
+            ++i;
+        } else if (strcmp(arg, "--metrics") == 0 && value) {
+            if (!parseMetricList(value, outputMetrics)) {
+                fprintf(stderr, "Unknown metric in %s; see --list-metrics\n", value);
+                return 2;
+            }
+            ++i;
+        } else if (strcmp(arg, "--list-metrics") == 0) {
+            printMetrics();
+            return 0;
+        } else if (strcmp(arg, "--serial") == 0) {
+            parallel = false;
+        } else if (strcmp(arg, "--synthetic") == 0 && value) {
+            synthetic = true;
+            syntheticConfig.deviceCount = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--processes") == 0 && value) {
+            syntheticConfig.processesPerDevice = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--churn") == 0 && value) {
+            syntheticConfig.processStartsPerMinute = strtod(value, nullptr);
+            ++i;
+        } else if (strcmp(arg, "--time-scale") == 0 && value) {
+            syntheticConfig.timeScale = strtod(value, nullptr);
+            ++i;
+        } else if (strcmp(arg, "--listen") == 0 && value) {
+            listenPort = atoi(value);
+            ++i;
+        } else if (strcmp(arg, "--listen-address") == 0 && value) {
+            listenAddress = value;
+            ++i;
+        } else if (strcmp(arg, "--shm") == 0) {
+            publishShm = true;
+        } else if (strcmp(arg, "--shm-name") == 0 && value) {
+            publishShm = true;
+            shmName = value;
+            ++i;
+        } else if (strcmp(arg, "--record") == 0 && value) {
+            recordPath = value;
+            ++i;
+        } else if (strcmp(arg, "--replay") == 0 && value) {
+            replayPath = value;
+            ++i;
+        } else if (strcmp(arg, "--speed") == 0 && value) {
+            replaySpeed = strtod(value, nullptr);
+            speedSet = true;
+            ++i;
+        } else if (strcmp(arg, "--from") == 0 && value) {
+            replayFrom = strtoll(value, nullptr, 10);
+            ++i;
+        } else if (strcmp(arg, "--compress-history") == 0) {
+            compressHistory = true;
+        } else if (strcmp(arg, "--history") == 0 && value) {
+            historyPath = value;
+            ++i;
+        } else if (strcmp(arg, "--alerts") == 0 && value) {
+            alertsPath = value;
+            ++i;
+        } else if (strcmp(arg, "--alert-log") == 0 && value) {
+            alertLogPath = value;
+            ++i;
+        } else if (strcmp(arg, "--events") == 0) {
+            printEvents = true;
+        } else if (strcmp(arg, "--top") == 0 && value) {
+            topProcesses = static_cast<size_t>(strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--stats") == 0) {
+            printStats = true;
+        } else if (strcmp(arg, "--snapshot") == 0 && value) {
+            snapshotPath = value;
+            ++i;
+        } else if (strcmp(arg, "--snapshot-width") == 0 && value) {
+            snapshotConfig.width = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+            if (snapshotConfig.width == 0) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            ++i;
+        } else if (strcmp(arg, "--snapshot-columns") == 0 && value) {
+            snapshotConfig.columns = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--debug-overlay") == 0) {
+            snapshotConfig.overlay = true;
+        } else if (strcmp(arg, "--layout") == 0 && value) {
+            if (strcmp(value, "detail") == 0) {
+                snapshotConfig.mode = LayoutMode::Detail;
+            } else if (strcmp(value, "grid") == 0) {
+                snapshotConfig.mode = LayoutMode::Grid;
+            } else {
+                printUsage(argv[0]);
+                return 2;
+            }
+            ++i;
+        } else if (strcmp(arg, "--graphs") == 0 && value) {
+            if (!parseMetricList(value, graphs)) {
+                fprintf(stderr, "Unknown metric in %s; see --list-metrics\n", value);
+                return 2;
+            }
+            ++i;
+        } else if (strcmp(arg, "--time-window") == 0 && value) {
+            timeWindowMs = strtoll(value, nullptr, 10) * 1000;
+            if (timeWindowMs <= 0) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            ++i;
+        } else {
+            printUsage(argv[0]);
+            return strcmp(arg, "--help") == 0 ? 0 : 2;
+        }
+    }
+    std::unique_ptr<MetricsSource> source;
+    ReplaySource* replay = nullptr;
+    if (replayPath) {
+        auto replaySource = std::make_unique<ReplaySource>(replayPath);
+        replay = replaySource.get();
+        source = std::move(replaySource);
+    } else if (synthetic) {
+        source = std::make_unique<SyntheticSource>(syntheticConfig);
+    } else {
+        source = std::make_unique<NvmlSource>();
+    }
+
+    GpuMonitor monitor(std::move(source));
+    monitor.setCompressedHistory(compressHistory);
+    // A missing file is the normal first run
+    bool historyLoaded = false;
+    if (historyPath) historyLoaded = monitor.loadHistory(historyPath);
+    if (!monitor.initialize()) {
+        if (replay) {
+            fprintf(stderr, "Failed to open recording %s\n", replayPath);
+        } else {
+            fprintf(stderr, "Failed to initialize GPU monitoring. Make sure NVIDIA drivers are installed.\n");
+        }
+        return 1;
+    }
+    monitor.setParallelCollection(parallel);
+    if (topProcesses > 0) monitor.setTopProcessCount(topProcesses);
+
+    // Replays tick at the recorded cadence scaled by the speed; speed 0 replays as fast as possible.
+    // A snapshot of a replay only needs the history, so it runs unpaced unless a speed is given.
+    if (replay && snapshotPath && !speedSet) replaySpeed = 0.0;
+    bool paced = true;
+    if (replay) {
+        if (replayFrom != 0) replay->seek(replayFrom);
+        if (replaySpeed <= 0.0) {
+            paced = false;
+        } else if (!intervalSet) {
+            intervalMs = static_cast<unsigned int>(replay->recordedIntervalMs() / replaySpeed);
+        }
+    }
+    if (intervalMs == 0) intervalMs = 1;
+
+    if (recordPath) {
+        auto recorder = std::make_shared<TelemetryRecorder>();
+        if (!recorder->open(recordPath)) {
+            fprintf(stderr, "Failed to create recording %s\n", recordPath);
+            return 1;
+        }
+        monitor.addSink(recorder);
+    }
+
+    std::shared_ptr<MetricsExporter> exporter;
+    if (listenPort >= 0) {
+        exporter = std::make_shared<MetricsExporter>();
+        if (!exporter->start(static_cast<unsigned short>(listenPort), listenAddress)) {
+            fprintf(stderr, "Failed to listen on %s:%d\n", listenAddress, listenPort);
+            return 1;
+        }
+        fprintf(stderr, "Serving metrics at http://%s:%u/metrics\n", listenAddress, exporter->port());
+        monitor.addSink(exporter);
+    }
+
+    if (publishShm) {
+        auto publisher = std::make_shared<ShmPublisher>();
+        if (!publisher->open(shmName)) {
+            fprintf(stderr, "Failed to create shared memory segment %s\n", shmName);
+            return 1;
+        }
+        monitor.addSink(publisher);
+    }
+
+    std::shared_ptr<AlertEngine> alerts;
+    FILE* alertLog = nullptr;
+    if (alertsPath) {
+        alerts = std::make_shared<AlertEngine>();
+        std::string error;
+        if (!alerts->load(alertsPath, error)) {
+            fprintf(stderr, "Invalid alert rules in %s: %s\n", alertsPath, error.c_str());
+            return 2;
+        }
+        if (alertLogPath) {
+            alertLog = fopen(alertLogPath, "a");
+            if (!alertLog) {
+                fprintf(stderr, "Failed to open alert log %s\n", alertLogPath);
+                return 1;
+            }
+            alerts->setLog(alertLog);
+        }
+        monitor.addSink(alerts);
+    }
+
+    // Replays keep the recorded cadence
+    std::unique_ptr<SamplingScheduler> scheduler;
+    if (adaptive && !replay) {
+        schedulerConfig.baseIntervalMs = intervalMs;
+        schedulerConfig.minIntervalMs = std::max(1u, std::min(schedulerConfig.minIntervalMs, intervalMs));
+        schedulerConfig.maxIntervalMs = std::max(schedulerConfig.maxIntervalMs, intervalMs);
+        scheduler = std::make_unique<SamplingScheduler>(schedulerConfig);
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    // Snapshots are usually all that is wanted, so samples are only written when asked for
+    if (snapshotPath && !formatSet) writeOutput = false;
+
+    SampleWriter writer(stdout, format);
+    if (!outputMetrics.empty()) writer.setMetrics(outputMetrics);
+    if (writeOutput) writer.writeHeader();
+
+    // Sample on the calling thread; no UI means there is nothing to keep responsive
+    unsigned long long samples = 0;
+    std::chrono::microseconds totalSampleTime{0};
+    std::chrono::microseconds maxSampleTime{0};
+    unsigned long long lastEvent = 0;
+
+    auto nextTick = std::chrono::steady_clock::now();
+    for (unsigned long long n = 0; !g_stopRequested && (count == 0 || n < count); ++n) {
+        // Only a replay that has reached the end of its recording has nothing to sample
+        if (!monitor.update()) break;
+        auto snapshot = monitor.getSnapshot();
+        if (writeOutput) writer.write(*snapshot);
+        if (printEvents && snapshot->events) {
+            // Each event once, when first seen; later repeats merge into it
+            const unsigned long long printed = lastEvent;
+            for (const GpuEvent& event : *snapshot->events) {
+                if (event.sequence <= printed) continue;
+                fprintf(stderr, "%s\n", formatEvent(event).c_str());
+                lastEvent = std::max(lastEvent, event.sequence);
+            }
+        }
+
+        ++samples;
+        totalSampleTime += snapshot->sampleDuration;
+        maxSampleTime = std::max(maxSampleTime, snapshot->sampleDuration);
+
+        if (count != 0 && n + 1 == count) break;
+        if (!paced) continue;
+        if (scheduler) intervalMs = scheduler->next(*snapshot);
+        // Keep the cadence, but after a slow tick or a suspend start again from
+        // now rather than catching up with a burst of samples
+        nextTick += std::chrono::milliseconds(intervalMs);
+        const auto now = std::chrono::steady_clock::now();
+        if (nextTick < now) nextTick = now;
+        std::this_thread::sleep_until(nextTick);
+    }
+    writer.flush();
+
+    if (historyPath && !monitor.saveHistory(historyPath)) {
+        fprintf(stderr, "Failed to save history to %s\n", historyPath);
+    }
+
+    if (snapshotPath) {
+        SnapshotRenderer renderer(snapshotConfig);
+        renderer.setTimeWindow(timeWindowMs);
+        if (!graphs.empty()) renderer.setGraphs(graphs);
+        renderer.render(*monitor.getSnapshot());
+        if (!renderer.write(snapshotPath)) {
+            fprintf(stderr, "Failed to write snapshot %s\n", snapshotPath);
+            return 1;
+        }
+    }
+
+    if (topProcesses > 0 && samples > 0) {
+        auto last = monitor.getSnapshot();
+        printTopProcesses("memory", last->topByMemory, last->timestampMs);
+        printTopProcesses("util", last->topByUtil, last->timestampMs);
+    }
+
+    if (printStats && samples > 0) {
+        struct rusage usage = {};
+        getrusage(RUSAGE_SELF, &usage);
+        auto last = monitor.getSnapshot();
+        fprintf(stderr, "samples=%llu avg_sample_us=%lld max_sample_us=%lld peak_rss_kb=%ld"
+            " sample_rate_hz=%.2f cpu_ms_per_min=%.1f\n",
+            samples, static_cast<long long>(totalSampleTime.count() / samples),
+            static_cast<long long>(maxSampleTime.count()), usage.ru_maxrss,
+            last->sampleRateHz, last->cpuTimePerMinute.count() / 1000.0);
+        printHistoryStats(*last);
+        const StartupTimes startup = monitor.startupTimes();
+        fprintf(stderr, "history_restored=%d history_load_ms=%.2f initialize_ms=%.2f time_to_first_sample_ms=%.2f\n",
+            historyLoaded ? 1 : 0, startup.historyLoadedMs, startup.initializedMs, startup.firstSampleMs);
+        fprintf(stderr, "events_total=%llu processes_tracked=%zu\n", monitor.eventLog().total(),
+            last->processesTracked);
+        for (const ProbeSummary& probe : summarizeProbes()) {
+            fprintf(stderr, "probe=%s calls=%llu p50_us=%.2f p99_us=%.2f max_us=%.2f\n", probeName(probe.probe),
+                probe.count, probe.p50Ns / 1000.0, probe.p99Ns / 1000.0, probe.maxNs / 1000.0);
+        }
+        if (alerts) {
+            fprintf(stderr, "alert_rules=%zu alert_windows_per_gpu=%zu alert_events=%llu alerts_firing=%zu\n",
+                alerts->rules().size(), alerts->windowCount(), alerts->eventCount(), alerts->firingCount());
+        }
+    }
+
+    if (alertLog) fclose(alertLog);
+    return 0;
+}
@@ -0,0 +1,244 @@
+#include "history_codec.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Most significant bit first
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : m_out(out), m_accumulator(0), m_bits(0) {}
+
+    void write(uint64_t value, int count) {
+        // Split wide writes so the accumulator never overflows
+        if (count > 32) {
+            write(value >> 32, count - 32);
+            count = 32;
+        }
+        value &= (count == 64) ? ~0ULL : ((1ULL << count) - 1);
+        m_accumulator = (m_accumulator << count) | value;
+        m_bits += count;
+        while (m_bits >= 8) {
+            m_bits -= 8;
+            m_out.push_back(static_cast<uint8_t>(m_accumulator >> m_bits));
+        }
+    }
+
+    void flush() {
+        if (m_bits > 0) {
+            m_out.push_back(static_cast<uint8_t>(m_accumulator << (8 - m_bits)));
+            m_bits = 0;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint64_t m_accumulator;
+    int m_bits;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, const uint8_t* end) : m_data(data), m_end(end), m_accumulator(0), m_bits(0) {}
+
+    uint64_t read(int count) {
+        if (count > 32) {
+            uint64_t high = read(count - 32);
+            return (high << 32) | read(32);
+        }
+        while (m_bits < count) {
+            // Reading past the end yields zeros rather than faulting on a damaged stream
+            uint8_t byte = m_data < m_end ? *m_data++ : 0;
+            m_accumulator = (m_accumulator << 8) | byte;
+            m_bits += 8;
+        }
+        m_bits -= count;
+        return (m_accumulator >> m_bits) & ((1ULL << count) - 1);
+    }
+
+    bool readBit() { return read(1) != 0; }
+
+private:
+    const uint8_t* m_data;
+    const uint8_t* m_end;
+    uint64_t m_accumulator;
+    int m_bits;
+};
+
+int leadingZeros(uint32_t value) {
+    int count = 0;
+    for (uint32_t bit = 0x80000000u; bit && !(value & bit); bit >>= 1) ++count;
+    return count;
+}
+
+int trailingZeros(uint32_t value) {
+    int count = 0;
+    for (uint32_t bit = 1; bit && !(value & bit); bit <<= 1) ++count;
+    return count;
+}
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Delta-of-delta buckets: control bits, then a signed payload of the given width
+struct DodBucket {
+    uint64_t control;
+    int controlBits;
+    int valueBits;
+};
+
+constexpr DodBucket DOD_BUCKETS[] = {
+    { 0x2, 2, 7 },   // 10
+    { 0x6, 3, 9 },   // 110
+    { 0xe, 4, 12 },  // 1110
+    { 0xf, 4, 64 },  // 1111
+};
+
+void encodeTimestamps(BitWriter& out, const long long* timestamps, size_t count) {
+    long long previous = timestamps[0];
+    long long previousDelta = 0;
+    for (size_t i = 1; i < count; ++i) {
+        const long long delta = timestamps[i] - previous;
+        const long long dod = delta - previousDelta;
+        previous = timestamps[i];
+        previousDelta = delta;
+
+        if (dod == 0) {
+            out.write(0, 1);
+            continue;
+        }
+        for (const auto& bucket : DOD_BUCKETS) {
+            const long long limit = bucket.valueBits == 64 ? 0 : (1LL << (bucket.valueBits - 1));
+            if (bucket.valueBits == 64 || (dod >= -limit && dod < limit)) {
+                out.write(bucket.control, bucket.controlBits);
+                out.write(static_cast<uint64_t>(dod), bucket.valueBits);
+                break;
+            }
+        }
+    }
+}
+
+void encodeColumn(BitWriter& out, const float* values, size_t count) {
+    uint32_t previous = floatBits(values[0]);
+    out.write(previous, 32);
+
+    int windowLeading = -1;
+    int windowTrailing = 0;
+    for (size_t i = 1; i < count; ++i) {
+        const uint32_t bits = floatBits(values[i]);
+        const uint32_t x = bits ^ previous;
+        previous = bits;
+
+        if (x == 0) {
+            out.write(0, 1);
+            continue;
+        }
+
+        const int leading = leadingZeros(x);
+        const int trailing = trailingZeros(x);
+        if (windowLeading >= 0 && leading >= windowLeading && trailing >= windowTrailing) {
+            // Meaningful bits fit the previous window: no need to repeat its bounds
+            out.write(0x2, 2);
+            out.write(x >> windowTrailing, 32 - windowLeading - windowTrailing);
+        } else {
+            const int length = 32 - leading - trailing;
+            out.write(0x3, 2);
+            out.write(static_cast<uint64_t>(leading), 5);
+            out.write(static_cast<uint64_t>(length - 1), 5);
+            out.write(x >> trailing, length);
+            windowLeading = leading;
+            windowTrailing = trailing;
+        }
+    }
+}
+
+}
+
+size_t CompressedBlock::memoryBytes() const {
+    return sizeof(*this) + offsets.capacity() * sizeof(uint32_t) + data.capacity();
+}
+
+std::shared_ptr<const CompressedBlock> compressBlock(const long long* timestamps, const float* values,
+                                                     size_t columnStride, size_t columnCount, size_t count) {
+    auto block = std::make_shared<CompressedBlock>();
+    block->count = count;
+    if (count == 0) return block;
+
+    block->firstTimestampMs = timestamps[0];
+    block->lastTimestampMs = timestamps[count - 1];
+    block->offsets.reserve(columnCount + 2);
+
+    // Each stream starts on a byte boundary so columns can be decoded independently
+    BitWriter writer(block->data);
+    block->offsets.push_back(0);
+    encodeTimestamps(writer, timestamps, count);
+    writer.flush();
+    for (size_t c = 0; c < columnCount; ++c) {
+        block->offsets.push_back(static_cast<uint32_t>(block->data.size()));
+        encodeColumn(writer, values + c * columnStride, count);
+        writer.flush();
+    }
+    block->offsets.push_back(static_cast<uint32_t>(block->data.size()));
+
+    block->data.shrink_to_fit();
+    return block;
+}
+
+void decompressTimestamps(const CompressedBlock& block, long long* out) {
+    if (block.count == 0) return;
+
+    BitReader reader(block.data.data() + block.offsets[0], block.data.data() + block.offsets[1]);
+    long long previous = block.firstTimestampMs;
+    long long previousDelta = 0;
+    out[0] = previous;
+    for (size_t i = 1; i < block.count; ++i) {
+        long long dod = 0;
+        if (reader.readBit()) {
+            int valueBits = 64;
+            if (!reader.readBit()) valueBits = 7;
+            else if (!reader.readBit()) valueBits = 9;
+            else if (!reader.readBit()) valueBits = 12;
+
+            // Sign-extend the payload
+            const uint64_t raw = reader.read(valueBits);
+            dod = valueBits == 64 ? static_cast<long long>(raw)
+                                  : static_cast<long long>(raw << (64 - valueBits)) >> (64 - valueBits);
+        }
+        // Wrapping arithmetic, so a damaged stream gives wrong timestamps rather than overflow
+        previousDelta = static_cast<long long>(static_cast<uint64_t>(previousDelta) + static_cast<uint64_t>(dod));
+        previous = static_cast<long long>(static_cast<uint64_t>(previous) + static_cast<uint64_t>(previousDelta));
+        out[i] = previous;
+    }
+}
+
+void decompressColumn(const CompressedBlock& block, size_t column, float* out) {
+    if (block.count == 0) return;
+
+    BitReader reader(block.data.data() + block.offsets[column + 1], block.data.data() + block.offsets[column + 2]);
+    uint32_t previous = static_cast<uint32_t>(reader.read(32));
+    out[0] = bitsFloat(previous);
+
+    int windowLeading = 0;
+    int windowTrailing = 0;
+    for (size_t i = 1; i < block.count; ++i) {
+        if (reader.readBit()) {
+            if (reader.readBit()) {
+                windowLeading = static_cast<int>(reader.read(5));
+                // Only a damaged stream has a window past the end of the word
+                windowTrailing = std::max(0, 32 - windowLeading - (static_cast<int>(reader.read(5)) + 1));
+            }
+            const int length = 32 - windowLeading - windowTrailing;
+            previous ^= static_cast<uint32_t>(reader.read(length)) << windowTrailing;
+        }
+        out[i] = bitsFloat(previous);
+    }
+}
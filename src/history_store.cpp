@@ -0,0 +1,167 @@
+#include "history_store.hpp"
+#include "metrics_history.hpp"
+#include "telemetry_reader.hpp"
+#include "varint.hpp"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace {
+
+// Bounds-checked cursor over the payload
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        if (ok && !getVarint(p, end, value)) ok = false;
+        return value;
+    }
+
+    // Element counts are checked against what is left, as every element takes at least a byte
+    size_t count() {
+        uint64_t value = varint();
+        if (value > static_cast<uint64_t>(end - p)) ok = false;
+        return ok ? static_cast<size_t>(value) : 0;
+    }
+
+    std::string string() {
+        size_t length = count();
+        std::string text(reinterpret_cast<const char*>(p), length);
+        p += length;
+        return text;
+    }
+
+    std::wstring wideString() {
+        std::wstring text(count(), L'\0');
+        for (auto& c : text) c = static_cast<wchar_t>(varint());
+        return text;
+    }
+};
+
+void putString(std::vector<uint8_t>& out, const std::string& text) {
+    putVarint(out, text.size());
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+// Stored as code units so names round-trip whatever the width of wchar_t
+void putWideString(std::vector<uint8_t>& out, const std::wstring& text) {
+    putVarint(out, text.size());
+    for (wchar_t c : text) {
+        putVarint(out, static_cast<uint64_t>(c));
+    }
+}
+
+void putBlock(std::vector<uint8_t>& out, const CompressedBlock& block) {
+    putVarint(out, block.count);
+    putVarint(out, zigzagEncode(block.firstTimestampMs));
+    putVarint(out, zigzagEncode(block.lastTimestampMs));
+    putVarint(out, block.offsets.size());
+    for (uint32_t offset : block.offsets) putVarint(out, offset);
+    out.insert(out.end(), block.data.begin(), block.data.end());
+}
+
+std::shared_ptr<const CompressedBlock> readBlock(Reader& in, size_t columnCount) {
+    auto block = std::make_shared<CompressedBlock>();
+    block->count = static_cast<size_t>(in.varint());
+    block->firstTimestampMs = zigzagDecode(in.varint());
+    block->lastTimestampMs = zigzagDecode(in.varint());
+    block->offsets.resize(in.count());
+    for (auto& offset : block->offsets) offset = static_cast<uint32_t>(in.varint());
+
+    // Streams must lie in order within the data, one per column plus the timestamps
+    bool valid = in.ok && block->count > 0 && block->count <= HistoryTier::BLOCK_SAMPLES &&
+                 block->offsets.size() == columnCount + 2 && block->offsets[0] == 0;
+    for (size_t i = 1; valid && i < block->offsets.size(); ++i) {
+        valid = block->offsets[i] >= block->offsets[i - 1];
+    }
+    if (!valid || block->offsets.back() > static_cast<size_t>(in.end - in.p)) {
+        in.ok = false;
+        return nullptr;
+    }
+    block->data.assign(in.p, in.p + block->offsets.back());
+    in.p += block->offsets.back();
+    return block;
+}
+
+bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+}
+
+bool writeHistoryFile(const std::string& path, long long savedAtMs, const std::vector<StoredHistory>& devices) {
+    std::vector<uint8_t> payload;
+    putVarint(payload, devices.size());
+    for (const StoredHistory& history : devices) {
+        const DeviceInfo& device = history.device;
+        putVarint(payload, device.index);
+        putString(payload, device.uuid);
+        putWideString(payload, device.name);
+        putVarint(payload, device.totalMemory);
+        putVarint(payload, device.powerLimit);
+        putVarint(payload, history.tiers.size());
+        for (const StoredTier& tier : history.tiers) {
+            putVarint(payload, zigzagEncode(tier.resolutionMs));
+            putVarint(payload, tier.columnCount);
+            putVarint(payload, tier.blocks.size());
+            for (const auto& block : tier.blocks) putBlock(payload, *block);
+        }
+    }
+
+    const std::string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) return false;
+    const HistoryFileHeader header = { HISTORY_FILE_MAGIC, HISTORY_FILE_VERSION, savedAtMs };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || !replaceFile(temporary, path)) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readHistoryFile(const std::string& path, long long& savedAtMs, std::vector<StoredHistory>& devices) {
+    devices.clear();
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    HistoryFileHeader header = {};
+    if (file.size() < sizeof(header)) return false;
+    memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != HISTORY_FILE_MAGIC || header.version != HISTORY_FILE_VERSION) return false;
+    savedAtMs = header.savedAtMs;
+
+    Reader in = { file.data() + sizeof(header), file.data() + file.size() };
+    devices.resize(in.count());
+    for (StoredHistory& history : devices) {
+        DeviceInfo& device = history.device;
+        device.index = static_cast<unsigned int>(in.varint());
+        device.uuid = in.string();
+        device.name = in.wideString();
+        device.totalMemory = in.varint();
+        device.powerLimit = static_cast<unsigned int>(in.varint());
+        history.tiers.resize(in.count());
+        for (StoredTier& tier : history.tiers) {
+            tier.resolutionMs = zigzagDecode(in.varint());
+            tier.columnCount = static_cast<size_t>(in.varint());
+            tier.blocks.resize(in.count());
+            for (auto& block : tier.blocks) {
+                block = in.ok ? readBlock(in, tier.columnCount) : nullptr;
+            }
+        }
+    }
+    if (!in.ok) devices.clear();
+    return in.ok;
+}
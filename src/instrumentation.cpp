@@ -0,0 +1,139 @@
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// In Probe order
+const char* const PROBE_NAMES[PROBE_COUNT] = {
+    "nvmlDeviceGetCount",
+    "nvmlDeviceGetHandleByIndex",
+    "nvmlDeviceGetUUID",
+    "nvmlDeviceGetName",
+    "nvmlDeviceGetEnforcedPowerLimit",
+    "nvmlDeviceGetSamples",
+    "nvmlDeviceGetFieldValues",
+    "nvmlDeviceGetUtilizationRates",
+    "nvmlDeviceGetTemperature",
+    "nvmlDeviceGetFanSpeed",
+    "nvmlDeviceGetPowerUsage",
+    "nvmlDeviceGetClockInfo",
+    "nvmlDeviceGetMemoryInfo",
+    "nvmlDeviceGetComputeRunningProcesses",
+    "nvmlDeviceGetGraphicsRunningProcesses",
+    "nvmlDeviceGetProcessUtilization",
+    "nvmlDeviceGetCurrentClocksThrottleReasons",
+    "nvmlDeviceGetViolationStatus",
+    "os_process_start_time",
+    "os_process_name",
+    "os_thread_cpu_time",
+    "sample_device",
+    "sample_tick",
+    "publish",
+    "scene_build",
+    "render_frame",
+};
+
+LatencyHistogram g_histograms[PROBE_COUNT];
+
+// Reference points for converting ticks to nanoseconds
+const unsigned long long g_startTicks = probeTicks();
+const std::chrono::steady_clock::time_point g_startTime = std::chrono::steady_clock::now();
+
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+unsigned long long LatencyHistogram::count() const {
+    unsigned long long total = 0;
+    for (const auto& bucket : m_buckets) total += bucket.load(std::memory_order_relaxed);
+    return total;
+}
+
+unsigned long long LatencyHistogram::bucketLow(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    const unsigned int shift = static_cast<unsigned int>(bucket / SUB_BUCKETS) - 1;
+    return (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+}
+
+unsigned long long LatencyHistogram::bucketWidth(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return 1;
+    return 1ULL << (bucket / SUB_BUCKETS - 1);
+}
+
+double LatencyHistogram::percentile(double q) const {
+    // Buckets are read once so the total matches them while others record
+    unsigned long long counts[BUCKET_COUNT];
+    unsigned long long total = 0;
+    for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+        counts[b] = m_buckets[b].load(std::memory_order_relaxed);
+        total += counts[b];
+    }
+    if (total == 0) return 0.0;
+
+    const double rank = q <= 0.0 ? 1.0 : q * static_cast<double>(total);
+    unsigned long long seen = 0;
+    for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+        seen += counts[b];
+        if (static_cast<double>(seen) >= rank) {
+            // Never past the largest duration actually seen
+            const double middle = static_cast<double>(bucketLow(b)) + (static_cast<double>(bucketWidth(b)) - 1.0) / 2.0;
+            return std::min(middle, static_cast<double>(max()));
+        }
+    }
+    return static_cast<double>(max());
+}
+
+double probeNsPerTick() {
+    const unsigned long long ticks = probeTicks() - g_startTicks;
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - g_startTime).count();
+    return ticks > 0 ? ns / static_cast<double>(ticks) : 1.0;
+}
+
+const char* probeName(Probe probe) {
+    return PROBE_NAMES[static_cast<size_t>(probe)];
+}
+
+LatencyHistogram& probeHistogram(Probe probe) {
+    return g_histograms[static_cast<size_t>(probe)];
+}
+
+void resetProbes() {
+    for (auto& histogram : g_histograms) histogram.reset();
+}
+
+std::vector<ProbeSummary> summarizeProbes() {
+    std::vector<ProbeSummary> summaries;
+#if NVWINTOP_INSTRUMENTATION
+    const double nsPerTick = probeNsPerTick();
+    for (size_t p = 0; p < PROBE_COUNT; ++p) {
+        const LatencyHistogram& histogram = g_histograms[p];
+        const unsigned long long count = histogram.count();
+        if (count == 0) continue;
+        summaries.push_back({ static_cast<Probe>(p), count, histogram.percentile(0.5) * nsPerTick,
+                              histogram.percentile(0.99) * nsPerTick, histogram.max() * nsPerTick });
+    }
+#endif
+    return summaries;
+}
+
+std::string formatDuration(double ns) {
+    char text[32];
+    if (ns < 1000.0) {
+        snprintf(text, sizeof(text), "%.0fns", ns);
+    } else if (ns < 1e6) {
+        snprintf(text, sizeof(text), "%.*fus", ns < 1e4 ? 2 : 1, ns / 1e3);
+    } else if (ns < 1e9) {
+        snprintf(text, sizeof(text), "%.*fms", ns < 1e7 ? 2 : 1, ns / 1e6);
+    } else {
+        snprintf(text, sizeof(text), "%.2fs", ns / 1e9);
+    }
+    return text;
+}
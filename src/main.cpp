@@ -1,7 +1,159 @@
 #include "window.hpp"
+#include "replay_source.hpp"
+#include "telemetry_recorder.hpp"
+#include "metrics_exporter.hpp"
+#include "shm_publisher.hpp"
+#include "metric_registry.hpp"
+#include "alert_engine.hpp"
+#include <shellapi.h>
+#include <cwchar>
+#include <cstdlib>
+
+namespace {
+
+std::string toAnsi(const wchar_t* text) {
+    int length = WideCharToMultiByte(CP_ACP, 0, text, -1, nullptr, 0, nullptr, nullptr);
+    if (length <= 1) return std::string();
+    std::string result(static_cast<size_t>(length - 1), '\0');
+    WideCharToMultiByte(CP_ACP, 0, text, -1, &result[0], length, nullptr, nullptr);
+    return result;
+}
+
+// %LOCALAPPDATA%\NvWinTop\history.bin, creating the folder; empty if there is no such folder
+std::string defaultHistoryPath() {
+    const wchar_t* localAppData = _wgetenv(L"LOCALAPPDATA");
+    if (!localAppData || !*localAppData) return std::string();
+    const std::wstring folder = std::wstring(localAppData) + L"\\NvWinTop";
+    if (!CreateDirectoryW(folder.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS) return std::string();
+    return toAnsi(folder.c_str()) + "\\history.bin";
+}
+
+}
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine, int nCmdShow) {
-    MainWindow window;
+    // --record FILE, --replay FILE, --speed X, --listen PORT and --shm, as in the headless build,
+    // --graphs LIST to pick the graphed metrics by their headless --metrics names, and
+    // --alerts FILE with --alert-log FILE (default FILE.log, as there is no console), and
+    // --history FILE or --no-history for the history kept across restarts
+    std::string recordPath;
+    std::string replayPath;
+    double replaySpeed = 1.0;
+    int listenPort = -1;
+    bool publishShm = false;
+    std::vector<Metric> graphs;
+    bool graphsValid = true;
+    std::string alertsPath;
+    std::string alertLogPath;
+    std::string historyPath;
+    bool keepHistory = true;
+
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    for (int i = 1; argv && i < argc; ++i) {
+        if (wcscmp(argv[i], L"--shm") == 0) {
+            publishShm = true;
+        } else if (wcscmp(argv[i], L"--no-history") == 0) {
+            keepHistory = false;
+        } else if (i + 1 >= argc) {
+            break;
+        } else if (wcscmp(argv[i], L"--record") == 0) {
+            recordPath = toAnsi(argv[++i]);
+        } else if (wcscmp(argv[i], L"--replay") == 0) {
+            replayPath = toAnsi(argv[++i]);
+        } else if (wcscmp(argv[i], L"--speed") == 0) {
+            replaySpeed = wcstod(argv[++i], nullptr);
+        } else if (wcscmp(argv[i], L"--listen") == 0) {
+            listenPort = static_cast<int>(wcstol(argv[++i], nullptr, 10));
+        } else if (wcscmp(argv[i], L"--graphs") == 0) {
+            graphsValid = parseMetricList(toAnsi(argv[++i]), graphs);
+        } else if (wcscmp(argv[i], L"--alerts") == 0) {
+            alertsPath = toAnsi(argv[++i]);
+        } else if (wcscmp(argv[i], L"--alert-log") == 0) {
+            alertLogPath = toAnsi(argv[++i]);
+        } else if (wcscmp(argv[i], L"--history") == 0) {
+            historyPath = toAnsi(argv[++i]);
+        }
+    }
+    if (argv) LocalFree(argv);
+
+    if (!graphsValid) {
+        MessageBoxW(nullptr, L"Unknown metric in --graphs.", L"Error", MB_ICONERROR);
+        return 2;
+    }
+
+    std::unique_ptr<GpuMonitor> monitor;
+    unsigned int intervalMs = GpuMonitor::DEFAULT_INTERVAL_MS;
+    if (!replayPath.empty()) {
+        auto replay = std::make_unique<ReplaySource>(replayPath);
+        ReplaySource* source = replay.get();
+        monitor = std::make_unique<GpuMonitor>(std::move(replay));
+        if (!monitor->initialize()) {
+            MessageBoxW(nullptr, L"Failed to open the recording.", L"Error", MB_ICONERROR);
+            return 1;
+        }
+        if (replaySpeed > 0.0) {
+            intervalMs = static_cast<unsigned int>(source->recordedIntervalMs() / replaySpeed);
+        }
+        if (intervalMs == 0) intervalMs = 1;
+    } else {
+        monitor = std::make_unique<GpuMonitor>();
+        // Speeds up while metrics move, backs off while they are steady or the window is hidden
+        monitor->setScheduler(std::make_unique<SamplingScheduler>());
+    }
+
+    if (!recordPath.empty()) {
+        auto recorder = std::make_shared<TelemetryRecorder>();
+        if (!recorder->open(recordPath)) {
+            MessageBoxW(nullptr, L"Failed to create the recording file.", L"Error", MB_ICONERROR);
+            return 1;
+        }
+        monitor->addSink(recorder);
+    }
+
+    if (listenPort >= 0) {
+        auto exporter = std::make_shared<MetricsExporter>();
+        if (!exporter->start(static_cast<unsigned short>(listenPort))) {
+            MessageBoxW(nullptr, L"Failed to start the metrics endpoint.", L"Error", MB_ICONERROR);
+            return 1;
+        }
+        monitor->addSink(exporter);
+    }
+
+    if (publishShm) {
+        auto publisher = std::make_shared<ShmPublisher>();
+        if (!publisher->open()) {
+            MessageBoxW(nullptr, L"Failed to create the shared memory segment.", L"Error", MB_ICONERROR);
+            return 1;
+        }
+        monitor->addSink(publisher);
+    }
+
+    // Declared before the window so the log outlives its sampler thread
+    std::unique_ptr<FILE, int (*)(FILE*)> alertLog(nullptr, fclose);
+    if (!alertsPath.empty()) {
+        auto alerts = std::make_shared<AlertEngine>();
+        std::string error;
+        if (!alerts->load(alertsPath, error)) {
+            const std::string message = "Invalid alert rules in " + alertsPath + ": " + error;
+            MessageBoxA(nullptr, message.c_str(), "Error", MB_ICONERROR);
+            return 2;
+        }
+        if (alertLogPath.empty()) alertLogPath = alertsPath + ".log";
+        alertLog.reset(fopen(alertLogPath.c_str(), "a"));
+        if (!alertLog) {
+            MessageBoxW(nullptr, L"Failed to open the alert log.", L"Error", MB_ICONERROR);
+            return 1;
+        }
+        alerts->setLog(alertLog.get());
+        monitor->addSink(alerts);
+    }
+
+    // A replay's history is the recording's, so it is only kept when asked for
+    if (keepHistory && historyPath.empty() && replayPath.empty()) historyPath = defaultHistoryPath();
+
+    MainWindow window(std::move(monitor), intervalMs);
+    if (!graphs.empty()) window.setGraphs(graphs);
+    if (keepHistory) window.setHistoryPath(historyPath);
     
     if (!window.create()) {
         return 1;
@@ -15,5 +167,5 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
         DispatchMessage(&msg);
     }
 
-    return 0;
+    return window.failed() ? 1 : 0;
 }
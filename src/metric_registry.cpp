@@ -0,0 +1,27 @@
+#include "metric_registry.hpp"
+
+bool findMetric(const std::string& key, Metric& metric) {
+    for (const MetricDescriptor& descriptor : METRIC_DESCRIPTORS) {
+        if (key == descriptor.key) {
+            metric = descriptor.metric;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseMetricList(const std::string& list, std::vector<Metric>& out) {
+    std::vector<Metric> metrics;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        Metric metric;
+        if (!findMetric(list.substr(start, end - start), metric)) return false;
+        metrics.push_back(metric);
+        start = end + 1;
+    }
+    if (metrics.empty()) return false;
+    out = std::move(metrics);
+    return true;
+}
@@ -0,0 +1,324 @@
+#include "metrics_exporter.hpp"
+#include "metric_registry.hpp"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+constexpr intptr_t NO_SOCKET = static_cast<intptr_t>(INVALID_SOCKET);
+constexpr int SEND_FLAGS = 0;
+void closeSocket(intptr_t socket) { closesocket(static_cast<SOCKET>(socket)); }
+#else
+using SocketHandle = int;
+constexpr intptr_t NO_SOCKET = -1;
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;  // A client hanging up must not kill the process
+void closeSocket(intptr_t socket) { close(static_cast<int>(socket)); }
+#endif
+
+constexpr const char* CONTENT_TYPE = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+bool sendAll(intptr_t socket, const char* data, size_t size) {
+    while (size > 0) {
+        int chunk = static_cast<int>(size > (1u << 30) ? (1u << 30) : size);
+        int sent = send(static_cast<SocketHandle>(socket), data, chunk, SEND_FLAGS);
+        if (sent <= 0) return false;
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Appends to a body whose capacity survives between samples
+void append(std::string& out, const char* text) {
+    out.append(text);
+}
+
+void appendUnsigned(std::string& out, unsigned long long value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+void appendFixed(std::string& out, double value, int precision) {
+    char digits[64];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, precision);
+    out.append(digits, result.ptr);
+}
+
+// Label values escape backslash, quote and newline; names are ASCII in practice
+void appendLabel(std::string& out, const char* name, const std::string& value) {
+    out.append(name);
+    out.append("=\"");
+    for (char c : value) {
+        if (c == '\\' || c == '"') out.push_back('\\');
+        if (c == '\n') {
+            out.append("\\n");
+            continue;
+        }
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+void appendLabel(std::string& out, const char* name, unsigned int value) {
+    out.append(name);
+    out.append("=\"");
+    appendUnsigned(out, value);
+    out.push_back('"');
+}
+
+void appendLabel(std::string& out, const char* name, const std::wstring& value) {
+    out.append(name);
+    out.append("=\"");
+    for (wchar_t c : value) {
+        char narrow = (c >= 0x20 && c < 0x7f) ? static_cast<char>(c) : '?';
+        if (narrow == '\\' || narrow == '"') out.push_back('\\');
+        out.push_back(narrow);
+    }
+    out.push_back('"');
+}
+
+void appendFamily(std::string& out, const char* name, const char* unit, const char* help) {
+    out.append("# TYPE ").append(name).append(" gauge\n");
+    if (unit) out.append("# UNIT ").append(name).append(" ").append(unit).append("\n");
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+}
+
+void appendGpuLabels(std::string& out, const GpuMetrics& metrics) {
+    out.push_back('{');
+    appendLabel(out, "gpu", metrics.index);
+    out.push_back(',');
+    appendLabel(out, "uuid", metrics.uuid);
+    out.push_back(',');
+    appendLabel(out, "name", metrics.name);
+    out.push_back('}');
+}
+
+// Metric values in the descriptor's base unit
+void appendMetric(std::string& out, const MetricDescriptor& descriptor, const GpuMetrics& metrics) {
+    const double value = descriptor.value(metrics) * descriptor.exportScale;
+    if (descriptor.textDecimals > 0) {
+        appendFixed(out, value, descriptor.textDecimals);
+    } else {
+        appendUnsigned(out, static_cast<unsigned long long>(value));
+    }
+}
+
+}
+
+MetricsExporter::MetricsExporter()
+    : m_body(std::make_shared<std::string>("# EOF\n"))
+    , m_listenSocket(NO_SOCKET)
+    , m_port(0)
+    , m_stopRequested(false)
+    , m_scrapes(0)
+{}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+void MetricsExporter::serialize(const GpuSnapshot& snapshot, std::string& out) {
+    out.clear();
+
+    // One gauge family per metric with a sample per GPU
+    for (const MetricDescriptor& descriptor : METRIC_DESCRIPTORS) {
+        appendFamily(out, descriptor.exportName, descriptor.exportUnit, descriptor.help);
+        for (const auto& metrics : snapshot.metrics) {
+            out.append(descriptor.exportName);
+            appendGpuLabels(out, metrics);
+            out.push_back(' ');
+            appendMetric(out, descriptor, metrics);
+            out.push_back('\n');
+        }
+    }
+
+    appendFamily(out, "nvwintop_process_memory_used_bytes", "bytes", "Device memory used by a process");
+    for (const auto& process : snapshot.processes) {
+        out.append("nvwintop_process_memory_used_bytes{");
+        appendLabel(out, "gpu", process.gpuIndex);
+        out.push_back(',');
+        appendLabel(out, "pid", process.pid);
+        out.push_back(',');
+        appendLabel(out, "name", process.name);
+        out.append("} ");
+        appendUnsigned(out, process.memoryUsed);
+        out.push_back('\n');
+    }
+
+    appendFamily(out, "nvwintop_process_gpu_utilization_percent", "percent", "GPU utilization of a process");
+    for (const auto& process : snapshot.processes) {
+        out.append("nvwintop_process_gpu_utilization_percent{");
+        appendLabel(out, "gpu", process.gpuIndex);
+        out.push_back(',');
+        appendLabel(out, "pid", process.pid);
+        out.push_back(',');
+        appendLabel(out, "name", process.name);
+        out.append("} ");
+        appendUnsigned(out, process.gpuUtil);
+        out.push_back('\n');
+    }
+
+    appendFamily(out, "nvwintop_sample_timestamp_seconds", "seconds", "Time the sample was taken");
+    append(out, "nvwintop_sample_timestamp_seconds ");
+    appendFixed(out, snapshot.timestampMs / 1000.0, 3);
+    out.push_back('\n');
+
+    appendFamily(out, "nvwintop_sample_rate_hertz", "hertz", "Samples taken per second over the last minute");
+    append(out, "nvwintop_sample_rate_hertz ");
+    appendFixed(out, snapshot.sampleRateHz, 3);
+    out.push_back('\n');
+
+    appendFamily(out, "nvwintop_sampling_cpu_seconds", "seconds", "CPU time spent sampling over the last minute");
+    append(out, "nvwintop_sampling_cpu_seconds ");
+    appendFixed(out, snapshot.cpuTimePerMinute.count() / 1e6, 6);
+    out.push_back('\n');
+
+    append(out, "# EOF\n");
+}
+
+void MetricsExporter::onSnapshot(const GpuSnapshot& snapshot) {
+    // Format into the retired body if no scrape is still sending it
+    std::shared_ptr<std::string> body;
+    if (m_spare && m_spare.use_count() == 1) {
+        body = std::move(m_spare);
+    } else {
+        body = std::make_shared<std::string>();
+    }
+    serialize(snapshot, *body);
+
+    auto previous = std::atomic_exchange(&m_body, std::shared_ptr<const std::string>(body));
+    m_spare = std::const_pointer_cast<std::string>(previous);
+}
+
+bool MetricsExporter::start(unsigned short port, const std::string& bindAddress) {
+    if (m_thread.joinable()) return false;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return false;
+#endif
+
+    auto fail = [this]() {
+        if (m_listenSocket != NO_SOCKET) {
+            closeSocket(m_listenSocket);
+            m_listenSocket = NO_SOCKET;
+        }
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    };
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, bindAddress.c_str(), &address.sin_addr) != 1) return fail();
+
+    SocketHandle listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    m_listenSocket = static_cast<intptr_t>(listener);
+    if (m_listenSocket == NO_SOCKET) return fail();
+
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        return fail();
+    }
+
+    socklen_t length = sizeof(address);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+    m_port = ntohs(address.sin_port);
+
+    m_stopRequested = false;
+    m_thread = std::thread(&MetricsExporter::serveLoop, this);
+    return true;
+}
+
+void MetricsExporter::stop() {
+    m_stopRequested = true;
+    if (m_thread.joinable()) m_thread.join();
+
+    if (m_listenSocket != NO_SOCKET) {
+        closeSocket(m_listenSocket);
+        m_listenSocket = NO_SOCKET;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+}
+
+void MetricsExporter::serveLoop() {
+    const SocketHandle listener = static_cast<SocketHandle>(m_listenSocket);
+    while (!m_stopRequested) {
+        // Wake up periodically to notice stop()
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+        timeval timeout = { 0, 200 * 1000 };
+        if (select(static_cast<int>(listener) + 1, &readable, nullptr, nullptr, &timeout) <= 0) continue;
+
+        SocketHandle client = accept(listener, nullptr, nullptr);
+        if (static_cast<intptr_t>(client) == NO_SOCKET) continue;
+        handleConnection(static_cast<intptr_t>(client));
+        closeSocket(static_cast<intptr_t>(client));
+    }
+}
+
+void MetricsExporter::handleConnection(intptr_t client) {
+    const SocketHandle socket = static_cast<SocketHandle>(client);
+
+    // Scrapes are served one at a time, so a stalled client must not hold up the others
+#ifdef _WIN32
+    DWORD timeoutMs = 2000;
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeoutMs), sizeof(timeoutMs));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeoutMs), sizeof(timeoutMs));
+#else
+    timeval timeout = { 2, 0 };
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#endif
+
+    // Only the request line matters; read until the end of the headers
+    char request[2048];
+    size_t length = 0;
+    while (length < sizeof(request) - 1) {
+        int received = recv(socket, request + length, static_cast<int>(sizeof(request) - 1 - length), 0);
+        if (received <= 0) break;
+        length += static_cast<size_t>(received);
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n")) break;
+    }
+    request[length] = '\0';
+
+    char header[256];
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0) {
+        auto body = std::atomic_load(&m_body);
+        int headerLength = snprintf(header, sizeof(header),
+            "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+            CONTENT_TYPE, body->size());
+        if (sendAll(client, header, static_cast<size_t>(headerLength))) {
+            sendAll(client, body->data(), body->size());
+        }
+        m_scrapes.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        static const char NOT_FOUND[] =
+            "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 24\r\nConnection: close\r\n\r\n"
+            "Metrics are at /metrics\n";
+        sendAll(client, NOT_FOUND, sizeof(NOT_FOUND) - 1);
+    }
+}
@@ -0,0 +1,492 @@
+#include "metrics_history.hpp"
+#include "gpu_monitor.hpp"
+#include "metric_registry.hpp"
+#include <algorithm>
+
+void toMetricValues(const GpuMetrics& metrics, float (&values)[METRIC_COUNT]) {
+    for (size_t i = 0; i < METRIC_COUNT; ++i) {
+        values[i] = static_cast<float>(METRIC_DESCRIPTORS[i].value(metrics));
+    }
+}
+
+HistoryTier::HistoryTier(const TierSpec& spec, bool rollup)
+    : m_spec(spec)
+    , m_rollup(rollup)
+    , m_columnCount(rollup ? METRIC_COUNT * STAT_COUNT : METRIC_COUNT)
+    , m_ring(std::make_shared<Ring>((spec.compressed ? BLOCK_SAMPLES : spec.capacity) + SLACK_SAMPLES, m_columnCount))
+{
+    if (spec.compressed) m_blocks = std::make_shared<const BlockList>();
+}
+
+Span<long long> HistoryTier::timestamps() const {
+    Span<long long> span;
+    if (m_size == 0 || m_spec.compressed) return span;
+
+    span.data = m_ring->timestamps.data() + ringStart();
+    span.size = m_size;
+    return span;
+}
+
+Span<float> HistoryTier::column(Metric metric, Stat stat) const {
+    Span<float> span;
+    if (m_size == 0 || m_spec.compressed) return span;
+
+    span.data = columnBase(columnIndex(metric, stat)) + ringStart();
+    span.size = m_size;
+    return span;
+}
+
+float HistoryTier::latest(Metric metric, Stat stat) const {
+    if (m_size == 0) return 0.0f;
+    if (ringSamples() > 0) return columnBase(columnIndex(metric, stat))[ringStart() + ringSamples() - 1];
+
+    // A compressed tier restored from whole blocks has nothing open yet
+    const CompressedBlock& block = *m_blocks->back();
+    float values[BLOCK_SAMPLES];
+    decompressColumn(block, columnIndex(metric, stat), values);
+    return values[block.count - 1];
+}
+
+long long HistoryTier::latestTimestamp() const {
+    if (m_size == 0) return 0;
+    if (ringSamples() > 0) return m_ring->timestamps[ringStart() + ringSamples() - 1];
+    return m_blocks->back()->lastTimestampMs;
+}
+
+size_t HistoryTier::lowerBound(long long timestampMs) const {
+    Span<long long> ts = timestamps();
+    return static_cast<size_t>(std::lower_bound(ts.begin(), ts.end(), timestampMs) - ts.begin());
+}
+
+void HistoryTier::push(long long timestampMs, const float* values) {
+    if (m_spec.capacity == 0) return;
+
+    // Seal lazily so the open block always holds the newest sample
+    if (m_spec.compressed && m_open == BLOCK_SAMPLES) sealBlock();
+
+    const size_t slots = m_ring->slots;
+    const size_t slot = static_cast<size_t>(m_end % slots);
+    m_ring->timestamps[slot] = timestampMs;
+    m_ring->timestamps[slot + slots] = timestampMs;
+
+    float* base = m_ring->values.data();
+    for (size_t c = 0; c < m_columnCount; ++c, base += 2 * slots) {
+        base[slot] = values[c];
+        base[slot + slots] = values[c];
+    }
+    ++m_end;
+
+    if (m_spec.compressed) {
+        ++m_open;
+        m_size = std::min(m_sealedSamples + m_open, m_spec.capacity);
+    } else if (m_size < m_spec.capacity) {
+        ++m_size;
+    }
+}
+
+void HistoryTier::clear() {
+    m_size = 0;
+    m_open = 0;
+    m_sealedSamples = 0;
+    if (m_spec.compressed) m_blocks = std::make_shared<const BlockList>();
+}
+
+bool HistoryTier::overwrites(const HistoryTier& published, size_t pushes) const {
+    if (published.m_ring != m_ring) return false;
+    // The last of the pushes lands on the slot of the sample one ring before it
+    const unsigned long long oldest = published.m_end - published.ringSamples();
+    return m_end + pushes > oldest + m_ring->slots;
+}
+
+void HistoryTier::detach() {
+    m_ring = std::make_shared<Ring>(*m_ring);
+}
+
+void HistoryTier::sealBlock() {
+    const size_t start = ringStart();
+    auto block = compressBlock(m_ring->timestamps.data() + start, m_ring->values.data() + start,
+                               2 * m_ring->slots, m_columnCount, m_open);
+    m_open = 0;
+    appendSealed(std::move(block));
+}
+
+// Copies share the block list, so this builds a new one with the block added,
+// dropping whole blocks while the remaining ones still cover the capacity
+void HistoryTier::appendSealed(std::shared_ptr<const CompressedBlock> block) {
+    size_t sealed = m_sealedSamples + block->count;
+    size_t dropped = 0;
+    while (dropped < m_blocks->size() && sealed - (*m_blocks)[dropped]->count >= m_spec.capacity) {
+        sealed -= (*m_blocks)[dropped]->count;
+        ++dropped;
+    }
+    auto blocks = std::make_shared<BlockList>(m_blocks->begin() + dropped, m_blocks->end());
+    blocks->push_back(std::move(block));
+    m_blocks = std::move(blocks);
+    m_sealedSamples = sealed;
+    m_size = std::min(m_sealedSamples + m_open, m_spec.capacity);
+}
+
+void HistoryTier::decode(long long fromMs, size_t column, std::vector<long long>* timestamps,
+                         std::vector<float>& values) const {
+    if (!m_spec.compressed) {
+        const size_t first = lowerBound(fromMs);
+        Span<long long> times = this->timestamps().subspan(first);
+        const float* base = columnBase(column) + ringStart() + first;
+        if (timestamps) timestamps->insert(timestamps->end(), times.begin(), times.end());
+        values.insert(values.end(), base, base + times.size);
+        return;
+    }
+
+    // Whole blocks are kept, so the oldest stored samples can be past capacity; hide them
+    size_t expired = m_sealedSamples + m_open - m_size;
+
+    long long blockTimes[BLOCK_SAMPLES];
+    float blockValues[BLOCK_SAMPLES];
+    for (const auto& block : *m_blocks) {
+        const size_t expiredHere = std::min(expired, block->count);
+        expired -= expiredHere;
+        if (expiredHere == block->count || block->lastTimestampMs < fromMs) continue;
+
+        // Timestamps are only decoded when asked for or to trim the block straddling fromMs
+        size_t skip = expiredHere;
+        if (timestamps || block->firstTimestampMs < fromMs) {
+            decompressTimestamps(*block, blockTimes);
+            skip = std::max(skip, static_cast<size_t>(
+                std::lower_bound(blockTimes, blockTimes + block->count, fromMs) - blockTimes));
+            if (timestamps) timestamps->insert(timestamps->end(), blockTimes + skip, blockTimes + block->count);
+        }
+        decompressColumn(*block, column, blockValues);
+        values.insert(values.end(), blockValues + skip, blockValues + block->count);
+    }
+
+    const long long* open = m_ring->timestamps.data() + ringStart();
+    const float* openValues = columnBase(column) + ringStart();
+    const size_t first = std::max(expired,
+        static_cast<size_t>(std::lower_bound(open, open + m_open, fromMs) - open));
+    if (timestamps) timestamps->insert(timestamps->end(), open + first, open + m_open);
+    values.insert(values.end(), openValues + first, openValues + m_open);
+}
+
+void HistoryTier::exportBlocks(std::vector<std::shared_ptr<const CompressedBlock>>& out) const {
+    if (m_size == 0) return;
+
+    const size_t start = ringStart();
+    const size_t stride = 2 * m_ring->slots;
+    if (m_spec.compressed) {
+        // Blocks whose samples have all expired are left out; the rest go as they are
+        size_t expired = m_sealedSamples + m_open - m_size;
+        for (const auto& block : *m_blocks) {
+            if (expired >= block->count) {
+                expired -= block->count;
+                continue;
+            }
+            expired = 0;
+            out.push_back(block);
+        }
+        if (m_open > 0) {
+            out.push_back(compressBlock(m_ring->timestamps.data() + start, m_ring->values.data() + start,
+                                        stride, m_columnCount, m_open));
+        }
+        return;
+    }
+
+    for (size_t offset = 0; offset < m_size; offset += BLOCK_SAMPLES) {
+        const size_t count = std::min(BLOCK_SAMPLES, m_size - offset);
+        out.push_back(compressBlock(m_ring->timestamps.data() + start + offset, m_ring->values.data() + start + offset,
+                                    stride, m_columnCount, count));
+    }
+}
+
+bool HistoryTier::appendBlock(const std::shared_ptr<const CompressedBlock>& block) {
+    if (block->columnCount() != m_columnCount) return false;
+    if (block->count == 0) return true;
+
+    // Blocks come from a file that may be damaged; readers rely on timestamps rising
+    std::vector<long long> timestamps(block->count);
+    decompressTimestamps(*block, timestamps.data());
+    if (timestamps.back() != block->lastTimestampMs) return false;
+    if (m_size > 0 && timestamps[0] <= latestTimestamp()) return false;
+    for (size_t i = 1; i < block->count; ++i) {
+        if (timestamps[i] <= timestamps[i - 1]) return false;
+    }
+
+    // A full block in front of an empty open block is exactly what sealing would have produced
+    if (m_spec.compressed && m_open == 0 && block->count == BLOCK_SAMPLES) {
+        appendSealed(block);
+        return true;
+    }
+
+    std::vector<float> columns(block->count * m_columnCount);
+    for (size_t c = 0; c < m_columnCount; ++c) {
+        decompressColumn(*block, c, columns.data() + c * block->count);
+    }
+    std::vector<float> row(m_columnCount);
+    for (size_t i = 0; i < block->count; ++i) {
+        for (size_t c = 0; c < m_columnCount; ++c) row[c] = columns[c * block->count + i];
+        push(timestamps[i], row.data());
+    }
+    return true;
+}
+
+size_t HistoryTier::memoryBytes() const {
+    size_t bytes = sizeof(*this) + sizeof(Ring) + m_ring->timestamps.capacity() * sizeof(long long) +
+                   m_ring->values.capacity() * sizeof(float);
+    if (m_blocks) {
+        bytes += m_blocks->capacity() * sizeof((*m_blocks)[0]);
+        for (const auto& block : *m_blocks) {
+            bytes += block->memoryBytes();
+        }
+    }
+    return bytes;
+}
+
+HistoryWindow HistoryReader::read(const HistoryTier& tier, Metric metric, long long fromMs) {
+    HistoryWindow window;
+    window.rollup = tier.isRollup();
+
+    if (!tier.isCompressed()) {
+        const size_t first = tier.lowerBound(fromMs);
+        window.timestamps = tier.timestamps().subspan(first);
+        window.avg = tier.column(metric, Stat::Avg).subspan(first);
+        window.min = tier.column(metric, Stat::Min).subspan(first);
+        window.max = tier.column(metric, Stat::Max).subspan(first);
+        return window;
+    }
+
+    // Raw tiers hold one column per metric, which stands in for every statistic
+    const size_t statCount = tier.isRollup() ? STAT_COUNT : 1;
+    m_timestamps.clear();
+    for (size_t stat = 0; stat < statCount; ++stat) {
+        m_columns[stat].clear();
+        tier.decode(fromMs, tier.columnIndex(metric, static_cast<Stat>(stat)),
+                    stat == 0 ? &m_timestamps : nullptr, m_columns[stat]);
+    }
+
+    window.timestamps.data = m_timestamps.data();
+    window.timestamps.size = m_timestamps.size();
+    Span<float>* spans[STAT_COUNT];
+    spans[static_cast<size_t>(Stat::Avg)] = &window.avg;
+    spans[static_cast<size_t>(Stat::Min)] = &window.min;
+    spans[static_cast<size_t>(Stat::Max)] = &window.max;
+    for (size_t stat = 0; stat < STAT_COUNT; ++stat) {
+        const auto& column = m_columns[stat < statCount ? stat : 0];
+        spans[stat]->data = column.data();
+        spans[stat]->size = column.size();
+    }
+    return window;
+}
+
+const HistoryTier& MetricsHistory::selectTier(long long windowMs) const {
+    if (m_fine && !m_tiers.empty() && m_fine->retentionMs() >= windowMs) {
+        // Allow one raw slot of slack since the fine tier starts mid-second
+        const HistoryTier& raw = *m_tiers[0];
+        const long long fineSpan = static_cast<long long>(m_fine->size()) * m_fine->spec().resolutionMs;
+        const long long rawSpan = static_cast<long long>(raw.size()) * raw.spec().resolutionMs;
+        if (m_fine->size() == m_fine->capacity() || fineSpan + raw.spec().resolutionMs >= rawSpan) return *m_fine;
+    }
+    for (const auto& tier : m_tiers) {
+        if (tier->retentionMs() >= windowMs) return *tier;
+    }
+    return *m_tiers.back();
+}
+
+Span<float> MetricsHistory::column(Metric metric) const {
+    if (m_tiers.empty()) return Span<float>();
+    return m_tiers[0]->column(metric);
+}
+
+size_t MetricsHistory::memoryBytes() const {
+    size_t bytes = 0;
+    for (const auto& tier : m_tiers) bytes += tier->memoryBytes();
+    if (m_fine) bytes += m_fine->memoryBytes();
+    return bytes;
+}
+
+size_t MetricsHistory::rawBytes() const {
+    size_t bytes = 0;
+    for (const auto& tier : m_tiers) bytes += tier->rawBytes();
+    return bytes;
+}
+
+TieredHistory::TieredHistory(const std::vector<TierSpec>& tiers)
+    : m_retired(tiers.size())
+    , m_rollups(tiers.size())
+{
+    for (size_t t = 0; t < tiers.size(); ++t) {
+        m_tiers.push_back(std::make_shared<HistoryTier>(tiers[t], t > 0));
+    }
+}
+
+HistoryTier& TieredHistory::writable(std::shared_ptr<HistoryTier>& current,
+                                    std::vector<std::shared_ptr<HistoryTier>>& retired, size_t pushes) {
+    if (current.use_count() > 1) {
+        // A published view holds this copy, so retire it and carry on in
+        // another. Copies share their samples; this only copies the window's
+        // position, into a retired copy whose views are gone where there is one.
+        auto spare = std::find_if(retired.begin(), retired.end(),
+            [](const std::shared_ptr<HistoryTier>& tier) { return tier.use_count() == 1; });
+        if (spare == retired.end()) {
+            spare = retired.insert(retired.end(), std::make_shared<HistoryTier>(*current));
+        } else {
+            **spare = *current;
+        }
+        std::swap(current, *spare);
+    }
+
+    // Views normally let go within the ring's slack; one held longer keeps the old ring to itself
+    for (const auto& tier : retired) {
+        if (tier.use_count() > 1 && current->overwrites(*tier, pushes)) {
+            current->detach();
+            break;
+        }
+    }
+    return *current;
+}
+
+void TieredHistory::flushRollup(size_t tier) {
+    Rollup& rollup = m_rollups[tier];
+    if (rollup.count == 0) return;
+
+    float values[METRIC_COUNT * STAT_COUNT];
+    for (size_t m = 0; m < METRIC_COUNT; ++m) {
+        values[m * STAT_COUNT + static_cast<size_t>(Stat::Avg)] = static_cast<float>(rollup.sum[m] / rollup.weight);
+        values[m * STAT_COUNT + static_cast<size_t>(Stat::Min)] = rollup.min[m];
+        values[m * STAT_COUNT + static_cast<size_t>(Stat::Max)] = rollup.max[m];
+    }
+
+    HistoryTier& target = writable(tier, 1);
+    target.push(rollup.bucket * target.spec().resolutionMs, values);
+    rollup.count = 0;
+}
+
+void TieredHistory::push(const GpuMetrics& metrics, long long timestampMs) {
+    if (m_tiers.empty()) return;
+
+    float values[METRIC_COUNT];
+    toMetricValues(metrics, values);
+
+    // Keep the raw tier at its nominal resolution so its retention holds at any
+    // sampling rate; the fine tier keeps what the raw tier drops
+    const long long resolutionMs = m_tiers[0]->spec().resolutionMs;
+    const bool sameSlot = m_lastPushMs >= 0 && timestampMs / resolutionMs == m_lastPushMs / resolutionMs;
+    if (sameSlot || m_fine) pushFine(timestampMs, values);
+    if (!sameSlot) writable(0, 1).push(timestampMs, values);
+    const long long sinceLastMs = m_lastPushMs >= 0 ? timestampMs - m_lastPushMs : resolutionMs;
+    m_lastPushMs = timestampMs;
+
+    for (size_t t = 1; t < m_tiers.size(); ++t) {
+        Rollup& rollup = m_rollups[t];
+        const long long tierResolutionMs = m_tiers[t]->spec().resolutionMs;
+        const long long bucket = timestampMs / tierResolutionMs;
+
+        // Averages weigh each sample by the time it stands for, so irregular
+        // sampling does not skew them towards the busy stretches
+        const double weight = static_cast<double>(std::min(std::max(sinceLastMs, 1LL), tierResolutionMs));
+
+        // A sample in a new bucket closes the previous one
+        if (rollup.count > 0 && bucket != rollup.bucket) {
+            flushRollup(t);
+        }
+
+        if (rollup.count == 0) {
+            rollup.bucket = bucket;
+            for (size_t m = 0; m < METRIC_COUNT; ++m) {
+                rollup.min[m] = values[m];
+                rollup.max[m] = values[m];
+                rollup.sum[m] = 0.0;
+            }
+            rollup.weight = 0.0;
+        }
+
+        for (size_t m = 0; m < METRIC_COUNT; ++m) {
+            rollup.min[m] = std::min(rollup.min[m], values[m]);
+            rollup.max[m] = std::max(rollup.max[m], values[m]);
+            rollup.sum[m] += values[m] * weight;
+        }
+        rollup.weight += weight;
+        ++rollup.count;
+    }
+}
+
+HistoryTier& TieredHistory::writableFine() {
+    if (!m_fine) {
+        const bool compressed = !m_tiers.empty() && m_tiers[0]->isCompressed();
+        m_fine = std::make_shared<HistoryTier>(TierSpec{ FINE_RESOLUTION_MS, FINE_CAPACITY, compressed }, false);
+    }
+    return writable(m_fine, m_fineRetired, 1);
+}
+
+void TieredHistory::pushFine(long long timestampMs, const float* values) {
+    std::copy(values, values + METRIC_COUNT, m_fineValues);
+    const long long bucket = timestampMs / FINE_RESOLUTION_MS;
+    if (bucket > m_fineBucket) {
+        writableFine().push(bucket * FINE_RESOLUTION_MS, m_fineValues);
+        m_fineBucket = bucket;
+    }
+}
+
+void TieredHistory::pushSubSamples(const std::vector<SubSample>& samples, const GpuMetrics& metrics) {
+    float tick[METRIC_COUNT];
+    toMetricValues(metrics, tick);
+    bool sampled[METRIC_COUNT] = {};
+    for (const auto& sample : samples) sampled[static_cast<size_t>(sample.metric)] = true;
+    for (size_t m = 0; m < METRIC_COUNT; ++m) {
+        if (!sampled[m]) m_fineValues[m] = tick[m];
+    }
+
+    // Samples come grouped by metric; interleave them by time
+    m_fineScratch.assign(samples.begin(), samples.end());
+    std::stable_sort(m_fineScratch.begin(), m_fineScratch.end(),
+        [](const SubSample& a, const SubSample& b) { return a.timestampMs < b.timestampMs; });
+
+    size_t i = 0;
+    while (i < m_fineScratch.size()) {
+        const long long bucket = m_fineScratch[i].timestampMs / FINE_RESOLUTION_MS;
+        double sum[METRIC_COUNT] = {};
+        unsigned int count[METRIC_COUNT] = {};
+        for (; i < m_fineScratch.size() && m_fineScratch[i].timestampMs / FINE_RESOLUTION_MS == bucket; ++i) {
+            const size_t m = static_cast<size_t>(m_fineScratch[i].metric);
+            sum[m] += m_fineScratch[i].value;
+            ++count[m];
+        }
+        for (size_t m = 0; m < METRIC_COUNT; ++m) {
+            if (count[m] > 0) m_fineValues[m] = static_cast<float>(sum[m] / count[m]);
+        }
+
+        // Late readings for a bucket already written only carry forward
+        if (bucket > m_fineBucket) {
+            writableFine().push(bucket * FINE_RESOLUTION_MS, m_fineValues);
+            m_fineBucket = bucket;
+        }
+    }
+}
+
+void TieredHistory::clear() {
+    for (size_t t = 0; t < m_tiers.size(); ++t) {
+        clearTier(t);
+    }
+    if (m_fine) writable(m_fine, m_fineRetired, 0).clear();
+    m_fineBucket = -1;
+    m_lastPushMs = -1;
+}
+
+void TieredHistory::clearTier(size_t tier) {
+    writable(tier, 0).clear();
+    m_rollups[tier].count = 0;
+}
+
+bool TieredHistory::restoreTier(size_t tier, const std::vector<std::shared_ptr<const CompressedBlock>>& blocks) {
+    size_t samples = 0;
+    for (const auto& block : blocks) samples += block->count;
+    HistoryTier& target = writable(tier, samples);
+    for (const auto& block : blocks) {
+        if (!target.appendBlock(block)) return false;
+    }
+    // Rollups weigh the first new sample as if it followed the newest raw one
+    if (tier == 0 && !target.empty()) m_lastPushMs = target.latestTimestamp();
+    return true;
+}
+
+MetricsHistory TieredHistory::view() const {
+    return MetricsHistory(m_name, std::vector<std::shared_ptr<const HistoryTier>>(m_tiers.begin(), m_tiers.end()), m_fine);
+}
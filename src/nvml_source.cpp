@@ -0,0 +1,486 @@
+#include "nvml_source.hpp"
+#include "gpu_monitor.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+struct SampledMetric {
+    nvmlSamplingType_t type;
+    Metric metric;
+    double scale;  // To GpuMetrics units
+};
+
+// In NvmlSource::DeviceState::sampled order
+constexpr SampledMetric SAMPLED_METRICS[] = {
+    { NVML_GPU_UTILIZATION_SAMPLES, Metric::GpuUtil, 1.0 },
+    { NVML_MEMORY_UTILIZATION_SAMPLES, Metric::MemUtil, 1.0 },
+    { NVML_TOTAL_POWER_SAMPLES, Metric::PowerUsage, 0.001 },
+    { NVML_PROCESSOR_CLK_SAMPLES, Metric::CoreClock, 1.0 },
+};
+
+struct BatchedField {
+    unsigned int fieldId;
+    Metric metric;
+    double scale;
+};
+
+// NVML has field IDs for few of the counters shown; clocks, utilization, fan
+// and temperature are not among them
+constexpr BatchedField BATCHED_METRICS[] = {
+    { NVML_FI_DEV_POWER_INSTANT, Metric::PowerUsage, 0.001 },
+};
+
+unsigned int metricBit(Metric metric) {
+    return 1u << static_cast<unsigned int>(metric);
+}
+
+// Errors that will not go away by asking again
+bool isPermanentError(nvmlReturn_t result) {
+    return result == NVML_ERROR_NOT_SUPPORTED || result == NVML_ERROR_NO_PERMISSION ||
+           result == NVML_ERROR_FUNCTION_NOT_FOUND || result == NVML_ERROR_INVALID_ARGUMENT;
+}
+
+double toDouble(nvmlValueType_t type, const nvmlValue_t& value) {
+    switch (type) {
+        case NVML_VALUE_TYPE_DOUBLE: return value.dVal;
+        case NVML_VALUE_TYPE_UNSIGNED_INT: return value.uiVal;
+        case NVML_VALUE_TYPE_UNSIGNED_LONG: return static_cast<double>(value.ulVal);
+        case NVML_VALUE_TYPE_UNSIGNED_LONG_LONG: return static_cast<double>(value.ullVal);
+        case NVML_VALUE_TYPE_SIGNED_LONG_LONG: return static_cast<double>(value.sllVal);
+        case NVML_VALUE_TYPE_SIGNED_INT: return value.siVal;
+        default: return 0.0;
+    }
+}
+
+constexpr unsigned long long WATCHED_EVENTS = nvmlEventTypeXidCriticalError | nvmlEventTypeDoubleBitEccError;
+
+static_assert(throttle_reason::SW_POWER_CAP == nvmlClocksThrottleReasonSwPowerCap &&
+              throttle_reason::HW_SLOWDOWN == nvmlClocksThrottleReasonHwSlowdown &&
+              throttle_reason::SW_THERMAL == nvmlClocksThrottleReasonSwThermalSlowdown &&
+              throttle_reason::HW_THERMAL == nvmlClocksThrottleReasonHwThermalSlowdown &&
+              throttle_reason::HW_POWER_BRAKE == nvmlClocksThrottleReasonHwPowerBrakeSlowdown,
+              "throttle_reason bits must match NVML's");
+
+// In NvmlSource::DeviceState::violation* order, with the reasons each policy stands for
+struct ViolationPolicy {
+    nvmlPerfPolicyType_t policy;
+    unsigned long long reasons;
+};
+
+constexpr ViolationPolicy VIOLATION_POLICIES[] = {
+    { NVML_PERF_POLICY_POWER, throttle_reason::SW_POWER_CAP },
+    { NVML_PERF_POLICY_THERMAL, throttle_reason::SW_THERMAL },
+};
+
+long long wallClockMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void setMetric(GpuMetrics& metrics, Metric metric, double value) {
+    switch (metric) {
+        case Metric::GpuUtil: metrics.gpuUtil = static_cast<unsigned int>(value); break;
+        case Metric::MemUtil: metrics.memUtil = static_cast<unsigned int>(value); break;
+        case Metric::PowerUsage: metrics.powerUsage = value; break;
+        case Metric::CoreClock: metrics.coreClock = static_cast<unsigned int>(value); break;
+        default: break;
+    }
+}
+
+}
+
+bool NvmlSource::initialize() {
+    nvmlReturn_t result = nvmlInit();
+    if (result != NVML_SUCCESS) return false;
+
+    refreshDevices();
+    return true;
+}
+
+void NvmlSource::shutdown() {
+    nvmlShutdown();
+}
+
+bool NvmlSource::refreshDevices() {
+    if (!m_registry.refresh() && m_states.size() == m_registry.size()) return false;
+
+    // Per-device scratch state (process buffers, utilization cursors) follows the new order
+    m_states.clear();
+    m_states.resize(m_registry.size());
+
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    m_eventDevices.clear();
+    for (size_t i = 0; i < m_registry.size(); ++i) {
+        const DeviceInfo& info = m_registry.devices()[i];
+        m_eventDevices.push_back({ m_registry.handle(i), info.index, info.uuid });
+    }
+    ++m_eventVersion;
+    return true;
+}
+
+SampleStatus NvmlSource::sampleDevice(size_t index, GpuMetrics& metrics, std::vector<ProcessInfo>& processes) {
+    nvmlDevice_t device = m_registry.handle(index);
+    DeviceState& state = m_states[index];
+    state.subSamples.clear();
+
+    // Utilization, power and SM clock come from the driver's sample ring, which
+    // also yields the readings between ticks. Power falls back to a batched
+    // field query, and anything still missing to its dedicated call.
+    unsigned int pending = metricBit(Metric::GpuUtil) | metricBit(Metric::MemUtil) |
+                           metricBit(Metric::PowerUsage) | metricBit(Metric::CoreClock);
+    nvmlReturn_t result = readSampledCounters(device, state, metrics, pending);
+    if (result == NVML_SUCCESS && pending != 0) result = readFields(device, state, metrics, pending);
+    if (result == NVML_ERROR_GPU_IS_LOST) return SampleStatus::DeviceLost;
+
+    // Get utilization
+    if (pending & (metricBit(Metric::GpuUtil) | metricBit(Metric::MemUtil))) {
+        nvmlUtilization_t utilization;
+        result = NVWINTOP_TIMED(Probe::NvmlGetUtilizationRates, nvmlDeviceGetUtilizationRates(device, &utilization));
+        if (result == NVML_ERROR_GPU_IS_LOST) return SampleStatus::DeviceLost;
+        if (result == NVML_SUCCESS) {
+            if (pending & metricBit(Metric::GpuUtil)) metrics.gpuUtil = utilization.gpu;
+            if (pending & metricBit(Metric::MemUtil)) metrics.memUtil = utilization.memory;
+        }
+    }
+
+    // Get temperature
+    unsigned int temp;
+    if (NVWINTOP_TIMED(Probe::NvmlGetTemperature, nvmlDeviceGetTemperature(device, NVML_TEMPERATURE_GPU, &temp)) == NVML_SUCCESS) {
+        metrics.temperature = temp;
+    }
+
+    // Get fan speed
+    unsigned int fanSpeed;
+    if (NVWINTOP_TIMED(Probe::NvmlGetFanSpeed, nvmlDeviceGetFanSpeed(device, &fanSpeed)) == NVML_SUCCESS) {
+        metrics.fanSpeed = fanSpeed;
+    }
+
+    // Get power usage
+    unsigned int power;
+    if ((pending & metricBit(Metric::PowerUsage)) && NVWINTOP_TIMED(Probe::NvmlGetPowerUsage, nvmlDeviceGetPowerUsage(device, &power)) == NVML_SUCCESS) {
+        metrics.powerUsage = power / 1000.0; // Convert from milliwatts to watts
+    }
+
+    // Get clock speeds
+    unsigned int clock;
+    if ((pending & metricBit(Metric::CoreClock)) &&
+        NVWINTOP_TIMED(Probe::NvmlGetClockInfo, nvmlDeviceGetClockInfo(device, NVML_CLOCK_GRAPHICS, &clock)) == NVML_SUCCESS) {
+        metrics.coreClock = clock;
+    }
+    if (NVWINTOP_TIMED(Probe::NvmlGetClockInfo, nvmlDeviceGetClockInfo(device, NVML_CLOCK_MEM, &clock)) == NVML_SUCCESS) {
+        metrics.memClock = clock;
+    }
+
+    // Get memory info
+    nvmlMemory_t memInfo;
+    if (NVWINTOP_TIMED(Probe::NvmlGetMemoryInfo, nvmlDeviceGetMemoryInfo(device, &memInfo)) == NVML_SUCCESS) {
+        metrics.usedMemory = memInfo.used;
+    }
+
+    // Get process information
+    collectProcesses(nvmlDeviceGetComputeRunningProcesses, Probe::NvmlGetComputeProcesses, device, metrics.index,
+                     state, processes);
+    collectProcesses(nvmlDeviceGetGraphicsRunningProcesses, Probe::NvmlGetGraphicsProcesses, device, metrics.index,
+                     state, processes);
+    collectProcessUtilization(device, state, processes);
+
+    readThrottling(device, m_registry.devices()[index], state);
+
+    return SampleStatus::Ok;
+}
+
+void NvmlSource::collectSubSamples(size_t index, std::vector<SubSample>& samples) {
+    // Hand the buffer over; the caller's empty one becomes next tick's
+    samples.swap(m_states[index].subSamples);
+}
+
+void NvmlSource::collectEvents(size_t index, std::vector<GpuEvent>& events) {
+    events.swap(m_states[index].events);
+}
+
+bool NvmlSource::openEvents() {
+    return registerEvents();
+}
+
+void NvmlSource::waitEvents(unsigned int timeoutMs, std::vector<GpuEvent>& events) {
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(m_eventMutex);
+        changed = m_eventVersion != m_registeredVersion;
+    }
+    if (changed) registerEvents();
+    if (!m_eventSet) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return;
+    }
+
+    nvmlEventData_t data = {};
+    nvmlReturn_t result = nvmlEventSetWait_v2(m_eventSet, &data, timeoutMs);
+    if (result == NVML_ERROR_TIMEOUT) return;
+    if (result != NVML_SUCCESS) {
+        // Waiting again straight away would spin
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return;
+    }
+
+    GpuEvent event = {};
+    event.timestampMs = wallClockMs();
+    event.lastMs = event.timestampMs;
+    event.count = 1;
+    if (data.eventType & nvmlEventTypeXidCriticalError) {
+        event.type = GpuEventType::Xid;
+        event.data = data.eventData;
+    } else if (data.eventType & nvmlEventTypeDoubleBitEccError) {
+        event.type = GpuEventType::EccError;
+    } else {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    for (const EventDevice& device : m_eventDevices) {
+        if (device.handle != data.device) continue;
+        event.gpuIndex = device.index;
+        event.uuid = device.uuid;
+        events.push_back(std::move(event));
+        return;
+    }
+}
+
+void NvmlSource::closeEvents() {
+    if (m_eventSet) nvmlEventSetFree(m_eventSet);
+    m_eventSet = nullptr;
+}
+
+bool NvmlSource::registerEvents() {
+    std::vector<nvmlDevice_t> handles;
+    {
+        std::lock_guard<std::mutex> lock(m_eventMutex);
+        m_registeredVersion = m_eventVersion;
+        for (const EventDevice& device : m_eventDevices) handles.push_back(device.handle);
+    }
+
+    // A set cannot drop a device, so a new list gets a new set
+    closeEvents();
+    if (nvmlEventSetCreate(&m_eventSet) != NVML_SUCCESS) {
+        m_eventSet = nullptr;
+        return false;
+    }
+
+    bool registered = false;
+    for (nvmlDevice_t handle : handles) {
+        unsigned long long supported = 0;
+        if (nvmlDeviceGetSupportedEventTypes(handle, &supported) != NVML_SUCCESS) continue;
+        if ((supported & WATCHED_EVENTS) == 0) continue;
+        if (nvmlDeviceRegisterEvents(handle, supported & WATCHED_EVENTS, m_eventSet) == NVML_SUCCESS) registered = true;
+    }
+    if (!registered) closeEvents();
+    return registered;
+}
+
+nvmlReturn_t NvmlSource::readSampledCounters(nvmlDevice_t device, DeviceState& state, GpuMetrics& metrics,
+                                             unsigned int& pending) {
+    static_assert(sizeof(SAMPLED_METRICS) / sizeof(SAMPLED_METRICS[0]) == SAMPLED_COUNTERS, "SAMPLED_COUNTERS out of date");
+
+    for (size_t c = 0; c < SAMPLED_COUNTERS; ++c) {
+        const SampledMetric& spec = SAMPLED_METRICS[c];
+        SampledCounter& counter = state.sampled[c];
+        if (!counter.supported) continue;
+
+        nvmlValueType_t valueType;
+        nvmlReturn_t result;
+        if (counter.buffer.empty()) {
+            // A null buffer asks for the size of the driver's ring
+            unsigned int capacity = 0;
+            result = NVWINTOP_TIMED(Probe::NvmlGetSamples, nvmlDeviceGetSamples(device, spec.type, 0, &valueType, &capacity, nullptr));
+            if (result == NVML_ERROR_GPU_IS_LOST) return result;
+            if (result != NVML_SUCCESS || capacity == 0) {
+                counter.supported = !isPermanentError(result);
+                continue;
+            }
+            counter.buffer.resize(capacity);
+        }
+
+        // Only readings newer than the last one seen; the ring is not necessarily in time order
+        unsigned int count = static_cast<unsigned int>(counter.buffer.size());
+        result = NVWINTOP_TIMED(Probe::NvmlGetSamples, nvmlDeviceGetSamples(device, spec.type, counter.lastTimestamp, &valueType, &count, counter.buffer.data()));
+        if (result == NVML_ERROR_GPU_IS_LOST) return result;
+        if (result == NVML_SUCCESS) {
+            const unsigned long long previous = counter.lastTimestamp;
+            for (unsigned int i = 0; i < count; ++i) {
+                const nvmlSample_t& sample = counter.buffer[i];
+                if (sample.timeStamp <= previous) continue;
+
+                const float value = static_cast<float>(toDouble(valueType, sample.sampleValue) * spec.scale);
+                state.subSamples.push_back({ static_cast<long long>(sample.timeStamp / 1000), spec.metric, value });
+                if (sample.timeStamp > counter.lastTimestamp) {
+                    counter.lastTimestamp = sample.timeStamp;
+                    counter.value = value;
+                    counter.hasValue = true;
+                }
+            }
+        } else if (result != NVML_ERROR_NOT_FOUND) {
+            // NOT_FOUND only means nothing new since the last tick
+            counter.supported = !isPermanentError(result);
+            continue;
+        }
+
+        if (counter.hasValue) {
+            setMetric(metrics, spec.metric, counter.value);
+            pending &= ~metricBit(spec.metric);
+        }
+    }
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t NvmlSource::readFields(nvmlDevice_t device, DeviceState& state, GpuMetrics& metrics,
+                                    unsigned int& pending) {
+    static_assert(sizeof(BATCHED_METRICS) / sizeof(BATCHED_METRICS[0]) == BATCHED_FIELDS, "BATCHED_FIELDS out of date");
+
+    // One call for every pending counter that has a field
+    nvmlFieldValue_t values[BATCHED_FIELDS] = {};
+    size_t requested[BATCHED_FIELDS];
+    int count = 0;
+    for (size_t f = 0; f < BATCHED_FIELDS; ++f) {
+        if (!state.fieldSupported[f] || !(pending & metricBit(BATCHED_METRICS[f].metric))) continue;
+        values[count].fieldId = BATCHED_METRICS[f].fieldId;
+        requested[count++] = f;
+    }
+    if (count == 0) return NVML_SUCCESS;
+
+    nvmlReturn_t result = NVWINTOP_TIMED(Probe::NvmlGetFieldValues, nvmlDeviceGetFieldValues(device, count, values));
+    if (result == NVML_ERROR_GPU_IS_LOST) return result;
+    if (result != NVML_SUCCESS) {
+        if (isPermanentError(result)) {
+            for (int i = 0; i < count; ++i) state.fieldSupported[requested[i]] = false;
+        }
+        return NVML_SUCCESS;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const BatchedField& spec = BATCHED_METRICS[requested[i]];
+        if (values[i].nvmlReturn == NVML_ERROR_GPU_IS_LOST) return NVML_ERROR_GPU_IS_LOST;
+        if (values[i].nvmlReturn != NVML_SUCCESS) {
+            state.fieldSupported[requested[i]] = !isPermanentError(values[i].nvmlReturn);
+            continue;
+        }
+        setMetric(metrics, spec.metric, toDouble(values[i].valueType, values[i].value) * spec.scale);
+        pending &= ~metricBit(spec.metric);
+    }
+    return NVML_SUCCESS;
+}
+
+void NvmlSource::collectProcesses(ProcessQuery query, Probe probe, nvmlDevice_t device, unsigned int index,
+                                  DeviceState& state, std::vector<ProcessInfo>& processes) {
+    // The list can grow between the sizing call and the real one, so retry with what NVML asks for
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        unsigned int count = static_cast<unsigned int>(state.processBuffer.size());
+        nvmlReturn_t result = NVWINTOP_TIMED(probe, query(device, &count, state.processBuffer.data()));
+        if (result == NVML_ERROR_INSUFFICIENT_SIZE) {
+            state.processBuffer.resize(count + 8);
+            continue;
+        }
+        if (result != NVML_SUCCESS) return;
+
+        for (unsigned int p = 0; p < count; ++p) {
+            const nvmlProcessInfo_t& process = state.processBuffer[p];
+
+            // Not reported under WDDM on Windows
+            unsigned long long memoryUsed = process.usedGpuMemory;
+            if (memoryUsed == static_cast<unsigned long long>(NVML_VALUE_NOT_AVAILABLE)) memoryUsed = 0;
+
+            // A process doing both compute and graphics work is listed twice
+            auto existing = std::find_if(processes.begin(), processes.end(),
+                [&](const ProcessInfo& known) { return known.pid == process.pid; });
+            if (existing != processes.end()) {
+                existing->memoryUsed = std::max(existing->memoryUsed, memoryUsed);
+                continue;
+            }
+
+            ProcessInfo procInfo = {};
+            procInfo.gpuIndex = index;
+            procInfo.pid = process.pid;
+            procInfo.memoryUsed = memoryUsed;
+            processes.push_back(procInfo);
+        }
+        return;
+    }
+}
+
+void NvmlSource::collectProcessUtilization(nvmlDevice_t device, DeviceState& state, std::vector<ProcessInfo>& processes) {
+    if (processes.empty()) return;
+
+    // Only fetch samples the driver recorded since the last tick
+    unsigned int count = 0;
+    nvmlReturn_t result = NVWINTOP_TIMED(Probe::NvmlGetProcessUtilization, nvmlDeviceGetProcessUtilization(device, nullptr, &count, state.lastUtilTimestamp));
+    if ((result != NVML_SUCCESS && result != NVML_ERROR_INSUFFICIENT_SIZE) || count == 0) return;
+
+    if (state.utilBuffer.size() < count) state.utilBuffer.resize(count);
+    result = NVWINTOP_TIMED(Probe::NvmlGetProcessUtilization, nvmlDeviceGetProcessUtilization(device, state.utilBuffer.data(), &count, state.lastUtilTimestamp));
+    if (result != NVML_SUCCESS) return;
+
+    // Keep the newest sample per process
+    state.utilTimestamps.assign(processes.size(), 0);
+    for (unsigned int s = 0; s < count; ++s) {
+        const nvmlProcessUtilizationSample_t& utilSample = state.utilBuffer[s];
+        state.lastUtilTimestamp = std::max(state.lastUtilTimestamp, utilSample.timeStamp);
+
+        for (size_t p = 0; p < processes.size(); ++p) {
+            if (processes[p].pid != utilSample.pid) continue;
+            if (utilSample.timeStamp >= state.utilTimestamps[p]) {
+                state.utilTimestamps[p] = utilSample.timeStamp;
+                processes[p].gpuUtil = utilSample.smUtil;
+            }
+            break;
+        }
+    }
+}
+
+void NvmlSource::readThrottling(nvmlDevice_t device, const DeviceInfo& info, DeviceState& state) {
+    static_assert(sizeof(VIOLATION_POLICIES) / sizeof(VIOLATION_POLICIES[0]) == 2, "violation state out of date");
+
+    // The violation counters catch throttling that started and ended between
+    // two ticks; the current reasons name the hardware ones they do not cover
+    unsigned long long reasons = 0;
+    if (NVWINTOP_TIMED(Probe::NvmlGetThrottleReasons, nvmlDeviceGetCurrentClocksThrottleReasons(device, &reasons)) != NVML_SUCCESS) reasons = 0;
+    reasons &= throttle_reason::SLOWDOWN;
+
+    bool counted = false;
+    unsigned long long throttledNs = 0;
+    unsigned long long reference = 0;
+    for (size_t p = 0; p < 2; ++p) {
+        if (!state.violationSupported[p]) continue;
+        nvmlViolationTime_t violation = {};
+        nvmlReturn_t result = NVWINTOP_TIMED(Probe::NvmlGetViolationStatus, nvmlDeviceGetViolationStatus(device, VIOLATION_POLICIES[p].policy, &violation));
+        if (result != NVML_SUCCESS) {
+            state.violationSupported[p] = !isPermanentError(result);
+            continue;
+        }
+        counted = true;
+        reference = violation.referenceTime;
+        if (state.violationReference != 0 && violation.violationTime > state.violationNs[p]) {
+            throttledNs = std::max(throttledNs, violation.violationTime - state.violationNs[p]);
+            reasons |= VIOLATION_POLICIES[p].reasons;
+        }
+        state.violationNs[p] = violation.violationTime;
+    }
+
+    const long long nowMs = wallClockMs();
+    const long long previousMs = static_cast<long long>(state.violationReference / 1000);
+    if (counted) state.violationReference = reference;
+    if (reasons == 0) return;
+
+    GpuEvent event = {};
+    event.lastMs = counted && reference != 0 ? static_cast<long long>(reference / 1000) : nowMs;
+    event.durationMs = static_cast<unsigned int>(throttledNs / 1000000);
+    event.timestampMs = event.lastMs - event.durationMs;
+    if (previousMs != 0) event.timestampMs = std::max(event.timestampMs, previousMs);
+    event.uuid = info.uuid;
+    event.gpuIndex = info.index;
+    event.type = GpuEventType::Throttle;
+    event.data = reasons;
+    event.count = 1;
+    state.events.push_back(std::move(event));
+}
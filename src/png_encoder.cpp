@@ -0,0 +1,269 @@
+#include "png_encoder.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 3;
+constexpr size_t MAX_MATCH = 258;
+constexpr size_t MAX_DISTANCE = 32768;
+
+constexpr uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+constexpr uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+constexpr uint16_t DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+constexpr uint8_t DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// A code and its extra bits, ready to write least significant bit first
+struct Code {
+    uint32_t bits = 0;
+    uint32_t count = 0;
+};
+
+uint32_t reverseBits(uint32_t value, uint32_t count) {
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        result = (result << 1) | ((value >> i) & 1);
+    }
+    return result;
+}
+
+// Fixed Huffman codes of deflate (RFC 1951, 3.2.6)
+Code fixedLiteral(uint32_t symbol) {
+    if (symbol < 144) return { reverseBits(0x30 + symbol, 8), 8 };
+    if (symbol < 256) return { reverseBits(0x190 + symbol - 144, 9), 9 };
+    if (symbol < 280) return { reverseBits(symbol - 256, 7), 7 };
+    return { reverseBits(0xc0 + symbol - 280, 8), 8 };
+}
+
+struct FixedTables {
+    Code literals[256];
+    Code lengths[MAX_MATCH + 1];  // Length symbol followed by its extra bits
+    Code endOfBlock;
+
+    FixedTables() {
+        for (uint32_t i = 0; i < 256; ++i) literals[i] = fixedLiteral(i);
+        for (uint32_t symbol = 0; symbol < 29; ++symbol) {
+            const uint32_t last = symbol + 1 < 29 ? LENGTH_BASE[symbol + 1] : MAX_MATCH + 1;
+            for (uint32_t length = LENGTH_BASE[symbol]; length < last && length <= MAX_MATCH; ++length) {
+                const Code code = fixedLiteral(257 + symbol);
+                lengths[length] = { code.bits | ((length - LENGTH_BASE[symbol]) << code.count),
+                                    code.count + LENGTH_EXTRA[symbol] };
+            }
+        }
+        endOfBlock = fixedLiteral(256);
+    }
+};
+
+Code distanceCode(uint32_t distance) {
+    uint32_t symbol = 29;
+    while (DISTANCE_BASE[symbol] > distance) --symbol;
+    const uint32_t code = reverseBits(symbol, 5);
+    return { code | ((distance - DISTANCE_BASE[symbol]) << 5), 5u + DISTANCE_EXTRA[symbol] };
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : m_out(out), m_buffer(0), m_count(0) {}
+
+    void put(Code code) {
+        m_buffer |= static_cast<uint64_t>(code.bits) << m_count;
+        m_count += code.count;
+        if (m_count >= 32) {
+            const uint32_t word = static_cast<uint32_t>(m_buffer);
+            m_out.push_back(static_cast<uint8_t>(word));
+            m_out.push_back(static_cast<uint8_t>(word >> 8));
+            m_out.push_back(static_cast<uint8_t>(word >> 16));
+            m_out.push_back(static_cast<uint8_t>(word >> 24));
+            m_buffer >>= 32;
+            m_count -= 32;
+        }
+    }
+
+    // Pads to a whole byte
+    void flush() {
+        while (m_count > 0) {
+            m_out.push_back(static_cast<uint8_t>(m_buffer));
+            m_buffer >>= 8;
+            m_count = m_count > 8 ? m_count - 8 : 0;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint64_t m_buffer;
+    uint32_t m_count;
+};
+
+// Bytes at pos that repeat those distance back, up to limit
+size_t matchLength(const uint8_t* data, size_t pos, size_t distance, size_t limit) {
+    const uint8_t* a = data + pos;
+    const uint8_t* b = a - distance;
+    size_t length = 0;
+    while (length + 8 <= limit) {
+        uint64_t x, y;
+        memcpy(&x, a + length, 8);
+        memcpy(&y, b + length, 8);
+        if (x != y) break;
+        length += 8;
+    }
+    while (length < limit && a[length] == b[length]) ++length;
+    return length;
+}
+
+void deflateFixed(const std::vector<uint8_t>& data, size_t rowBytes, std::vector<uint8_t>& out) {
+    static const FixedTables tables;
+    const Code pixelDistance = distanceCode(3);
+    const bool rowMatches = rowBytes <= MAX_DISTANCE;
+    const Code rowDistance = rowMatches ? distanceCode(static_cast<uint32_t>(rowBytes)) : Code();
+
+    BitWriter writer(out);
+    writer.put({ 0x3, 3 });  // Final block, fixed Huffman codes
+
+    const size_t size = data.size();
+    size_t pos = 0;
+    while (pos < size) {
+        const size_t limit = std::min(MAX_MATCH, size - pos);
+        size_t length = pos >= 3 ? matchLength(data.data(), pos, 3, limit) : 0;
+        Code distance = pixelDistance;
+        if (rowMatches && length < limit && pos >= rowBytes) {
+            const size_t above = matchLength(data.data(), pos, rowBytes, limit);
+            if (above > length) {
+                length = above;
+                distance = rowDistance;
+            }
+        }
+
+        if (length >= MIN_MATCH) {
+            writer.put(tables.lengths[length]);
+            writer.put(distance);
+            pos += length;
+        } else {
+            writer.put(tables.literals[data[pos]]);
+            ++pos;
+        }
+    }
+    writer.put(tables.endOfBlock);
+    writer.flush();
+}
+
+uint32_t adler32(const std::vector<uint8_t>& data) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        // Largest run before b can overflow
+        const size_t end = std::min(data.size(), pos + 5552);
+        for (; pos < end; ++pos) {
+            a += data[pos];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    static const struct Table {
+        uint32_t entries[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                entries[i] = c;
+            }
+        }
+    } table;
+
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void writeBigEndian(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+// Appends a chunk header; finishChunk fills in the length and appends the CRC
+size_t beginChunk(std::vector<uint8_t>& out, const char* type) {
+    const size_t start = out.size();
+    putBigEndian(out, 0);
+    out.insert(out.end(), type, type + 4);
+    return start;
+}
+
+void finishChunk(std::vector<uint8_t>& out, size_t start) {
+    writeBigEndian(&out[start], static_cast<uint32_t>(out.size() - start - 8));
+    putBigEndian(out, crc32(&out[start + 4], out.size() - start - 4));
+}
+
+}
+
+void encodePng(const uint32_t* pixels, size_t width, size_t height, std::vector<uint8_t>& out) {
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    out.assign(SIGNATURE, SIGNATURE + 8);
+
+    size_t chunk = beginChunk(out, "IHDR");
+    putBigEndian(out, static_cast<uint32_t>(width));
+    putBigEndian(out, static_cast<uint32_t>(height));
+    const uint8_t header[5] = { 8, 2, 0, 0, 0 };  // 8-bit RGB, deflate, no filtering, not interlaced
+    out.insert(out.end(), header, header + 5);
+    finishChunk(out, chunk);
+
+    // Scanlines, each behind a filter type of 0
+    const size_t rowBytes = 1 + width * 3;
+    std::vector<uint8_t> scanlines(rowBytes * height);
+    for (size_t y = 0; y < height; ++y) {
+        uint8_t* row = &scanlines[y * rowBytes];
+        *row++ = 0;
+        const uint32_t* source = pixels + y * width;
+        for (size_t x = 0; x < width; ++x) {
+            *row++ = static_cast<uint8_t>(source[x] >> 16);
+            *row++ = static_cast<uint8_t>(source[x] >> 8);
+            *row++ = static_cast<uint8_t>(source[x]);
+        }
+    }
+
+    chunk = beginChunk(out, "IDAT");
+    out.push_back(0x78);  // zlib header: deflate with a 32 KiB window
+    out.push_back(0x01);
+    deflateFixed(scanlines, rowBytes, out);
+    putBigEndian(out, adler32(scanlines));
+    finishChunk(out, chunk);
+
+    chunk = beginChunk(out, "IEND");
+    finishChunk(out, chunk);
+}
+
+bool writePng(const char* path, const uint32_t* pixels, size_t width, size_t height) {
+    std::vector<uint8_t> png;
+    encodePng(pixels, width, height, png);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    const bool written = fwrite(png.data(), 1, png.size(), file) == png.size();
+    return fclose(file) == 0 && written;
+}
@@ -0,0 +1,369 @@
+#include "polyline_kernel.hpp"
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define NVWINTOP_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define NVWINTOP_TARGET_AVX2
+#else
+#define NVWINTOP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+// Clamping is written the way minps/maxps behave, so every path rounds and
+// treats NaN alike (NaN becomes 0)
+inline float clampValue(float value, float valueMax) {
+    value = value > 0.0f ? value : 0.0f;
+    return value < valueMax ? value : valueMax;
+}
+
+void mapScalar(const long long* times, const float* values, size_t begin, size_t count,
+               const PlotTransform& t, float* xs, float* ys) {
+    for (size_t i = begin; i < count; ++i) {
+        const float dx = static_cast<float>(static_cast<int32_t>(times[i] - t.originMs));
+        xs[i] = t.xOrigin + dx * t.xScale;
+        ys[i] = t.yOrigin - clampValue(values[i] * t.valueScale, t.valueMax) * t.yScale;
+    }
+}
+
+// Largest and smallest of ys[begin, end), which must not be empty
+void reduceScalar(const float* ys, size_t begin, size_t end, float& largest, float& smallest) {
+    float high = ys[begin];
+    float low = ys[begin];
+    for (size_t i = begin + 1; i < end; ++i) {
+        high = ys[i] > high ? ys[i] : high;
+        low = ys[i] < low ? ys[i] : low;
+    }
+    largest = high;
+    smallest = low;
+}
+
+// First index from begin holding value, which must occur before the column ends
+size_t findScalar(const float* ys, size_t begin, float value) {
+    while (ys[begin] != value) ++begin;
+    return begin;
+}
+
+#ifdef NVWINTOP_X64
+
+void mapSse2(const long long* times, const float* values, size_t count,
+             const PlotTransform& t, float* xs, float* ys) {
+    const __m128i origin = _mm_set1_epi64x(t.originMs);
+    const __m128 xOrigin = _mm_set1_ps(t.xOrigin);
+    const __m128 xScale = _mm_set1_ps(t.xScale);
+    const __m128 yOrigin = _mm_set1_ps(t.yOrigin);
+    const __m128 yScale = _mm_set1_ps(t.yScale);
+    const __m128 valueScale = _mm_set1_ps(t.valueScale);
+    const __m128 valueMax = _mm_set1_ps(t.valueMax);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Low halves of four 64-bit deltas
+        __m128i a = _mm_sub_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(times + i)), origin);
+        __m128i b = _mm_sub_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(times + i + 2)), origin);
+        a = _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 0, 2, 0));
+        b = _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 dx = _mm_cvtepi32_ps(_mm_unpacklo_epi64(a, b));
+        _mm_storeu_ps(xs + i, _mm_add_ps(xOrigin, _mm_mul_ps(dx, xScale)));
+
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(values + i), valueScale);
+        v = _mm_min_ps(_mm_max_ps(v, zero), valueMax);
+        _mm_storeu_ps(ys + i, _mm_sub_ps(yOrigin, _mm_mul_ps(v, yScale)));
+    }
+    mapScalar(times, values, i, count, t, xs, ys);
+}
+
+NVWINTOP_TARGET_AVX2
+void mapAvx2(const long long* times, const float* values, size_t count,
+             const PlotTransform& t, float* xs, float* ys) {
+    const __m256i origin = _mm256_set1_epi64x(t.originMs);
+    const __m256i lowHalves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m256 xOrigin = _mm256_set1_ps(t.xOrigin);
+    const __m256 xScale = _mm256_set1_ps(t.xScale);
+    const __m256 yOrigin = _mm256_set1_ps(t.yOrigin);
+    const __m256 yScale = _mm256_set1_ps(t.yScale);
+    const __m256 valueScale = _mm256_set1_ps(t.valueScale);
+    const __m256 valueMax = _mm256_set1_ps(t.valueMax);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Low halves of eight 64-bit deltas
+        __m256i a = _mm256_sub_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(times + i)), origin);
+        __m256i b = _mm256_sub_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(times + i + 4)), origin);
+        const __m128i lowA = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(a, lowHalves));
+        const __m128i lowB = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(b, lowHalves));
+        const __m256 dx = _mm256_cvtepi32_ps(_mm256_inserti128_si256(_mm256_castsi128_si256(lowA), lowB, 1));
+        _mm256_storeu_ps(xs + i, _mm256_add_ps(xOrigin, _mm256_mul_ps(dx, xScale)));
+
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(values + i), valueScale);
+        v = _mm256_min_ps(_mm256_max_ps(v, zero), valueMax);
+        _mm256_storeu_ps(ys + i, _mm256_sub_ps(yOrigin, _mm256_mul_ps(v, yScale)));
+    }
+    mapScalar(times, values, i, count, t, xs, ys);
+}
+
+inline float horizontalMax(__m128 v) {
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+inline float horizontalMin(__m128 v) {
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+// Mapped ys are never NaN, so the order extremes are combined in doesn't
+// change them
+void reduceSse2(const float* ys, size_t begin, size_t end, float& largest, float& smallest) {
+    if (end - begin < 8) {
+        reduceScalar(ys, begin, end, largest, smallest);
+        return;
+    }
+    // Two accumulators each to hide the latency of maxps/minps
+    __m128 high0 = _mm_loadu_ps(ys + begin);
+    __m128 high1 = _mm_loadu_ps(ys + begin + 4);
+    __m128 low0 = high0;
+    __m128 low1 = high1;
+    size_t i = begin + 8;
+    for (; i + 8 <= end; i += 8) {
+        const __m128 a = _mm_loadu_ps(ys + i);
+        const __m128 b = _mm_loadu_ps(ys + i + 4);
+        high0 = _mm_max_ps(high0, a);
+        high1 = _mm_max_ps(high1, b);
+        low0 = _mm_min_ps(low0, a);
+        low1 = _mm_min_ps(low1, b);
+    }
+    // The tail overlaps samples already seen, which is harmless
+    const __m128 a = _mm_loadu_ps(ys + end - 8);
+    const __m128 b = _mm_loadu_ps(ys + end - 4);
+    largest = horizontalMax(_mm_max_ps(_mm_max_ps(high0, a), _mm_max_ps(high1, b)));
+    smallest = horizontalMin(_mm_min_ps(_mm_min_ps(low0, a), _mm_min_ps(low1, b)));
+}
+
+NVWINTOP_TARGET_AVX2
+void reduceAvx2(const float* ys, size_t begin, size_t end, float& largest, float& smallest) {
+    if (end - begin < 16) {
+        reduceSse2(ys, begin, end, largest, smallest);
+        return;
+    }
+    __m256 high0 = _mm256_loadu_ps(ys + begin);
+    __m256 high1 = _mm256_loadu_ps(ys + begin + 8);
+    __m256 low0 = high0;
+    __m256 low1 = high1;
+    size_t i = begin + 16;
+    for (; i + 16 <= end; i += 16) {
+        const __m256 a = _mm256_loadu_ps(ys + i);
+        const __m256 b = _mm256_loadu_ps(ys + i + 8);
+        high0 = _mm256_max_ps(high0, a);
+        high1 = _mm256_max_ps(high1, b);
+        low0 = _mm256_min_ps(low0, a);
+        low1 = _mm256_min_ps(low1, b);
+    }
+    const __m256 a = _mm256_loadu_ps(ys + end - 16);
+    const __m256 b = _mm256_loadu_ps(ys + end - 8);
+    const __m256 high = _mm256_max_ps(_mm256_max_ps(high0, a), _mm256_max_ps(high1, b));
+    const __m256 low = _mm256_min_ps(_mm256_min_ps(low0, a), _mm256_min_ps(low1, b));
+    largest = horizontalMax(_mm_max_ps(_mm256_castps256_ps128(high), _mm256_extractf128_ps(high, 1)));
+    smallest = horizontalMin(_mm_min_ps(_mm256_castps256_ps128(low), _mm256_extractf128_ps(low, 1)));
+}
+
+inline size_t lowestSetBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+}
+
+size_t findSse2(const float* ys, size_t begin, size_t end, float value) {
+    const __m128 target = _mm_set1_ps(value);
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(ys + i), target));
+        if (mask != 0) return i + lowestSetBit(static_cast<unsigned>(mask));
+    }
+    return findScalar(ys, i, value);
+}
+
+bool cpuHasAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    // The OS must also save the upper halves of the YMM registers
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+    if (!osxsave || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+void reduce(PolylineIsa isa, const float* ys, size_t begin, size_t end, float& largest, float& smallest) {
+#ifdef NVWINTOP_X64
+    if (isa == PolylineIsa::Avx2) {
+        reduceAvx2(ys, begin, end, largest, smallest);
+        return;
+    }
+    if (isa == PolylineIsa::Sse2) {
+        reduceSse2(ys, begin, end, largest, smallest);
+        return;
+    }
+#else
+    (void)isa;
+#endif
+    reduceScalar(ys, begin, end, largest, smallest);
+}
+
+size_t find(PolylineIsa isa, const float* ys, size_t begin, size_t end, float value) {
+#ifdef NVWINTOP_X64
+    if (isa != PolylineIsa::Scalar) return findSse2(ys, begin, end, value);
+#else
+    (void)isa;
+    (void)end;
+#endif
+    return findScalar(ys, begin, value);
+}
+
+// Pixel column of a screen x
+inline int columnOf(float x) {
+    return static_cast<int>(x);
+}
+
+// End of the run of samples from begin that fall in begin's pixel column.
+// Timestamps are ascending, so xs are too: gallop forward, then binary search
+// the last step. Short histories have about one sample per column and stop
+// at the first probe.
+size_t columnEnd(const std::vector<float>& xs, size_t begin) {
+    const float limit = static_cast<float>(columnOf(xs[begin]) + 1);
+    const size_t count = xs.size();
+    size_t low = begin + 1;
+    size_t step = 1;
+    while (low < count && xs[low] < limit) {
+        const size_t probe = low + step;
+        if (probe >= count || xs[probe] >= limit) {
+            const auto end = std::lower_bound(xs.begin() + low + 1, xs.begin() + std::min(probe, count), limit);
+            return static_cast<size_t>(end - xs.begin());
+        }
+        low = probe + 1;
+        step *= 2;
+    }
+    return low;
+}
+
+}
+
+PolylineIsa detectPolylineIsa() {
+#ifdef NVWINTOP_X64
+    static const PolylineIsa isa = cpuHasAvx2() ? PolylineIsa::Avx2 : PolylineIsa::Sse2;
+    return isa;
+#else
+    return PolylineIsa::Scalar;
+#endif
+}
+
+const char* polylineIsaName(PolylineIsa isa) {
+    switch (isa) {
+        case PolylineIsa::Sse2: return "sse2";
+        case PolylineIsa::Avx2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+PolylineBuilder::PolylineBuilder(PolylineIsa isa)
+    : m_isa(isa)
+{}
+
+void PolylineBuilder::map(PolylineIsa isa, const long long* times, const float* values, size_t count,
+                          const PlotTransform& transform, float* xs, float* ys) {
+#ifdef NVWINTOP_X64
+    if (isa == PolylineIsa::Avx2) {
+        mapAvx2(times, values, count, transform, xs, ys);
+        return;
+    }
+    if (isa == PolylineIsa::Sse2) {
+        mapSse2(times, values, count, transform, xs, ys);
+        return;
+    }
+#else
+    (void)isa;
+#endif
+    mapScalar(times, values, 0, count, transform, xs, ys);
+}
+
+const std::vector<DlPoint>& PolylineBuilder::build(const long long* times, const float* values, size_t count,
+                                                   const PlotTransform& transform) {
+    m_xs.resize(count);
+    m_ys.resize(count);
+    map(m_isa, times, values, count, transform, m_xs.data(), m_ys.data());
+
+    // Screen y grows downwards: the lowest value has the largest y
+    m_points.clear();
+    size_t i = 0;
+    while (i < count) {
+        const size_t next = columnEnd(m_xs, i);
+        if (next == i + 1) {
+            // Short histories have one sample per column
+            m_points.push_back({ m_xs[i], m_ys[i] });
+            i = next;
+            continue;
+        }
+
+        // Extremes first, then where they occur, so neither pass branches on the data
+        float low;
+        float high;
+        reduce(m_isa, m_ys.data(), i, next, low, high);
+        const size_t lowest = find(m_isa, m_ys.data(), i, next, low);
+        const size_t highest = find(m_isa, m_ys.data(), i, next, high);
+
+        const size_t first = std::min(lowest, highest);
+        const size_t second = std::max(lowest, highest);
+        m_points.push_back({ m_xs[first], m_ys[first] });
+        if (second != first) m_points.push_back({ m_xs[second], m_ys[second] });
+        i = next;
+    }
+    return m_points;
+}
+
+const std::vector<DlPoint>& PolylineBuilder::buildSpread(const long long* times, const float* minValues,
+                                                         const float* maxValues, size_t count,
+                                                         const PlotTransform& transform) {
+    m_xs.resize(count);
+    m_ys.resize(count);
+    m_ysHigh.resize(count);
+    map(m_isa, times, maxValues, count, transform, m_xs.data(), m_ysHigh.data());
+    map(m_isa, times, minValues, count, transform, m_xs.data(), m_ys.data());
+
+    m_points.clear();
+    size_t i = 0;
+    while (i < count) {
+        const size_t next = columnEnd(m_xs, i);
+        // Only the lower end of the mins and the upper end of the maxes are kept
+        float bottom, unusedTop;
+        float unusedBottom, top;
+        reduce(m_isa, m_ys.data(), i, next, bottom, unusedTop);
+        reduce(m_isa, m_ysHigh.data(), i, next, unusedBottom, top);
+
+        if (bottom > top) {
+            m_points.push_back({ m_xs[i], bottom });
+            m_points.push_back({ m_xs[i], top });
+        }
+        i = next;
+    }
+    return m_points;
+}
@@ -0,0 +1,223 @@
+#include "process_history.hpp"
+#include "gpu_monitor.hpp"
+#include <algorithm>
+
+ProcessHistory::ProcessHistory()
+    : m_topCount(DEFAULT_TOP_COUNT)
+{}
+
+void ProcessHistory::setTopCount(size_t count) {
+    m_topCount = count;
+    for (Ranking& ranking : m_rankings) ranking.stale = true;
+}
+
+void ProcessHistory::update(const std::vector<ProcessInfo>& processes, long long timestampMs) {
+    ++m_tick;
+    for (const ProcessInfo& process : processes) {
+        const ProcessKey key = { process.gpuIndex, process.pid, process.startTime };
+        EntryList::iterator it;
+        auto found = m_index.find(key);
+        if (found == m_index.end()) {
+            it = m_entries.emplace(m_entries.end());
+            it->key = key;
+            it->serial = m_nextSerial++;
+            it->firstSeenMs = timestampMs;
+            it->slot = m_scores.size();
+            m_scores.push_back({ {}, it->serial, &*it });
+            m_index.emplace(key, it);
+        } else {
+            it = found->second;
+            m_entries.splice(m_entries.end(), m_entries, it);
+        }
+        if (it->name != process.name) it->name = process.name;
+        record(*it, process, timestampMs);
+        rescore(*it);
+    }
+
+    // Everything seen this tick was moved to the back, so the front holds the
+    // processes that have been gone longest
+    while (!m_entries.empty()) {
+        const Entry& oldest = m_entries.front();
+        const bool expired = oldest.lastTick != m_tick && timestampMs - oldest.lastSeenMs >= EXITED_RETENTION_MS;
+        if (!expired && m_entries.size() <= MAX_PROCESSES) break;
+        evict(m_entries.begin());
+    }
+
+    for (size_t r = 0; r < RANKING_COUNT; ++r) {
+        finishRanking(r);
+    }
+}
+
+void ProcessHistory::record(Entry& entry, const ProcessInfo& process, long long timestampMs) {
+    const long long slot = timestampMs - timestampMs % RESOLUTION_MS;
+    if (entry.buckets.empty() || slot > entry.newest().timestampMs) {
+        const ProcessBucket bucket = { slot, 0, 0, 0 };
+        if (entry.buckets.size() < CAPACITY) {
+            entry.buckets.push_back(bucket);
+        } else {
+            // Slide the window: the oldest bucket's samples leave the totals
+            ProcessBucket& dropped = entry.buckets[entry.oldest];
+            entry.utilSum -= dropped.utilSum;
+            entry.samples -= dropped.samples;
+            const bool peakDropped = dropped.maxMemory == entry.peakMemory;
+            dropped = bucket;
+            entry.oldest = (entry.oldest + 1) % CAPACITY;
+            if (peakDropped) {
+                entry.peakMemory = 0;
+                for (const ProcessBucket& kept : entry.buckets) {
+                    entry.peakMemory = std::max(entry.peakMemory, kept.maxMemory);
+                }
+            }
+        }
+    }
+
+    ProcessBucket& bucket = entry.newest();
+    bucket.maxMemory = std::max(bucket.maxMemory, process.memoryUsed);
+    bucket.utilSum += process.gpuUtil;
+    ++bucket.samples;
+
+    entry.peakMemory = std::max(entry.peakMemory, process.memoryUsed);
+    entry.utilSum += process.gpuUtil;
+    ++entry.samples;
+    entry.memoryUsed = process.memoryUsed;
+    entry.gpuUtil = process.gpuUtil;
+    entry.lastSeenMs = timestampMs;
+    entry.lastTick = m_tick;
+}
+
+void ProcessHistory::rescore(Entry& entry) {
+    Scores& scores = m_scores[entry.slot];
+    scores.score[static_cast<size_t>(ProcessRanking::PeakMemory)] = static_cast<double>(entry.peakMemory);
+    scores.score[static_cast<size_t>(ProcessRanking::AvgUtil)] = entry.avgUtil();
+
+    // Top rows are re-sorted once the update is done; anything else either
+    // joins them or raises the bound on what is outside
+    for (size_t r = 0; r < RANKING_COUNT; ++r) {
+        Ranking& ranking = m_rankings[r];
+        if (ranking.stale || entry.inTop[r]) continue;
+        const Rank current = scores.rank(r);
+        if (ranking.top.size() < m_topCount || current.ahead(ranking.cutoff)) {
+            ranking.top.push_back(&entry);
+            entry.inTop[r] = true;
+        } else if (!ranking.hasOutside || current.ahead(ranking.outside)) {
+            ranking.outside = current;
+            ranking.hasOutside = true;
+        }
+    }
+}
+
+void ProcessHistory::finishRanking(size_t r) {
+    Ranking& ranking = m_rankings[r];
+    if (!ranking.stale) {
+        std::sort(ranking.top.begin(), ranking.top.end(), [this, r](const Entry* a, const Entry* b) {
+            return rank(*a, r).ahead(rank(*b, r));
+        });
+        while (ranking.top.size() > m_topCount) {
+            Entry* dropped = ranking.top.back();
+            ranking.top.pop_back();
+            dropped->inTop[r] = false;
+            const Rank droppedRank = rank(*dropped, r);
+            if (!ranking.hasOutside || droppedRank.ahead(ranking.outside)) {
+                ranking.outside = droppedRank;
+                ranking.hasOutside = true;
+            }
+        }
+
+        // A top row that fell behind the bound, or an eviction that left too
+        // few rows, means something outside may now belong in the top
+        const bool outsiders = m_scores.size() > ranking.top.size();
+        if (outsiders && ranking.top.size() < m_topCount) {
+            ranking.stale = true;
+        } else if (outsiders && !ranking.top.empty() && ranking.outside.ahead(rank(*ranking.top.back(), r))) {
+            ranking.stale = true;
+        }
+    }
+    if (ranking.stale) select(r);
+    if (!ranking.top.empty()) ranking.cutoff = rank(*ranking.top.back(), r);
+}
+
+void ProcessHistory::select(size_t r) {
+    ++m_rescans;
+    Ranking& ranking = m_rankings[r];
+    for (Entry* entry : ranking.top) entry->inTop[r] = false;
+    ranking.top.clear();
+
+    m_selection = m_scores;
+    const size_t count = std::min(m_topCount, m_selection.size());
+    auto ahead = [r](const Scores& a, const Scores& b) { return a.rank(r).ahead(b.rank(r)); };
+    ranking.hasOutside = m_selection.size() > count;
+    if (ranking.hasOutside) {
+        // The first one past the top is the best of the rest
+        std::nth_element(m_selection.begin(), m_selection.begin() + count, m_selection.end(), ahead);
+        ranking.outside = m_selection[count].rank(r);
+    }
+    std::sort(m_selection.begin(), m_selection.begin() + count, ahead);
+    for (size_t i = 0; i < count; ++i) {
+        ranking.top.push_back(m_selection[i].entry);
+        m_selection[i].entry->inTop[r] = true;
+    }
+    ranking.stale = false;
+}
+
+void ProcessHistory::evict(EntryList::iterator it) {
+    for (size_t r = 0; r < RANKING_COUNT; ++r) {
+        if (!it->inTop[r]) continue;
+        std::vector<Entry*>& top = m_rankings[r].top;
+        top.erase(std::find(top.begin(), top.end(), &*it));
+    }
+
+    // Keep the scores packed
+    const size_t slot = it->slot;
+    m_scores[slot] = m_scores.back();
+    m_scores[slot].entry->slot = slot;
+    m_scores.pop_back();
+
+    m_index.erase(it->key);
+    m_entries.erase(it);
+    ++m_evicted;
+}
+
+void ProcessHistory::clear() {
+    m_index.clear();
+    m_entries.clear();
+    m_scores.clear();
+    for (Ranking& ranking : m_rankings) {
+        ranking.top.clear();
+        ranking.hasOutside = false;
+        ranking.stale = true;
+    }
+}
+
+ProcessUsage ProcessHistory::usage(const Entry& entry) const {
+    ProcessUsage row;
+    row.key = entry.key;
+    row.name = entry.name;
+    row.memoryUsed = entry.memoryUsed;
+    row.gpuUtil = entry.gpuUtil;
+    row.peakMemory = entry.peakMemory;
+    row.avgUtil = static_cast<float>(entry.avgUtil());
+    row.firstSeenMs = entry.firstSeenMs;
+    row.lastSeenMs = entry.lastSeenMs;
+    row.running = entry.lastTick == m_tick;
+    return row;
+}
+
+void ProcessHistory::top(ProcessRanking ranking, size_t count, std::vector<ProcessUsage>& out) const {
+    out.clear();
+    for (const Entry* entry : m_rankings[static_cast<size_t>(ranking)].top) {
+        if (out.size() == count) break;
+        out.push_back(usage(*entry));
+    }
+}
+
+bool ProcessHistory::series(const ProcessKey& key, std::vector<ProcessBucket>& out) const {
+    out.clear();
+    auto found = m_index.find(key);
+    if (found == m_index.end()) return false;
+
+    const Entry& entry = *found->second;
+    for (size_t i = 0; i < entry.buckets.size(); ++i) {
+        out.push_back(entry.buckets[(entry.oldest + i) % entry.buckets.size()]);
+    }
+    return true;
+}
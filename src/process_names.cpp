@@ -0,0 +1,118 @@
+#include "process_names.hpp"
+#include "instrumentation.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+
+// Cheap identity check: limited query rights are enough and work across most users
+bool queryStartTime(unsigned int pid, unsigned long long& startTime) {
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!hProcess) return false;
+
+    FILETIME creation, exit, kernel, user;
+    bool ok = GetProcessTimes(hProcess, &creation, &exit, &kernel, &user) != 0;
+    if (ok) {
+        startTime = (static_cast<unsigned long long>(creation.dwHighDateTime) << 32) | creation.dwLowDateTime;
+    }
+    CloseHandle(hProcess);
+    return ok;
+}
+
+std::wstring queryName(unsigned int pid) {
+    std::wstring name;
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!hProcess) return name;
+
+    wchar_t path[MAX_PATH];
+    DWORD size = MAX_PATH;
+    if (QueryFullProcessImageNameW(hProcess, 0, path, &size)) {
+        const wchar_t* base = wcsrchr(path, L'\\');
+        name = base ? base + 1 : path;
+    }
+    CloseHandle(hProcess);
+    return name;
+}
+
+#else
+
+// Reads a small /proc file into buffer without allocating; returns the byte count
+size_t readProcFile(unsigned int pid, const char* file, char* buffer, size_t size) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%u/%s", pid, file);
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    size_t length = fread(buffer, 1, size - 1, f);
+    fclose(f);
+    buffer[length] = '\0';
+    return length;
+}
+
+bool queryStartTime(unsigned int pid, unsigned long long& startTime) {
+    char stat[1024];
+    if (readProcFile(pid, "stat", stat, sizeof(stat)) == 0) return false;
+
+    // Field 22 is the start time in clock ticks; skip past the command name,
+    // which is in parentheses and may itself contain spaces
+    const char* p = strrchr(stat, ')');
+    if (!p) return false;
+    for (int field = 2; field < 22 && p; ++field) {
+        p = strchr(p + 1, ' ');
+    }
+    if (!p) return false;
+    startTime = strtoull(p + 1, nullptr, 10);
+    return true;
+}
+
+std::wstring queryName(unsigned int pid) {
+    char comm[64];
+    size_t length = readProcFile(pid, "comm", comm, sizeof(comm));
+    while (length > 0 && comm[length - 1] == '\n') --length;
+    return std::wstring(comm, comm + length);
+}
+
+#endif
+
+}
+
+const std::wstring& ProcessNameCache::lookup(unsigned int pid, unsigned long long& startTime) {
+    auto it = m_entries.find(pid);
+
+    // A pid seen last tick (or earlier this tick) is taken to be the same
+    // process; only one that is new or has been away is asked about
+    if (it != m_entries.end() && m_tick - it->second.lastUsedTick <= 1) {
+        it->second.lastUsedTick = m_tick;
+        startTime = it->second.startTime;
+        return it->second.name;
+    }
+
+    startTime = 0;
+    NVWINTOP_TIMED(Probe::ProcessStartTime, queryStartTime(pid, startTime));
+    if (it == m_entries.end() || it->second.startTime != startTime) {
+        Entry entry;
+        entry.startTime = startTime;
+        entry.name = NVWINTOP_TIMED(Probe::ProcessName, queryName(pid));
+        it = m_entries.insert_or_assign(pid, std::move(entry)).first;
+    }
+
+    it->second.lastUsedTick = m_tick;
+    return it->second.name;
+}
+
+void ProcessNameCache::endTick() {
+    ++m_tick;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (m_tick - it->second.lastUsedTick > MAX_IDLE_TICKS) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,243 @@
+#include "raster_canvas.hpp"
+#include <algorithm>
+#include <cmath>
+
+using std::max;
+using std::min;
+
+namespace {
+
+// Same palette as the Direct2D backend
+constexpr uint32_t COLORS[DL_BRUSH_COUNT] = {
+    0x262626,  // Window
+    0x1a1a1a,  // Background
+    0x666666,  // Separator
+    0x76b900,  // Green
+    0xe6e633,  // Yellow
+    0xe63333,  // Red
+    0x1f3314,  // GreenShade
+    0x403b14,  // YellowShade
+    0x4d1a1a,  // RedShade
+};
+
+// Printable ASCII from 0x20, one byte per column, least significant bit at the top
+constexpr uint8_t FONT_5X7[95][5] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5f, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 },
+    { 0x14, 0x7f, 0x14, 0x7f, 0x14 }, { 0x24, 0x2a, 0x7f, 0x2a, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 },
+    { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 }, { 0x00, 0x1c, 0x22, 0x41, 0x00 },
+    { 0x00, 0x41, 0x22, 0x1c, 0x00 }, { 0x08, 0x2a, 0x1c, 0x2a, 0x08 }, { 0x08, 0x08, 0x3e, 0x08, 0x08 },
+    { 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x60, 0x60, 0x00, 0x00 },
+    { 0x20, 0x10, 0x08, 0x04, 0x02 }, { 0x3e, 0x51, 0x49, 0x45, 0x3e }, { 0x00, 0x42, 0x7f, 0x40, 0x00 },
+    { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4b, 0x31 }, { 0x18, 0x14, 0x12, 0x7f, 0x10 },
+    { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3c, 0x4a, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 },
+    { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1e }, { 0x00, 0x36, 0x36, 0x00, 0x00 },
+    { 0x00, 0x56, 0x36, 0x00, 0x00 }, { 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 },
+    { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 }, { 0x32, 0x49, 0x79, 0x41, 0x3e },
+    { 0x7e, 0x11, 0x11, 0x11, 0x7e }, { 0x7f, 0x49, 0x49, 0x49, 0x36 }, { 0x3e, 0x41, 0x41, 0x41, 0x22 },
+    { 0x7f, 0x41, 0x41, 0x22, 0x1c }, { 0x7f, 0x49, 0x49, 0x49, 0x41 }, { 0x7f, 0x09, 0x09, 0x09, 0x01 },
+    { 0x3e, 0x41, 0x49, 0x49, 0x7a }, { 0x7f, 0x08, 0x08, 0x08, 0x7f }, { 0x00, 0x41, 0x7f, 0x41, 0x00 },
+    { 0x20, 0x40, 0x41, 0x3f, 0x01 }, { 0x7f, 0x08, 0x14, 0x22, 0x41 }, { 0x7f, 0x40, 0x40, 0x40, 0x40 },
+    { 0x7f, 0x02, 0x0c, 0x02, 0x7f }, { 0x7f, 0x04, 0x08, 0x10, 0x7f }, { 0x3e, 0x41, 0x41, 0x41, 0x3e },
+    { 0x7f, 0x09, 0x09, 0x09, 0x06 }, { 0x3e, 0x41, 0x51, 0x21, 0x5e }, { 0x7f, 0x09, 0x19, 0x29, 0x46 },
+    { 0x46, 0x49, 0x49, 0x49, 0x31 }, { 0x01, 0x01, 0x7f, 0x01, 0x01 }, { 0x3f, 0x40, 0x40, 0x40, 0x3f },
+    { 0x1f, 0x20, 0x40, 0x20, 0x1f }, { 0x3f, 0x40, 0x38, 0x40, 0x3f }, { 0x63, 0x14, 0x08, 0x14, 0x63 },
+    { 0x07, 0x08, 0x70, 0x08, 0x07 }, { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7f, 0x41, 0x41, 0x00 },
+    { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7f, 0x00 }, { 0x04, 0x02, 0x01, 0x02, 0x04 },
+    { 0x40, 0x40, 0x40, 0x40, 0x40 }, { 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 },
+    { 0x7f, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 }, { 0x38, 0x44, 0x44, 0x48, 0x7f },
+    { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x08, 0x7e, 0x09, 0x01, 0x02 }, { 0x0c, 0x52, 0x52, 0x52, 0x3e },
+    { 0x7f, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7d, 0x40, 0x00 }, { 0x20, 0x40, 0x44, 0x3d, 0x00 },
+    { 0x7f, 0x10, 0x28, 0x44, 0x00 }, { 0x00, 0x41, 0x7f, 0x40, 0x00 }, { 0x7c, 0x04, 0x18, 0x04, 0x78 },
+    { 0x7c, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 }, { 0x7c, 0x14, 0x14, 0x14, 0x08 },
+    { 0x08, 0x14, 0x14, 0x18, 0x7c }, { 0x7c, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 },
+    { 0x04, 0x3f, 0x44, 0x40, 0x20 }, { 0x3c, 0x40, 0x40, 0x20, 0x7c }, { 0x1c, 0x20, 0x40, 0x20, 0x1c },
+    { 0x3c, 0x40, 0x30, 0x40, 0x3c }, { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0c, 0x50, 0x50, 0x50, 0x3c },
+    { 0x44, 0x64, 0x54, 0x4c, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 }, { 0x00, 0x00, 0x7f, 0x00, 0x00 },
+    { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x08, 0x04, 0x08, 0x10, 0x08 },
+};
+
+constexpr uint8_t DEGREE_GLYPH[5] = { 0x00, 0x06, 0x09, 0x09, 0x06 };
+
+const uint8_t* glyphFor(wchar_t c) {
+    if (c >= 0x20 && c <= 0x7e) return FONT_5X7[c - 0x20];
+    if (c == 0xb0) return DEGREE_GLYPH;
+    return FONT_5X7['?' - 0x20];
+}
+
+}
+
+RasterCanvas::RasterCanvas()
+    : m_width(0)
+    , m_height(0)
+    , m_clip{ 0, 0, 0, 0 }
+{}
+
+void RasterCanvas::resize(size_t width, size_t height) {
+    m_width = width;
+    m_height = height;
+    m_pixels.assign(width * height, 0);
+    m_clips.clear();
+    m_clip = { 0, 0, static_cast<int>(width), static_cast<int>(height) };
+}
+
+RasterCanvas::Clip RasterCanvas::toPixels(const DlRect& rect) const {
+    // Pixels whose centers lie inside the rectangle
+    return {
+        static_cast<int>(std::ceil(rect.left - 0.5f)),
+        static_cast<int>(std::ceil(rect.top - 0.5f)),
+        static_cast<int>(std::ceil(rect.right - 0.5f)),
+        static_cast<int>(std::ceil(rect.bottom - 0.5f)),
+    };
+}
+
+void RasterCanvas::fill(const DlRect& rect, uint32_t color) {
+    const Clip area = toPixels(rect);
+    const int left = max(area.left, m_clip.left);
+    const int right = min(area.right, m_clip.right);
+    if (left >= right) return;
+    for (int y = max(area.top, m_clip.top); y < min(area.bottom, m_clip.bottom); ++y) {
+        uint32_t* row = &m_pixels[static_cast<size_t>(y) * m_width];
+        std::fill(row + left, row + right, color);
+    }
+}
+
+void RasterCanvas::blend(int x, int y, uint32_t color, int alpha) {
+    uint32_t& pixel = m_pixels[static_cast<size_t>(y) * m_width + x];
+    if (alpha >= 255) {
+        pixel = color;
+        return;
+    }
+    uint32_t result = 0;
+    for (int shift = 0; shift <= 16; shift += 8) {
+        const int from = static_cast<int>((pixel >> shift) & 0xff);
+        const int to = static_cast<int>((color >> shift) & 0xff);
+        result |= static_cast<uint32_t>(from + ((to - from) * alpha + 127) / 255) << shift;
+    }
+    pixel = result;
+}
+
+// Coverage of each pixel falls off with the distance of its center from the
+// segment, which also rounds the ends so polyline joints stay closed. Only
+// pixels within reach of the line on each row are visited.
+void RasterCanvas::strokeSegment(DlPoint from, DlPoint to, float width, uint32_t color) {
+    const float reach = width * 0.5f + 0.5f;
+    const float dx = to.x - from.x;
+    const float dy = to.y - from.y;
+    const float lengthSq = dx * dx + dy * dy;
+    const float invLengthSq = lengthSq > 0.0f ? 1.0f / lengthSq : 0.0f;
+    const bool steep = std::fabs(dy) > 1e-3f;
+    const float slope = steep ? dx / dy : 0.0f;
+    const float spread = steep ? reach * std::sqrt(lengthSq) / std::fabs(dy) : 0.0f;
+    const float minX = min(from.x, to.x) - reach;
+    const float maxX = max(from.x, to.x) + reach;
+
+    const int top = max(m_clip.top, static_cast<int>(std::floor(min(from.y, to.y) - reach - 0.5f)));
+    const int bottom = min(m_clip.bottom - 1, static_cast<int>(std::ceil(max(from.y, to.y) + reach - 0.5f)));
+    for (int y = top; y <= bottom; ++y) {
+        const float cy = y + 0.5f;
+        float left = minX;
+        float right = maxX;
+        if (steep) {
+            const float center = from.x + (cy - from.y) * slope;
+            left = max(left, center - spread);
+            right = min(right, center + spread);
+        }
+        const int firstX = max(m_clip.left, static_cast<int>(std::floor(left - 0.5f)));
+        const int lastX = min(m_clip.right - 1, static_cast<int>(std::ceil(right - 0.5f)));
+        for (int x = firstX; x <= lastX; ++x) {
+            const float px = x + 0.5f - from.x;
+            const float py = cy - from.y;
+            const float t = min(1.0f, max(0.0f, (px * dx + py * dy) * invLengthSq));
+            const float ex = px - t * dx;
+            const float ey = py - t * dy;
+            const float coverage = reach - std::sqrt(ex * ex + ey * ey);
+            if (coverage <= 0.0f) continue;
+            blend(x, y, color, coverage >= 1.0f ? 255 : static_cast<int>(coverage * 255.0f + 0.5f));
+        }
+    }
+}
+
+void RasterCanvas::drawGlyph(const uint8_t* columns, int x, int y, bool bold, uint32_t color) {
+    const int thickness = bold ? 2 : 1;
+    for (int column = 0; column < 5; ++column) {
+        for (int row = 0; row < 7; ++row) {
+            if (!(columns[column] & (1 << row))) continue;
+            const int py = y + row;
+            if (py < m_clip.top || py >= m_clip.bottom) continue;
+            for (int px = x + column; px < x + column + thickness; ++px) {
+                if (px >= m_clip.left && px < m_clip.right) blend(px, py, color, 255);
+            }
+        }
+    }
+}
+
+// One line from the top left of the layout box, like DirectWrite with the
+// default alignment; the title font is drawn bold
+void RasterCanvas::drawText(const wchar_t* text, size_t length, const DlRect& rect, DlFont font, uint32_t color) {
+    const bool bold = font == DlFont::Title;
+    const int advance = bold ? 7 : 6;
+    int x = static_cast<int>(std::lround(rect.left));
+    const int y = static_cast<int>(std::lround(rect.top)) + (bold ? 6 : 5);
+    for (size_t i = 0; i < length; ++i) {
+        wchar_t c = text[i];
+        if (c == 0x2103) {
+            // Degree Celsius as a degree sign and a C
+            drawGlyph(DEGREE_GLYPH, x, y, bold, color);
+            x += advance;
+            c = L'C';
+        }
+        drawGlyph(glyphFor(c), x, y, bold, color);
+        x += advance;
+    }
+}
+
+void RasterCanvas::replay(const DisplayList& list) {
+    for (const DlCommand& command : list.commands()) {
+        const uint32_t color = COLORS[static_cast<size_t>(command.brush)];
+        switch (command.op) {
+            case DlOp::FillRect:
+                fill(command.rect, color);
+                break;
+            case DlOp::StrokeRect: {
+                // Four bands centered on the edges
+                const DlRect& r = command.rect;
+                const float half = command.width * 0.5f;
+                fill({ r.left - half, r.top - half, r.right + half, r.top + half }, color);
+                fill({ r.left - half, r.bottom - half, r.right + half, r.bottom + half }, color);
+                fill({ r.left - half, r.top + half, r.left + half, r.bottom - half }, color);
+                fill({ r.right - half, r.top + half, r.right + half, r.bottom - half }, color);
+                break;
+            }
+            case DlOp::Lines: {
+                const DlPoint* points = list.points(command);
+                for (uint32_t i = 0; i + 1 < command.count; i += 2) {
+                    strokeSegment(points[i], points[i + 1], command.width, color);
+                }
+                break;
+            }
+            case DlOp::Polyline: {
+                const DlPoint* points = list.points(command);
+                for (uint32_t i = 1; i < command.count; ++i) {
+                    strokeSegment(points[i - 1], points[i], command.width, color);
+                }
+                break;
+            }
+            case DlOp::Text:
+                drawText(list.text(command), command.count, command.rect, command.font, color);
+                break;
+            case DlOp::PushClip: {
+                m_clips.push_back(m_clip);
+                const Clip area = toPixels(command.rect);
+                m_clip = { max(m_clip.left, area.left), max(m_clip.top, area.top),
+                           min(m_clip.right, area.right), min(m_clip.bottom, area.bottom) };
+                break;
+            }
+            case DlOp::PopClip:
+                if (!m_clips.empty()) {
+                    m_clip = m_clips.back();
+                    m_clips.pop_back();
+                }
+                break;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#include "replay_source.hpp"
+#include <algorithm>
+
+namespace {
+
+bool sameDevices(const std::vector<DeviceInfo>& a, const std::vector<DeviceInfo>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].uuid != b[i].uuid || a[i].index != b[i].index) return false;
+    }
+    return true;
+}
+
+}
+
+ReplaySource::ReplaySource(const std::string& path)
+    : m_path(path)
+    , m_blockIndex(0)
+    , m_nextSample(0)
+    , m_sample(0)
+    , m_devicesChanged(false)
+    , m_finished(false)
+    , m_recordedIntervalMs(1000)
+{}
+
+bool ReplaySource::initialize() {
+    if (!m_reader.open(m_path)) return false;
+    if (!loadBlock(0)) {
+        m_finished = true;
+        return true;
+    }
+
+    // Start out with the first block's devices so the monitor sees them right away
+    m_devices = m_block.devices;
+    m_devicesChanged = false;
+
+    const size_t samples = m_block.sampleCount();
+    if (samples > 1) {
+        const long long span = m_block.timestamps.back() - m_block.timestamps.front();
+        const long long interval = span / static_cast<long long>(samples - 1);
+        if (interval > 0) m_recordedIntervalMs = static_cast<unsigned int>(interval);
+    }
+    return true;
+}
+
+void ReplaySource::shutdown() {
+    m_reader.close();
+    m_devices.clear();
+}
+
+bool ReplaySource::loadBlock(size_t block) {
+    if (!m_reader.readBlock(block, m_block)) return false;
+
+    m_blockIndex = block;
+    m_nextSample = 0;
+    if (!sameDevices(m_block.devices, m_devices)) {
+        m_devicesChanged = true;
+    }
+    return true;
+}
+
+bool ReplaySource::seek(long long timestampMs) {
+    const size_t block = m_reader.findBlock(timestampMs);
+    if (block >= m_reader.blockCount() || !loadBlock(block)) {
+        m_finished = true;
+        return false;
+    }
+
+    const auto& timestamps = m_block.timestamps;
+    m_nextSample = static_cast<size_t>(
+        std::lower_bound(timestamps.begin(), timestamps.end(), timestampMs) - timestamps.begin());
+    m_finished = false;
+    return true;
+}
+
+SampleStatus ReplaySource::beginSample(long long& timestampMs) {
+    if (m_finished) return SampleStatus::Failed;
+
+    // Skip blocks that are empty or fail to decode rather than stopping playback
+    while (m_nextSample >= m_block.sampleCount()) {
+        size_t next = m_blockIndex + 1;
+        while (next < m_reader.blockCount() && !loadBlock(next)) ++next;
+        if (next >= m_reader.blockCount()) {
+            m_finished = true;
+            return SampleStatus::Failed;
+        }
+    }
+
+    m_sample = m_nextSample++;
+    timestampMs = m_block.timestamps[m_sample];
+    return m_devicesChanged ? SampleStatus::DeviceLost : SampleStatus::Ok;
+}
+
+bool ReplaySource::refreshDevices() {
+    if (!m_devicesChanged) return false;
+
+    m_devices = m_block.devices;
+    m_devicesChanged = false;
+    return true;
+}
+
+SampleStatus ReplaySource::sampleDevice(size_t device, GpuMetrics& metrics, std::vector<ProcessInfo>& processes) {
+    if (m_devicesChanged || device >= m_block.devices.size()) return SampleStatus::DeviceLost;
+
+    metrics = m_block.metrics[m_sample * m_block.devices.size() + device];
+
+    const unsigned int gpuIndex = m_block.devices[device].index;
+    for (size_t p = m_block.processOffsets[m_sample]; p < m_block.processOffsets[m_sample + 1]; ++p) {
+        if (m_block.processes[p].gpuIndex == gpuIndex) {
+            processes.push_back(m_block.processes[p]);
+        }
+    }
+    return SampleStatus::Ok;
+}
@@ -0,0 +1,149 @@
+#include "sample_writer.hpp"
+#include "metric_registry.hpp"
+#include <charconv>
+
+SampleWriter::SampleWriter(FILE* out, OutputFormat format)
+    : m_out(out)
+    , m_format(format)
+    , m_length(0)
+{
+    for (const MetricDescriptor& descriptor : METRIC_DESCRIPTORS) {
+        m_metrics.push_back(descriptor.metric);
+    }
+}
+
+SampleWriter::~SampleWriter() {
+    flush();
+}
+
+void SampleWriter::flush() {
+    if (m_length > 0) {
+        fwrite(m_buffer, 1, m_length, m_out);
+        m_length = 0;
+    }
+    fflush(m_out);
+}
+
+void SampleWriter::put(char c) {
+    if (m_length == BUFFER_SIZE) {
+        fwrite(m_buffer, 1, m_length, m_out);
+        m_length = 0;
+    }
+    m_buffer[m_length++] = c;
+}
+
+void SampleWriter::put(const char* text) {
+    while (*text) put(*text++);
+}
+
+void SampleWriter::putUnsigned(unsigned long long value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    for (const char* p = digits; p != result.ptr; ++p) put(*p);
+}
+
+void SampleWriter::putSigned(long long value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    for (const char* p = digits; p != result.ptr; ++p) put(*p);
+}
+
+void SampleWriter::putFixed(double value, int precision) {
+    char digits[64];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, precision);
+    for (const char* p = digits; p != result.ptr; ++p) put(*p);
+}
+
+void SampleWriter::putMetric(Metric metric, const GpuMetrics& metrics) {
+    const MetricDescriptor& descriptor = describe(metric);
+    const double value = descriptor.value(metrics);
+    if (descriptor.textDecimals > 0) {
+        putFixed(value, descriptor.textDecimals);
+    } else {
+        putUnsigned(static_cast<unsigned long long>(value));
+    }
+}
+
+void SampleWriter::putQuoted(const std::string& text) {
+    put('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') put('\\');
+        put(c);
+    }
+    put('"');
+}
+
+void SampleWriter::putQuoted(const std::wstring& text) {
+    // Device and process names are ASCII in practice; anything else is replaced
+    put('"');
+    for (wchar_t c : text) {
+        char narrow = (c >= 0x20 && c < 0x7f) ? static_cast<char>(c) : '?';
+        if (narrow == '"' || narrow == '\\') put('\\');
+        put(narrow);
+    }
+    put('"');
+}
+
+void SampleWriter::writeHeader() {
+    if (m_format == OutputFormat::Csv) {
+        put("timestamp_ms,gpu,uuid,name");
+        for (Metric metric : m_metrics) {
+            put(',');
+            put(describe(metric).key);
+        }
+        put('\n');
+    }
+}
+
+void SampleWriter::write(const GpuSnapshot& snapshot) {
+    if (m_format == OutputFormat::Csv) {
+        writeCsv(snapshot);
+    } else {
+        writeJson(snapshot);
+    }
+    flush();
+}
+
+void SampleWriter::writeCsv(const GpuSnapshot& snapshot) {
+    for (const auto& metrics : snapshot.metrics) {
+        putSigned(snapshot.timestampMs); put(',');
+        putUnsigned(metrics.index); put(',');
+        putQuoted(metrics.uuid); put(',');
+        putQuoted(metrics.name);
+        for (Metric metric : m_metrics) {
+            put(',');
+            putMetric(metric, metrics);
+        }
+        put('\n');
+    }
+}
+
+void SampleWriter::writeJson(const GpuSnapshot& snapshot) {
+    put("{\"timestamp_ms\":"); putSigned(snapshot.timestampMs);
+    put(",\"sample_us\":"); putSigned(snapshot.sampleDuration.count());
+    put(",\"gpus\":[");
+    for (size_t i = 0; i < snapshot.metrics.size(); ++i) {
+        const GpuMetrics& metrics = snapshot.metrics[i];
+        if (i > 0) put(',');
+        put("{\"index\":"); putUnsigned(metrics.index);
+        put(",\"uuid\":"); putQuoted(metrics.uuid);
+        put(",\"name\":"); putQuoted(metrics.name);
+        for (Metric metric : m_metrics) {
+            put(",\""); put(describe(metric).key); put("\":");
+            putMetric(metric, metrics);
+        }
+        put('}');
+    }
+    put("],\"processes\":[");
+    for (size_t i = 0; i < snapshot.processes.size(); ++i) {
+        const ProcessInfo& process = snapshot.processes[i];
+        if (i > 0) put(',');
+        put("{\"gpu\":"); putUnsigned(process.gpuIndex);
+        put(",\"pid\":"); putUnsigned(process.pid);
+        put(",\"name\":"); putQuoted(process.name);
+        put(",\"mem_used_bytes\":"); putUnsigned(process.memoryUsed);
+        put(",\"gpu_util\":"); putUnsigned(process.gpuUtil);
+        put('}');
+    }
+    put("]}\n");
+}
@@ -0,0 +1,65 @@
+#include "sampling_scheduler.hpp"
+#include "gpu_monitor.hpp"
+#include <algorithm>
+#include <cmath>
+
+SamplingScheduler::SamplingScheduler(const SchedulerConfig& config)
+    : m_config(config)
+    , m_previousTimestampMs(0)
+    , m_adaptiveMs(config.baseIntervalMs)
+    , m_intervalMs(config.baseIntervalMs)
+    , m_visible(true)
+{}
+
+unsigned int SamplingScheduler::next(const GpuSnapshot& snapshot) {
+    const auto& metrics = snapshot.metrics;
+    const bool comparable = m_previous.size() == metrics.size() && m_previousTimestampMs > 0 &&
+                            snapshot.timestampMs > m_previousTimestampMs;
+    const float seconds = comparable ? (snapshot.timestampMs - m_previousTimestampMs) / 1000.0f : 0.0f;
+
+    float rate = 0.0f;
+    bool crossed = false;
+    m_previous.resize(metrics.size());
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        const GpuMetrics& gpu = metrics[i];
+        DeviceState state;
+        state.util = static_cast<float>(gpu.gpuUtil);
+        state.memUtil = static_cast<float>(gpu.memUtil);
+        state.power = gpu.powerLimit > 0 ? static_cast<float>(100.0 * gpu.powerUsage / gpu.powerLimit) : 0.0f;
+        state.memory = gpu.totalMemory > 0 ? static_cast<float>(100.0 * gpu.usedMemory / gpu.totalMemory) : 0.0f;
+        state.temperature = static_cast<float>(gpu.temperature);
+        state.hot = gpu.gpuUtil >= m_config.utilThreshold || gpu.temperature >= m_config.temperatureThreshold ||
+                    state.power >= 100.0f * m_config.powerThreshold;
+
+        if (comparable) {
+            const DeviceState& previous = m_previous[i];
+            float change = std::max({ std::fabs(state.util - previous.util),
+                                      std::fabs(state.memUtil - previous.memUtil),
+                                      std::fabs(state.power - previous.power),
+                                      std::fabs(state.memory - previous.memory),
+                                      5.0f * std::fabs(state.temperature - previous.temperature) });
+            rate = std::max(rate, change / seconds);
+            crossed = crossed || state.hot != previous.hot;
+        }
+        m_previous[i] = state;
+    }
+    m_previousTimestampMs = snapshot.timestampMs;
+
+    if (!comparable) {
+        // First sample, or the device set changed: nothing to compare against
+        m_adaptiveMs = m_config.baseIntervalMs;
+    } else if (crossed || rate >= m_config.fastRate) {
+        m_adaptiveMs = m_config.minIntervalMs;
+    } else if (rate <= m_config.steadyRate) {
+        m_adaptiveMs = std::min(m_adaptiveMs * 2, m_config.maxIntervalMs);
+    } else {
+        m_adaptiveMs = m_adaptiveMs < m_config.baseIntervalMs
+                           ? std::min(m_adaptiveMs * 2, m_config.baseIntervalMs)
+                           : m_config.baseIntervalMs;
+    }
+
+    unsigned int interval = m_adaptiveMs;
+    if (!m_visible.load(std::memory_order_relaxed)) interval = std::max(interval, m_config.baseIntervalMs);
+    m_intervalMs.store(interval, std::memory_order_relaxed);
+    return interval;
+}
@@ -0,0 +1,167 @@
+#include "shm_publisher.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+static_assert(SHM_METRIC_COUNT == METRIC_COUNT, "ShmMetric must mirror Metric");
+
+namespace {
+
+constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+uint64_t alignUp(uint64_t value) {
+    return (value + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+template <size_t N>
+void copyString(char (&out)[N], const std::string& text) {
+    size_t length = std::min(text.size(), N - 1);
+    memcpy(out, text.data(), length);
+    memset(out + length, 0, N - length);
+}
+
+template <size_t N>
+void copyString(char (&out)[N], const std::wstring& text) {
+    size_t length = std::min(text.size(), N - 1);
+    for (size_t i = 0; i < length; ++i) {
+        wchar_t c = text[i];
+        out[i] = (c >= 0x20 && c < 0x7f) ? static_cast<char>(c) : '?';
+    }
+    memset(out + length, 0, N - length);
+}
+
+}
+
+ShmPublisher::~ShmPublisher() {
+    close();
+}
+
+bool ShmPublisher::open(const std::string& name, unsigned int maxGpus, unsigned int maxProcesses,
+                        unsigned int historyCapacity) {
+    close();
+
+    const uint64_t historyStride = alignUp(historyCapacity * (sizeof(int64_t) + SHM_METRIC_COUNT * sizeof(float)));
+    const uint64_t gpusOffset = alignUp(sizeof(ShmHeader));
+    const uint64_t processesOffset = alignUp(gpusOffset + uint64_t(maxGpus) * sizeof(ShmGpu));
+    const uint64_t historyOffset = alignUp(processesOffset + uint64_t(maxProcesses) * sizeof(ShmProcess));
+    const uint64_t totalSize = historyOffset + uint64_t(maxGpus) * historyStride;
+
+    if (!m_memory.create(name, static_cast<size_t>(totalSize))) return false;
+
+    // The segment starts zeroed; only the layout description needs filling in
+    auto* header = new (m_memory.data()) ShmHeader();
+    header->magic = SHM_MAGIC;
+    header->version = SHM_VERSION;
+    header->headerSize = sizeof(ShmHeader);
+    header->gpuRecordSize = sizeof(ShmGpu);
+    header->processRecordSize = sizeof(ShmProcess);
+    header->metricCount = SHM_METRIC_COUNT;
+    header->maxGpus = maxGpus;
+    header->maxProcesses = maxProcesses;
+    header->historyCapacity = historyCapacity;
+    header->totalSize = totalSize;
+    header->gpusOffset = gpusOffset;
+    header->processesOffset = processesOffset;
+    header->historyOffset = historyOffset;
+    header->historyStride = historyStride;
+    header->writerActive = 1;
+    header->sequence.store(0, std::memory_order_release);
+
+    m_header = header;
+    return true;
+}
+
+void ShmPublisher::close() {
+    if (m_header) {
+        m_header->sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_header->writerActive = 0;
+        m_header->sequence.fetch_add(1, std::memory_order_release);
+        m_header = nullptr;
+    }
+    m_memory.close();
+}
+
+void ShmPublisher::onSnapshot(const GpuSnapshot& snapshot) {
+    if (!m_header) return;
+
+    ShmHeader& header = *m_header;
+    auto* base = static_cast<uint8_t*>(m_memory.data());
+    auto* gpus = reinterpret_cast<ShmGpu*>(base + header.gpusOffset);
+    auto* processes = reinterpret_cast<ShmProcess*>(base + header.processesOffset);
+
+    // Odd sequence: readers that start now will retry until the update is done
+    header.sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const size_t gpuCount = std::min<size_t>(snapshot.metrics.size(), header.maxGpus);
+    for (size_t i = 0; i < gpuCount; ++i) {
+        const GpuMetrics& metrics = snapshot.metrics[i];
+        ShmGpu& record = gpus[i];
+        record.index = metrics.index;
+        record.gpuUtil = metrics.gpuUtil;
+        record.memUtil = metrics.memUtil;
+        record.temperature = metrics.temperature;
+        record.fanSpeed = metrics.fanSpeed;
+        record.powerLimit = metrics.powerLimit;
+        record.coreClock = metrics.coreClock;
+        record.memClock = metrics.memClock;
+        record.powerUsage = metrics.powerUsage;
+        record.totalMemory = metrics.totalMemory;
+        record.usedMemory = metrics.usedMemory;
+        record.reserved = 0;
+        copyString(record.uuid, metrics.uuid);
+        copyString(record.name, metrics.name);
+
+        if (i < snapshot.history.size()) {
+            writeHistory(i, snapshot.history[i], record);
+        } else {
+            record.historySize = 0;
+        }
+    }
+
+    const size_t processCount = std::min<size_t>(snapshot.processes.size(), header.maxProcesses);
+    for (size_t i = 0; i < processCount; ++i) {
+        const ProcessInfo& process = snapshot.processes[i];
+        ShmProcess& record = processes[i];
+        record.gpuIndex = process.gpuIndex;
+        record.pid = process.pid;
+        record.gpuUtil = process.gpuUtil;
+        record.reserved = 0;
+        record.memoryUsed = process.memoryUsed;
+        copyString(record.name, process.name);
+    }
+
+    header.timestampMs = snapshot.timestampMs;
+    header.sampleCount += 1;
+    header.gpuCount = static_cast<uint32_t>(gpuCount);
+    header.processCount = static_cast<uint32_t>(processCount);
+
+    header.sequence.fetch_add(1, std::memory_order_release);
+}
+
+void ShmPublisher::writeHistory(size_t gpu, const MetricsHistory& history, ShmGpu& record) {
+    const size_t capacity = m_header->historyCapacity;
+    auto* base = static_cast<uint8_t*>(m_memory.data()) + m_header->historyOffset + gpu * m_header->historyStride;
+    auto* timestamps = reinterpret_cast<int64_t*>(base);
+    auto* values = reinterpret_cast<float*>(base + capacity * sizeof(int64_t));
+
+    record.historySize = 0;
+    if (history.empty() || capacity == 0) return;
+
+    // Ask for a little more than needed so gaps in sampling don't shorten the window
+    const HistoryTier& tier = history.tier(0);
+    const long long fromMs = tier.latestTimestamp() - 2 * static_cast<long long>(capacity) * tier.spec().resolutionMs;
+
+    size_t count = 0;
+    for (size_t m = 0; m < METRIC_COUNT; ++m) {
+        HistoryWindow window = m_historyReader.read(tier, static_cast<Metric>(m), fromMs);
+        count = std::min(window.avg.size, capacity);
+        const size_t skip = window.avg.size - count;
+        if (m == 0) {
+            memcpy(timestamps, window.timestamps.data + skip, count * sizeof(int64_t));
+        }
+        memcpy(values + m * capacity, window.avg.data + skip, count * sizeof(float));
+    }
+    record.historySize = static_cast<uint32_t>(count);
+}
@@ -0,0 +1,247 @@
+#include "shm_reader.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SharedMemory::SharedMemory()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_owner(false)
+#ifdef _WIN32
+    , m_mapping(nullptr)
+#endif
+{}
+
+SharedMemory::~SharedMemory() {
+    close();
+}
+
+#ifdef _WIN32
+
+namespace {
+
+std::wstring mappingName(const std::string& name) {
+    return L"Local\\" + std::wstring(name.begin(), name.end());
+}
+
+}
+
+bool SharedMemory::create(const std::string& name, size_t size) {
+    close();
+
+    const unsigned long long size64 = size;
+    m_mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                   static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64 & 0xffffffffu),
+                                   mappingName(name).c_str());
+    if (!m_mapping) return false;
+
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!m_data) {
+        close();
+        return false;
+    }
+    m_size = size;
+    m_name = name;
+    m_owner = true;
+    return true;
+}
+
+bool SharedMemory::open(const std::string& name) {
+    close();
+
+    m_mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, mappingName(name).c_str());
+    if (!m_mapping) return false;
+
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_data) {
+        close();
+        return false;
+    }
+
+    MEMORY_BASIC_INFORMATION info = {};
+    VirtualQuery(m_data, &info, sizeof(info));
+    m_size = info.RegionSize;
+    m_name = name;
+    return true;
+}
+
+void SharedMemory::close() {
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_size = 0;
+    m_owner = false;
+}
+
+#else
+
+bool SharedMemory::create(const std::string& name, size_t size) {
+    close();
+
+    // Start from a fresh segment so readers still mapping an old one keep a consistent view
+    const std::string path = "/" + name;
+    shm_unlink(path.c_str());
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return false;
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        shm_unlink(path.c_str());
+        return false;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        shm_unlink(path.c_str());
+        return false;
+    }
+
+    m_data = data;
+    m_size = size;
+    m_name = name;
+    m_owner = true;
+    return true;
+}
+
+bool SharedMemory::open(const std::string& name) {
+    close();
+
+    const std::string path = "/" + name;
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+
+    m_data = data;
+    m_size = static_cast<size_t>(st.st_size);
+    m_name = name;
+    return true;
+}
+
+void SharedMemory::close() {
+    if (m_data) munmap(m_data, m_size);
+    if (m_owner) shm_unlink(("/" + m_name).c_str());
+    m_data = nullptr;
+    m_size = 0;
+    m_owner = false;
+}
+
+#endif
+
+const int64_t* ShmSnapshot::historyTimestamps(size_t gpu) const {
+    return reinterpret_cast<const int64_t*>(history.data() + gpu * historyStride);
+}
+
+const float* ShmSnapshot::historyColumn(size_t gpu, ShmMetric metric) const {
+    const uint8_t* base = history.data() + gpu * historyStride + historyCapacity * sizeof(int64_t);
+    return reinterpret_cast<const float*>(base) + static_cast<size_t>(metric) * historyCapacity;
+}
+
+namespace {
+
+// Every section the header describes lies inside the segment it claims
+bool sectionsFit(const ShmHeader& header) {
+    const uint64_t total = header.totalSize;
+    auto fits = [total](uint64_t offset, uint64_t count, uint64_t size) {
+        return offset <= total && (size == 0 || count <= (total - offset) / size);
+    };
+    const uint64_t historyBytes = uint64_t(header.historyCapacity) * (sizeof(int64_t) + SHM_METRIC_COUNT * sizeof(float));
+    return header.gpusOffset >= sizeof(ShmHeader) &&
+           fits(header.gpusOffset, header.maxGpus, sizeof(ShmGpu)) &&
+           fits(header.processesOffset, header.maxProcesses, sizeof(ShmProcess)) &&
+           header.historyStride >= historyBytes &&
+           fits(header.historyOffset, header.maxGpus, header.historyStride);
+}
+
+}
+
+bool ShmReader::open(const std::string& name) {
+    close();
+    if (!m_memory.open(name)) return false;
+
+    // Check the fixed part of the layout before trusting any offsets
+    const auto* header = static_cast<const ShmHeader*>(m_memory.data());
+    if (m_memory.size() < sizeof(ShmHeader) ||
+        header->magic != SHM_MAGIC || header->version != SHM_VERSION ||
+        header->headerSize != sizeof(ShmHeader) || header->gpuRecordSize != sizeof(ShmGpu) ||
+        header->processRecordSize != sizeof(ShmProcess) || header->metricCount != SHM_METRIC_COUNT ||
+        header->totalSize > m_memory.size() || !sectionsFit(*header)) {
+        close();
+        return false;
+    }
+
+    m_header = header;
+    m_retries = 0;
+    return true;
+}
+
+void ShmReader::close() {
+    m_header = nullptr;
+    m_memory.close();
+}
+
+bool ShmReader::read(ShmSnapshot& out, bool withHistory, unsigned int maxRetries) {
+    if (!m_header) return false;
+
+    const auto* base = static_cast<const uint8_t*>(m_memory.data());
+    const ShmHeader& header = *m_header;
+
+    // Size buffers for the worst case up front so the copy loop never allocates
+    out.gpus.reserve(header.maxGpus);
+    out.processes.reserve(header.maxProcesses);
+    out.historyCapacity = header.historyCapacity;
+    out.historyStride = static_cast<size_t>(header.historyStride);
+    if (withHistory) out.history.reserve(header.maxGpus * out.historyStride);
+
+    for (unsigned int attempt = 0; attempt <= maxRetries; ++attempt) {
+        if (attempt > 0) ++m_retries;
+
+        const uint64_t before = header.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            // Mid-update; let the writer finish rather than burning retries
+            std::this_thread::yield();
+            continue;
+        }
+        if (!header.writerActive) return false;
+
+        // Counts may be torn mid-update; clamp them and let the sequence check decide
+        const size_t gpuCount = std::min<size_t>(header.gpuCount, header.maxGpus);
+        const size_t processCount = std::min<size_t>(header.processCount, header.maxProcesses);
+        out.timestampMs = header.timestampMs;
+        out.sampleCount = header.sampleCount;
+
+        out.gpus.resize(gpuCount);
+        memcpy(out.gpus.data(), base + header.gpusOffset, gpuCount * sizeof(ShmGpu));
+        out.processes.resize(processCount);
+        memcpy(out.processes.data(), base + header.processesOffset, processCount * sizeof(ShmProcess));
+        if (withHistory) {
+            out.history.resize(gpuCount * out.historyStride);
+            memcpy(out.history.data(), base + header.historyOffset, out.history.size());
+        } else {
+            out.history.clear();
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header.sequence.load(std::memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
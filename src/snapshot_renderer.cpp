@@ -0,0 +1,43 @@
+#include "snapshot_renderer.hpp"
+#include "png_encoder.hpp"
+#include "instrumentation.hpp"
+#include <cmath>
+
+SnapshotRenderer::SnapshotRenderer(const SnapshotConfig& config)
+    : m_config(config)
+{}
+
+unsigned int SnapshotRenderer::defaultColumns(size_t devices) {
+    if (devices <= 1) return 1;
+    return devices <= 4 ? 2 : 4;
+}
+
+void SnapshotRenderer::render(const GpuSnapshot& snapshot) {
+    NVWINTOP_PROBE(Probe::RenderFrame);
+    const size_t devices = snapshot.metrics.size();
+    m_scene.setMode(m_config.mode);
+    m_scene.setColumns(m_config.columns ? m_config.columns : defaultColumns(devices));
+    m_scene.setMinGraphHeight(static_cast<float>(m_config.graphHeight));
+
+    // Graphs get their minimum height when there is no viewport to share, and the image fits them all
+    const size_t width = m_config.width;
+    m_scene.resize(static_cast<float>(width), 0.0f);
+    const size_t height = static_cast<size_t>(std::ceil(m_scene.contentHeight(devices)));
+    m_scene.resize(static_cast<float>(width), static_cast<float>(height));
+    if (m_canvas.width() != width || m_canvas.height() != height) m_canvas.resize(width, height);
+
+    // Every snapshot is a complete picture
+    m_scene.invalidate();
+    m_scene.setEvents(snapshot.events);
+    m_scene.setOverlay(m_config.overlay ? summarizeProbes() : std::vector<ProbeSummary>());
+    m_scene.build(snapshot.metrics, snapshot.history, m_displayList);
+    m_canvas.replay(m_displayList);
+}
+
+void SnapshotRenderer::encode(std::vector<uint8_t>& out) const {
+    encodePng(m_canvas.pixels(), m_canvas.width(), m_canvas.height(), out);
+}
+
+bool SnapshotRenderer::write(const char* path) const {
+    return writePng(path, m_canvas.pixels(), m_canvas.width(), m_canvas.height());
+}
@@ -0,0 +1,168 @@
+#include "synthetic_source.hpp"
+#include "gpu_monitor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+constexpr unsigned long long DEVICE_MEMORY = 80ULL << 30;
+constexpr unsigned long long BASE_MEMORY_USED = 300ULL << 20;  // Driver and context overhead
+constexpr unsigned int POWER_LIMIT = 700;
+constexpr double AMBIENT_TEMPERATURE = 30.0;
+constexpr double UTIL_TIME_CONSTANT = 5.0;          // Seconds for load to ramp
+constexpr double THERMAL_TIME_CONSTANT = 30.0;      // Seconds for temperature to settle
+constexpr double MEAN_PHASE_SECONDS = 60.0;
+
+// Exponentially distributed delay for a Poisson process with the given rate per second
+double exponential(std::mt19937& rng, double rate) {
+    if (rate <= 0.0) return 1e300;
+    return std::exponential_distribution<double>(rate)(rng);
+}
+
+double approach(double current, double target, double dt, double timeConstant) {
+    return target + (current - target) * std::exp(-dt / timeConstant);
+}
+
+}
+
+SyntheticSource::SyntheticSource(const SyntheticConfig& config)
+    : m_config(config)
+    , m_requestedCount(config.deviceCount)
+    , m_nextPid(100000)
+    , m_startTime(std::chrono::steady_clock::now())
+{}
+
+bool SyntheticSource::initialize() {
+    m_startTime = std::chrono::steady_clock::now();
+    refreshDevices();
+    return true;
+}
+
+SampleStatus SyntheticSource::beginSample(long long& timestampMs) {
+    if (m_config.stepMs > 0) {
+        if (m_ticks == 0) m_firstTimestampMs = timestampMs;
+        timestampMs = m_firstTimestampMs + m_ticks * m_config.stepMs;
+        ++m_ticks;
+    }
+    return SampleStatus::Ok;
+}
+
+double SyntheticSource::now() const {
+    if (m_config.stepMs > 0) {
+        return static_cast<double>(m_ticks * m_config.stepMs) / 1000.0;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - m_startTime;
+    return std::chrono::duration<double>(elapsed).count() * m_config.timeScale;
+}
+
+bool SyntheticSource::refreshDevices() {
+    const unsigned int count = m_requestedCount;
+    if (count == m_devices.size()) return false;
+
+    // Existing devices keep their state; new ones start idle
+    m_devices.resize(count);
+    m_states.resize(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        DeviceInfo& info = m_devices[i];
+        if (!info.uuid.empty()) continue;
+
+        char uuid[64];
+        snprintf(uuid, sizeof(uuid), "SYN-00000000-0000-0000-0000-%012x", i);
+        info.index = i;
+        info.uuid = uuid;
+        info.name = L"Synthetic GPU";
+        info.totalMemory = DEVICE_MEMORY;
+        info.powerLimit = POWER_LIMIT;
+        m_states[i].rng.seed(m_config.seed * 7919u + i);
+    }
+    return true;
+}
+
+void SyntheticSource::startProcess(DeviceState& state, double time) {
+    std::uniform_int_distribution<unsigned long long> memoryMiB(256, 8192);
+    std::uniform_real_distribution<double> share(0.2, 1.0);
+
+    // Little's law: mean lifetime = live processes / start rate
+    const double startsPerSecond = m_config.processStartsPerMinute / 60.0;
+    const double lifetimeRate = startsPerSecond / std::max(1u, m_config.processesPerDevice);
+
+    SimProcess process;
+    process.pid = m_nextPid++;
+    process.name = L"job-" + std::to_wstring(process.pid);
+    process.memory = memoryMiB(state.rng) << 20;
+    process.share = share(state.rng);
+    process.endTime = time + exponential(state.rng, lifetimeRate);
+    state.processes.push_back(std::move(process));
+}
+
+void SyntheticSource::advance(DeviceState& state, double time) {
+    const double startsPerSecond = m_config.processStartsPerMinute / 60.0;
+
+    if (state.lastTime < 0.0) {
+        // Start in steady state so the first samples already show a populated device
+        for (unsigned int p = 0; p < m_config.processesPerDevice; ++p) {
+            startProcess(state, time);
+        }
+        state.nextProcessStart = time + exponential(state.rng, startsPerSecond);
+        state.lastTime = time;
+    }
+    const double dt = std::max(0.0, time - state.lastTime);
+    state.lastTime = time;
+
+    // Alternate between idle and busy phases of random length
+    if (time >= state.phaseEnd) {
+        std::uniform_real_distribution<double> busy(40.0, 100.0);
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        state.targetUtil = coin(state.rng) < 0.3 ? 2.0 : busy(state.rng);
+        state.phaseEnd = time + exponential(state.rng, 1.0 / MEAN_PHASE_SECONDS);
+    }
+    state.util = approach(state.util, state.targetUtil, dt, UTIL_TIME_CONSTANT);
+
+    const double equilibrium = AMBIENT_TEMPERATURE + 55.0 * state.util / 100.0;
+    state.temperature = approach(state.temperature, equilibrium, dt, THERMAL_TIME_CONSTANT);
+
+    // Process churn
+    state.processes.erase(
+        std::remove_if(state.processes.begin(), state.processes.end(),
+            [time](const SimProcess& process) { return process.endTime <= time; }),
+        state.processes.end());
+    while (state.nextProcessStart <= time) {
+        startProcess(state, state.nextProcessStart);
+        state.nextProcessStart += exponential(state.rng, startsPerSecond);
+    }
+}
+
+SampleStatus SyntheticSource::sampleDevice(size_t device, GpuMetrics& metrics, std::vector<ProcessInfo>& processes) {
+    DeviceState& state = m_states[device];
+    const DeviceInfo& info = m_devices[device];
+    advance(state, now());
+
+    std::normal_distribution<double> noise(0.0, 1.0);
+    const double util = std::clamp(state.util + 2.0 * noise(state.rng), 0.0, 100.0);
+    const double load = util / 100.0;
+
+    metrics.gpuUtil = static_cast<unsigned int>(util);
+    metrics.memUtil = static_cast<unsigned int>(std::clamp(util * 0.6 + 2.0 * noise(state.rng), 0.0, 100.0));
+    metrics.temperature = static_cast<unsigned int>(state.temperature + 0.5 * noise(state.rng));
+    metrics.fanSpeed = static_cast<unsigned int>(std::clamp(30.0 + (state.temperature - 40.0) * 1.5, 30.0, 100.0));
+    metrics.powerUsage = std::min<double>(info.powerLimit,
+        info.powerLimit * (0.12 + 0.88 * std::pow(load, 1.2)) + 5.0 * noise(state.rng));
+    metrics.coreClock = load > 0.05 ? static_cast<unsigned int>(1400 + 580 * load) : 210;
+    metrics.memClock = load > 0.05 ? 2619 : 405;
+
+    unsigned long long used = BASE_MEMORY_USED;
+    for (const auto& process : state.processes) {
+        ProcessInfo procInfo = {};
+        procInfo.gpuIndex = info.index;
+        procInfo.pid = process.pid;
+        procInfo.name = process.name;
+        procInfo.memoryUsed = process.memory;
+        procInfo.gpuUtil = static_cast<unsigned int>(util * process.share / state.processes.size());
+        processes.push_back(std::move(procInfo));
+        used += process.memory;
+    }
+    metrics.usedMemory = std::min(used, info.totalMemory);
+
+    return SampleStatus::Ok;
+}
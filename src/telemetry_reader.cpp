@@ -0,0 +1,364 @@
+#include "telemetry_reader.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Bounds-checked cursor over a block payload
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        if (ok && !getVarint(p, end, value)) ok = false;
+        return value;
+    }
+
+    std::string string() {
+        uint64_t length = varint();
+        if (!ok || length > static_cast<uint64_t>(end - p)) {
+            ok = false;
+            return std::string();
+        }
+        std::string text(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+        p += length;
+        return text;
+    }
+
+    std::wstring wideString() {
+        uint64_t length = varint();
+        if (!ok || length > static_cast<uint64_t>(end - p)) {
+            ok = false;
+            return std::wstring();
+        }
+        std::wstring text(static_cast<size_t>(length), L'\0');
+        for (auto& c : text) c = static_cast<wchar_t>(varint());
+        return text;
+    }
+
+    // Returns a reader over the next length-prefixed section and skips past it
+    Reader section() {
+        uint64_t length = varint();
+        Reader inner = { p, p, ok };
+        if (!ok || length > static_cast<uint64_t>(end - p)) {
+            ok = false;
+            inner.ok = false;
+            return inner;
+        }
+        inner.end = p + length;
+        p += length;
+        return inner;
+    }
+};
+
+}
+
+MappedFile::MappedFile()
+    : m_data(nullptr)
+    , m_size(0)
+#ifdef _WIN32
+    , m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(nullptr)
+#endif
+{}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+        close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        close();
+        return false;
+    }
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+TelemetryReader::TelemetryReader()
+    : m_index(nullptr)
+    , m_blockCount(0)
+    , m_indexRebuilt(false)
+{}
+
+bool TelemetryReader::open(const std::string& path) {
+    close();
+    if (!m_file.open(path)) return false;
+
+    TelemetryFileHeader header = {};
+    if (m_file.size() < sizeof(header)) {
+        close();
+        return false;
+    }
+    memcpy(&header, m_file.data(), sizeof(header));
+    if (header.magic != TELEMETRY_FILE_MAGIC || header.version != TELEMETRY_VERSION) {
+        close();
+        return false;
+    }
+
+    if (!loadIndex()) {
+        rebuildIndex();
+    }
+    return true;
+}
+
+void TelemetryReader::close() {
+    m_file.close();
+    m_index = nullptr;
+    m_blockCount = 0;
+    m_rebuiltIndex.clear();
+    m_indexRebuilt = false;
+}
+
+bool TelemetryReader::loadIndex() {
+    const size_t size = m_file.size();
+    if (size < sizeof(TelemetryFileHeader) + sizeof(TelemetryIndexTrailer)) return false;
+
+    TelemetryIndexTrailer trailer = {};
+    memcpy(&trailer, m_file.data() + size - sizeof(trailer), sizeof(trailer));
+    if (trailer.magic != TELEMETRY_INDEX_MAGIC) return false;
+
+    const uint64_t indexBytes = static_cast<uint64_t>(trailer.blockCount) * sizeof(TelemetryIndexEntry);
+    if (trailer.indexOffset < sizeof(TelemetryFileHeader) ||
+        trailer.indexOffset + indexBytes != size - sizeof(trailer)) {
+        return false;
+    }
+
+    m_index = m_file.data() + trailer.indexOffset;
+    m_blockCount = trailer.blockCount;
+    return true;
+}
+
+void TelemetryReader::rebuildIndex() {
+    // Walk the block headers; anything after the last complete block is a torn write
+    size_t offset = sizeof(TelemetryFileHeader);
+    while (offset + sizeof(TelemetryBlockHeader) <= m_file.size()) {
+        TelemetryBlockHeader header = {};
+        memcpy(&header, m_file.data() + offset, sizeof(header));
+        if (header.magic != TELEMETRY_BLOCK_MAGIC) break;
+
+        const size_t next = offset + sizeof(header) + header.payloadSize;
+        if (next > m_file.size()) break;
+
+        m_rebuiltIndex.push_back({ header.firstTimestampMs, header.lastTimestampMs, offset });
+        offset = next;
+    }
+
+    m_index = reinterpret_cast<const uint8_t*>(m_rebuiltIndex.data());
+    m_blockCount = m_rebuiltIndex.size();
+    m_indexRebuilt = true;
+}
+
+TelemetryIndexEntry TelemetryReader::blockInfo(size_t block) const {
+    // Entries inside the mapping are not necessarily aligned
+    TelemetryIndexEntry entry = {};
+    memcpy(&entry, m_index + block * sizeof(TelemetryIndexEntry), sizeof(entry));
+    return entry;
+}
+
+long long TelemetryReader::startTime() const {
+    return m_blockCount ? blockInfo(0).firstTimestampMs : 0;
+}
+
+long long TelemetryReader::endTime() const {
+    return m_blockCount ? blockInfo(m_blockCount - 1).lastTimestampMs : 0;
+}
+
+size_t TelemetryReader::findBlock(long long timestampMs) const {
+    size_t low = 0;
+    size_t high = m_blockCount;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (blockInfo(mid).lastTimestampMs < timestampMs) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool TelemetryReader::readBlock(size_t block, TelemetryBlock& out) const {
+    if (block >= m_blockCount) return false;
+
+    const TelemetryIndexEntry entry = blockInfo(block);
+    if (entry.offset + sizeof(TelemetryBlockHeader) > m_file.size()) return false;
+
+    TelemetryBlockHeader header = {};
+    memcpy(&header, m_file.data() + entry.offset, sizeof(header));
+    const uint8_t* payload = m_file.data() + entry.offset + sizeof(header);
+    if (header.magic != TELEMETRY_BLOCK_MAGIC ||
+        entry.offset + sizeof(header) + header.payloadSize > m_file.size()) {
+        return false;
+    }
+
+    Reader in = { payload, payload + header.payloadSize };
+    const size_t sampleCount = header.sampleCount;
+
+    const size_t deviceCount = static_cast<size_t>(in.varint());
+    if (!in.ok || deviceCount != header.deviceCount) return false;
+    out.devices.resize(deviceCount);
+    for (auto& device : out.devices) {
+        device.index = static_cast<unsigned int>(in.varint());
+        device.uuid = in.string();
+        device.name = in.wideString();
+        device.totalMemory = in.varint();
+        device.powerLimit = static_cast<unsigned int>(in.varint());
+    }
+
+    out.timestamps.resize(sampleCount);
+    Reader timestamps = in.section();
+    long long timestamp = header.firstTimestampMs;
+    for (auto& value : out.timestamps) {
+        timestamp += zigzagDecode(timestamps.varint());
+        value = timestamp;
+    }
+    if (!timestamps.ok) return false;
+
+    // Static fields come from the device table, dynamic ones from the columns
+    out.metrics.resize(sampleCount * deviceCount);
+    for (size_t s = 0; s < sampleCount; ++s) {
+        for (size_t d = 0; d < deviceCount; ++d) {
+            GpuMetrics& metrics = out.metrics[s * deviceCount + d];
+            const DeviceInfo& device = out.devices[d];
+            metrics.index = device.index;
+            metrics.uuid = device.uuid;
+            metrics.name = device.name;
+            metrics.totalMemory = device.totalMemory;
+            metrics.powerLimit = device.powerLimit;
+        }
+    }
+
+    std::vector<int64_t> fields(sampleCount * RECORDED_FIELD_COUNT);
+    for (size_t d = 0; d < deviceCount; ++d) {
+        for (size_t f = 0; f < RECORDED_FIELD_COUNT; ++f) {
+            Reader column = in.section();
+            int64_t value = 0;
+            for (size_t s = 0; s < sampleCount; ++s) {
+                value += zigzagDecode(column.varint());
+                fields[s * RECORDED_FIELD_COUNT + f] = value;
+            }
+            if (!column.ok) return false;
+        }
+        for (size_t s = 0; s < sampleCount; ++s) {
+            int64_t sampleFields[RECORDED_FIELD_COUNT];
+            std::copy_n(fields.data() + s * RECORDED_FIELD_COUNT, RECORDED_FIELD_COUNT, sampleFields);
+            fromRecordedFields(sampleFields, out.metrics[s * deviceCount + d]);
+        }
+    }
+
+    // Process rows carry name ids; the dictionary follows them
+    Reader processes = in.section();
+    std::vector<uint32_t> nameIds;
+    std::vector<ProcessRow> previousRows;
+    out.processes.clear();
+    out.processOffsets.assign(1, 0);
+    for (size_t s = 0; s < sampleCount; ++s) {
+        const size_t rows = static_cast<size_t>(processes.varint());
+        for (size_t r = 0; r < rows && processes.ok; ++r) {
+            if (r == previousRows.size()) previousRows.emplace_back();
+            ProcessRow& row = previousRows[r];
+
+            const size_t slot = static_cast<size_t>(processes.varint());
+            row.pid += zigzagDecode(processes.varint());
+            row.memoryUsed += zigzagDecode(processes.varint());
+            row.gpuUtil += zigzagDecode(processes.varint());
+            const uint32_t name = static_cast<uint32_t>(processes.varint());
+            if (slot >= deviceCount) continue;
+
+            ProcessInfo process;
+            process.gpuIndex = out.devices[slot].index;
+            process.pid = static_cast<unsigned int>(row.pid);
+            process.memoryUsed = static_cast<unsigned long long>(row.memoryUsed);
+            process.gpuUtil = static_cast<unsigned int>(row.gpuUtil);
+            out.processes.push_back(std::move(process));
+            nameIds.push_back(name);
+        }
+        out.processOffsets.push_back(out.processes.size());
+    }
+    if (!processes.ok) return false;
+
+    std::vector<std::wstring> names(static_cast<size_t>(in.varint()));
+    for (auto& name : names) name = in.wideString();
+    if (!in.ok) return false;
+
+    for (size_t p = 0; p < out.processes.size(); ++p) {
+        if (nameIds[p] < names.size()) out.processes[p].name = names[nameIds[p]];
+    }
+    return true;
+}
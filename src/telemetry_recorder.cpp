@@ -0,0 +1,244 @@
+#include "telemetry_recorder.hpp"
+#include "varint.hpp"
+#include <cmath>
+
+namespace {
+
+void putString(std::vector<uint8_t>& out, const std::string& text) {
+    putVarint(out, text.size());
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+// Stored as code units so names round-trip whatever the width of wchar_t
+void putWideString(std::vector<uint8_t>& out, const std::wstring& text) {
+    putVarint(out, text.size());
+    for (wchar_t c : text) {
+        putVarint(out, static_cast<uint64_t>(c));
+    }
+}
+
+void putSection(std::vector<uint8_t>& out, const std::vector<uint8_t>& section) {
+    putVarint(out, section.size());
+    out.insert(out.end(), section.begin(), section.end());
+}
+
+}
+
+void toRecordedFields(const GpuMetrics& metrics, int64_t (&fields)[RECORDED_FIELD_COUNT]) {
+    fields[static_cast<size_t>(RecordedField::GpuUtil)] = metrics.gpuUtil;
+    fields[static_cast<size_t>(RecordedField::MemUtil)] = metrics.memUtil;
+    fields[static_cast<size_t>(RecordedField::Temperature)] = metrics.temperature;
+    fields[static_cast<size_t>(RecordedField::FanSpeed)] = metrics.fanSpeed;
+    fields[static_cast<size_t>(RecordedField::PowerMilliwatts)] = std::llround(metrics.powerUsage * 1000.0);
+    fields[static_cast<size_t>(RecordedField::CoreClock)] = metrics.coreClock;
+    fields[static_cast<size_t>(RecordedField::MemClock)] = metrics.memClock;
+    fields[static_cast<size_t>(RecordedField::UsedMemory)] = static_cast<int64_t>(metrics.usedMemory);
+}
+
+void fromRecordedFields(const int64_t (&fields)[RECORDED_FIELD_COUNT], GpuMetrics& metrics) {
+    metrics.gpuUtil = static_cast<unsigned int>(fields[static_cast<size_t>(RecordedField::GpuUtil)]);
+    metrics.memUtil = static_cast<unsigned int>(fields[static_cast<size_t>(RecordedField::MemUtil)]);
+    metrics.temperature = static_cast<unsigned int>(fields[static_cast<size_t>(RecordedField::Temperature)]);
+    metrics.fanSpeed = static_cast<unsigned int>(fields[static_cast<size_t>(RecordedField::FanSpeed)]);
+    metrics.powerUsage = fields[static_cast<size_t>(RecordedField::PowerMilliwatts)] / 1000.0;
+    metrics.coreClock = static_cast<unsigned int>(fields[static_cast<size_t>(RecordedField::CoreClock)]);
+    metrics.memClock = static_cast<unsigned int>(fields[static_cast<size_t>(RecordedField::MemClock)]);
+    metrics.usedMemory = static_cast<unsigned long long>(fields[static_cast<size_t>(RecordedField::UsedMemory)]);
+}
+
+TelemetryRecorder::TelemetryRecorder()
+    : m_file(nullptr)
+    , m_offset(0)
+    , m_totalSamples(0)
+    , m_sampleCount(0)
+    , m_firstTimestampMs(0)
+    , m_lastTimestampMs(0)
+{}
+
+TelemetryRecorder::~TelemetryRecorder() {
+    close();
+}
+
+bool TelemetryRecorder::open(const std::string& path) {
+    close();
+
+    m_file = fopen(path.c_str(), "wb");
+    if (!m_file) return false;
+
+    m_offset = 0;
+    m_totalSamples = 0;
+    m_index.clear();
+    m_sampleCount = 0;
+
+    TelemetryFileHeader header = { TELEMETRY_FILE_MAGIC, TELEMETRY_VERSION };
+    if (!write(&header, sizeof(header))) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TelemetryRecorder::close() {
+    if (!m_file) return;
+
+    flushBlock();
+
+    TelemetryIndexTrailer trailer = {};
+    trailer.indexOffset = m_offset;
+    trailer.blockCount = static_cast<uint32_t>(m_index.size());
+    trailer.magic = TELEMETRY_INDEX_MAGIC;
+    if (!m_index.empty()) {
+        write(m_index.data(), m_index.size() * sizeof(TelemetryIndexEntry));
+    }
+    write(&trailer, sizeof(trailer));
+
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+bool TelemetryRecorder::write(const void* data, size_t size) {
+    if (fwrite(data, 1, size, m_file) != size) return false;
+    m_offset += size;
+    return true;
+}
+
+bool TelemetryRecorder::matchesBlockDevices(const GpuSnapshot& snapshot) const {
+    if (snapshot.metrics.size() != m_devices.size()) return false;
+    for (size_t d = 0; d < m_devices.size(); ++d) {
+        if (snapshot.metrics[d].uuid != m_devices[d].uuid ||
+            snapshot.metrics[d].index != m_devices[d].index) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TelemetryRecorder::beginBlock(const GpuSnapshot& snapshot) {
+    m_devices.clear();
+    for (const auto& metrics : snapshot.metrics) {
+        DeviceInfo info;
+        info.index = metrics.index;
+        info.uuid = metrics.uuid;
+        info.name = metrics.name;
+        info.totalMemory = metrics.totalMemory;
+        info.powerLimit = metrics.powerLimit;
+        m_devices.push_back(std::move(info));
+    }
+
+    const size_t columnCount = m_devices.size() * RECORDED_FIELD_COUNT;
+    if (m_columns.size() < columnCount) m_columns.resize(columnCount);
+    for (auto& column : m_columns) column.clear();
+    m_previous.assign(columnCount, 0);
+    m_timestamps.clear();
+    m_processes.clear();
+    m_previousRows.clear();
+    m_nameIds.clear();
+    m_names.clear();
+
+    m_sampleCount = 0;
+    m_firstTimestampMs = snapshot.timestampMs;
+    m_lastTimestampMs = snapshot.timestampMs;
+}
+
+uint32_t TelemetryRecorder::nameId(const std::wstring& name) {
+    auto result = m_nameIds.emplace(name, static_cast<uint32_t>(m_names.size()));
+    if (result.second) {
+        m_names.push_back(&result.first->first);
+    }
+    return result.first->second;
+}
+
+void TelemetryRecorder::append(const GpuSnapshot& snapshot) {
+    if (!m_file) return;
+
+    // A block covers one device set, so a hot-plug or a lost GPU starts a new one
+    if (m_sampleCount > 0 && (m_sampleCount >= TELEMETRY_SAMPLES_PER_BLOCK || !matchesBlockDevices(snapshot))) {
+        flushBlock();
+    }
+    if (m_sampleCount == 0) {
+        beginBlock(snapshot);
+    }
+
+    putVarint(m_timestamps, zigzagEncode(snapshot.timestampMs - m_lastTimestampMs));
+    m_lastTimestampMs = snapshot.timestampMs;
+
+    for (size_t d = 0; d < m_devices.size(); ++d) {
+        int64_t fields[RECORDED_FIELD_COUNT];
+        toRecordedFields(snapshot.metrics[d], fields);
+        for (size_t f = 0; f < RECORDED_FIELD_COUNT; ++f) {
+            const size_t column = d * RECORDED_FIELD_COUNT + f;
+            putVarint(m_columns[column], zigzagEncode(fields[f] - m_previous[column]));
+            m_previous[column] = fields[f];
+        }
+    }
+
+    putVarint(m_processes, snapshot.processes.size());
+    size_t r = 0;
+    for (const auto& process : snapshot.processes) {
+        // Processes refer to devices by slot in the block's device table
+        size_t slot = 0;
+        while (slot < m_devices.size() && m_devices[slot].index != process.gpuIndex) ++slot;
+
+        // Process lists are mostly stable between samples, so each row is stored
+        // as a delta against the row at the same position in the previous sample
+        ProcessRow row = { process.pid, static_cast<int64_t>(process.memoryUsed), process.gpuUtil };
+        const ProcessRow previous = r < m_previousRows.size() ? m_previousRows[r] : ProcessRow();
+        putVarint(m_processes, slot);
+        putVarint(m_processes, zigzagEncode(row.pid - previous.pid));
+        putVarint(m_processes, zigzagEncode(row.memoryUsed - previous.memoryUsed));
+        putVarint(m_processes, zigzagEncode(row.gpuUtil - previous.gpuUtil));
+        putVarint(m_processes, nameId(process.name));
+
+        if (r < m_previousRows.size()) {
+            m_previousRows[r] = row;
+        } else {
+            m_previousRows.push_back(row);
+        }
+        ++r;
+    }
+
+    ++m_sampleCount;
+    ++m_totalSamples;
+}
+
+void TelemetryRecorder::flushBlock() {
+    if (!m_file || m_sampleCount == 0) return;
+
+    m_payload.clear();
+    putVarint(m_payload, m_devices.size());
+    for (const auto& device : m_devices) {
+        putVarint(m_payload, device.index);
+        putString(m_payload, device.uuid);
+        putWideString(m_payload, device.name);
+        putVarint(m_payload, device.totalMemory);
+        putVarint(m_payload, device.powerLimit);
+    }
+
+    putSection(m_payload, m_timestamps);
+    for (size_t c = 0; c < m_devices.size() * RECORDED_FIELD_COUNT; ++c) {
+        putSection(m_payload, m_columns[c]);
+    }
+    putSection(m_payload, m_processes);
+
+    putVarint(m_payload, m_names.size());
+    for (const auto* name : m_names) {
+        putWideString(m_payload, *name);
+    }
+
+    TelemetryBlockHeader header = {};
+    header.magic = TELEMETRY_BLOCK_MAGIC;
+    header.payloadSize = static_cast<uint32_t>(m_payload.size());
+    header.firstTimestampMs = m_firstTimestampMs;
+    header.lastTimestampMs = m_lastTimestampMs;
+    header.sampleCount = m_sampleCount;
+    header.deviceCount = static_cast<uint32_t>(m_devices.size());
+
+    TelemetryIndexEntry entry = { m_firstTimestampMs, m_lastTimestampMs, m_offset };
+    if (write(&header, sizeof(header)) && write(m_payload.data(), m_payload.size())) {
+        m_index.push_back(entry);
+    }
+    // Blocks are complete on disk once written, so a crash loses at most the pending one
+    fflush(m_file);
+
+    m_sampleCount = 0;
+}
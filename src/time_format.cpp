@@ -0,0 +1,15 @@
+#include "time_format.hpp"
+#include <cstdio>
+#include <ctime>
+
+void formatUtc(long long timestampMs, char* out, size_t size) {
+    const time_t seconds = static_cast<time_t>(timestampMs / 1000);
+    struct tm utc = {};
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    snprintf(out, size, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday,
+             utc.tm_hour, utc.tm_min, utc.tm_sec, static_cast<int>(timestampMs % 1000));
+}
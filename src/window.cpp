@@ -1,23 +1,31 @@
 #include "window.hpp"
 #include <windowsx.h>
-
-MainWindow::MainWindow() : m_hwnd(nullptr), m_isActive(false) {
-    m_gpuMonitor = std::make_unique<GpuMonitor>();
+#include <cfloat>
+#include <cwchar>
+
+MainWindow::MainWindow()
+    : MainWindow(std::make_unique<GpuMonitor>(), GpuMonitor::DEFAULT_INTERVAL_MS)
+{}
+
+MainWindow::MainWindow(std::unique_ptr<GpuMonitor> monitor, unsigned int intervalMs)
+    : m_hwnd(nullptr)
+    , m_gpuMonitor(std::move(monitor))
+    , m_intervalMs(intervalMs)
+    , m_isActive(false)
+    , m_showOverlay(false)
+    , m_failed(false)
+    , m_firstFrame(true)
+{
     m_renderer = std::make_unique<GraphRenderer>();
 }
 
 MainWindow::~MainWindow() {
-    if (m_isActive) {
-        KillTimer(m_hwnd, 1);
-    }
+    m_gpuMonitor->stop();
 }
 
 bool MainWindow::create() {
-    if (!m_gpuMonitor->initialize()) {
-        MessageBoxW(nullptr, L"Failed to initialize GPU monitoring.\nMake sure you have NVIDIA drivers installed.", 
-                   L"Error", MB_ICONERROR);
-        return false;
-    }
+    // Mapped and published before the window exists, so the first frame already has graphs
+    if (!m_historyPath.empty()) m_gpuMonitor->loadHistory(m_historyPath);
 
     WNDCLASSEXW wc = {};
     wc.cbSize = sizeof(WNDCLASSEX);
@@ -50,9 +58,12 @@ bool MainWindow::create() {
         return false;
     }
 
-    // Start update timer (1 second interval)
-    SetTimer(m_hwnd, 1, 1000, nullptr);
-    m_isActive = true;
+    // NVML can take a while to come up on many GPUs, so it does so on the
+    // sampler thread while the window shows saved history; repaint on every new snapshot
+    HWND hwnd = m_hwnd;
+    m_isActive = m_gpuMonitor->startAsync(m_intervalMs,
+        [hwnd](bool ready) { PostMessageW(hwnd, WM_GPU_READY, ready ? 1 : 0, 0); },
+        [hwnd]() { PostMessageW(hwnd, WM_GPU_SAMPLE, 0, 0); });
 
     return true;
 }
@@ -80,13 +91,29 @@ LRESULT MainWindow::handleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) {
             onResize();
             return 0;
 
-        case WM_TIMER:
-            if (wParam == 1) {
-                onTimer();
-            }
+        case WM_KEYDOWN:
+            onKeyDown(wParam);
+            return 0;
+
+        case WM_MOUSEWHEEL:
+            // Three lines of 20 pixels per notch, like most scrolling views
+            m_renderer->scrollBy(-60.0f * GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA);
+            InvalidateRect(m_hwnd, nullptr, FALSE);
+            return 0;
+
+        case WM_GPU_SAMPLE:
+            onSample();
+            return 0;
+
+        case WM_GPU_READY:
+            onReady(wParam != 0);
             return 0;
 
         case WM_DESTROY:
+            m_gpuMonitor->stop();
+            m_isActive = false;
+            // Only a monitor that came up saves; a failed start keeps the previous file
+            if (!m_historyPath.empty()) m_gpuMonitor->saveHistory(m_historyPath);
             PostQuitMessage(0);
             return 0;
 
@@ -99,19 +126,102 @@ void MainWindow::onPaint() {
     PAINTSTRUCT ps;
     BeginPaint(m_hwnd, &ps);
     
-    const auto& currentMetrics = m_gpuMonitor->getCurrentMetrics();
-    const auto& history = m_gpuMonitor->getMetricsHistory();
-    m_renderer->render(currentMetrics, history);
+    // Hold the snapshot for the whole frame; the sampler may publish a newer one meanwhile
+    auto snapshot = m_gpuMonitor->getSnapshot();
+    m_renderer->setEvents(snapshot->events);
+    m_renderer->setOverlay(m_showOverlay ? summarizeProbes() : std::vector<ProbeSummary>());
+    m_renderer->setStatus(statusText(*snapshot));
+    m_renderer->render(snapshot->metrics, snapshot->history);
     
     EndPaint(m_hwnd, &ps);
+
+    if (m_firstFrame) {
+        m_gpuMonitor->markFirstFrame();
+        m_firstFrame = false;
+    }
+}
+
+std::wstring MainWindow::statusText(const GpuSnapshot& snapshot) const {
+    if (m_gpuMonitor->state() == MonitorState::Connecting) {
+        return snapshot.restored ? L"Connecting to GPUs... showing saved history" : L"Connecting to GPUs...";
+    }
+    if (!m_showOverlay) return std::wstring();
+
+    // Next to the latency table: how long startup took, from launch
+    const StartupTimes times = m_gpuMonitor->startupTimes();
+    auto part = [](const wchar_t* label, double ms) {
+        wchar_t text[64];
+        if (ms < 0.0) {
+            swprintf(text, 64, L"%ls -", label);
+        } else {
+            swprintf(text, 64, L"%ls %.0f ms", label, ms);
+        }
+        return std::wstring(text);
+    };
+    return part(L"first frame", times.firstFrameMs) + L", " + part(L"first sample", times.firstSampleMs) + L", " +
+           part(L"history load", times.historyLoadedMs);
 }
 
-void MainWindow::onTimer() {
-    m_gpuMonitor->update();
+void MainWindow::onSample() {
+    // Sampling carries on while hidden so history stays complete; only painting stops
+    if (updateVisibility()) {
+        InvalidateRect(m_hwnd, nullptr, FALSE);
+    }
+}
+
+void MainWindow::onReady(bool ready) {
+    if (!ready) {
+        m_failed = true;
+        m_isActive = false;
+        MessageBoxW(m_hwnd, L"Failed to initialize GPU monitoring.\nMake sure you have NVIDIA drivers installed.",
+                    L"Error", MB_ICONERROR);
+        DestroyWindow(m_hwnd);
+        return;
+    }
+    // Clears the connecting status
+    InvalidateRect(m_hwnd, nullptr, FALSE);
+}
+
+bool MainWindow::updateVisibility() {
+    bool visible = IsWindowVisible(m_hwnd) && !IsIconic(m_hwnd) && !m_renderer->isOccluded();
+    if (SamplingScheduler* scheduler = m_gpuMonitor->scheduler()) {
+        scheduler->setVisible(visible);
+    }
+    return visible;
+}
+
+void MainWindow::onKeyDown(WPARAM key) {
+    // 1-4 select the visible time window: 2 minutes, 10 minutes, 6 hours, 7 days
+    static const long long windows[] = {
+        2LL * 60 * 1000,
+        10LL * 60 * 1000,
+        6LL * 60 * 60 * 1000,
+        7LL * 24 * 60 * 60 * 1000,
+    };
+    RECT rc;
+    GetClientRect(m_hwnd, &rc);
+    const float page = static_cast<float>(rc.bottom - rc.top);
+
+    if (key >= '1' && key <= '4') {
+        m_renderer->setTimeWindow(windows[key - '1']);
+    } else if (key == 'G') {
+        // Toggles between full graphs and the compact grid of every GPU
+        m_renderer->setMode(m_renderer->mode() == LayoutMode::Grid ? LayoutMode::Detail : LayoutMode::Grid);
+    } else if (key == 'D') {
+        m_showOverlay = !m_showOverlay;
+    } else if (key == VK_PRIOR || key == VK_NEXT) {
+        m_renderer->scrollBy(key == VK_PRIOR ? -page : page);
+    } else if (key == VK_HOME || key == VK_END) {
+        // The scene clamps the end to the last page
+        m_renderer->setScroll(key == VK_HOME ? 0.0f : FLT_MAX);
+    } else {
+        return;
+    }
     InvalidateRect(m_hwnd, nullptr, FALSE);
 }
 
 void MainWindow::onResize() {
     m_renderer->resize();
+    updateVisibility();
     InvalidateRect(m_hwnd, nullptr, FALSE);
 }
@@ -0,0 +1,72 @@
+#include "worker_pool.hpp"
+#include "cpu_time.hpp"
+
+WorkerPool::WorkerPool(size_t threadCount)
+    : m_job(nullptr)
+    , m_jobCount(0)
+    , m_nextIndex(0)
+    , m_pending(0)
+    , m_stopping(false)
+    , m_cpuMicros(0)
+{
+    m_threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workCv.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job = &fn;
+    m_jobCount = count;
+    m_nextIndex = 0;
+    m_pending = count;
+    m_workCv.notify_all();
+
+    // Help out instead of idling, then wait for the stragglers
+    while (runNext(lock)) {}
+    m_doneCv.wait(lock, [this] { return m_pending == 0; });
+    m_job = nullptr;
+}
+
+bool WorkerPool::runNext(std::unique_lock<std::mutex>& lock) {
+    if (!m_job || m_nextIndex >= m_jobCount) return false;
+
+    size_t index = m_nextIndex++;
+    const auto* job = m_job;
+    lock.unlock();
+    (*job)(index);
+    lock.lock();
+
+    if (--m_pending == 0) {
+        m_doneCv.notify_all();
+    }
+    return true;
+}
+
+void WorkerPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_workCv.wait(lock, [this] {
+            return m_stopping || (m_job && m_nextIndex < m_jobCount);
+        });
+        if (m_stopping) return;
+
+        auto cpuStart = threadCpuTime();
+        while (runNext(lock)) {}
+        m_cpuMicros.fetch_add((threadCpuTime() - cpuStart).count(), std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,46 @@
+// Controls for the stub NVML library. Defaults can also be set through the
+// environment before nvmlInit():
+//   NVML_STUB_DEVICES    number of simulated GPUs (default 2)
+//   NVML_STUB_PROCESSES  compute processes per GPU (default 3)
+//   NVML_STUB_SAMPLES    0 to report nvmlDeviceGetSamples as unsupported
+//   NVML_STUB_FIELDS     0 to report every field value as unsupported
+//   NVML_STUB_EVENTS     0 to report event sets as unsupported
+//   NVML_STUB_XID_PERIOD_MS  raise XID 13 on each GPU in turn this often (default 0, never)
+//
+// Each GPU runs into its power cap during the short full-load bursts it has
+// every seven seconds, which shows in its throttle reasons and violation time.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void nvmlStubSetDeviceCount(unsigned int count);
+void nvmlStubSetProcessCount(unsigned int perDevice);
+void nvmlStubSetSamplesSupported(int supported);
+void nvmlStubSetFieldValuesSupported(int supported);
+void nvmlStubSetEventsSupported(int supported);
+void nvmlStubSetXidPeriod(unsigned int periodMs);
+
+// Delivers an event to every event set device is registered with for that
+// type, waking their waiters. Returns the number of sets it was delivered to.
+unsigned int nvmlStubInjectEvent(unsigned int device, unsigned long long eventType, unsigned long long eventData);
+
+// Device queries made since nvmlInit(), to compare collection paths
+unsigned long long nvmlStubCallCount(void);
+
+// Entry points that tell the collection paths apart
+typedef enum {
+    NVML_STUB_CALL_SAMPLES,        // nvmlDeviceGetSamples
+    NVML_STUB_CALL_FIELD_VALUES,   // nvmlDeviceGetFieldValues
+    NVML_STUB_CALL_UTILIZATION,    // nvmlDeviceGetUtilizationRates
+    NVML_STUB_CALL_POWER_USAGE,    // nvmlDeviceGetPowerUsage
+    NVML_STUB_CALL_COUNT
+} nvmlStubCall_t;
+
+// Calls of one entry point since nvmlInit()
+unsigned long long nvmlStubCallCountOf(nvmlStubCall_t call);
+
+#ifdef __cplusplus
+}
+#endif
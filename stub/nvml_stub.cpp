@@ -0,0 +1,518 @@
+// Stub NVML library: simulates a configurable number of GPUs with smoothly
+// varying counters so the sampling core can run without NVIDIA hardware.
+#include "nvml.h"
+#include "nvml_stub.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+
+struct nvmlDevice_st {
+    unsigned int index;
+};
+
+struct nvmlEventSet_st {
+    std::vector<unsigned long long> registered;  // Event types by device index
+    std::deque<nvmlEventData_t> pending;
+    std::condition_variable ready;
+    unsigned long long nextXidMicros = 0;
+    unsigned int nextXidDevice = 0;
+};
+
+namespace {
+
+constexpr unsigned int MAX_DEVICES = 1024;
+constexpr unsigned long long MEMORY_TOTAL = 24ULL << 30;
+
+nvmlDevice_st g_devices[MAX_DEVICES];
+std::atomic<unsigned int> g_deviceCount{2};
+std::atomic<unsigned int> g_processCount{3};
+std::atomic<bool> g_initialized{false};
+std::atomic<bool> g_samplesSupported{true};
+std::atomic<bool> g_fieldValuesSupported{true};
+std::atomic<bool> g_eventsSupported{true};
+std::atomic<unsigned int> g_xidPeriodMs{0};
+std::atomic<unsigned long long> g_calls{0};
+std::atomic<unsigned long long> g_entryCalls[NVML_STUB_CALL_COUNT];
+unsigned long long g_startMicros = 0;
+
+// Every live event set, for injection; also guards the sets themselves
+std::mutex g_eventMutex;
+std::vector<nvmlEventSet_st*> g_eventSets;
+
+constexpr unsigned long long SUPPORTED_EVENTS =
+    nvmlEventTypeSingleBitEccError | nvmlEventTypeDoubleBitEccError | nvmlEventTypeXidCriticalError;
+
+// The driver's sample ring: how often each counter is sampled and how many readings it keeps
+constexpr unsigned int SAMPLE_RING_SIZE = 120;
+constexpr unsigned long long UTILIZATION_SAMPLE_PERIOD_US = 166667;
+constexpr unsigned long long POWER_SAMPLE_PERIOD_US = 50000;
+
+unsigned int envOr(const char* name, unsigned int fallback) {
+    const char* value = getenv(name);
+    return value ? static_cast<unsigned int>(strtoul(value, nullptr, 10)) : fallback;
+}
+
+unsigned long long nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Seconds since nvmlInit() at a CPU timestamp; every counter is a function of this
+double elapsedAt(unsigned long long micros) {
+    return (static_cast<double>(micros) - static_cast<double>(g_startMicros)) / 1e6;
+}
+
+double elapsedSeconds() {
+    return elapsedAt(nowMicros());
+}
+
+// Phase-shifted wave in [0, 1] so every device looks a little different
+double wave(const nvmlDevice_st* device, double seconds, double period, double phase = 0.0) {
+    return 0.5 + 0.5 * sin(seconds * 6.283185307 / period + device->index * 0.7 + phase);
+}
+
+constexpr double BURST_PERIOD = 7.0;
+constexpr double BURST_LENGTH = 0.4;
+
+bool inBurst(const nvmlDevice_st* device, double seconds) {
+    return fmod(seconds + device->index * 1.3, BURST_PERIOD) < BURST_LENGTH;
+}
+
+// Seconds spent in bursts, where the power cap holds the clocks back, since nvmlInit()
+double burstSecondsUntil(const nvmlDevice_st* device, double seconds) {
+    auto bursts = [](double x) {
+        return floor(x / BURST_PERIOD) * BURST_LENGTH + std::min(fmod(x, BURST_PERIOD), BURST_LENGTH);
+    };
+    const double offset = device->index * 1.3;
+    return bursts(std::max(seconds, 0.0) + offset) - bursts(offset);
+}
+
+// Slow load curve with a short full-load burst every few seconds, the kind of
+// spike that 1 Hz polling mostly misses
+double gpuUtilAt(const nvmlDevice_st* device, double seconds) {
+    if (inBurst(device, seconds)) return 100.0;
+    return 100.0 * wave(device, seconds, 60.0);
+}
+
+double memUtilAt(const nvmlDevice_st* device, double seconds) {
+    return 80.0 * wave(device, seconds, 45.0, 1.0);
+}
+
+double powerMilliwattsAt(const nvmlDevice_st* device, double seconds) {
+    return 40000.0 + 3000.0 * gpuUtilAt(device, seconds);
+}
+
+double smClockAt(const nvmlDevice_st* device, double seconds) {
+    return 210.0 + 18.0 * gpuUtilAt(device, seconds);
+}
+
+bool valid(nvmlDevice_t device) {
+    g_calls.fetch_add(1, std::memory_order_relaxed);
+    return g_initialized && device && device->index < g_deviceCount;
+}
+
+void countCall(nvmlStubCall_t call) {
+    g_entryCalls[call].fetch_add(1, std::memory_order_relaxed);
+}
+
+unsigned int processPid(const nvmlDevice_st* device, unsigned int p) {
+    // The first process is this one, so name lookups have something real to find
+    if (device->index == 0 && p == 0) return static_cast<unsigned int>(getpid());
+    return 1000000 + device->index * 1000 + p;
+}
+
+}
+
+extern "C" {
+
+void nvmlStubSetDeviceCount(unsigned int count) {
+    g_deviceCount = count < MAX_DEVICES ? count : MAX_DEVICES;
+}
+
+void nvmlStubSetProcessCount(unsigned int perDevice) {
+    g_processCount = perDevice;
+}
+
+void nvmlStubSetSamplesSupported(int supported) {
+    g_samplesSupported = supported != 0;
+}
+
+void nvmlStubSetFieldValuesSupported(int supported) {
+    g_fieldValuesSupported = supported != 0;
+}
+
+void nvmlStubSetEventsSupported(int supported) {
+    g_eventsSupported = supported != 0;
+}
+
+void nvmlStubSetXidPeriod(unsigned int periodMs) {
+    g_xidPeriodMs = periodMs;
+}
+
+unsigned int nvmlStubInjectEvent(unsigned int device, unsigned long long eventType, unsigned long long eventData) {
+    if (device >= MAX_DEVICES) return 0;
+    std::lock_guard<std::mutex> lock(g_eventMutex);
+    unsigned int delivered = 0;
+    for (nvmlEventSet_st* set : g_eventSets) {
+        if (device >= set->registered.size() || !(set->registered[device] & eventType)) continue;
+        set->pending.push_back({ &g_devices[device], static_cast<unsigned long long>(eventType), eventData, 0, 0 });
+        set->ready.notify_all();
+        ++delivered;
+    }
+    return delivered;
+}
+
+unsigned long long nvmlStubCallCount(void) {
+    return g_calls.load(std::memory_order_relaxed);
+}
+
+unsigned long long nvmlStubCallCountOf(nvmlStubCall_t call) {
+    return call < NVML_STUB_CALL_COUNT ? g_entryCalls[call].load(std::memory_order_relaxed) : 0;
+}
+
+nvmlReturn_t nvmlInit(void) {
+    if (!g_initialized.exchange(true)) {
+        for (unsigned int i = 0; i < MAX_DEVICES; ++i) {
+            g_devices[i].index = i;
+        }
+        nvmlStubSetDeviceCount(envOr("NVML_STUB_DEVICES", g_deviceCount));
+        nvmlStubSetProcessCount(envOr("NVML_STUB_PROCESSES", g_processCount));
+        nvmlStubSetSamplesSupported(envOr("NVML_STUB_SAMPLES", g_samplesSupported) != 0);
+        nvmlStubSetFieldValuesSupported(envOr("NVML_STUB_FIELDS", g_fieldValuesSupported) != 0);
+        nvmlStubSetEventsSupported(envOr("NVML_STUB_EVENTS", g_eventsSupported) != 0);
+        nvmlStubSetXidPeriod(envOr("NVML_STUB_XID_PERIOD_MS", g_xidPeriodMs));
+        g_calls = 0;
+        for (auto& calls : g_entryCalls) calls = 0;
+        g_startMicros = nowMicros();
+    }
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlShutdown(void) {
+    g_initialized = false;
+    return NVML_SUCCESS;
+}
+
+const char* nvmlErrorString(nvmlReturn_t result) {
+    switch (result) {
+        case NVML_SUCCESS: return "Success";
+        case NVML_ERROR_UNINITIALIZED: return "Uninitialized";
+        case NVML_ERROR_INVALID_ARGUMENT: return "Invalid Argument";
+        case NVML_ERROR_NOT_SUPPORTED: return "Not Supported";
+        case NVML_ERROR_NOT_FOUND: return "Not Found";
+        case NVML_ERROR_INSUFFICIENT_SIZE: return "Insufficient Size";
+        case NVML_ERROR_FUNCTION_NOT_FOUND: return "Function Not Found";
+        case NVML_ERROR_GPU_IS_LOST: return "GPU is lost";
+        default: return "Unknown Error";
+    }
+}
+
+nvmlReturn_t nvmlDeviceGetCount(unsigned int* deviceCount) {
+    if (!g_initialized) return NVML_ERROR_UNINITIALIZED;
+    if (!deviceCount) return NVML_ERROR_INVALID_ARGUMENT;
+    *deviceCount = g_deviceCount;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetHandleByIndex(unsigned int index, nvmlDevice_t* device) {
+    if (!g_initialized) return NVML_ERROR_UNINITIALIZED;
+    if (!device || index >= g_deviceCount) return NVML_ERROR_INVALID_ARGUMENT;
+    *device = &g_devices[index];
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetName(nvmlDevice_t device, char* name, unsigned int length) {
+    if (!valid(device) || !name) return NVML_ERROR_INVALID_ARGUMENT;
+    snprintf(name, length, "NVIDIA Stub GPU");
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetUUID(nvmlDevice_t device, char* uuid, unsigned int length) {
+    if (!valid(device) || !uuid) return NVML_ERROR_INVALID_ARGUMENT;
+    snprintf(uuid, length, "GPU-00000000-0000-0000-0000-%012x", device->index);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetEnforcedPowerLimit(nvmlDevice_t device, unsigned int* limit) {
+    if (!valid(device) || !limit) return NVML_ERROR_INVALID_ARGUMENT;
+    *limit = 350000;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetUtilizationRates(nvmlDevice_t device, nvmlUtilization_t* utilization) {
+    countCall(NVML_STUB_CALL_UTILIZATION);
+    if (!valid(device) || !utilization) return NVML_ERROR_INVALID_ARGUMENT;
+    const double now = elapsedSeconds();
+    utilization->gpu = static_cast<unsigned int>(gpuUtilAt(device, now));
+    utilization->memory = static_cast<unsigned int>(memUtilAt(device, now));
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetTemperature(nvmlDevice_t device, nvmlTemperatureSensors_t sensorType, unsigned int* temp) {
+    if (!valid(device) || !temp) return NVML_ERROR_INVALID_ARGUMENT;
+    if (sensorType != NVML_TEMPERATURE_GPU) return NVML_ERROR_NOT_SUPPORTED;
+    *temp = 35 + static_cast<unsigned int>(50 * wave(device, elapsedSeconds(), 120.0));
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetFanSpeed(nvmlDevice_t device, unsigned int* speed) {
+    if (!valid(device) || !speed) return NVML_ERROR_INVALID_ARGUMENT;
+    *speed = 30 + static_cast<unsigned int>(60 * wave(device, elapsedSeconds(), 120.0, -0.3));
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetPowerUsage(nvmlDevice_t device, unsigned int* power) {
+    countCall(NVML_STUB_CALL_POWER_USAGE);
+    if (!valid(device) || !power) return NVML_ERROR_INVALID_ARGUMENT;
+    *power = static_cast<unsigned int>(powerMilliwattsAt(device, elapsedSeconds()));
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetClockInfo(nvmlDevice_t device, nvmlClockType_t type, unsigned int* clock) {
+    if (!valid(device) || !clock) return NVML_ERROR_INVALID_ARGUMENT;
+    switch (type) {
+        case NVML_CLOCK_GRAPHICS:
+        case NVML_CLOCK_SM:
+            *clock = static_cast<unsigned int>(smClockAt(device, elapsedSeconds()));
+            return NVML_SUCCESS;
+        case NVML_CLOCK_MEM:
+            *clock = 9501;
+            return NVML_SUCCESS;
+        default:
+            return NVML_ERROR_NOT_SUPPORTED;
+    }
+}
+
+nvmlReturn_t nvmlDeviceGetMemoryInfo(nvmlDevice_t device, nvmlMemory_t* memory) {
+    if (!valid(device) || !memory) return NVML_ERROR_INVALID_ARGUMENT;
+    memory->total = MEMORY_TOTAL;
+    memory->used = static_cast<unsigned long long>(MEMORY_TOTAL * 0.9 * wave(device, elapsedSeconds(), 300.0, 2.0));
+    memory->free = memory->total - memory->used;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetFieldValues(nvmlDevice_t device, int valuesCount, nvmlFieldValue_t* values) {
+    countCall(NVML_STUB_CALL_FIELD_VALUES);
+    if (!valid(device) || valuesCount < 0 || (valuesCount > 0 && !values)) return NVML_ERROR_INVALID_ARGUMENT;
+
+    // Like the driver, the call succeeds and failures are reported per field
+    const long long now = static_cast<long long>(nowMicros());
+    for (int i = 0; i < valuesCount; ++i) {
+        nvmlFieldValue_t& field = values[i];
+        field.timestamp = now;
+        field.latencyUsec = 0;
+        if (g_fieldValuesSupported && field.fieldId == NVML_FI_DEV_POWER_INSTANT) {
+            field.valueType = NVML_VALUE_TYPE_UNSIGNED_INT;
+            field.value.uiVal = static_cast<unsigned int>(powerMilliwattsAt(device, elapsedAt(now)));
+            field.nvmlReturn = NVML_SUCCESS;
+        } else {
+            field.nvmlReturn = NVML_ERROR_NOT_SUPPORTED;
+        }
+    }
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetSamples(nvmlDevice_t device, nvmlSamplingType_t type, unsigned long long lastSeenTimeStamp,
+                                  nvmlValueType_t* sampleValType, unsigned int* sampleCount, nvmlSample_t* samples) {
+    countCall(NVML_STUB_CALL_SAMPLES);
+    if (!valid(device) || !sampleValType || !sampleCount) return NVML_ERROR_INVALID_ARGUMENT;
+    if (!g_samplesSupported) return NVML_ERROR_NOT_SUPPORTED;
+
+    unsigned long long period = 0;
+    double (*valueAt)(const nvmlDevice_st*, double) = nullptr;
+    switch (type) {
+        case NVML_TOTAL_POWER_SAMPLES: period = POWER_SAMPLE_PERIOD_US; valueAt = powerMilliwattsAt; break;
+        case NVML_GPU_UTILIZATION_SAMPLES: period = UTILIZATION_SAMPLE_PERIOD_US; valueAt = gpuUtilAt; break;
+        case NVML_MEMORY_UTILIZATION_SAMPLES: period = UTILIZATION_SAMPLE_PERIOD_US; valueAt = memUtilAt; break;
+        case NVML_PROCESSOR_CLK_SAMPLES: period = UTILIZATION_SAMPLE_PERIOD_US; valueAt = smClockAt; break;
+        default: return NVML_ERROR_NOT_SUPPORTED;
+    }
+
+    *sampleValType = NVML_VALUE_TYPE_UNSIGNED_INT;
+    if (!samples) {
+        *sampleCount = SAMPLE_RING_SIZE;
+        return NVML_SUCCESS;
+    }
+
+    // Readings land on multiples of the period; the ring keeps the newest SAMPLE_RING_SIZE
+    const unsigned long long now = nowMicros();
+    const unsigned long long newest = now - now % period;
+    unsigned long long oldest = newest - (SAMPLE_RING_SIZE - 1) * period;
+    oldest = std::max(oldest, g_startMicros - g_startMicros % period + period);
+    if (lastSeenTimeStamp >= oldest) oldest = lastSeenTimeStamp - lastSeenTimeStamp % period + period;
+    if (oldest > newest) {
+        *sampleCount = 0;
+        return NVML_ERROR_NOT_FOUND;
+    }
+
+    unsigned long long count = (newest - oldest) / period + 1;
+    count = std::min<unsigned long long>(count, *sampleCount);
+    const unsigned long long first = newest - (count - 1) * period;
+    for (unsigned long long i = 0; i < count; ++i) {
+        const unsigned long long timeStamp = first + i * period;
+        samples[i].timeStamp = timeStamp;
+        samples[i].sampleValue.uiVal = static_cast<unsigned int>(valueAt(device, elapsedAt(timeStamp)));
+    }
+    *sampleCount = static_cast<unsigned int>(count);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetComputeRunningProcesses(nvmlDevice_t device, unsigned int* infoCount, nvmlProcessInfo_t* infos) {
+    if (!valid(device) || !infoCount) return NVML_ERROR_INVALID_ARGUMENT;
+
+    const unsigned int count = g_processCount;
+    if (*infoCount < count || (count > 0 && !infos)) {
+        *infoCount = count;
+        return NVML_ERROR_INSUFFICIENT_SIZE;
+    }
+
+    for (unsigned int p = 0; p < count; ++p) {
+        infos[p] = {};
+        infos[p].pid = processPid(device, p);
+        infos[p].usedGpuMemory = (256ULL << 20) * (p + 1);
+    }
+    *infoCount = count;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetGraphicsRunningProcesses(nvmlDevice_t device, unsigned int* infoCount, nvmlProcessInfo_t*) {
+    if (!valid(device) || !infoCount) return NVML_ERROR_INVALID_ARGUMENT;
+    *infoCount = 0;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetProcessUtilization(nvmlDevice_t device, nvmlProcessUtilizationSample_t* utilization,
+                                             unsigned int* processSamplesCount, unsigned long long lastSeenTimeStamp) {
+    if (!valid(device) || !processSamplesCount) return NVML_ERROR_INVALID_ARGUMENT;
+
+    const unsigned long long now = nowMicros();
+    const unsigned int count = now > lastSeenTimeStamp ? g_processCount.load() : 0;
+    if (count == 0) {
+        *processSamplesCount = 0;
+        return NVML_ERROR_NOT_FOUND;
+    }
+    if (!utilization || *processSamplesCount < count) {
+        *processSamplesCount = count;
+        return NVML_ERROR_INSUFFICIENT_SIZE;
+    }
+
+    for (unsigned int p = 0; p < count; ++p) {
+        utilization[p] = {};
+        utilization[p].pid = processPid(device, p);
+        utilization[p].timeStamp = now;
+        utilization[p].smUtil = static_cast<unsigned int>(100 * wave(device, elapsedSeconds(), 60.0, p * 0.5) / count);
+        utilization[p].memUtil = static_cast<unsigned int>(80 * wave(device, elapsedSeconds(), 45.0, p * 0.5) / count);
+    }
+    *processSamplesCount = count;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetCurrentClocksThrottleReasons(nvmlDevice_t device, unsigned long long* clocksThrottleReasons) {
+    if (!valid(device) || !clocksThrottleReasons) return NVML_ERROR_INVALID_ARGUMENT;
+    const double now = elapsedSeconds();
+    if (inBurst(device, now)) {
+        *clocksThrottleReasons = nvmlClocksThrottleReasonSwPowerCap;
+    } else {
+        *clocksThrottleReasons = gpuUtilAt(device, now) < 5.0 ? nvmlClocksThrottleReasonGpuIdle : 0;
+    }
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetViolationStatus(nvmlDevice_t device, nvmlPerfPolicyType_t perfPolicyType,
+                                          nvmlViolationTime_t* violTime) {
+    if (!valid(device) || !violTime) return NVML_ERROR_INVALID_ARGUMENT;
+    const unsigned long long now = nowMicros();
+    violTime->referenceTime = now;
+    switch (perfPolicyType) {
+        case NVML_PERF_POLICY_POWER:
+            violTime->violationTime = static_cast<unsigned long long>(burstSecondsUntil(device, elapsedAt(now)) * 1e9);
+            return NVML_SUCCESS;
+        case NVML_PERF_POLICY_THERMAL:
+            violTime->violationTime = 0;  // Simulated GPUs never get hot enough
+            return NVML_SUCCESS;
+        default:
+            return NVML_ERROR_NOT_SUPPORTED;
+    }
+}
+
+nvmlReturn_t nvmlEventSetCreate(nvmlEventSet_t* set) {
+    if (!g_initialized) return NVML_ERROR_UNINITIALIZED;
+    if (!set) return NVML_ERROR_INVALID_ARGUMENT;
+    *set = new nvmlEventSet_st();
+    (*set)->nextXidMicros = nowMicros() + g_xidPeriodMs * 1000ULL;
+    std::lock_guard<std::mutex> lock(g_eventMutex);
+    g_eventSets.push_back(*set);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlEventSetFree(nvmlEventSet_t set) {
+    if (!set) return NVML_ERROR_INVALID_ARGUMENT;
+    std::lock_guard<std::mutex> lock(g_eventMutex);
+    g_eventSets.erase(std::remove(g_eventSets.begin(), g_eventSets.end(), set), g_eventSets.end());
+    delete set;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetSupportedEventTypes(nvmlDevice_t device, unsigned long long* eventTypes) {
+    if (!valid(device) || !eventTypes) return NVML_ERROR_INVALID_ARGUMENT;
+    if (!g_eventsSupported) return NVML_ERROR_NOT_SUPPORTED;
+    *eventTypes = SUPPORTED_EVENTS;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceRegisterEvents(nvmlDevice_t device, unsigned long long eventTypes, nvmlEventSet_t set) {
+    if (!valid(device) || !set) return NVML_ERROR_INVALID_ARGUMENT;
+    if (!g_eventsSupported || (eventTypes & ~SUPPORTED_EVENTS)) return NVML_ERROR_NOT_SUPPORTED;
+    std::lock_guard<std::mutex> lock(g_eventMutex);
+    if (set->registered.size() <= device->index) set->registered.resize(device->index + 1, 0);
+    set->registered[device->index] |= eventTypes;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlEventSetWait_v2(nvmlEventSet_t set, nvmlEventData_t* data, unsigned int timeoutms) {
+    if (!g_initialized) return NVML_ERROR_UNINITIALIZED;
+    if (!set || !data) return NVML_ERROR_INVALID_ARGUMENT;
+
+    const auto deadline = std::chrono::system_clock::now() + std::chrono::milliseconds(timeoutms);
+    std::unique_lock<std::mutex> lock(g_eventMutex);
+    for (;;) {
+        if (!set->pending.empty()) {
+            *data = set->pending.front();
+            set->pending.pop_front();
+            return NVML_SUCCESS;
+        }
+
+        // Scheduled XIDs go round the GPUs registered for them
+        const unsigned int periodMs = g_xidPeriodMs;
+        auto wake = deadline;
+        if (periodMs > 0) {
+            const unsigned long long now = nowMicros();
+            if (now >= set->nextXidMicros) {
+                set->nextXidMicros = now + periodMs * 1000ULL;
+                for (size_t i = 0; i < set->registered.size(); ++i) {
+                    const unsigned int device = (set->nextXidDevice + i) % set->registered.size();
+                    if (device >= g_deviceCount || !(set->registered[device] & nvmlEventTypeXidCriticalError)) continue;
+                    set->pending.push_back({ &g_devices[device], static_cast<unsigned long long>(nvmlEventTypeXidCriticalError), 13, 0, 0 });
+                    set->nextXidDevice = device + 1;
+                    break;
+                }
+                continue;
+            }
+            wake = std::min(wake, std::chrono::system_clock::time_point(std::chrono::microseconds(set->nextXidMicros)));
+        }
+
+        if (std::chrono::system_clock::now() >= deadline) return NVML_ERROR_TIMEOUT;
+        set->ready.wait_until(lock, wake);
+    }
+}
+
+}
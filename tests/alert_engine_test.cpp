@@ -0,0 +1,175 @@
+#include "test.hpp"
+#include "alert_engine.hpp"
+#include "gpu_monitor.hpp"
+#include <cmath>
+#include <random>
+
+namespace {
+
+constexpr long long START_MS = 1700000000000LL;
+
+GpuMetrics makeGpu(unsigned int index, unsigned int temperature, unsigned int util) {
+    GpuMetrics gpu = {};
+    gpu.index = index;
+    gpu.uuid = "GPU-" + std::to_string(index);
+    gpu.temperature = temperature;
+    gpu.gpuUtil = util;
+    gpu.powerUsage = 300.0;
+    gpu.powerLimit = 300;
+    return gpu;
+}
+
+GpuSnapshot makeSnapshot(long long timestampMs, unsigned int temperature, unsigned int util) {
+    GpuSnapshot snapshot;
+    snapshot.timestampMs = timestampMs;
+    snapshot.metrics.push_back(makeGpu(0, temperature, util));
+    return snapshot;
+}
+
+// Transitions as "+rule" or "-rule" with the time since START_MS
+using Transitions = std::vector<std::pair<std::string, long long>>;
+
+void record(AlertEngine& engine, Transitions& transitions) {
+    engine.setListener([&transitions](const AlertEvent& event) {
+        transitions.push_back({ (event.firing ? "+" : "-") + event.rule->name, event.timestampMs - START_MS });
+    });
+}
+
+}
+
+// Every aggregate against recomputing it from all samples in the window,
+// over a noisy stream with uneven gaps and the odd NaN
+NVWINTOP_TEST(alert_sliding_window) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> gap(50, 1500);
+    std::normal_distribution<double> noise(50.0, 20.0);
+    for (AlertAggregate aggregate : { AlertAggregate::Min, AlertAggregate::Max, AlertAggregate::Avg }) {
+        for (long long lengthMs : { 1000LL, 30000LL, 300000LL }) {
+            SlidingWindow window(aggregate, lengthMs);
+            std::vector<std::pair<long long, double>> samples;
+            long long time = START_MS;
+            size_t mismatches = 0;
+            for (int i = 0; i < 20000; ++i) {
+                time += gap(rng);
+                const double value = i % 101 == 0 ? NAN : noise(rng);
+                window.add(time, value);
+                if (!std::isnan(value)) samples.push_back({ time, value });
+
+                double expected = NAN;
+                double sum = 0.0;
+                size_t count = 0;
+                for (auto it = samples.rbegin(); it != samples.rend() && it->first >= time - lengthMs; ++it) {
+                    if (count == 0) expected = it->second;
+                    if (aggregate == AlertAggregate::Min) expected = std::min(expected, it->second);
+                    if (aggregate == AlertAggregate::Max) expected = std::max(expected, it->second);
+                    sum += it->second;
+                    ++count;
+                }
+                if (aggregate == AlertAggregate::Avg && count > 0) expected = sum / count;
+                const double actual = window.value();
+                if (std::isnan(expected) != std::isnan(actual) ||
+                    (!std::isnan(expected) && std::fabs(expected - actual) > 1e-9 * (1.0 + std::fabs(expected)))) {
+                    ++mismatches;
+                }
+            }
+            CHECK(mismatches == 0);
+        }
+    }
+
+    SlidingWindow window(AlertAggregate::Max, 1000);
+    CHECK(std::isnan(window.value()));
+    window.add(START_MS, 5.0);
+    window.add(START_MS + 500, NAN);  // Skipped, not a sample
+    CHECK(window.value() == 5.0);
+    window.add(START_MS + 2000, 3.0);  // The 5 has left the window
+    CHECK(window.value() == 3.0);
+    window.clear();
+    CHECK(std::isnan(window.value()));
+}
+
+// A GPU at 90 C from 10 s to 49 s, sampled every second: "for 30s" must
+// fire at 40 s and resolve at 50 s, and the power ratio stays at the limit
+// from the start
+NVWINTOP_TEST(alert_rules_fire_and_resolve) {
+    AlertEngine engine;
+    engine.setLog(nullptr);
+    std::string error;
+    const bool parsed = engine.parse("hot: temperature > 85 for 30s\n"
+                                     "at_limit: power_w / power_limit_w >= 100% for 1m  # comment\n"
+                                     "idle: max gpu_util < 5 over 20s and temperature > 85\n", error);
+    if (!CHECK(parsed)) {
+        fprintf(stderr, "  %s\n", error.c_str());
+        return;
+    }
+    CHECK(engine.rules().size() == 3);
+    CHECK(engine.windowCount() == 4);  // temperature last and min, power ratio, util max
+
+    Transitions transitions;
+    record(engine, transitions);
+    for (long long s = 0; s <= 70; ++s) {
+        engine.evaluate(makeSnapshot(START_MS + s * 1000, s >= 10 && s < 50 ? 90 : 50, 0));
+        if (s == 45) CHECK(engine.firingCount() == 2);  // hot and idle
+    }
+    CHECK(engine.firingCount() == 1);
+
+    GpuSnapshot empty;  // The GPU goes away, which resolves what it had firing
+    empty.timestampMs = START_MS + 71000;
+    engine.evaluate(empty);
+    CHECK(engine.firingCount() == 0);
+
+    const Transitions expected = {
+        { "+idle", 20000 }, { "+hot", 40000 }, { "-hot", 50000 }, { "-idle", 50000 },
+        { "+at_limit", 60000 }, { "-at_limit", 71000 }
+    };
+    CHECK(transitions == expected);
+    CHECK(engine.eventCount() == expected.size());
+}
+
+// Each GPU has its own windows and alerts, and a resolved event says when it fired
+NVWINTOP_TEST(alert_rules_per_gpu) {
+    AlertEngine engine;
+    engine.setLog(nullptr);
+    std::string error;
+    if (!CHECK(engine.parse("hot: avg temperature >= 80 over 10s\n", error))) return;
+
+    std::vector<AlertEvent> events;
+    engine.setListener([&](const AlertEvent& event) { events.push_back(event); });
+    for (long long s = 0; s <= 30; ++s) {
+        GpuSnapshot snapshot;
+        snapshot.timestampMs = START_MS + s * 1000;
+        snapshot.metrics.push_back(makeGpu(0, 60, 0));
+        snapshot.metrics.push_back(makeGpu(1, s < 20 ? 85 : 40, 0));
+        engine.evaluate(snapshot);
+    }
+
+    if (!CHECK(events.size() == 2)) return;
+    CHECK(events[0].firing && events[0].gpuIndex == 1 && events[0].uuid == "GPU-1");
+    CHECK(events[0].timestampMs == START_MS + 10000);
+    CHECK(events[0].values.size() == 1 && events[0].values[0] == 85.0);
+    CHECK(!events[1].firing && events[1].gpuIndex == 1);
+    CHECK(events[1].sinceMs == START_MS + 10000);
+    CHECK(events[1].values[0] < 80.0);
+}
+
+// Malformed rules are rejected with the line named, and the rules in force stay
+NVWINTOP_TEST(alert_rules_parse_errors) {
+    AlertEngine engine;
+    engine.setLog(nullptr);
+    std::string error;
+    if (!CHECK(engine.parse("hot: temperature > 85 for 30s\n", error))) return;
+
+    for (const char* invalid : { "x: nope > 1", "x: temperature >", "x: min temperature > 1",
+                                 "x: temperature > 1 for 30", "temperature > 1", "x: gpu_util > 1 or" }) {
+        error.clear();
+        if (!CHECK(!engine.parse(invalid, error))) fprintf(stderr, "  accepted: %s\n", invalid);
+        CHECK(!error.empty());
+    }
+    CHECK(!engine.parse("ok: temperature > 1\n\nbad: temperature >\n", error));
+    CHECK(error.find('3') != std::string::npos);
+    CHECK(engine.rules().size() == 1 && engine.rules()[0].name == "hot");
+
+    // Blank lines and comments are fine; an empty file clears the rules
+    CHECK(engine.parse("# nothing yet\n\n", error));
+    CHECK(engine.rules().empty());
+    CHECK(engine.windowCount() == 0);
+}
@@ -0,0 +1,169 @@
+#include "test.hpp"
+#include "dashboard_layout.hpp"
+#include "display_list.hpp"
+#include "gpu_monitor.hpp"
+#include "graph_scene.hpp"
+#include "synthetic_source.hpp"
+#include <memory>
+
+namespace {
+
+constexpr float VIEW_WIDTH = 1920.0f;
+constexpr float VIEW_HEIGHT = 1080.0f;
+
+bool overlaps(const DlRect& a, const DlRect& b) {
+    return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+bool contains(const DlRect& outer, const DlRect& inner) {
+    return inner.left >= outer.left && inner.right <= outer.right &&
+           inner.top >= outer.top && inner.bottom <= outer.bottom;
+}
+
+// Inconsistencies in one layout: panels that overlap or leave the content,
+// graphs outside their panel, and visible ranges that disagree with testing
+// every panel against the viewport
+size_t layoutErrors(const LayoutParams& params) {
+    DashboardLayout layout;
+    layout.update(params);
+    size_t errors = 0;
+    const DlRect content = { 0.0f, 0.0f, params.width, layout.contentHeight() };
+    for (size_t i = 0; i < params.devices; ++i) {
+        const DlRect panel = layout.panelRect(i);
+        if (!contains(content, panel)) ++errors;
+        if (i > 0 && overlaps(panel, layout.panelRect(i - 1))) ++errors;
+        if (i >= layout.columns() && overlaps(panel, layout.panelRect(i - layout.columns()))) ++errors;
+        if (params.mode == LayoutMode::Detail) {
+            for (size_t slot = 0; slot < params.graphsPerDevice; ++slot) {
+                if (!contains(panel, layout.graphRect(i, slot))) ++errors;
+            }
+        }
+    }
+
+    for (float scroll = 0.0f; scroll <= layout.maxScroll(); scroll += params.height / 3) {
+        const std::pair<size_t, size_t> range = layout.visibleRange(scroll, scroll + params.height);
+        const DlRect view = { 0.0f, scroll, params.width, scroll + params.height };
+        for (size_t i = 0; i < params.devices; ++i) {
+            const bool visible = overlaps(layout.panelRect(i), view);
+            if (visible != (i >= range.first && i < range.second)) ++errors;
+        }
+    }
+    return errors;
+}
+
+LayoutParams viewParams(LayoutMode mode, size_t devices, size_t columns = 1) {
+    LayoutParams params;
+    params.mode = mode;
+    params.width = VIEW_WIDTH;
+    params.height = VIEW_HEIGHT;
+    params.devices = devices;
+    params.graphsPerDevice = 4;
+    params.columns = columns;
+    return params;
+}
+
+}
+
+// Detail and grid layouts for 1 to 256 GPUs in 1, 2 and 4 columns
+NVWINTOP_TEST(dashboard_layout_consistency) {
+    for (LayoutMode mode : { LayoutMode::Detail, LayoutMode::Grid }) {
+        for (size_t devices = 1; devices <= 256; ++devices) {
+            for (size_t columns : { 1, 2, 4 }) {
+                const size_t errors = layoutErrors(viewParams(mode, devices, columns));
+                if (!CHECK(errors == 0)) {
+                    fprintf(stderr, "  %s, %zu GPUs, %zu columns: %zu errors\n",
+                            mode == LayoutMode::Grid ? "grid" : "detail", devices, columns, errors);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+// Detail graphs share the viewport until they would drop below the minimum
+// height; then they stay at it and the view scrolls
+NVWINTOP_TEST(dashboard_layout_detail_fit) {
+    DashboardLayout layout;
+    layout.update(viewParams(LayoutMode::Detail, 1));
+    CHECK(layout.maxScroll() == 0.0f);
+    CHECK(layout.contentHeight() <= VIEW_HEIGHT);
+    CHECK(layout.graphHeight() > 400.0f);
+
+    layout.update(viewParams(LayoutMode::Detail, 2));
+    CHECK(layout.maxScroll() == 0.0f);
+    CHECK(layout.graphHeight() >= layout.params().minGraphHeight);
+
+    layout.update(viewParams(LayoutMode::Detail, 16));
+    CHECK(layout.graphHeight() == layout.params().minGraphHeight);
+    CHECK(layout.maxScroll() > 0.0f);
+    CHECK(layout.visibleRange(0.0f, VIEW_HEIGHT).first == 0);
+    CHECK(layout.visibleRange(0.0f, VIEW_HEIGHT).second < 16);
+    CHECK(layout.visibleRange(layout.maxScroll(), layout.maxScroll() + VIEW_HEIGHT).second == 16);
+    CHECK(layout.visibleRange(VIEW_HEIGHT, VIEW_HEIGHT).second == 0);  // Empty band
+
+    // Side by side, half as many rows
+    DashboardLayout columns;
+    columns.update(viewParams(LayoutMode::Detail, 16, 2));
+    CHECK(columns.columns() == 2);
+    CHECK(columns.contentHeight() < layout.contentHeight());
+}
+
+// Grid cells are at least GRID_CELL_WIDTH wide and stretch to fill each row
+NVWINTOP_TEST(dashboard_layout_grid_cells) {
+    DashboardLayout layout;
+    layout.update(viewParams(LayoutMode::Grid, 256));
+    CHECK(layout.columns() == 9);  // (1920 - 10) / (200 + 10)
+    const DlRect first = layout.panelRect(0);
+    const DlRect last = layout.panelRect(layout.columns() - 1);
+    CHECK(first.right - first.left >= DashboardLayout::GRID_CELL_WIDTH);
+    CHECK(first.bottom - first.top == DashboardLayout::GRID_CELL_HEIGHT);
+    CHECK(last.right <= VIEW_WIDTH && last.right > VIEW_WIDTH - 20.0f);
+    CHECK(layout.panelRect(layout.columns()).top > first.bottom);
+
+    layout.update(viewParams(LayoutMode::Grid, 0));
+    CHECK(layout.visibleRange(0.0f, VIEW_HEIGHT).second == 0);
+}
+
+// A frame only touches the GPUs inside the viewport, so 256 GPUs cost what 16 do
+NVWINTOP_TEST(graph_scene_visible_only) {
+    SyntheticConfig config;
+    config.deviceCount = 256;
+    config.stepMs = GpuMonitor::DEFAULT_INTERVAL_MS;
+    GpuMonitor monitor(std::make_unique<SyntheticSource>(config));
+    if (!CHECK(monitor.initialize())) return;
+    for (int i = 0; i < 20; ++i) monitor.update();
+    const auto snapshot = monitor.getSnapshot();
+    if (!CHECK(snapshot->metrics.size() == 256)) return;
+
+    for (LayoutMode mode : { LayoutMode::Detail, LayoutMode::Grid }) {
+        GraphScene scene;
+        scene.setMode(mode);
+        scene.resize(VIEW_WIDTH, VIEW_HEIGHT);
+        DisplayList list;
+        const GraphScene::FrameStats& stats = scene.build(snapshot->metrics, snapshot->history, list);
+
+        DashboardLayout layout;
+        LayoutParams params = viewParams(mode, 256);
+        layout.update(params);
+        const std::pair<size_t, size_t> range = layout.visibleRange(0.0f, VIEW_HEIGHT);
+        CHECK(stats.fullRepaint);
+        CHECK(stats.devicesVisible == range.second - range.first);
+        CHECK(stats.devicesVisible < 256);
+        CHECK(stats.graphsDrawn == stats.devicesVisible * (mode == LayoutMode::Grid ? 1 : scene.graphs().size()));
+
+        // Nothing is drawn past the last panel that reaches into the viewport
+        const float lastBottom = layout.panelRect(range.second - 1).bottom;
+        CHECK(layout.panelRect(range.second).top >= VIEW_HEIGHT);
+        for (const DlCommand& command : list.commands()) {
+            if (command.op == DlOp::FillRect || command.op == DlOp::StrokeRect) CHECK(command.rect.top < lastBottom);
+        }
+
+        // Scrolling is clamped to the content, and a scrolled frame is still bounded
+        scene.setScroll(1e9f);
+        CHECK(scene.scroll() == layout.maxScroll());
+        const GraphScene::FrameStats& scrolled = scene.build(snapshot->metrics, snapshot->history, list);
+        CHECK(scrolled.fullRepaint);
+        CHECK(scrolled.devicesVisible > 0 && scrolled.devicesVisible < 256);
+        CHECK(scene.contentHeight(256) == layout.contentHeight());
+    }
+}
@@ -0,0 +1,75 @@
+#include "test.hpp"
+#include "event_log.hpp"
+
+namespace {
+
+constexpr long long START_MS = 1700000000000LL;
+
+GpuEvent makeEvent(long long timestampMs, const char* uuid, GpuEventType type, unsigned long long data,
+                   unsigned int durationMs = 0) {
+    GpuEvent event = {};
+    event.timestampMs = timestampMs;
+    event.lastMs = timestampMs;
+    event.uuid = uuid;
+    event.type = type;
+    event.data = data;
+    event.durationMs = durationMs;
+    event.count = 1;
+    return event;
+}
+
+}
+
+// Repeats merge, other XIDs and GPUs do not, a gap splits, late arrivals are
+// placed by time and the oldest entries go once the log is full
+NVWINTOP_TEST(event_log_merging) {
+    EventLog log(4);
+    std::vector<GpuEvent> events = {
+        makeEvent(START_MS, "GPU-a", GpuEventType::Xid, 79),
+        makeEvent(START_MS + 100, "GPU-a", GpuEventType::Throttle, throttle_reason::SW_POWER_CAP, 400),
+        makeEvent(START_MS + 200, "GPU-a", GpuEventType::Xid, 79),
+        makeEvent(START_MS + 300, "GPU-b", GpuEventType::Xid, 79),
+        makeEvent(START_MS + 1100, "GPU-a", GpuEventType::Throttle, throttle_reason::HW_THERMAL, 300),
+    };
+    log.append(events);
+
+    auto published = log.events();
+    if (!CHECK(published->size() == 3)) return;
+    CHECK(log.total() == 5);
+    const GpuEvent& xid = (*published)[0];
+    const GpuEvent& throttle = (*published)[1];
+    CHECK(xid.count == 2 && xid.lastMs == START_MS + 200);
+    CHECK(throttle.durationMs == 700);
+    CHECK(throttle.data == (throttle_reason::SW_POWER_CAP | throttle_reason::HW_THERMAL));
+    CHECK((*published)[2].uuid == "GPU-b");
+    CHECK(log.events() == published);  // Unchanged log, same vector
+
+    events = {
+        makeEvent(START_MS + 250, "GPU-b", GpuEventType::Xid, 13),  // Late, lands before GPU-b's 79
+        makeEvent(START_MS + 1200 + EventLog::MERGE_GAP_MS, "GPU-a", GpuEventType::Xid, 79),
+    };
+    log.append(events);
+    published = log.events();
+    if (!CHECK(published->size() == 4)) return;
+    CHECK((*published)[0].uuid == "GPU-a" && (*published)[0].type == GpuEventType::Throttle);  // The first XID went
+    CHECK((*published)[1].data == 13);
+    CHECK((*published)[3].count == 1);  // Past the gap, a new entry
+    for (size_t i = 1; i < published->size(); ++i) {
+        CHECK((*published)[i].timestampMs >= (*published)[i - 1].timestampMs);
+        CHECK((*published)[i].sequence != (*published)[i - 1].sequence);
+    }
+}
+
+NVWINTOP_TEST(event_log_format) {
+    GpuEvent xid = makeEvent(START_MS + 250, "GPU-a", GpuEventType::Xid, 79);
+    xid.gpuIndex = 3;
+    CHECK(formatEvent(xid) == "2023-11-14T22:13:20.250Z xid 79 gpu=3 uuid=GPU-a");
+    xid.count = 4;
+    CHECK(formatEvent(xid) == "2023-11-14T22:13:20.250Z xid 79 gpu=3 uuid=GPU-a repeats=4");
+
+    const GpuEvent throttle = makeEvent(START_MS, "GPU-b", GpuEventType::Throttle,
+                                        throttle_reason::SW_POWER_CAP | throttle_reason::HW_THERMAL, 850);
+    CHECK(formatEvent(throttle) == "2023-11-14T22:13:20.000Z throttle power_cap,hw_thermal gpu=0 uuid=GPU-b throttled_ms=850");
+    CHECK(throttleReasonNames(throttle_reason::GPU_IDLE) == "other");
+    CHECK(std::string(eventTypeName(GpuEventType::EccError)) == "ecc");
+}
@@ -0,0 +1,199 @@
+#include "test.hpp"
+#include "display_list.hpp"
+#include "gpu_monitor.hpp"
+#include "graph_scene.hpp"
+#include "synthetic_source.hpp"
+#include <memory>
+#include <string>
+
+namespace {
+
+// Synthetic GPUs with a few minutes of history, and snapshots one tick apart
+struct SceneFixture {
+    explicit SceneFixture(unsigned int gpus) {
+        SyntheticConfig config;
+        config.deviceCount = gpus;
+        config.stepMs = GpuMonitor::DEFAULT_INTERVAL_MS;
+        monitor = std::make_unique<GpuMonitor>(std::make_unique<SyntheticSource>(config));
+        monitor->initialize();
+        for (int i = 0; i < 180; ++i) monitor->update();
+        previous = monitor->getSnapshot();
+        monitor->update();
+        latest = monitor->getSnapshot();
+    }
+
+    std::unique_ptr<GpuMonitor> monitor;
+    std::shared_ptr<const GpuSnapshot> previous;
+    std::shared_ptr<const GpuSnapshot> latest;
+};
+
+// Clips pushed and popped in pairs, never nested
+bool clipsBalanced(const DisplayList& list, size_t& clips) {
+    clips = 0;
+    bool open = false;
+    for (const DlCommand& command : list.commands()) {
+        if (command.op == DlOp::PushClip) {
+            if (open) return false;
+            open = true;
+            ++clips;
+        } else if (command.op == DlOp::PopClip) {
+            if (!open) return false;
+            open = false;
+        }
+    }
+    return !open;
+}
+
+}
+
+// Adjacent segments sharing brush and width merge; anything else starts a new command
+NVWINTOP_TEST(display_list_merging) {
+    DisplayList list;
+    list.line({ 0, 0 }, { 1, 1 }, DlBrush::Separator, 1.0f);
+    list.line({ 1, 1 }, { 2, 2 }, DlBrush::Separator, 1.0f);
+    CHECK(list.commands().size() == 1);
+    CHECK(list.commands()[0].count == 4);
+    list.line({ 2, 2 }, { 3, 3 }, DlBrush::Separator, 2.0f);
+    list.line({ 3, 3 }, { 4, 4 }, DlBrush::Green, 2.0f);
+    CHECK(list.commands().size() == 3);
+
+    const DlPoint line[] = { { 0, 0 }, { 1, 2 }, { 2, 1 } };
+    list.polyline(line, 3, DlBrush::Green, 1.0f);
+    list.polyline(line, 1, DlBrush::Green, 1.0f);  // Nothing to draw
+    list.text(L"42%", 3, { 0, 0, 10, 10 }, DlFont::Title, DlBrush::Yellow);
+    list.pushClip({ 0, 0, 5, 5 });
+    list.fillRect({ 0, 0, 5, 5 }, DlBrush::Window);
+    list.popClip();
+    CHECK(list.commands().size() == 8);
+    CHECK(list.primitiveCount() == 4 + 2 + 1 + 1);
+
+    // Appended commands point into the appended points and text
+    DisplayList combined;
+    combined.text(L"GPU", 3, { 0, 0, 10, 10 }, DlFont::Text, DlBrush::Separator);
+    combined.line({ 9, 9 }, { 8, 8 }, DlBrush::Red, 1.0f);
+    combined.append(list);
+    CHECK(combined.commands().size() == 10);
+    CHECK(combined.primitiveCount() == 2 + list.primitiveCount());
+    const DlCommand& polyline = combined.commands()[5];
+    if (CHECK(polyline.op == DlOp::Polyline)) {
+        CHECK(combined.points(polyline)[1].x == 1.0f && combined.points(polyline)[1].y == 2.0f);
+    }
+    const DlCommand& text = combined.commands()[6];
+    if (CHECK(text.op == DlOp::Text)) {
+        CHECK(std::wstring(combined.text(text), text.count) == L"42%");
+    }
+
+    list.clear();
+    CHECK(list.empty());
+    CHECK(list.primitiveCount() == 0);
+}
+
+// The first frame repaints everything; after that only graphs whose data
+// changed are redrawn, each inside its own clip, and an unchanged frame is empty
+NVWINTOP_TEST(graph_scene_partial_repaint) {
+    SceneFixture fixture(2);
+    GraphScene scene;
+    scene.resize(1024.0f, 1536.0f);
+    const size_t graphs = 2 * scene.graphs().size();
+    DisplayList list;
+
+    GraphScene::FrameStats stats = scene.build(fixture.previous->metrics, fixture.previous->history, list);
+    CHECK(stats.fullRepaint);
+    CHECK(stats.devicesVisible == 2);
+    CHECK(stats.graphsDrawn == graphs);
+    size_t clips = 0;
+    CHECK(clipsBalanced(list, clips));
+    CHECK(clips == 0);  // A full frame covers the window, so nothing needs clipping
+    if (CHECK(!list.empty())) {
+        CHECK(list.commands()[0].op == DlOp::FillRect);
+    }
+    const size_t fullPrimitives = stats.primitives;
+
+    stats = scene.build(fixture.previous->metrics, fixture.previous->history, list);
+    CHECK(!stats.fullRepaint);
+    CHECK(stats.graphsDrawn == 0);
+    CHECK(list.empty());
+
+    // A new sample on the first GPU only redraws its graphs
+    std::vector<GpuMetrics> metrics = { fixture.latest->metrics[0], fixture.previous->metrics[1] };
+    std::vector<MetricsHistory> history = { fixture.latest->history[0], fixture.previous->history[1] };
+    stats = scene.build(metrics, history, list);
+    CHECK(!stats.fullRepaint);
+    CHECK(stats.graphsDrawn == graphs / 2);
+    CHECK(clipsBalanced(list, clips));
+    CHECK(clips == stats.graphsDrawn);
+    CHECK(stats.primitives < fullPrimitives);
+
+    // Every command of a partial frame is inside a clip, and drawn within it
+    DlRect clip = {};
+    bool clipped = false;
+    for (const DlCommand& command : list.commands()) {
+        if (command.op == DlOp::PushClip) {
+            clip = command.rect;
+            clipped = true;
+        } else if (command.op == DlOp::PopClip) {
+            clipped = false;
+        } else {
+            CHECK(clipped);
+            if (command.op == DlOp::FillRect) {
+                CHECK(command.rect.left >= clip.left && command.rect.right <= clip.right &&
+                      command.rect.top >= clip.top && command.rect.bottom <= clip.bottom);
+            }
+        }
+    }
+
+    // Then the second GPU catches up, and only its graphs are redrawn
+    stats = scene.build(fixture.latest->metrics, fixture.latest->history, list);
+    CHECK(!stats.fullRepaint);
+    CHECK(stats.graphsDrawn == graphs / 2);
+
+    // Losing the backend's pixels, and a resize, both bring back a full repaint
+    scene.invalidate();
+    stats = scene.build(fixture.latest->metrics, fixture.latest->history, list);
+    CHECK(stats.fullRepaint);
+    CHECK(stats.graphsDrawn == graphs);
+    CHECK(stats.primitives == fullPrimitives);
+
+    scene.resize(1280.0f, 1536.0f);
+    stats = scene.build(fixture.latest->metrics, fixture.latest->history, list);
+    CHECK(stats.fullRepaint);
+    CHECK(scene.build(fixture.latest->metrics, fixture.latest->history, list).graphsDrawn == 0);
+}
+
+// Events redraw every visible graph; a status line on its own redraws only itself
+NVWINTOP_TEST(graph_scene_overlays) {
+    SceneFixture fixture(2);
+    GraphScene scene;
+    scene.resize(1024.0f, 1536.0f);
+    DisplayList list;
+    scene.build(fixture.latest->metrics, fixture.latest->history, list);
+
+    auto events = std::make_shared<std::vector<GpuEvent>>();
+    GpuEvent xid = {};
+    xid.timestampMs = fixture.latest->timestampMs - 5000;
+    xid.lastMs = xid.timestampMs;
+    xid.type = GpuEventType::Xid;
+    xid.data = 79;
+    xid.count = 1;
+    events->push_back(xid);
+    scene.setEvents(events);
+    GraphScene::FrameStats stats = scene.build(fixture.latest->metrics, fixture.latest->history, list);
+    CHECK(!stats.fullRepaint);
+    CHECK(stats.graphsDrawn == 2 * scene.graphs().size());
+
+    // The same list again is not a change
+    scene.setEvents(events);
+    CHECK(scene.build(fixture.latest->metrics, fixture.latest->history, list).graphsDrawn == 0);
+
+    scene.setStatus(L"Connecting to NVML");
+    stats = scene.build(fixture.latest->metrics, fixture.latest->history, list);
+    CHECK(stats.graphsDrawn == 0);
+    bool statusDrawn = false;
+    for (const DlCommand& command : list.commands()) {
+        if (command.op == DlOp::Text && std::wstring(list.text(command), command.count) == L"Connecting to NVML") {
+            statusDrawn = true;
+        }
+    }
+    CHECK(statusDrawn);
+    CHECK(list.primitiveCount() <= 3);
+}
@@ -0,0 +1,254 @@
+#include "test.hpp"
+#include "gpu_monitor.hpp"
+#include "history_store.hpp"
+#include "history_workload.hpp"
+#include "synthetic_source.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+const char* const HISTORY_FILE = "nvwintop_test_history.bin";
+
+bool writeBytes(const std::vector<uint8_t>& bytes) {
+    FILE* file = fopen(HISTORY_FILE, "wb");
+    if (!file) return false;
+    const bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && ok;
+}
+
+// True if the file is refused and nothing is handed back
+bool refused() {
+    long long savedAtMs = 0;
+    std::vector<StoredHistory> devices;
+    return !readHistoryFile(HISTORY_FILE, savedAtMs, devices) && devices.empty();
+}
+
+// Fields of a saved block as they go into the file, free to be damaged
+struct RawBlock {
+    uint64_t count = 0;
+    long long firstTimestampMs = 0;
+    long long lastTimestampMs = 0;
+    std::vector<uint64_t> offsets;
+    std::vector<uint8_t> data;
+};
+
+// The first block of a short raw history
+RawBlock rawBlock() {
+    const TieredHistory history = historyOf(10, false);
+    std::vector<std::shared_ptr<const CompressedBlock>> blocks;
+    history.view().tier(0).exportBlocks(blocks);
+    RawBlock raw;
+    raw.count = blocks[0]->count;
+    raw.firstTimestampMs = blocks[0]->firstTimestampMs;
+    raw.lastTimestampMs = blocks[0]->lastTimestampMs;
+    raw.offsets.assign(blocks[0]->offsets.begin(), blocks[0]->offsets.end());
+    raw.data = blocks[0]->data;
+    return raw;
+}
+
+// A file of one device with one raw tier holding the block, laid out by hand
+// as history_store.hpp describes
+std::vector<uint8_t> craftFile(const RawBlock& block, uint64_t columnCount = METRIC_COUNT, uint64_t deviceCount = 1) {
+    const HistoryFileHeader header = { HISTORY_FILE_MAGIC, HISTORY_FILE_VERSION, HISTORY_START_MS };
+    std::vector<uint8_t> bytes(sizeof(header));
+    memcpy(bytes.data(), &header, sizeof(header));
+    putVarint(bytes, deviceCount);
+    putVarint(bytes, 0);               // Index
+    putVarint(bytes, 0);               // UUID
+    putVarint(bytes, 0);               // Name
+    putVarint(bytes, 24ULL << 30);     // Total memory
+    putVarint(bytes, 300);             // Power limit
+    putVarint(bytes, 1);               // Tiers
+    putVarint(bytes, zigzagEncode(1000));
+    putVarint(bytes, columnCount);
+    putVarint(bytes, 1);               // Blocks
+    putVarint(bytes, block.count);
+    putVarint(bytes, zigzagEncode(block.firstTimestampMs));
+    putVarint(bytes, zigzagEncode(block.lastTimestampMs));
+    putVarint(bytes, block.offsets.size());
+    for (uint64_t offset : block.offsets) putVarint(bytes, offset);
+    bytes.insert(bytes.end(), block.data.begin(), block.data.end());
+    return bytes;
+}
+
+}
+
+// A week of history saved in each layout and loaded into both gives back
+// every sample of every tier
+NVWINTOP_TEST(history_store_round_trip) {
+    for (bool savedCompressed : { false, true }) {
+        const TieredHistory original = historyOf(7 * 24 * 3600, savedCompressed);
+        const MetricsHistory view = original.view();
+        if (!CHECK(writeHistoryFile(HISTORY_FILE, HISTORY_START_MS, { storeHistory(view, 0) }))) return;
+
+        long long savedAtMs = 0;
+        std::vector<StoredHistory> loaded;
+        if (!CHECK(readHistoryFile(HISTORY_FILE, savedAtMs, loaded))) return;
+        if (!CHECK(loaded.size() == 1)) return;
+        CHECK(savedAtMs == HISTORY_START_MS);
+        CHECK(loaded[0].device.name == L"Bench GPU");
+        CHECK(loaded[0].device.uuid == "GPU-bench-0");
+
+        for (bool loadCompressed : { false, true }) {
+            TieredHistory restored(monitorTiers(loadCompressed));
+            CHECK(restoreHistory(restored, loaded[0]));
+            const size_t differences = countDifferences(view, restored.view());
+            if (!CHECK(differences == 0)) {
+                fprintf(stderr, "  saved %s, loaded %s: %zu columns differ\n", savedCompressed ? "compressed" : "raw",
+                        loadCompressed ? "compressed" : "raw", differences);
+            }
+        }
+    }
+    std::remove(HISTORY_FILE);
+}
+
+// Every prefix of a file is refused, as is another format or version
+NVWINTOP_TEST(history_store_truncated) {
+    const std::vector<uint8_t> bytes = craftFile(rawBlock());
+    if (!CHECK(writeBytes(bytes))) return;
+    if (!CHECK(!refused())) return;
+
+    for (size_t size = 0; size < bytes.size(); ++size) {
+        writeBytes(std::vector<uint8_t>(bytes.begin(), bytes.begin() + size));
+        if (!CHECK(refused())) {
+            fprintf(stderr, "  accepted %zu of %zu bytes\n", size, bytes.size());
+            break;
+        }
+    }
+
+    for (size_t field : { offsetof(HistoryFileHeader, magic), offsetof(HistoryFileHeader, version) }) {
+        std::vector<uint8_t> damaged = bytes;
+        ++damaged[field];
+        writeBytes(damaged);
+        CHECK(refused());
+    }
+    std::remove(HISTORY_FILE);
+}
+
+// Counts and offsets that do not add up are refused before anything is allocated for them
+NVWINTOP_TEST(history_store_corrupted_counts) {
+    const RawBlock valid = rawBlock();
+
+    writeBytes(craftFile(valid, METRIC_COUNT, 1ULL << 40));
+    CHECK(refused());
+
+    // Sample counts outside 1 to BLOCK_SAMPLES
+    for (uint64_t count : { uint64_t(0), uint64_t(HistoryTier::BLOCK_SAMPLES + 1), uint64_t(1) << 40 }) {
+        RawBlock block = valid;
+        block.count = count;
+        writeBytes(craftFile(block));
+        if (!CHECK(refused())) fprintf(stderr, "  sample count %llu\n", static_cast<unsigned long long>(count));
+    }
+
+    // Offsets that do not start at 0, go backwards or run past the data
+    RawBlock block = valid;
+    block.offsets[0] = 1;
+    writeBytes(craftFile(block));
+    CHECK(refused());
+
+    block = valid;
+    block.offsets[2] = block.offsets[1] - 1;
+    writeBytes(craftFile(block));
+    CHECK(refused());
+
+    block = valid;
+    ++block.offsets.back();
+    writeBytes(craftFile(block));
+    CHECK(refused());
+
+    block = valid;
+    block.offsets.back() = 1ULL << 40;
+    writeBytes(craftFile(block));
+    CHECK(refused());
+    std::remove(HISTORY_FILE);
+}
+
+// A tier must hold one stream per column it declares, plus the timestamps
+NVWINTOP_TEST(history_store_column_mismatch) {
+    const RawBlock valid = rawBlock();
+    for (uint64_t columns : { uint64_t(METRIC_COUNT - 1), uint64_t(METRIC_COUNT + 1), uint64_t(METRIC_COUNT * STAT_COUNT) }) {
+        writeBytes(craftFile(valid, columns));
+        if (!CHECK(refused())) fprintf(stderr, "  %llu columns declared\n", static_cast<unsigned long long>(columns));
+    }
+
+    RawBlock block = valid;
+    block.offsets.pop_back();
+    writeBytes(craftFile(block));
+    CHECK(refused());
+
+    // Blocks a file does hold are still checked against the tier they go into
+    const TieredHistory rollups = historyOf(3600, false);
+    std::vector<std::shared_ptr<const CompressedBlock>> blocks;
+    rollups.view().tier(1).exportBlocks(blocks);
+    TieredHistory history(monitorTiers(false));
+    CHECK(!history.restoreTier(0, blocks));
+    std::remove(HISTORY_FILE);
+}
+
+// Damaged streams still read, but never into a tier with samples out of order
+NVWINTOP_TEST(history_store_damaged_streams) {
+    const RawBlock valid = rawBlock();
+    const size_t dataStart = craftFile(valid).size() - valid.data.size();
+    size_t restored = 0;
+    for (size_t i = 0; i < valid.data.size(); ++i) {
+        for (uint8_t flip : { uint8_t(0x01), uint8_t(0x80), uint8_t(0xff) }) {
+            std::vector<uint8_t> bytes = craftFile(valid);
+            bytes[dataStart + i] ^= flip;
+            writeBytes(bytes);
+
+            long long savedAtMs = 0;
+            std::vector<StoredHistory> loaded;
+            if (!CHECK(readHistoryFile(HISTORY_FILE, savedAtMs, loaded))) return;
+            TieredHistory history(monitorTiers(false));
+            if (!history.restoreTier(0, loaded[0].tiers[0].blocks)) continue;
+            ++restored;
+
+            const HistoryTier& tier = history.view().tier(0);
+            std::vector<long long> timestamps;
+            std::vector<float> values;
+            tier.decode(LLONG_MIN, 0, &timestamps, values);
+            if (!CHECK(std::adjacent_find(timestamps.begin(), timestamps.end(),
+                                          [](long long a, long long b) { return a >= b; }) == timestamps.end())) {
+                fprintf(stderr, "  byte %zu ^ 0x%02x restored out of order\n", i, flip);
+                return;
+            }
+        }
+    }
+    // Flips in the value streams leave the timestamps alone
+    CHECK(restored > 0);
+    std::remove(HISTORY_FILE);
+}
+
+// A tier whose blocks do not fit together is dropped on load, one with other
+// columns is skipped, and the rest of the device's history still comes back
+NVWINTOP_TEST(gpu_monitor_load_history_drops_bad_tiers) {
+    const TieredHistory original = historyOf(3 * 3600, false);
+    const MetricsHistory view = original.view();
+    StoredHistory stored = storeHistory(view, 0);
+    if (!CHECK(stored.tiers.size() == 3 && stored.tiers[1].blocks.size() > 2)) return;
+
+    // 10 s tier out of order; 1 min tier holding raw columns
+    std::swap(stored.tiers[1].blocks[0], stored.tiers[1].blocks[1]);
+    stored.tiers[2].columnCount = stored.tiers[0].columnCount;
+    stored.tiers[2].blocks = stored.tiers[0].blocks;
+    if (!CHECK(writeHistoryFile(HISTORY_FILE, HISTORY_START_MS, { stored }))) return;
+
+    SyntheticConfig config;
+    config.deviceCount = 1;
+    GpuMonitor monitor(std::make_unique<SyntheticSource>(config));
+    if (!CHECK(monitor.loadHistory(HISTORY_FILE))) return;
+    const auto snapshot = monitor.getSnapshot();
+    if (!CHECK(snapshot && snapshot->restored && snapshot->history.size() == 1)) return;
+
+    const MetricsHistory& loaded = snapshot->history[0];
+    CHECK(loaded.tier(0).size() == view.tier(0).size());
+    CHECK(loaded.tier(0).latestTimestamp() == view.tier(0).latestTimestamp());
+    CHECK(loaded.tier(1).empty());
+    CHECK(loaded.tier(2).empty());
+    std::remove(HISTORY_FILE);
+}
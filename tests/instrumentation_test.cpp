@@ -0,0 +1,69 @@
+#include "test.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// Percentiles of a long-tailed latency stream against the exact ones from
+// sorting it; HDR buckets promise 1/16 relative error
+NVWINTOP_TEST(probe_percentiles) {
+    std::mt19937_64 rng(11);
+    std::lognormal_distribution<double> latency(8.0, 1.5);  // Median about 3 us
+    LatencyHistogram histogram;
+    CHECK(histogram.percentile(0.5) == 0.0);
+    std::vector<unsigned long long> values;
+    for (int i = 0; i < 200000; ++i) {
+        const unsigned long long ns = static_cast<unsigned long long>(latency(rng));
+        histogram.record(ns);
+        values.push_back(ns);
+    }
+    std::sort(values.begin(), values.end());
+
+    for (double q : { 0.5, 0.9, 0.99, 0.999 }) {
+        const double exact = static_cast<double>(values[static_cast<size_t>(std::ceil(q * values.size())) - 1]);
+        const double estimate = histogram.percentile(q);
+        if (!CHECK(std::fabs(estimate - exact) <= exact / LatencyHistogram::SUB_BUCKETS + 1.0)) {
+            fprintf(stderr, "  p%g: %.0f against %.0f\n", q * 100.0, estimate, exact);
+        }
+    }
+    CHECK(histogram.count() == values.size());
+    CHECK(histogram.max() == values.back());
+    CHECK(histogram.percentile(1.0) <= static_cast<double>(values.back()));
+
+    histogram.reset();
+    CHECK(histogram.count() == 0 && histogram.max() == 0);
+}
+
+// Every value falls in the bucket whose range holds it, and the buckets tile
+// the range without gaps up to the top one
+NVWINTOP_TEST(probe_bucket_boundaries) {
+    for (unsigned long long ns : { 0ULL, 1ULL, 15ULL, 16ULL, 17ULL, 31ULL, 32ULL, 1000ULL, 123456789ULL,
+                                   (1ULL << 39) + 5 }) {
+        const size_t bucket = LatencyHistogram::bucketFor(ns);
+        const unsigned long long low = LatencyHistogram::bucketLow(bucket);
+        if (!CHECK(ns >= low && ns < low + LatencyHistogram::bucketWidth(bucket))) {
+            fprintf(stderr, "  %llu in bucket %zu [%llu, +%llu)\n", ns, bucket, low, LatencyHistogram::bucketWidth(bucket));
+        }
+    }
+    for (size_t bucket = 1; bucket + 1 < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+        const unsigned long long low = LatencyHistogram::bucketLow(bucket);
+        if (!CHECK(low == LatencyHistogram::bucketLow(bucket - 1) + LatencyHistogram::bucketWidth(bucket - 1))) return;
+        CHECK(LatencyHistogram::bucketFor(low) == bucket);
+        CHECK(LatencyHistogram::bucketFor(low - 1) == bucket - 1);
+    }
+    CHECK(LatencyHistogram::bucketFor(~0ULL) == LatencyHistogram::BUCKET_COUNT - 1);
+}
+
+// A timed call records into its probe when instrumentation is built in and
+// is the bare call otherwise; either way it returns the call's result
+NVWINTOP_TEST(probe_timed_call) {
+    LatencyHistogram& histogram = probeHistogram(Probe::NvmlGetCount);
+    const unsigned long long before = histogram.count();
+    int calls = 0;
+    const int result = NVWINTOP_TIMED(Probe::NvmlGetCount, ++calls);
+    CHECK(result == 1 && calls == 1);
+    CHECK(histogram.count() - before == (NVWINTOP_INSTRUMENTATION ? 1u : 0u));
+    CHECK(std::string(probeName(Probe::NvmlGetCount)).size() > 0);
+}
@@ -0,0 +1,139 @@
+#include "test.hpp"
+#include "metrics_exporter.hpp"
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+void closeSocket(SocketHandle socket) { closesocket(socket); }
+bool validSocket(SocketHandle socket) { return socket != INVALID_SOCKET; }
+#else
+using SocketHandle = int;
+void closeSocket(SocketHandle socket) { close(socket); }
+bool validSocket(SocketHandle socket) { return socket >= 0; }
+#endif
+
+// Sends one request line to the exporter and returns the whole response
+std::string request(unsigned short port, const char* requestLine) {
+    std::string response;
+    SocketHandle client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (!validSocket(client)) return response;
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        const std::string text = std::string(requestLine) + "\r\nHost: localhost\r\n\r\n";
+        send(client, text.data(), static_cast<int>(text.size()), 0);
+        char buffer[4096];
+        int received;
+        while ((received = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, static_cast<size_t>(received));
+        }
+    }
+    closeSocket(client);
+    return response;
+}
+
+bool contains(const std::string& text, const char* part) {
+    return text.find(part) != std::string::npos;
+}
+
+GpuSnapshot makeSnapshot() {
+    GpuSnapshot snapshot;
+    snapshot.timestampMs = 1718000000123LL;
+    snapshot.sampleRateHz = 1.0;
+    for (unsigned int i = 0; i < 2; ++i) {
+        GpuMetrics gpu = {};
+        gpu.index = i;
+        gpu.uuid = "GPU-" + std::to_string(i);
+        gpu.name = L"Test \"GPU\"";
+        gpu.gpuUtil = 37 + i;
+        gpu.powerUsage = 123.4567;
+        gpu.coreClock = 1500;
+        gpu.totalMemory = 24ULL << 30;
+        snapshot.metrics.push_back(gpu);
+    }
+    snapshot.processes.push_back({ 1, 4242, L"train\\py", 1ULL << 30, 55, 0 });
+    return snapshot;
+}
+
+}
+
+// One scrape of a known snapshot: headers, families, base units, label
+// escaping and the terminating # EOF
+NVWINTOP_TEST(metrics_exporter_scrape) {
+    MetricsExporter exporter;
+    if (!CHECK(exporter.start(0))) return;
+    CHECK(exporter.port() != 0);
+
+    // Before the first sample the body is just the terminator
+    std::string response = request(exporter.port(), "GET /metrics HTTP/1.1");
+    CHECK(response.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    CHECK(response.size() >= 6 && response.compare(response.size() - 6, 6, "# EOF\n") == 0);
+
+    exporter.onSnapshot(makeSnapshot());
+    response = request(exporter.port(), "GET /metrics HTTP/1.1");
+    const size_t bodyStart = response.find("\r\n\r\n");
+    if (!CHECK(bodyStart != std::string::npos)) return;
+    const std::string body = response.substr(bodyStart + 4);
+
+    CHECK(contains(response, "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"));
+    CHECK(contains(response, ("Content-Length: " + std::to_string(body.size()) + "\r\n").c_str()));
+    CHECK(body.size() >= 6 && body.compare(body.size() - 6, 6, "# EOF\n") == 0);
+    CHECK(body.find("# EOF") == body.size() - 6);
+
+    CHECK(contains(body, "# TYPE nvwintop_gpu_utilization_percent gauge\n"
+                         "# UNIT nvwintop_gpu_utilization_percent percent\n"));
+    CHECK(contains(body, "nvwintop_gpu_utilization_percent{gpu=\"0\",uuid=\"GPU-0\",name=\"Test \\\"GPU\\\"\"} 37\n"));
+    CHECK(contains(body, "nvwintop_gpu_utilization_percent{gpu=\"1\",uuid=\"GPU-1\",name=\"Test \\\"GPU\\\"\"} 38\n"));
+    CHECK(contains(body, "nvwintop_gpu_power_usage_watts{gpu=\"0\",uuid=\"GPU-0\",name=\"Test \\\"GPU\\\"\"} 123.457\n"));
+    CHECK(contains(body, "nvwintop_gpu_core_clock_hertz{gpu=\"0\",uuid=\"GPU-0\",name=\"Test \\\"GPU\\\"\"} 1500000000\n"));
+    CHECK(contains(body, "nvwintop_gpu_memory_total_bytes{gpu=\"1\",uuid=\"GPU-1\",name=\"Test \\\"GPU\\\"\"} 25769803776\n"));
+    CHECK(contains(body, "nvwintop_process_memory_used_bytes{gpu=\"1\",pid=\"4242\",name=\"train\\\\py\"} 1073741824\n"));
+    CHECK(contains(body, "nvwintop_process_gpu_utilization_percent{gpu=\"1\",pid=\"4242\",name=\"train\\\\py\"} 55\n"));
+    CHECK(contains(body, "nvwintop_sample_timestamp_seconds 1718000000.123\n"));
+
+    // Each family is declared once
+    size_t types = 0;
+    for (size_t at = body.find("# TYPE nvwintop_gpu_utilization_percent "); at != std::string::npos;
+         at = body.find("# TYPE nvwintop_gpu_utilization_percent ", at + 1)) {
+        ++types;
+    }
+    CHECK(types == 1);
+
+    CHECK(exporter.scrapeCount() == 2);
+    exporter.stop();
+}
+
+// Anything but /metrics is a 404 and not counted as a scrape
+NVWINTOP_TEST(metrics_exporter_not_found) {
+    MetricsExporter exporter;
+    if (!CHECK(exporter.start(0))) return;
+    exporter.onSnapshot(makeSnapshot());
+
+    CHECK(request(exporter.port(), "GET / HTTP/1.1").compare(0, 22, "HTTP/1.1 404 Not Found") == 0);
+    CHECK(request(exporter.port(), "GET /metricsfoo HTTP/1.1").compare(0, 22, "HTTP/1.1 404 Not Found") == 0);
+    CHECK(request(exporter.port(), "GET /metrics?x=1 HTTP/1.1").compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    CHECK(exporter.scrapeCount() == 1);
+
+    // A second exporter cannot take the same port; stop() releases it
+    const unsigned short port = exporter.port();
+    MetricsExporter other;
+    CHECK(!other.start(port));
+    exporter.stop();
+    CHECK(other.start(port));
+}
@@ -0,0 +1,116 @@
+#include "test.hpp"
+#include "history_workload.hpp"
+#include "metrics_history.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+namespace {
+
+constexpr long long START_MS = HISTORY_START_MS;
+
+struct Column {
+    std::vector<long long> timestamps;
+    std::vector<float> values;
+};
+
+Column readColumn(const HistoryTier& tier, Metric metric) {
+    Column column;
+    tier.decode(LLONG_MIN, tier.columnIndex(metric, Stat::Avg), &column.timestamps, column.values);
+    return column;
+}
+
+// GPU utilization of the capacity newest ticks before tick, oldest first
+Column expectedColumn(unsigned int tick, size_t capacity) {
+    Column column;
+    for (unsigned int i = tick > capacity ? tick - static_cast<unsigned int>(capacity) : 0; i < tick; ++i) {
+        column.timestamps.push_back(START_MS + static_cast<long long>(i) * 1000);
+        column.values.push_back(static_cast<float>(makeHistoryMetrics(i).gpuUtil));
+    }
+    return column;
+}
+
+bool sameColumn(const Column& a, const Column& b) {
+    return a.timestamps == b.timestamps && a.values == b.values;
+}
+
+// Best time of a few rounds of pushes, each taking a view as GpuMonitor::publish does
+double viewedPushNs(size_t capacity) {
+    TieredHistory history({ { 1000, capacity } });
+    unsigned int tick = 0;
+    while (tick < capacity + HistoryTier::BLOCK_SAMPLES) {
+        history.push(makeHistoryMetrics(tick), START_MS + static_cast<long long>(tick) * 1000);
+        ++tick;
+    }
+
+    constexpr int PUSHES = 2000;
+    double best = 0.0;
+    MetricsHistory view = history.view();
+    for (int round = 0; round < 5; ++round) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < PUSHES; ++i, ++tick) {
+            history.push(makeHistoryMetrics(tick), START_MS + static_cast<long long>(tick) * 1000);
+            view = history.view();
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / PUSHES;
+        if (round == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+}
+
+// A push while the previous view is held writes in place instead of copying
+// the tier, so it costs the same at any capacity
+NVWINTOP_TEST(metrics_history_viewed_push_cost) {
+    const double small = viewedPushNs(600);
+    const double large = viewedPushNs(86400);
+    if (!CHECK(large < 4.0 * small + 200.0)) {
+        fprintf(stderr, "  viewed push: %.0f ns at 600 samples, %.0f ns at 86400\n", small, large);
+    }
+}
+
+// Every view keeps showing what the history held when it was taken, while
+// the writer carries on in place, whether views are dropped right away, held
+// across a few pushes, or held for longer than the ring's slack
+NVWINTOP_TEST(metrics_history_views_stay_unchanged) {
+    for (bool compressed : { false, true }) {
+        constexpr size_t CAPACITY = 300;
+        TieredHistory history({ { 1000, CAPACITY, compressed } });
+        std::vector<std::pair<unsigned int, MetricsHistory>> recent, kept;
+        for (unsigned int tick = 1; tick <= 2000; ++tick) {
+            history.push(makeHistoryMetrics(tick - 1), START_MS + static_cast<long long>(tick - 1) * 1000);
+            const MetricsHistory view = history.view();
+            if (tick % 7 == 0) recent.push_back({ tick, view });
+            if (recent.size() > 3) recent.erase(recent.begin());
+            if (tick % 450 == 0) kept.push_back({ tick, view });
+        }
+        kept.insert(kept.end(), recent.begin(), recent.end());
+        for (const auto& [tick, view] : kept) {
+            if (!CHECK(sameColumn(readColumn(view.tier(0), Metric::GpuUtil), expectedColumn(tick, CAPACITY)))) {
+                fprintf(stderr, "  %s view taken after %u pushes\n", compressed ? "compressed" : "raw", tick);
+            }
+        }
+        CHECK(sameColumn(readColumn(history.view().tier(0), Metric::GpuUtil), expectedColumn(2000, CAPACITY)));
+    }
+}
+
+// Ticks faster than the raw resolution keep the slot's first sample and go
+// on into the fine tier
+NVWINTOP_TEST(metrics_history_fast_ticks) {
+    TieredHistory history({ { 1000, 60 } });
+    for (unsigned int i = 0; i < 40; ++i) {
+        history.push(makeHistoryMetrics(i), START_MS + static_cast<long long>(i) * 250);
+    }
+    const MetricsHistory view = history.view();
+    const Column raw = readColumn(view.tier(0), Metric::GpuUtil);
+    if (!CHECK(raw.timestamps.size() == 10)) return;
+    for (size_t s = 0; s < raw.timestamps.size(); ++s) {
+        CHECK(raw.timestamps[s] == START_MS + static_cast<long long>(s) * 1000);
+        CHECK(raw.values[s] == static_cast<float>(makeHistoryMetrics(static_cast<unsigned int>(s) * 4).gpuUtil));
+    }
+    if (!CHECK(view.fineTier() != nullptr)) return;
+    // It starts with the first tick that shares a slot
+    CHECK(view.fineTier()->size() == 39);
+    CHECK(view.fineTier()->latest(Metric::GpuUtil) == static_cast<float>(makeHistoryMetrics(39).gpuUtil));
+}
@@ -0,0 +1,253 @@
+#include "test.hpp"
+#include "gpu_monitor.hpp"
+#include "nvml_source.hpp"
+#include <nvml.h>
+#include <nvml_stub.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// Starts NvmlSource on one stub GPU with the given paths available, and puts
+// the stub back to its defaults afterwards
+class StubSource {
+public:
+    StubSource(bool samples, bool fields) {
+        nvmlStubSetDeviceCount(1);
+        nvmlStubSetSamplesSupported(samples);
+        nvmlStubSetFieldValuesSupported(fields);
+        m_initialized = m_source.initialize();
+    }
+
+    ~StubSource() {
+        if (m_initialized) m_source.shutdown();
+        nvmlStubSetDeviceCount(2);
+        nvmlStubSetSamplesSupported(1);
+        nvmlStubSetFieldValuesSupported(1);
+    }
+
+    bool initialized() const { return m_initialized && m_source.devices().size() == 1; }
+
+    // One tick, and the stub calls of each path it made
+    SampleStatus sample(GpuMetrics& metrics, std::vector<SubSample>& subSamples, unsigned long long (&calls)[NVML_STUB_CALL_COUNT]) {
+        unsigned long long before[NVML_STUB_CALL_COUNT];
+        for (int c = 0; c < NVML_STUB_CALL_COUNT; ++c) before[c] = nvmlStubCallCountOf(static_cast<nvmlStubCall_t>(c));
+
+        metrics = {};
+        std::vector<ProcessInfo> processes;
+        subSamples.clear();
+        const SampleStatus status = m_source.sampleDevice(0, metrics, processes);
+        if (status == SampleStatus::Ok) m_source.collectSubSamples(0, subSamples);
+
+        for (int c = 0; c < NVML_STUB_CALL_COUNT; ++c) {
+            calls[c] = nvmlStubCallCountOf(static_cast<nvmlStubCall_t>(c)) - before[c];
+        }
+        return status;
+    }
+
+    void collectEvents(std::vector<GpuEvent>& events) { m_source.collectEvents(0, events); }
+
+private:
+    NvmlSource m_source;
+    bool m_initialized = false;
+};
+
+// The stub's power curve runs from 40 W idle to 340 W at full load
+bool plausiblePower(double watts) {
+    return watts >= 40.0 && watts <= 340.0;
+}
+
+}
+
+// Utilization, power and SM clock all come from the sample ring, along with
+// every reading the driver took between ticks
+NVWINTOP_TEST(nvml_source_sample_ring) {
+    StubSource source(true, true);
+    if (!CHECK(source.initialized())) return;
+
+    // Let the stub's ring fill: power is sampled every 50 ms, utilization every 167 ms
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    GpuMetrics metrics;
+    std::vector<SubSample> subSamples;
+    unsigned long long calls[NVML_STUB_CALL_COUNT];
+    if (!CHECK(source.sample(metrics, subSamples, calls) == SampleStatus::Ok)) return;
+
+    CHECK(calls[NVML_STUB_CALL_SAMPLES] > 0);
+    CHECK(calls[NVML_STUB_CALL_FIELD_VALUES] == 0);
+    CHECK(calls[NVML_STUB_CALL_UTILIZATION] == 0);
+    CHECK(calls[NVML_STUB_CALL_POWER_USAGE] == 0);
+    CHECK(plausiblePower(metrics.powerUsage));
+    CHECK(metrics.coreClock >= 210);
+
+    size_t perMetric[4] = {};
+    long long newest[4] = {};
+    for (const SubSample& sample : subSamples) {
+        size_t slot = 4;
+        switch (sample.metric) {
+            case Metric::GpuUtil: slot = 0; break;
+            case Metric::MemUtil: slot = 1; break;
+            case Metric::PowerUsage: slot = 2; CHECK(plausiblePower(sample.value)); break;
+            case Metric::CoreClock: slot = 3; break;
+            default: break;
+        }
+        if (!CHECK(slot < 4)) continue;
+        ++perMetric[slot];
+        newest[slot] = std::max(newest[slot], sample.timestampMs);
+    }
+    for (size_t count : perMetric) CHECK(count > 0);
+    CHECK(perMetric[2] >= 5);  // Power at 20 Hz over half a second
+
+    // The next tick only hands over readings taken since this one
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    if (!CHECK(source.sample(metrics, subSamples, calls) == SampleStatus::Ok)) return;
+    CHECK(!subSamples.empty());
+    for (const SubSample& sample : subSamples) {
+        if (sample.metric == Metric::PowerUsage) CHECK(sample.timestampMs > newest[2]);
+        if (sample.metric == Metric::GpuUtil) CHECK(sample.timestampMs > newest[0]);
+    }
+}
+
+// Without the ring, power comes from one batched field read and the rest
+// from their dedicated calls
+NVWINTOP_TEST(nvml_source_batched_fields) {
+    StubSource source(false, true);
+    if (!CHECK(source.initialized())) return;
+
+    GpuMetrics metrics;
+    std::vector<SubSample> subSamples;
+    unsigned long long calls[NVML_STUB_CALL_COUNT];
+    for (int tick = 0; tick < 2; ++tick) {
+        if (!CHECK(source.sample(metrics, subSamples, calls) == SampleStatus::Ok)) return;
+        CHECK(subSamples.empty());
+        CHECK(calls[NVML_STUB_CALL_FIELD_VALUES] == 1);
+        CHECK(calls[NVML_STUB_CALL_POWER_USAGE] == 0);
+        CHECK(calls[NVML_STUB_CALL_UTILIZATION] == 1);
+        CHECK(plausiblePower(metrics.powerUsage));
+        CHECK(metrics.coreClock >= 210);
+    }
+    // An unsupported ring is learned on the first tick and not asked again
+    CHECK(calls[NVML_STUB_CALL_SAMPLES] == 0);
+}
+
+// With neither, every counter falls back to its dedicated call, and the
+// rejected field is not asked for again
+NVWINTOP_TEST(nvml_source_dedicated_calls) {
+    StubSource source(false, false);
+    if (!CHECK(source.initialized())) return;
+
+    GpuMetrics metrics;
+    std::vector<SubSample> subSamples;
+    unsigned long long calls[NVML_STUB_CALL_COUNT];
+    if (!CHECK(source.sample(metrics, subSamples, calls) == SampleStatus::Ok)) return;
+    CHECK(calls[NVML_STUB_CALL_FIELD_VALUES] == 1);
+    CHECK(calls[NVML_STUB_CALL_POWER_USAGE] == 1);
+
+    if (!CHECK(source.sample(metrics, subSamples, calls) == SampleStatus::Ok)) return;
+    CHECK(subSamples.empty());
+    CHECK(calls[NVML_STUB_CALL_SAMPLES] == 0);
+    CHECK(calls[NVML_STUB_CALL_FIELD_VALUES] == 0);
+    CHECK(calls[NVML_STUB_CALL_POWER_USAGE] == 1);
+    CHECK(calls[NVML_STUB_CALL_UTILIZATION] == 1);
+    CHECK(plausiblePower(metrics.powerUsage));
+    CHECK(metrics.gpuUtil <= 100);
+    CHECK(metrics.coreClock >= 210);
+}
+
+// XIDs and uncorrectable ECC errors come through the event set with the
+// device they happened on; single-bit ECC errors are not asked for
+NVWINTOP_TEST(nvml_source_events) {
+    nvmlStubSetDeviceCount(2);
+    NvmlSource source;
+    if (!CHECK(source.initialize())) return;
+    if (CHECK(source.openEvents())) {
+        std::vector<GpuEvent> events;
+        CHECK(nvmlStubInjectEvent(1, nvmlEventTypeXidCriticalError, 79) == 1);
+        source.waitEvents(1000, events);
+        if (CHECK(events.size() == 1)) {
+            CHECK(events[0].type == GpuEventType::Xid && events[0].data == 79);
+            CHECK(events[0].gpuIndex == 1 && events[0].uuid == source.devices()[1].uuid);
+        }
+
+        events.clear();
+        CHECK(nvmlStubInjectEvent(0, nvmlEventTypeDoubleBitEccError, 0) == 1);
+        source.waitEvents(1000, events);
+        CHECK(events.size() == 1 && events[0].type == GpuEventType::EccError && events[0].gpuIndex == 0);
+
+        events.clear();
+        CHECK(nvmlStubInjectEvent(0, nvmlEventTypeSingleBitEccError, 0) == 0);
+        source.waitEvents(50, events);
+        CHECK(events.empty());
+        source.closeEvents();
+    }
+    source.shutdown();
+
+    // Without event support the source says so, and the monitor falls back to polling alone
+    nvmlStubSetEventsSupported(0);
+    NvmlSource unsupported;
+    if (CHECK(unsupported.initialize())) {
+        CHECK(!unsupported.openEvents());
+        unsupported.shutdown();
+    }
+    nvmlStubSetEventsSupported(1);
+}
+
+// The stub's first GPU is at its power cap for the first 0.4 s; the
+// violation counters report that as throttling between two ticks
+NVWINTOP_TEST(nvml_source_throttling) {
+    StubSource source(true, true);
+    if (!CHECK(source.initialized())) return;
+
+    GpuMetrics metrics;
+    std::vector<SubSample> subSamples;
+    unsigned long long calls[NVML_STUB_CALL_COUNT];
+    std::vector<GpuEvent> events;
+    CHECK(source.sample(metrics, subSamples, calls) == SampleStatus::Ok);
+    source.collectEvents(events);  // The counters' starting point, nothing to compare yet
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    events.clear();
+    CHECK(source.sample(metrics, subSamples, calls) == SampleStatus::Ok);
+    source.collectEvents(events);
+
+    if (!CHECK(events.size() == 1)) return;
+    const GpuEvent& event = events[0];
+    CHECK(event.type == GpuEventType::Throttle);
+    CHECK((event.data & throttle_reason::SW_POWER_CAP) != 0);
+    CHECK(event.durationMs >= 100 && event.durationMs <= 400);
+    CHECK(event.lastMs - event.timestampMs == event.durationMs);
+}
+
+// An XID injected into the driver reaches the monitor's log through the event
+// thread without waiting for a tick, and the next snapshot carries it
+NVWINTOP_TEST(gpu_monitor_event_thread) {
+    nvmlStubSetDeviceCount(2);
+    nvmlStubSetXidPeriod(0);
+    auto monitor = std::make_unique<GpuMonitor>(std::make_unique<NvmlSource>());
+    if (!CHECK(monitor->initialize())) return;
+    monitor->update();
+
+    CHECK(nvmlStubInjectEvent(1, nvmlEventTypeXidCriticalError, 48) == 1);
+    bool logged = false;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!logged && std::chrono::steady_clock::now() < deadline) {
+        for (const GpuEvent& event : *monitor->eventLog().events()) {
+            logged = logged || (event.type == GpuEventType::Xid && event.data == 48 && event.gpuIndex == 1);
+        }
+        if (!logged) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(logged);
+
+    monitor->update();
+    bool published = false;
+    for (const GpuEvent& event : *monitor->getSnapshot()->events) {
+        published = published || (event.type == GpuEventType::Xid && event.data == 48);
+    }
+    CHECK(published);
+
+    // Stopping the event thread takes at most one wait
+    const auto stopStart = std::chrono::steady_clock::now();
+    monitor.reset();
+    CHECK(std::chrono::steady_clock::now() - stopStart <
+          std::chrono::milliseconds(GpuMonitor::EVENT_WAIT_MS + 250));
+}
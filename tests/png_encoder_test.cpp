@@ -0,0 +1,289 @@
+#include "test.hpp"
+#include "png_encoder.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace {
+
+constexpr uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+constexpr uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+constexpr uint16_t DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+constexpr uint8_t DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Reads a deflate stream a bit at a time, flagging reads past its end
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size), m_bit(0), m_overrun(false) {}
+
+    // Extra bits and header fields, least significant bit first
+    uint32_t bits(uint32_t count) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; ++i) value |= next() << i;
+        return value;
+    }
+
+    // Huffman codes, most significant bit first
+    uint32_t code(uint32_t value, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) value = (value << 1) | next();
+        return value;
+    }
+
+    size_t bytesUsed() const { return (m_bit + 7) / 8; }
+    bool overrun() const { return m_overrun; }
+
+private:
+    uint32_t next() {
+        if (m_bit >= m_size * 8) {
+            m_overrun = true;
+            return 0;
+        }
+        const uint32_t bit = (m_data[m_bit / 8] >> (m_bit % 8)) & 1;
+        ++m_bit;
+        return bit;
+    }
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_bit;
+    bool m_overrun;
+};
+
+// Literal/length symbol under the fixed codes of RFC 1951, 3.2.6
+uint32_t fixedSymbol(BitReader& reader) {
+    uint32_t code = reader.code(0, 7);
+    if (code <= 23) return 256 + code;
+    code = reader.code(code, 1);
+    if (code >= 48 && code <= 191) return code - 48;
+    if (code >= 192 && code <= 199) return 280 + code - 192;
+    return 144 + reader.code(code, 1) - 400;
+}
+
+// Inflates a stream of fixed Huffman blocks, the only kind the encoder
+// writes; sets used to the bytes the stream took
+bool inflateFixed(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t& used) {
+    BitReader reader(data, size);
+    for (bool final = false; !final;) {
+        final = reader.bits(1) != 0;
+        if (reader.bits(2) != 1) return false;
+        for (;;) {
+            const uint32_t symbol = fixedSymbol(reader);
+            if (reader.overrun() || symbol > 285) return false;
+            if (symbol < 256) {
+                out.push_back(static_cast<uint8_t>(symbol));
+                continue;
+            }
+            if (symbol == 256) break;
+
+            const size_t length = LENGTH_BASE[symbol - 257] + reader.bits(LENGTH_EXTRA[symbol - 257]);
+            const uint32_t distanceSymbol = reader.code(0, 5);
+            if (distanceSymbol >= 30) return false;
+            const size_t distance = DISTANCE_BASE[distanceSymbol] + reader.bits(DISTANCE_EXTRA[distanceSymbol]);
+            if (reader.overrun() || distance > out.size()) return false;
+            // Byte by byte, as a match may overlap what it copies
+            for (size_t i = 0; i < length; ++i) out.push_back(out[out.size() - distance]);
+        }
+    }
+    used = reader.bytesUsed();
+    return !reader.overrun();
+}
+
+// Straight from the definitions, to check the encoder's table and blocked forms
+uint32_t slowCrc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320u : 0);
+    }
+    return ~crc;
+}
+
+uint32_t slowAdler32(const std::vector<uint8_t>& data) {
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : data) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t readBigEndian(const uint8_t* data) {
+    return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+}
+
+// Decodes what encodePng writes back to pixels, checking every chunk's CRC
+// and the zlib checksum on the way; why says what was wrong
+bool decodePng(const std::vector<uint8_t>& png, size_t width, size_t height, std::vector<uint32_t>& pixels,
+               const char*& why) {
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    why = "signature";
+    if (png.size() < 8 || memcmp(png.data(), SIGNATURE, 8) != 0) return false;
+
+    std::vector<uint8_t> header, idat;
+    bool ended = false;
+    for (size_t pos = 8; pos < png.size();) {
+        why = "chunk runs past the file";
+        if (ended || png.size() - pos < 12) return false;
+        const size_t length = readBigEndian(&png[pos]);
+        if (png.size() - pos - 12 < length) return false;
+        why = "chunk CRC";
+        if (readBigEndian(&png[pos + 8 + length]) != slowCrc32(&png[pos + 4], length + 4)) return false;
+
+        const uint8_t* type = &png[pos + 4];
+        const uint8_t* data = &png[pos + 8];
+        if (memcmp(type, "IHDR", 4) == 0) header.assign(data, data + length);
+        if (memcmp(type, "IDAT", 4) == 0) idat.insert(idat.end(), data, data + length);
+        if (memcmp(type, "IEND", 4) == 0) ended = true;
+        pos += 12 + length;
+    }
+    why = "IEND";
+    if (!ended) return false;
+
+    // 8-bit RGB, deflate, no filtering, not interlaced
+    why = "IHDR";
+    const uint8_t fields[5] = { 8, 2, 0, 0, 0 };
+    if (header.size() != 13 || readBigEndian(&header[0]) != width || readBigEndian(&header[4]) != height ||
+        memcmp(&header[8], fields, 5) != 0) {
+        return false;
+    }
+
+    why = "zlib header";
+    if (idat.size() < 6 || (idat[0] & 0x0f) != 8 || (idat[0] >> 4) > 7 || (idat[0] * 256 + idat[1]) % 31 != 0 ||
+        (idat[1] & 0x20) != 0) {
+        return false;
+    }
+    std::vector<uint8_t> scanlines;
+    size_t used = 0;
+    why = "deflate stream";
+    if (!inflateFixed(&idat[2], idat.size() - 6, scanlines, used)) return false;
+    why = "data after the Adler-32";
+    if (2 + used + 4 != idat.size()) return false;
+    why = "Adler-32";
+    if (readBigEndian(&idat[2 + used]) != slowAdler32(scanlines)) return false;
+
+    why = "scanline size";
+    const size_t rowBytes = 1 + width * 3;
+    if (scanlines.size() != rowBytes * height) return false;
+    pixels.clear();
+    for (size_t y = 0; y < height; ++y) {
+        const uint8_t* row = &scanlines[y * rowBytes];
+        why = "filter type";
+        if (row[0] != 0) return false;
+        for (size_t x = 0; x < width; ++x) {
+            const uint8_t* rgb = row + 1 + x * 3;
+            pixels.push_back((uint32_t(rgb[0]) << 16) | (uint32_t(rgb[1]) << 8) | rgb[2]);
+        }
+    }
+    return true;
+}
+
+struct Image {
+    const char* name;
+    size_t width;
+    size_t height;
+    std::vector<uint32_t> pixels;
+};
+
+Image flat(const char* name, size_t width, size_t height, uint32_t color) {
+    return { name, width, height, std::vector<uint32_t>(width * height, color) };
+}
+
+// Panels, bars and text-like specks on a dark background, as the dashboard draws
+Image dashboard(size_t width, size_t height) {
+    Image image = flat("dashboard", width, height, 0x202428);
+    std::mt19937 random(7);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            uint32_t& pixel = image.pixels[y * width + x];
+            if (y % 40 == 0 || x % 100 == 0) pixel = 0x3c4046;
+            if (y % 40 > 10 && y % 40 < 30 && x % 100 < (y / 40 * 17) % 100) pixel = 0x76b900;
+            if (y % 40 < 8 && x % 100 > 4 && x % 100 < 60 && random() % 3 == 0) pixel = 0xe0e0e0;
+        }
+    }
+    return image;
+}
+
+Image noise(size_t width, size_t height) {
+    Image image = flat("noise", width, height, 0);
+    std::mt19937 random(11);
+    for (uint32_t& pixel : image.pixels) pixel = random() & 0xffffff;
+    return image;
+}
+
+// Repeats of 1 to 300 pixels with a few unique bytes between them, so
+// matches end on and off every length code boundary
+Image runs(size_t width) {
+    Image image = flat("runs", width, 1, 0);
+    size_t x = 0;
+    for (uint32_t run = 1; x < width; ++run) {
+        for (uint32_t i = 0; i < run % 301 && x < width; ++i) image.pixels[x++] = 0x101010 * (run % 7);
+        if (x < width) image.pixels[x++] = run * 2654435761u & 0xffffff;
+    }
+    return image;
+}
+
+// Rows repeated under a row of noise, far enough apart for distances with
+// every number of extra bits, or past the window so no row match is used
+Image repeatedRows(const char* name, size_t width, size_t height) {
+    Image image = noise(width, height);
+    image.name = name;
+    for (size_t y = 1; y < height; ++y) {
+        std::copy(image.pixels.begin(), image.pixels.begin() + width, image.pixels.begin() + y * width);
+        image.pixels[y * width + y % width] ^= 0xffffff;
+    }
+    return image;
+}
+
+}
+
+// Images of every shape the encoder special-cases decode back to the pixels
+// they came from, through an independent inflate and checksums
+NVWINTOP_TEST(png_encoder_round_trip) {
+    std::vector<Image> images;
+    images.push_back(flat("single pixel", 1, 1, 0x123456));
+    images.push_back(flat("flat", 64, 64, 0x76b900));
+    images.push_back(flat("flat odd", 97, 13, 0x000000));
+    images.push_back(dashboard(640, 360));
+    images.push_back(noise(31, 17));
+    images.push_back(runs(20000));
+    for (size_t width : { 1, 2, 5, 8, 21, 85, 170, 682, 2730, 5461 }) {
+        images.push_back(repeatedRows("repeated rows", width, 4));
+    }
+    // Rows of 32767 bytes, the longest distance, and of 33001, past the window
+    images.push_back(repeatedRows("longest row distance", 10922, 3));
+    images.push_back(repeatedRows("rows past the window", 11000, 3));
+
+    for (const Image& image : images) {
+        std::vector<uint8_t> png;
+        encodePng(image.pixels.data(), image.width, image.height, png);
+        std::vector<uint32_t> decoded;
+        const char* why = "";
+        if (!CHECK(decodePng(png, image.width, image.height, decoded, why))) {
+            fprintf(stderr, "  %s %zux%zu: %s\n", image.name, image.width, image.height, why);
+            continue;
+        }
+        if (!CHECK(decoded == image.pixels)) {
+            fprintf(stderr, "  %s %zux%zu: pixels differ\n", image.name, image.width, image.height);
+        }
+    }
+}
+
+// A flat image is mostly matches of the row above or the previous pixel, so
+// it takes under 1% of its raw scanlines
+NVWINTOP_TEST(png_encoder_flat_compresses) {
+    const Image image = flat("flat", 1024, 768, 0x202428);
+    std::vector<uint8_t> png;
+    encodePng(image.pixels.data(), image.width, image.height, png);
+    const size_t raw = (1 + image.width * 3) * image.height;
+    if (!CHECK(png.size() < raw / 100)) fprintf(stderr, "  %zu bytes from %zu\n", png.size(), raw);
+}
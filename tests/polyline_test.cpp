@@ -0,0 +1,79 @@
+#include "test.hpp"
+#include "polyline_series.hpp"
+#include <cmath>
+
+namespace {
+
+bool samePoints(const std::vector<DlPoint>& a, const std::vector<DlPoint>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].x != b[i].x || a[i].y != b[i].y) return false;
+    }
+    return true;
+}
+
+// Both NaN, or bit-for-bit the same value
+bool sameFloat(float a, float b) {
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+}
+
+// Every vector path this CPU runs must match the scalar one exactly, for
+// lengths that end on and off a vector boundary
+NVWINTOP_TEST(polyline_matches_scalar) {
+    std::vector<PolylineIsa> isas;
+    if (detectPolylineIsa() != PolylineIsa::Scalar) isas.push_back(PolylineIsa::Sse2);
+    if (detectPolylineIsa() == PolylineIsa::Avx2) isas.push_back(PolylineIsa::Avx2);
+    if (isas.empty()) printf("polyline_matches_scalar: no vector instruction set, nothing to compare\n");
+
+    for (size_t count : { 1, 3, 4, 7, 8, 9, 17, 1200, 100003 }) {
+        const PolylineSeries series = makePolylineSeries(count);
+        std::vector<float> scalarXs(count), scalarYs(count);
+        PolylineBuilder::map(PolylineIsa::Scalar, series.times.data(), series.values.data(), count, series.transform,
+                             scalarXs.data(), scalarYs.data());
+        PolylineBuilder scalar(PolylineIsa::Scalar);
+        const std::vector<DlPoint> scalarLine =
+            scalar.build(series.times.data(), series.values.data(), count, series.transform);
+        const std::vector<DlPoint> scalarSpread = scalar.buildSpread(series.times.data(), series.values.data(),
+                                                                     series.highs.data(), count, series.transform);
+        CHECK(!scalarLine.empty());
+
+        for (PolylineIsa isa : isas) {
+            std::vector<float> xs(count), ys(count);
+            PolylineBuilder::map(isa, series.times.data(), series.values.data(), count, series.transform,
+                                 xs.data(), ys.data());
+            size_t mismatched = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if (!sameFloat(xs[i], scalarXs[i]) || !sameFloat(ys[i], scalarYs[i])) ++mismatched;
+            }
+            if (!CHECK(mismatched == 0)) {
+                fprintf(stderr, "  %s, %zu samples: %zu mapped points differ\n", polylineIsaName(isa), count, mismatched);
+            }
+
+            PolylineBuilder builder(isa);
+            if (!CHECK(samePoints(builder.build(series.times.data(), series.values.data(), count, series.transform),
+                                  scalarLine))) {
+                fprintf(stderr, "  %s, %zu samples: decimated line differs\n", polylineIsaName(isa), count);
+            }
+            if (!CHECK(samePoints(builder.buildSpread(series.times.data(), series.values.data(), series.highs.data(),
+                                                      count, series.transform), scalarSpread))) {
+                fprintf(stderr, "  %s, %zu samples: spread differs\n", polylineIsaName(isa), count);
+            }
+        }
+    }
+}
+
+// At most two points per pixel column, inside the graph and clamped to its range
+NVWINTOP_TEST(polyline_decimation) {
+    const PolylineSeries series = makePolylineSeries(100003);
+    PolylineBuilder builder(PolylineIsa::Scalar);
+    const std::vector<DlPoint>& points =
+        builder.build(series.times.data(), series.values.data(), series.values.size(), series.transform);
+    CHECK(points.size() <= 2 * (static_cast<size_t>(PolylineSeries::GRAPH_WIDTH) + 2));
+    const float top = series.transform.yOrigin - series.transform.valueMax * series.transform.yScale;
+    for (const DlPoint& point : points) {
+        CHECK(point.x >= series.transform.xOrigin && point.x <= series.transform.xOrigin + PolylineSeries::GRAPH_WIDTH + 1.0f);
+        CHECK(point.y >= top && point.y <= series.transform.yOrigin);
+    }
+}
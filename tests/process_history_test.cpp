@@ -0,0 +1,168 @@
+#include "test.hpp"
+#include "gpu_monitor.hpp"
+#include "process_history.hpp"
+#include "process_workload.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace {
+
+constexpr long long START_MS = ProcessWorkload::START_MS;
+constexpr long long TICK_MS = ProcessWorkload::TICK_MS;
+
+struct KeyLess {
+    bool operator()(const ProcessKey& a, const ProcessKey& b) const {
+        if (a.gpuIndex != b.gpuIndex) return a.gpuIndex < b.gpuIndex;
+        if (a.pid != b.pid) return a.pid < b.pid;
+        return a.startTime < b.startTime;
+    }
+};
+
+// Everything a process reported, for recomputing the rankings from scratch
+struct Shadow {
+    std::vector<long long> timestamps;
+    std::vector<unsigned long long> memory;
+    std::vector<unsigned int> util;
+    long long lastSeenMs = 0;
+    unsigned long long serial = 0;
+};
+
+struct Expected {
+    ProcessKey key;
+    unsigned long long serial;
+    unsigned long long peak;
+    double avgUtil;
+};
+
+// Recomputes each process's score from the samples in its newest CAPACITY slots
+std::vector<Expected> expectedScores(const std::map<ProcessKey, Shadow, KeyLess>& shadows) {
+    std::vector<Expected> expected;
+    for (const auto& [key, shadow] : shadows) {
+        const long long newestSlot = shadow.timestamps.back() - shadow.timestamps.back() % ProcessHistory::RESOLUTION_MS;
+        const long long firstSlot = newestSlot - (static_cast<long long>(ProcessHistory::CAPACITY) - 1) * ProcessHistory::RESOLUTION_MS;
+        unsigned long long peak = 0, utilSum = 0, samples = 0;
+        for (size_t s = 0; s < shadow.timestamps.size(); ++s) {
+            if (shadow.timestamps[s] < firstSlot) continue;
+            peak = std::max(peak, shadow.memory[s]);
+            utilSum += shadow.util[s];
+            ++samples;
+        }
+        expected.push_back({ key, shadow.serial, peak, static_cast<double>(utilSum) / samples });
+    }
+    return expected;
+}
+
+ProcessInfo makeProcess(unsigned int gpu, unsigned int pid, unsigned long long startTime,
+                        unsigned long long memoryUsed, unsigned int gpuUtil) {
+    ProcessInfo process = {};
+    process.gpuIndex = gpu;
+    process.pid = pid;
+    process.startTime = startTime;
+    process.memoryUsed = memoryUsed;
+    process.gpuUtil = gpuUtil;
+    return process;
+}
+
+}
+
+// Three simulated hours of churn against a brute-force model: peaks and
+// averages over the retained hour, eviction of exited processes, and the
+// incremental top-N against a full sort
+NVWINTOP_TEST(process_history_rankings) {
+    constexpr size_t TOP = 20;
+    ProcessHistory history;
+    history.setTopCount(TOP);
+    ProcessWorkload workload(120, 20 * 60 * 1000, 7);
+    std::map<ProcessKey, Shadow, KeyLess> shadows;
+    unsigned long long serial = 0;
+
+    for (long long tick = 0; tick < 3 * 3600; ++tick) {
+        const long long nowMs = START_MS + tick * TICK_MS;
+        const std::vector<ProcessInfo>& processes = workload.tick(nowMs);
+        history.update(processes, nowMs);
+        for (const ProcessInfo& process : processes) {
+            auto inserted = shadows.emplace(ProcessKey{ process.gpuIndex, process.pid, process.startTime }, Shadow());
+            Shadow& shadow = inserted.first->second;
+            if (inserted.second) shadow.serial = serial++;
+            shadow.timestamps.push_back(nowMs);
+            shadow.memory.push_back(process.memoryUsed);
+            shadow.util.push_back(process.gpuUtil);
+            shadow.lastSeenMs = nowMs;
+        }
+        for (auto it = shadows.begin(); it != shadows.end();) {
+            if (nowMs - it->second.lastSeenMs >= ProcessHistory::EXITED_RETENTION_MS) {
+                it = shadows.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (tick % 60 != 59) continue;
+
+        std::vector<Expected> expected = expectedScores(shadows);
+        if (!CHECK(expected.size() == history.size())) return;
+
+        std::vector<ProcessUsage> rows;
+        history.top(ProcessRanking::PeakMemory, TOP, rows);
+        std::sort(expected.begin(), expected.end(), [](const Expected& a, const Expected& b) {
+            return a.peak != b.peak ? a.peak > b.peak : a.serial < b.serial;
+        });
+        if (!CHECK(rows.size() == std::min(TOP, expected.size()))) return;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (!CHECK(rows[i].key == expected[i].key && rows[i].peakMemory == expected[i].peak)) {
+                fprintf(stderr, "  peak memory row %zu at tick %lld\n", i, tick);
+                return;
+            }
+        }
+
+        history.top(ProcessRanking::AvgUtil, TOP, rows);
+        std::sort(expected.begin(), expected.end(), [](const Expected& a, const Expected& b) {
+            return a.avgUtil != b.avgUtil ? a.avgUtil > b.avgUtil : a.serial < b.serial;
+        });
+        if (!CHECK(rows.size() == std::min(TOP, expected.size()))) return;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (!CHECK(std::abs(rows[i].avgUtil - expected[i].avgUtil) <= 1e-3)) {
+                fprintf(stderr, "  average utilization row %zu at tick %lld\n", i, tick);
+                return;
+            }
+        }
+
+        // A long-lived process holds at most an hour of buckets
+        std::vector<ProcessBucket> buckets;
+        for (const ProcessUsage& row : rows) {
+            CHECK(history.series(row.key, buckets));
+            CHECK(!buckets.empty() && buckets.size() <= ProcessHistory::CAPACITY);
+        }
+    }
+}
+
+// A reused pid is a new run; an exited run stays for EXITED_RETENTION_MS and
+// is then evicted, and beyond MAX_PROCESSES the least recently seen go first
+NVWINTOP_TEST(process_history_eviction) {
+    ProcessHistory history;
+    history.update({ makeProcess(0, 42, 1000, 1ULL << 30, 80) }, START_MS);
+    history.update({ makeProcess(0, 42, 2000, 2ULL << 30, 10) }, START_MS + TICK_MS);
+    CHECK(history.size() == 2);
+
+    std::vector<ProcessUsage> rows;
+    history.top(ProcessRanking::PeakMemory, 2, rows);
+    if (CHECK(rows.size() == 2)) {
+        CHECK(rows[0].key.startTime == 2000 && rows[0].running);
+        CHECK(rows[1].key.startTime == 1000 && !rows[1].running);
+        CHECK(rows[1].lastSeenMs == START_MS);
+    }
+
+    history.update({ makeProcess(0, 42, 2000, 2ULL << 30, 10) }, START_MS + ProcessHistory::EXITED_RETENTION_MS - TICK_MS);
+    CHECK(history.size() == 2);
+    history.update({ makeProcess(0, 42, 2000, 2ULL << 30, 10) }, START_MS + ProcessHistory::EXITED_RETENTION_MS);
+    CHECK(history.size() == 1);
+    std::vector<ProcessBucket> buckets;
+    CHECK(!history.series(ProcessKey{ 0, 42, 1000 }, buckets));
+    CHECK(history.series(ProcessKey{ 0, 42, 2000 }, buckets));
+
+    history.clear();
+    CHECK(history.size() == 0);
+    ProcessWorkload crowd(ProcessHistory::MAX_PROCESSES + 500, 3600 * 1000, 9);
+    history.update(crowd.tick(START_MS), START_MS);
+    CHECK(history.size() == ProcessHistory::MAX_PROCESSES);
+}
@@ -0,0 +1,63 @@
+#include "test.hpp"
+#include "instrumentation.hpp"
+#include "process_names.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+unsigned int currentPid() {
+#ifdef _WIN32
+    return static_cast<unsigned int>(GetCurrentProcessId());
+#else
+    return static_cast<unsigned int>(getpid());
+#endif
+}
+
+unsigned long long startTimeQueries() {
+    return probeHistogram(Probe::ProcessStartTime).count();
+}
+
+}
+
+// A pid present tick after tick is resolved once; the OS is asked again only
+// when it comes back after missing a tick
+NVWINTOP_TEST(process_names_steady_pid) {
+    ProcessNameCache cache;
+    const unsigned int pid = currentPid();
+
+    unsigned long long startTime = 0;
+    const std::wstring name = cache.lookup(pid, startTime);
+    CHECK(!name.empty());
+    CHECK(startTime != 0);
+    cache.endTick();
+
+    const unsigned long long queries = startTimeQueries();
+    for (int tick = 0; tick < 5; ++tick) {
+        unsigned long long again = 0;
+        CHECK(cache.lookup(pid, again) == name);
+        CHECK(again == startTime);
+        cache.endTick();
+    }
+    if (NVWINTOP_INSTRUMENTATION) CHECK(startTimeQueries() == queries);
+
+    // Gone for a tick: the start time is checked, and the name kept as it matches
+    cache.endTick();
+    unsigned long long returned = 0;
+    CHECK(cache.lookup(pid, returned) == name);
+    CHECK(returned == startTime);
+    if (NVWINTOP_INSTRUMENTATION) CHECK(startTimeQueries() == queries + 1);
+    CHECK(cache.size() == 1);
+}
+
+// Entries unused for MAX_IDLE_TICKS are dropped
+NVWINTOP_TEST(process_names_eviction) {
+    ProcessNameCache cache;
+    unsigned long long startTime = 0;
+    cache.lookup(currentPid(), startTime);
+    for (unsigned int tick = 0; tick <= ProcessNameCache::MAX_IDLE_TICKS; ++tick) cache.endTick();
+    CHECK(cache.size() == 0);
+}
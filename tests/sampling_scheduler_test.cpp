@@ -0,0 +1,189 @@
+#include "test.hpp"
+#include "gpu_monitor.hpp"
+#include "sampling_scheduler.hpp"
+#include <cmath>
+
+namespace {
+
+// A quiet device well below every threshold
+GpuMetrics quietGpu(unsigned int index) {
+    GpuMetrics gpu = {};
+    gpu.index = index;
+    gpu.gpuUtil = 40;
+    gpu.memUtil = 20;
+    gpu.temperature = 60;
+    gpu.powerUsage = 150.0;
+    gpu.powerLimit = 300;
+    gpu.totalMemory = 24ULL << 30;
+    gpu.usedMemory = 6ULL << 30;
+    return gpu;
+}
+
+// Feeds a scheduler snapshots spaced by the interval it asked for, as the
+// sampling thread does
+class Ticker {
+public:
+    explicit Ticker(size_t devices) : m_timestampMs(1700000000000LL) {
+        for (size_t i = 0; i < devices; ++i) metrics.push_back(quietGpu(static_cast<unsigned int>(i)));
+    }
+
+    unsigned int tick() {
+        GpuSnapshot snapshot;
+        snapshot.metrics = metrics;
+        snapshot.timestampMs = m_timestampMs;
+        const unsigned int interval = scheduler.next(snapshot);
+        m_timestampMs += interval;
+        return interval;
+    }
+
+    SamplingScheduler scheduler;
+    std::vector<GpuMetrics> metrics;
+
+private:
+    long long m_timestampMs;
+};
+
+// Ticks with nothing changing, returning the intervals picked
+std::vector<unsigned int> steadyTicks(Ticker& ticker, size_t count) {
+    std::vector<unsigned int> intervals;
+    for (size_t i = 0; i < count; ++i) intervals.push_back(ticker.tick());
+    return intervals;
+}
+
+}
+
+// Any metric moving fast, on any device, drops straight to the minimum interval
+NVWINTOP_TEST(sampling_scheduler_fast_change) {
+    const SchedulerConfig config;
+    using Change = void (*)(GpuMetrics&);
+    const Change changes[] = {
+        [](GpuMetrics& gpu) { gpu.gpuUtil += 30; },
+        [](GpuMetrics& gpu) { gpu.memUtil += 30; },
+        [](GpuMetrics& gpu) { gpu.powerUsage += 90.0; },
+        [](GpuMetrics& gpu) { gpu.usedMemory += 8ULL << 30; },
+        [](GpuMetrics& gpu) { gpu.temperature += 10; },
+    };
+    for (size_t c = 0; c < sizeof(changes) / sizeof(changes[0]); ++c) {
+        Ticker ticker(2);
+        if (!CHECK(ticker.tick() == config.baseIntervalMs)) return;
+
+        // Over a second, on the second device only, and below every threshold
+        changes[c](ticker.metrics[1]);
+        if (!CHECK(ticker.tick() == config.minIntervalMs)) fprintf(stderr, "  change %zu\n", c);
+    }
+
+    // Just under the fast rate from the base interval is not enough
+    Ticker ticker(1);
+    ticker.tick();
+    ticker.metrics[0].gpuUtil += static_cast<unsigned int>(config.fastRate * config.baseIntervalMs / 1000) - 1;
+    CHECK(ticker.tick() == config.baseIntervalMs);
+}
+
+// Crossing a threshold in either direction is enough on its own, even when
+// the metric barely moved
+NVWINTOP_TEST(sampling_scheduler_threshold_crossing) {
+    const SchedulerConfig config;
+    using Crossing = void (*)(GpuMetrics&, bool);
+    const Crossing crossings[] = {
+        [](GpuMetrics& gpu, bool up) { gpu.gpuUtil = up ? 80 : 79; },
+        [](GpuMetrics& gpu, bool up) { gpu.temperature = up ? 80 : 79; },
+        [](GpuMetrics& gpu, bool up) { gpu.powerUsage = up ? 270.0 : 269.0; },
+    };
+    for (size_t c = 0; c < sizeof(crossings) / sizeof(crossings[0]); ++c) {
+        Ticker ticker(1);
+        crossings[c](ticker.metrics[0], false);
+        ticker.tick();
+        steadyTicks(ticker, 4);
+        if (!CHECK(ticker.scheduler.interval() == config.maxIntervalMs)) return;
+
+        crossings[c](ticker.metrics[0], true);
+        if (!CHECK(ticker.tick() == config.minIntervalMs)) fprintf(stderr, "  crossing %zu up\n", c);
+        steadyTicks(ticker, 4);
+        crossings[c](ticker.metrics[0], false);
+        if (!CHECK(ticker.tick() == config.minIntervalMs)) fprintf(stderr, "  crossing %zu down\n", c);
+
+        // Staying above the threshold is not a crossing
+        crossings[c](ticker.metrics[0], true);
+        ticker.tick();
+        CHECK(ticker.tick() == 2 * config.minIntervalMs);
+    }
+}
+
+// Steady ticks double the interval up to the maximum and stay there, while
+// ticks between the steady and fast rates only climb back to the base
+NVWINTOP_TEST(sampling_scheduler_backoff) {
+    const SchedulerConfig config;
+    Ticker ticker(1);
+    CHECK(ticker.tick() == config.baseIntervalMs);
+    CHECK(steadyTicks(ticker, 5) == std::vector<unsigned int>({ 2000, 4000, 5000, 5000, 5000 }));
+
+    // Crossing the utilization threshold, then steady from the minimum
+    ticker.metrics[0].gpuUtil = 90;
+    CHECK(ticker.tick() == config.minIntervalMs);
+    CHECK(steadyTicks(ticker, 7) == std::vector<unsigned int>({ 200, 400, 800, 1600, 3200, 5000, 5000 }));
+
+    // 10 points a second, each tick moving by the time since the last one
+    ticker.metrics[0].gpuUtil = 20;
+    unsigned int interval = ticker.tick();
+    CHECK(interval == config.minIntervalMs);
+    std::vector<unsigned int> intervals;
+    for (int i = 0; i < 6; ++i) {
+        ticker.metrics[0].gpuUtil += static_cast<unsigned int>(std::lround(10.0 * interval / 1000.0));
+        interval = ticker.tick();
+        intervals.push_back(interval);
+    }
+    CHECK(intervals == std::vector<unsigned int>({ 200, 400, 800, 1000, 1000, 1000 }));
+}
+
+// Hidden, the interval is never below the base, but the scheduler keeps
+// tracking the load underneath and picks up from it once shown again
+NVWINTOP_TEST(sampling_scheduler_hidden) {
+    const SchedulerConfig config;
+    Ticker ticker(1);
+    ticker.tick();
+    ticker.scheduler.setVisible(false);
+
+    ticker.metrics[0].gpuUtil = 90;
+    CHECK(ticker.tick() == config.baseIntervalMs);
+    CHECK(ticker.scheduler.interval() == config.baseIntervalMs);
+    // Doubling from the minimum underneath: 200, 400 and 800 all clamp to the base
+    CHECK(steadyTicks(ticker, 5) == std::vector<unsigned int>({ 1000, 1000, 1000, 1600, 3200 }));
+
+    // Slower than the base is left alone
+    CHECK(ticker.tick() == config.maxIntervalMs);
+
+    ticker.metrics[0].gpuUtil = 40;
+    CHECK(ticker.tick() == config.baseIntervalMs);
+    ticker.scheduler.setVisible(true);
+    CHECK(ticker.tick() == 2 * config.minIntervalMs);
+    CHECK(ticker.scheduler.interval() == 2 * config.minIntervalMs);
+}
+
+// A snapshot with a different number of devices, like the first one or one
+// that does not move forward in time, has nothing to compare against and
+// starts over from the base interval
+NVWINTOP_TEST(sampling_scheduler_device_change) {
+    const SchedulerConfig config;
+    Ticker ticker(2);
+    CHECK(ticker.tick() == config.baseIntervalMs);
+    steadyTicks(ticker, 4);
+    if (!CHECK(ticker.scheduler.interval() == config.maxIntervalMs)) return;
+
+    ticker.metrics.push_back(quietGpu(2));
+    ticker.metrics.push_back(quietGpu(3));
+    ticker.metrics[3].gpuUtil = 100;
+    CHECK(ticker.tick() == config.baseIntervalMs);
+    CHECK(ticker.tick() == 2 * config.baseIntervalMs);
+
+    ticker.metrics.pop_back();
+    ticker.metrics[0].temperature = 95;
+    CHECK(ticker.tick() == config.baseIntervalMs);
+
+    // A snapshot from before the last one, then the same one again
+    ticker.metrics[0].gpuUtil = 100;
+    GpuSnapshot snapshot;
+    snapshot.metrics = ticker.metrics;
+    snapshot.timestampMs = 1700000000000LL;
+    CHECK(ticker.scheduler.next(snapshot) == config.baseIntervalMs);
+    CHECK(ticker.scheduler.next(snapshot) == config.baseIntervalMs);
+}
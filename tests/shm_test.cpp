@@ -0,0 +1,267 @@
+#include "test.hpp"
+#include "gpu_monitor.hpp"
+#include "shm_publisher.hpp"
+#include "shm_reader.hpp"
+#include "synthetic_source.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::string segmentName() {
+    return "nvwintop_test_" + std::to_string(getpid());
+}
+
+// What ShmPublisher stores for a name: printable ASCII, anything else as '?'
+std::string ascii(const std::wstring& text) {
+    std::string out;
+    for (wchar_t c : text) out += (c >= 0x20 && c < 0x7f) ? static_cast<char>(c) : '?';
+    return out;
+}
+
+std::shared_ptr<const GpuSnapshot> syntheticSnapshot(unsigned int gpus, unsigned int ticks) {
+    SyntheticConfig config;
+    config.deviceCount = gpus;
+    config.stepMs = GpuMonitor::DEFAULT_INTERVAL_MS;
+    GpuMonitor monitor(std::make_unique<SyntheticSource>(config));
+    if (!monitor.initialize()) return nullptr;
+    for (unsigned int i = 0; i < ticks; ++i) monitor.update();
+    return monitor.getSnapshot();
+}
+
+// Snapshot in which every published number is tag, so a read that mixes two is easy to spot
+GpuSnapshot taggedSnapshot(unsigned int tag, unsigned int gpus, unsigned int processes, size_t historySize) {
+    GpuSnapshot snapshot;
+    snapshot.timestampMs = tag;
+
+    GpuMetrics metrics = {};
+    metrics.uuid = "GPU-" + std::to_string(tag);
+    metrics.name = L"Tagged GPU";
+    metrics.gpuUtil = metrics.memUtil = metrics.temperature = metrics.fanSpeed = tag;
+    metrics.powerLimit = metrics.coreClock = metrics.memClock = tag;
+    metrics.powerUsage = tag;
+    metrics.totalMemory = metrics.usedMemory = tag;
+
+    TieredHistory history({ { 1000, historySize } });
+    for (size_t i = 0; i < historySize; ++i) {
+        history.push(metrics, static_cast<long long>(tag) * 1000000 + static_cast<long long>(i) * 1000);
+    }
+    for (unsigned int g = 0; g < gpus; ++g) {
+        metrics.index = g;
+        snapshot.metrics.push_back(metrics);
+        snapshot.history.push_back(history.view());
+    }
+    for (unsigned int p = 0; p < processes; ++p) {
+        snapshot.processes.push_back({ p % gpus, tag, L"tagged", tag, tag });
+    }
+    return snapshot;
+}
+
+// True if everything read carries the tag of the snapshot's timestamp
+bool untorn(const ShmSnapshot& out, size_t gpus, size_t processes) {
+    const uint64_t tag = static_cast<uint64_t>(out.timestampMs);
+    if (out.gpus.size() != gpus || out.processes.size() != processes) return false;
+    for (size_t g = 0; g < out.gpus.size(); ++g) {
+        const ShmGpu& gpu = out.gpus[g];
+        if (gpu.gpuUtil != tag || gpu.memUtil != tag || gpu.temperature != tag || gpu.fanSpeed != tag ||
+            gpu.powerLimit != tag || gpu.coreClock != tag || gpu.memClock != tag || gpu.powerUsage != tag ||
+            gpu.totalMemory != tag || gpu.usedMemory != tag || std::string(gpu.uuid) != "GPU-" + std::to_string(tag)) {
+            return false;
+        }
+        const int64_t* timestamps = out.historyTimestamps(g);
+        for (size_t i = 0; i < gpu.historySize; ++i) {
+            if (timestamps[i] / 1000000 != static_cast<int64_t>(tag)) return false;
+            for (size_t m = 0; m < SHM_METRIC_COUNT; ++m) {
+                if (out.historyColumn(g, static_cast<ShmMetric>(m))[i] != static_cast<float>(tag)) return false;
+            }
+        }
+    }
+    for (const ShmProcess& process : out.processes) {
+        if (process.pid != tag || process.memoryUsed != tag || process.gpuUtil != tag) return false;
+    }
+    return true;
+}
+
+}
+
+// Metrics, processes and the newest raw history come out as they went in
+NVWINTOP_TEST(shm_round_trip) {
+    const auto snapshot = syntheticSnapshot(4, 150);
+    if (!CHECK(snapshot && snapshot->metrics.size() == 4)) return;
+
+    constexpr unsigned int CAPACITY = 120;
+    ShmPublisher publisher;
+    if (!CHECK(publisher.open(segmentName(), 8, 4096, CAPACITY))) return;
+    publisher.onSnapshot(*snapshot);
+
+    ShmReader reader;
+    if (!CHECK(reader.open(segmentName()))) return;
+    ShmSnapshot out;
+    if (!CHECK(reader.read(out))) return;
+    CHECK(out.timestampMs == snapshot->timestampMs);
+    CHECK(out.sampleCount == 1);
+    if (!CHECK(out.gpus.size() == snapshot->metrics.size())) return;
+    if (!CHECK(out.processes.size() == snapshot->processes.size())) return;
+
+    HistoryReader historyReader;
+    for (size_t g = 0; g < out.gpus.size(); ++g) {
+        const GpuMetrics& metrics = snapshot->metrics[g];
+        const ShmGpu& gpu = out.gpus[g];
+        CHECK(gpu.index == metrics.index);
+        CHECK(gpu.gpuUtil == metrics.gpuUtil);
+        CHECK(gpu.memUtil == metrics.memUtil);
+        CHECK(gpu.temperature == metrics.temperature);
+        CHECK(gpu.fanSpeed == metrics.fanSpeed);
+        CHECK(gpu.powerUsage == metrics.powerUsage);
+        CHECK(gpu.powerLimit == metrics.powerLimit);
+        CHECK(gpu.coreClock == metrics.coreClock);
+        CHECK(gpu.memClock == metrics.memClock);
+        CHECK(gpu.totalMemory == metrics.totalMemory);
+        CHECK(gpu.usedMemory == metrics.usedMemory);
+        CHECK(std::string(gpu.uuid) == metrics.uuid);
+        CHECK(std::string(gpu.name) == ascii(metrics.name));
+
+        // The newest CAPACITY samples of the raw tier, oldest first
+        const HistoryTier& tier = snapshot->history[g].tier(0);
+        if (!CHECK(gpu.historySize == std::min<size_t>(tier.size(), CAPACITY))) continue;
+        for (size_t m = 0; m < METRIC_COUNT; ++m) {
+            const HistoryWindow window = historyReader.read(tier, static_cast<Metric>(m), LLONG_MIN);
+            const size_t skip = window.avg.size - gpu.historySize;
+            if (m == 0) {
+                CHECK(memcmp(out.historyTimestamps(g), window.timestamps.data + skip, gpu.historySize * sizeof(int64_t)) == 0);
+            }
+            if (!CHECK(memcmp(out.historyColumn(g, static_cast<ShmMetric>(m)), window.avg.data + skip,
+                              gpu.historySize * sizeof(float)) == 0)) {
+                fprintf(stderr, "  gpu %zu metric %zu\n", g, m);
+            }
+        }
+    }
+
+    for (size_t p = 0; p < out.processes.size(); ++p) {
+        const ProcessInfo& process = snapshot->processes[p];
+        CHECK(out.processes[p].gpuIndex == process.gpuIndex);
+        CHECK(out.processes[p].pid == process.pid);
+        CHECK(out.processes[p].gpuUtil == process.gpuUtil);
+        CHECK(out.processes[p].memoryUsed == process.memoryUsed);
+        CHECK(std::string(out.processes[p].name) == ascii(process.name));
+    }
+
+    // Metrics-only reads leave the history out
+    CHECK(reader.read(out, false) && out.history.empty() && out.gpus.size() == 4);
+
+    // Devices beyond the segment's maximum are left out
+    ShmPublisher small;
+    if (!CHECK(small.open(segmentName(), 2, 1, CAPACITY))) return;
+    small.onSnapshot(*snapshot);
+    if (!CHECK(reader.open(segmentName()) && reader.read(out))) return;
+    CHECK(out.gpus.size() == 2);
+    CHECK(out.processes.size() == std::min<size_t>(snapshot->processes.size(), 1));
+
+    // Reads fail once the publisher has gone
+    small.close();
+    CHECK(!reader.read(out));
+}
+
+// A segment whose header does not describe this build's layout is refused on open
+NVWINTOP_TEST(shm_layout_mismatch) {
+    const std::string name = segmentName();
+    std::vector<uint8_t> good;
+    {
+        ShmPublisher publisher;
+        if (!CHECK(publisher.open(name, 4, 16, 8))) return;
+        SharedMemory published;
+        if (!CHECK(published.open(name))) return;
+        const auto* bytes = static_cast<const uint8_t*>(published.data());
+        good.assign(bytes, bytes + static_cast<const ShmHeader*>(published.data())->totalSize);
+    }
+
+    struct Damage {
+        const char* field;
+        std::function<void(ShmHeader&)> apply;
+    };
+    const Damage damages[] = {
+        { "none", [](ShmHeader&) {} },
+        { "magic", [](ShmHeader& h) { h.magic ^= 1; } },
+        { "version", [](ShmHeader& h) { h.version = SHM_VERSION + 1; } },
+        { "headerSize", [](ShmHeader& h) { h.headerSize -= 8; } },
+        { "gpuRecordSize", [](ShmHeader& h) { h.gpuRecordSize += 8; } },
+        { "processRecordSize", [](ShmHeader& h) { h.processRecordSize += 8; } },
+        { "metricCount", [](ShmHeader& h) { h.metricCount += 1; } },
+        { "totalSize", [](ShmHeader& h) { h.totalSize += 4096 * 1024; } },
+        { "gpusOffset", [](ShmHeader& h) { h.gpusOffset = 0; } },
+        { "maxGpus", [](ShmHeader& h) { h.maxGpus *= 1000; } },
+        { "processesOffset", [](ShmHeader& h) { h.processesOffset = h.totalSize - sizeof(ShmProcess); } },
+        { "historyOffset", [](ShmHeader& h) { h.historyOffset = ~0ULL - 8; } },
+        { "historyStride", [](ShmHeader& h) { h.historyStride = sizeof(int64_t); } },
+    };
+    for (const Damage& damage : damages) {
+        SharedMemory segment;
+        if (!CHECK(segment.create(name, good.size()))) return;
+        memcpy(segment.data(), good.data(), good.size());
+        damage.apply(*static_cast<ShmHeader*>(segment.data()));
+
+        ShmReader reader;
+        const bool opened = reader.open(name);
+        if (!CHECK(opened == (strcmp(damage.field, "none") == 0))) {
+            fprintf(stderr, "  damaged %s: %s\n", damage.field, opened ? "opened" : "refused");
+        }
+    }
+}
+
+// A writer republishing as fast as it can never hands a reader half of one
+// snapshot and half of another
+NVWINTOP_TEST(shm_concurrent_writer) {
+    constexpr unsigned int GPUS = 64;
+    constexpr unsigned int PROCESSES = 256;
+    constexpr unsigned int CAPACITY = 120;
+    const GpuSnapshot snapshots[] = { taggedSnapshot(1, GPUS, PROCESSES, CAPACITY),
+                                      taggedSnapshot(2, GPUS, PROCESSES, CAPACITY) };
+
+    ShmPublisher publisher;
+    if (!CHECK(publisher.open(segmentName(), GPUS, PROCESSES, CAPACITY))) return;
+    publisher.onSnapshot(snapshots[0]);
+    ShmReader reader;
+    if (!CHECK(reader.open(segmentName()))) return;
+
+    std::atomic<bool> stop(false);
+    std::thread writer([&] {
+        for (size_t i = 1; !stop.load(std::memory_order_relaxed); ++i) {
+            publisher.onSnapshot(snapshots[i % 2]);
+            std::this_thread::yield();
+        }
+    });
+
+    ShmSnapshot out;
+    unsigned long long reads = 0, torn = 0, seen[2] = {};
+    const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (std::chrono::steady_clock::now() < end) {
+        if (!reader.read(out)) continue;
+        ++reads;
+        if (!untorn(out, GPUS, PROCESSES) || (out.timestampMs != 1 && out.timestampMs != 2)) {
+            ++torn;
+        } else {
+            ++seen[out.timestampMs - 1];
+        }
+    }
+    stop = true;
+    writer.join();
+
+    if (!CHECK(torn == 0)) fprintf(stderr, "  %llu of %llu reads torn\n", torn, reads);
+    CHECK(reads > 0);
+    // Both snapshots were read, so the writer really was interleaved with the reads
+    if (!CHECK(seen[0] > 0 && seen[1] > 0)) fprintf(stderr, "  %llu reads: %llu of the first, %llu of the second, %llu retries\n", reads, seen[0], seen[1], reader.retries());
+}
@@ -0,0 +1,284 @@
+#include "test.hpp"
+#include "replay_source.hpp"
+#include "telemetry_reader.hpp"
+#include "telemetry_recorder.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const RECORDING = "nvwintop_test_recording.bin";
+const char* const CUT_RECORDING = "nvwintop_test_recording_cut.bin";
+
+constexpr long long START_MS = 1700000000000LL;
+constexpr size_t SAMPLES = 200;        // Four blocks of TELEMETRY_SAMPLES_PER_BLOCK, and a short one
+constexpr size_t DEVICE_CHANGE = 130;  // A third GPU appears mid-block
+
+long long sampleTime(size_t s) {
+    // Slightly irregular, as real ticks are
+    return START_MS + static_cast<long long>(s) * 1000 + static_cast<long long>(s % 7) * 3;
+}
+
+GpuSnapshot recordedSample(size_t s) {
+    GpuSnapshot snapshot;
+    snapshot.timestampMs = sampleTime(s);
+    const unsigned int devices = s < DEVICE_CHANGE ? 2 : 3;
+    for (unsigned int d = 0; d < devices; ++d) {
+        GpuMetrics metrics = {};
+        metrics.index = d;
+        metrics.uuid = "GPU-test-" + std::to_string(d);
+        metrics.name = L"Test GPU " + std::to_wstring(d);
+        metrics.totalMemory = (16ULL + d) << 30;
+        metrics.powerLimit = 250 + d * 50;
+        metrics.gpuUtil = static_cast<unsigned int>((s * 7 + d * 13) % 101);
+        metrics.memUtil = static_cast<unsigned int>((s * 3 + d) % 101);
+        metrics.temperature = static_cast<unsigned int>(40 + (s + d) % 45);
+        metrics.fanSpeed = static_cast<unsigned int>(30 + s % 60);
+        metrics.powerUsage = static_cast<double>(100000 + s * 137 + d * 1000) / 1000.0;
+        metrics.coreClock = static_cast<unsigned int>(1400 + (s * 11) % 600);
+        metrics.memClock = 9000 + d;
+        metrics.usedMemory = (static_cast<unsigned long long>(s % 16) + 1) << 28;
+        snapshot.metrics.push_back(metrics);
+    }
+    for (unsigned int p = 0; p < s % 5; ++p) {
+        snapshot.processes.push_back({ p % devices, static_cast<unsigned int>(1000 + (s / 10) * 4 + p),
+                                       L"proc" + std::to_wstring(p % 3), ((p + 1ULL) << 26) + s,
+                                       static_cast<unsigned int>((s + p) % 100) });
+    }
+    return snapshot;
+}
+
+bool record(const char* path) {
+    TelemetryRecorder recorder;
+    if (!recorder.open(path)) return false;
+    for (size_t s = 0; s < SAMPLES; ++s) recorder.append(recordedSample(s));
+    recorder.close();
+    return true;
+}
+
+struct ReplayedSample {
+    long long timestampMs = 0;
+    std::vector<DeviceInfo> devices;
+    std::vector<GpuMetrics> metrics;
+    std::vector<ProcessInfo> processes;  // Grouped by device
+};
+
+// Plays the source to its end as GpuMonitor does: a stale device list is
+// refreshed before the tick's devices are sampled
+std::vector<ReplayedSample> replay(ReplaySource& source) {
+    std::vector<ReplayedSample> samples;
+    for (;;) {
+        ReplayedSample sample;
+        const SampleStatus status = source.beginSample(sample.timestampMs);
+        if (status == SampleStatus::Failed) break;
+        if (status == SampleStatus::DeviceLost) source.refreshDevices();
+        sample.devices = source.devices();
+        sample.metrics.resize(sample.devices.size());
+        for (size_t d = 0; d < sample.devices.size(); ++d) {
+            std::vector<ProcessInfo> processes;
+            source.sampleDevice(d, sample.metrics[d], processes);
+            sample.processes.insert(sample.processes.end(), processes.begin(), processes.end());
+        }
+        samples.push_back(std::move(sample));
+    }
+    return samples;
+}
+
+// Everything recorded for sample s came back, exactly
+bool sameSample(const ReplayedSample& replayed, size_t s) {
+    const GpuSnapshot expected = recordedSample(s);
+    if (replayed.timestampMs != expected.timestampMs || replayed.devices.size() != expected.metrics.size()) return false;
+
+    std::vector<ProcessInfo> processes;
+    for (size_t d = 0; d < expected.metrics.size(); ++d) {
+        const GpuMetrics& want = expected.metrics[d];
+        const GpuMetrics& got = replayed.metrics[d];
+        const DeviceInfo& device = replayed.devices[d];
+        if (device.index != want.index || device.uuid != want.uuid || device.name != want.name ||
+            device.totalMemory != want.totalMemory || device.powerLimit != want.powerLimit) {
+            return false;
+        }
+        if (got.gpuUtil != want.gpuUtil || got.memUtil != want.memUtil || got.temperature != want.temperature ||
+            got.fanSpeed != want.fanSpeed || got.powerUsage != want.powerUsage || got.coreClock != want.coreClock ||
+            got.memClock != want.memClock || got.usedMemory != want.usedMemory) {
+            return false;
+        }
+        for (const ProcessInfo& process : expected.processes) {
+            if (process.gpuIndex == want.index) processes.push_back(process);
+        }
+    }
+
+    if (replayed.processes.size() != processes.size()) return false;
+    for (size_t p = 0; p < processes.size(); ++p) {
+        const ProcessInfo& a = replayed.processes[p];
+        const ProcessInfo& b = processes[p];
+        if (a.gpuIndex != b.gpuIndex || a.pid != b.pid || a.name != b.name || a.memoryUsed != b.memoryUsed ||
+            a.gpuUtil != b.gpuUtil) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks that the replay from sample first on matches the recording up to sample end
+void checkReplay(TestContext& context, const std::vector<ReplayedSample>& samples, size_t first, size_t end) {
+    if (!CHECK(samples.size() == end - first)) {
+        fprintf(stderr, "  replayed %zu samples, expected %zu\n", samples.size(), end - first);
+        return;
+    }
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (!CHECK(sameSample(samples[i], first + i))) {
+            fprintf(stderr, "  sample %zu\n", first + i);
+            return;
+        }
+    }
+}
+
+}
+
+// Every timestamp, counter, device and process row comes back exactly, across
+// block boundaries and a change of device set
+NVWINTOP_TEST(telemetry_round_trip) {
+    if (!CHECK(record(RECORDING))) return;
+
+    TelemetryReader reader;
+    if (!CHECK(reader.open(RECORDING))) return;
+    CHECK(!reader.indexRebuilt());
+    // The device change closes a block early
+    CHECK(reader.blockCount() == 5);
+    CHECK(reader.startTime() == sampleTime(0));
+    CHECK(reader.endTime() == sampleTime(SAMPLES - 1));
+
+    ReplaySource source(RECORDING);
+    if (!CHECK(source.initialize())) return;
+    CHECK(source.recordedIntervalMs() == 1000);
+    checkReplay(context, replay(source), 0, SAMPLES);
+    CHECK(source.finished());
+    std::remove(RECORDING);
+}
+
+// Seeking goes through the block index to the first sample at or after the
+// requested time, wherever it falls in its block
+NVWINTOP_TEST(telemetry_seek) {
+    if (!CHECK(record(RECORDING))) return;
+
+    TelemetryReader reader;
+    if (!CHECK(reader.open(RECORDING))) return;
+    for (size_t s = 0; s < SAMPLES; ++s) {
+        // The block findBlock picks must be the first one ending at or after the sample
+        const size_t block = reader.findBlock(sampleTime(s));
+        if (!CHECK(block < reader.blockCount() && reader.blockInfo(block).firstTimestampMs <= sampleTime(s) &&
+                   reader.blockInfo(block).lastTimestampMs >= sampleTime(s) &&
+                   (block == 0 || reader.blockInfo(block - 1).lastTimestampMs < sampleTime(s)))) {
+            fprintf(stderr, "  sample %zu in block %zu\n", s, block);
+            return;
+        }
+    }
+    CHECK(reader.findBlock(sampleTime(SAMPLES - 1) + 1) == reader.blockCount());
+
+    const size_t targets[] = { 0, 1, 59, 60, 61, 129, 130, 131, SAMPLES - 1 };
+    for (size_t target : targets) {
+        ReplaySource source(RECORDING);
+        if (!CHECK(source.initialize())) return;
+        if (!CHECK(source.seek(sampleTime(target)))) return;
+        checkReplay(context, replay(source), target, SAMPLES);
+
+        // Between two samples, playback picks up at the later one
+        if (target + 1 < SAMPLES) {
+            ReplaySource between(RECORDING);
+            if (!CHECK(between.initialize() && between.seek(sampleTime(target) + 1))) return;
+            checkReplay(context, replay(between), target + 1, SAMPLES);
+        }
+    }
+
+    ReplaySource early(RECORDING);
+    if (!CHECK(early.initialize() && early.seek(START_MS - 60000))) return;
+    checkReplay(context, replay(early), 0, SAMPLES);
+
+    ReplaySource late(RECORDING);
+    if (!CHECK(late.initialize())) return;
+    CHECK(!late.seek(sampleTime(SAMPLES - 1) + 1));
+    CHECK(late.finished());
+    std::remove(RECORDING);
+}
+
+// A recording cut short, without its index or mid-block, is still read: the
+// index is rebuilt from the complete blocks and the torn one is left out
+NVWINTOP_TEST(telemetry_rebuild_index) {
+    if (!CHECK(record(RECORDING))) return;
+
+    std::vector<uint8_t> bytes;
+    FILE* file = fopen(RECORDING, "rb");
+    if (!CHECK(file)) return;
+    uint8_t buffer[4096];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    fclose(file);
+
+    TelemetryReader reader;
+    if (!CHECK(reader.open(RECORDING))) return;
+    std::vector<TelemetryIndexEntry> blocks;
+    for (size_t b = 0; b < reader.blockCount(); ++b) blocks.push_back(reader.blockInfo(b));
+    const size_t indexOffset = bytes.size() - sizeof(TelemetryIndexTrailer) - blocks.size() * sizeof(TelemetryIndexEntry);
+    reader.close();
+
+    // Sample that starts each block, and the end of the recording
+    std::vector<size_t> blockStart;
+    for (size_t s = 0, b = 0; s < SAMPLES && b < blocks.size(); ++s) {
+        if (sampleTime(s) == blocks[b].firstTimestampMs) {
+            blockStart.push_back(s);
+            ++b;
+        }
+    }
+    blockStart.push_back(SAMPLES);
+    if (!CHECK(blockStart.size() == blocks.size() + 1)) return;
+
+    struct Cut {
+        size_t size;
+        size_t completeBlocks;
+    };
+    std::vector<Cut> cuts = { { indexOffset, blocks.size() } };
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        // Inside a block's header, and halfway through its payload
+        const size_t start = static_cast<size_t>(blocks[b].offset);
+        const size_t next = b + 1 < blocks.size() ? static_cast<size_t>(blocks[b + 1].offset) : indexOffset;
+        cuts.push_back({ start + sizeof(TelemetryBlockHeader) / 2, b });
+        cuts.push_back({ start + (next - start) / 2, b });
+    }
+    cuts.push_back({ indexOffset - 1, blocks.size() - 1 });
+
+    for (const Cut& cut : cuts) {
+        file = fopen(CUT_RECORDING, "wb");
+        if (!CHECK(file)) return;
+        fwrite(bytes.data(), 1, cut.size, file);
+        fclose(file);
+
+        TelemetryReader cutReader;
+        if (!CHECK(cutReader.open(CUT_RECORDING))) return;
+        CHECK(cutReader.indexRebuilt());
+        if (!CHECK(cutReader.blockCount() == cut.completeBlocks)) {
+            fprintf(stderr, "  cut at %zu of %zu bytes: %zu blocks\n", cut.size, bytes.size(), cutReader.blockCount());
+            continue;
+        }
+        for (size_t b = 0; b < cut.completeBlocks; ++b) {
+            const TelemetryIndexEntry entry = cutReader.blockInfo(b);
+            CHECK(entry.offset == blocks[b].offset && entry.firstTimestampMs == blocks[b].firstTimestampMs &&
+                  entry.lastTimestampMs == blocks[b].lastTimestampMs);
+        }
+
+        const size_t end = blockStart[cut.completeBlocks];
+        ReplaySource source(CUT_RECORDING);
+        if (!CHECK(source.initialize())) return;
+        checkReplay(context, replay(source), 0, end);
+
+        // Seeking works on the rebuilt index too
+        if (end > 70) {
+            ReplaySource seeking(CUT_RECORDING);
+            if (!CHECK(seeking.initialize() && seeking.seek(sampleTime(70)))) return;
+            checkReplay(context, replay(seeking), 70, end);
+        }
+    }
+    std::remove(RECORDING);
+    std::remove(CUT_RECORDING);
+}
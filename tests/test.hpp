@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+
+// Minimal test harness for nvwintop_tests. Tests register themselves with
+// NVWINTOP_TEST and fail through CHECK, which reports the expression and
+// carries on; test_main runs the ones matching the command-line filter and
+// exits non-zero if any check failed.
+class TestContext {
+public:
+    explicit TestContext(const char* test) : m_test(test) {}
+
+    bool check(bool passed, const char* expression, const char* file, int line) {
+        if (!passed) {
+            fprintf(stderr, "%s:%d: %s: CHECK(%s) failed\n", file, line, m_test, expression);
+            ++m_failures;
+        }
+        return passed;
+    }
+
+    const char* test() const { return m_test; }
+    int failures() const { return m_failures; }
+
+private:
+    const char* m_test;
+    int m_failures = 0;
+};
+
+using TestFunction = void (*)(TestContext&);
+
+struct Test {
+    const char* name;
+    TestFunction function;
+};
+
+inline std::vector<Test>& tests() {
+    static std::vector<Test> registry;
+    return registry;
+}
+
+struct TestRegistration {
+    TestRegistration(const char* name, TestFunction function) {
+        tests().push_back({ name, function });
+    }
+};
+
+#define NVWINTOP_TEST(name)                                                  \
+    static void test_##name(TestContext& context);                          \
+    static TestRegistration registration_##name(#name, &test_##name);       \
+    static void test_##name(TestContext& context)
+
+// True if cond holds, so a test can stop before using what failed
+#define CHECK(cond) context.check(static_cast<bool>(cond), #cond, __FILE__, __LINE__)
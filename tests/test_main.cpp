@@ -0,0 +1,29 @@
+#include "test.hpp"
+#include <cstring>
+
+int main(int argc, char** argv) {
+    // Arguments are substring filters on test names
+    int run = 0;
+    int failed = 0;
+    for (const Test& test : tests()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; ++i) {
+            selected = strstr(test.name, argv[i]) != nullptr;
+        }
+        if (!selected) continue;
+
+        TestContext context(test.name);
+        test.function(context);
+        printf("%-48s %s\n", test.name, context.failures() ? "FAILED" : "ok");
+        fflush(stdout);
+        ++run;
+        if (context.failures()) ++failed;
+    }
+
+    if (run == 0) {
+        fprintf(stderr, "No tests match the filter\n");
+        return 1;
+    }
+    printf("%d of %d tests passed\n", run - failed, run);
+    return failed ? 1 : 0;
+}